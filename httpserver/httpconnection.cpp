@@ -0,0 +1,280 @@
+/**
+  @file
+  @author Stefan Frings
+*/
+
+#include "httpconnection.h"
+#include "httpdispatcher.h"
+#ifndef QT_NO_OPENSSL
+    #include <QSslSocket>
+#endif
+
+/** Response data buffered between worker and socket before either waits */
+static const int WATERMARK=256*1024;
+
+/** How many complete requests a client may pipeline ahead of the responses */
+static const int MAX_PIPELINED=16;
+
+HttpResponseStream::HttpResponseStream(QObject* connection, int timeout)
+    : QIODevice()
+{
+    this->connection=connection;
+    this->timeout=timeout;
+    aborted=false;
+    closing=false;
+    open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+}
+
+qint64 HttpResponseStream::writeData(const char* data, qint64 len) {
+    mutex.lock();
+    if (aborted) {
+        mutex.unlock();
+        return -1;
+    }
+    bool wasEmpty=buffer.isEmpty();
+    buffer.append(data,len);
+    mutex.unlock();
+
+    // let the connection know there is something to send
+    if (wasEmpty) {
+        QMetaObject::invokeMethod(connection,"drain",Qt::QueuedConnection);
+    }
+    return len;
+}
+
+bool HttpResponseStream::waitForBytesWritten(int) {
+    QMutexLocker locker(&mutex);
+    while (buffer.size()>=WATERMARK && !aborted) {
+        // the client isn't reading
+        if (!drained.wait(&mutex,timeout)) {
+            aborted=true;
+        }
+    }
+    return !aborted;
+}
+
+QByteArray HttpResponseStream::take() {
+    QMutexLocker locker(&mutex);
+    QByteArray data=buffer;
+    buffer.clear();
+    drained.wakeAll();
+    return data;
+}
+
+void HttpResponseStream::abort() {
+    QMutexLocker locker(&mutex);
+    aborted=true;
+    drained.wakeAll();
+}
+
+bool HttpResponseStream::isAborted() const {
+    QMutexLocker locker(&mutex);
+    return aborted;
+}
+
+bool HttpResponseStream::isClosing() const {
+    QMutexLocker locker(&mutex);
+    return closing;
+}
+
+void HttpResponseStream::close() {
+    // the device stays open, the connection closes once it has sent everything
+    QMutexLocker locker(&mutex);
+    closing=true;
+}
+
+
+HttpConnection::HttpConnection(HttpDispatcher* dispatcher, QObject* parent)
+    : QObject(parent)
+{
+    this->dispatcher=dispatcher;
+    socket=NULL;
+    currentRequest=NULL;
+    servingRequest=NULL;
+    stream=NULL;
+    closeAfter=false;
+    rejected=false;
+    dead=false;
+
+    timer.setSingleShot(true);
+    connect(&timer, SIGNAL(timeout()), SLOT(timeout()));
+}
+
+
+HttpConnection::~HttpConnection() {
+    // if the loop is stopping the dispatcher has already waited for the workers
+    delete currentRequest;
+    delete servingRequest;
+    delete stream;
+    qDeleteAll(queue);
+    delete socket;
+    dispatcher->closed(this);
+}
+
+
+bool HttpConnection::open(tSocketDescriptor socketDescriptor) {
+    // If SSL is supported and configured, then create an instance of QSslSocket
+    #ifndef QT_NO_OPENSSL
+        if (dispatcher->sslConfiguration()) {
+            QSslSocket* sslSocket=new QSslSocket();
+            sslSocket->setSslConfiguration(*dispatcher->sslConfiguration());
+            socket=sslSocket;
+        }
+    #endif
+    if (!socket) {
+        socket=new QTcpSocket();
+    }
+
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qCritical("HttpConnection (%p): cannot initialize socket: %s", this,qPrintable(socket->errorString()));
+        return false;
+    }
+
+    // don't buffer more than we are prepared to process, the client
+    // will be held back by tcp flow control when we stop reading
+    socket->setReadBufferSize(WATERMARK);
+
+    connect(socket, SIGNAL(readyRead()), SLOT(read()));
+    connect(socket, SIGNAL(bytesWritten(qint64)), SLOT(drain()));
+    connect(socket, SIGNAL(disconnected()), SLOT(disconnected()));
+
+    #ifndef QT_NO_OPENSSL
+        // Switch on encryption, if SSL is configured
+        if (dispatcher->sslConfiguration()) {
+            ((QSslSocket*)socket)->startServerEncryption();
+        }
+    #endif
+
+    timer.start(dispatcher->readTimeout());
+    return true;
+}
+
+
+void HttpConnection::read() {
+    // The loop adds support for HTTP pipelining, up to a point
+    while (socket->bytesAvailable() && queue.count()<MAX_PIPELINED && !rejected && !dead) {
+
+        // Create new HttpRequest object if necessary
+        if (!currentRequest) {
+            currentRequest=new HttpRequest(dispatcher->maxRequestSize(),dispatcher->maxMultiPartSize());
+        }
+
+        // Collect data for the request object
+        while (socket->bytesAvailable() && currentRequest->getStatus()!=HttpRequest::complete && currentRequest->getStatus()!=HttpRequest::abort) {
+            currentRequest->readFromSocket(socket);
+        }
+
+        // Too large, we answer once those before it have been
+        if (currentRequest->getStatus()==HttpRequest::abort) {
+            delete currentRequest;
+            currentRequest=NULL;
+            rejected=true;
+        }
+
+        // Queue it up, they are answered in order
+        else if (currentRequest->getStatus()==HttpRequest::complete) {
+            queue.enqueue(currentRequest);
+            currentRequest=NULL;
+        }
+    }
+
+    // a request is arriving, restart the timeout
+    if (!stream && !dead) {
+        timer.start(dispatcher->readTimeout());
+    }
+
+    next();
+}
+
+
+void HttpConnection::next() {
+    // one at a time, the responses must go back in order
+    if (stream || dead) return;
+
+    if (queue.isEmpty()) {
+        if (rejected) {
+            socket->write("HTTP/1.1 413 entity too large\r\nConnection: close\r\n\r\n413 Entity too large\r\n");
+            socket->disconnectFromHost();
+        }
+        return;
+    }
+
+    // no room, we will be resumed
+    if (!dispatcher->acquire(this)) return;
+
+    timer.stop();
+    servingRequest=queue.dequeue();
+
+    // HTTP/1.0 clients can't take chunks, and need the close to see the end of the body
+    closeAfter=servingRequest->getVersion()!="HTTP/1.1" || QString::compare(servingRequest->getHeader("Connection"),"close",Qt::CaseInsensitive)==0;
+
+    stream=new HttpResponseStream(this,dispatcher->readTimeout());
+    dispatcher->dispatch(this,servingRequest,stream,closeAfter);
+}
+
+
+void HttpConnection::resume() {
+    next();
+}
+
+
+void HttpConnection::drain() {
+    if (!stream || dead) return;
+
+    // the socket will tell us when it has written some more
+    if (socket->bytesToWrite()>=WATERMARK) return;
+
+    QByteArray data=stream->take();
+    if (data.size()) {
+        socket->write(data);
+    }
+}
+
+
+void HttpConnection::served() {
+    // the worker has finished with the stream, whatever is left can go
+    QByteArray data=stream->take();
+    if (data.size() && !dead) {
+        socket->write(data);
+    }
+    bool closing=closeAfter || stream->isClosing() || stream->isAborted();
+
+    delete servingRequest;
+    servingRequest=NULL;
+    delete stream;
+    stream=NULL;
+
+    if (dead) {
+        deleteLater();
+        return;
+    }
+
+    // the rest is sent before the connection closes
+    if (closing) {
+        socket->disconnectFromHost();
+        return;
+    }
+
+    // Start timer for next request, and carry on with any pipelined
+    timer.start(dispatcher->readTimeout());
+    read();
+}
+
+
+void HttpConnection::timeout() {
+    socket->disconnectFromHost();
+}
+
+
+void HttpConnection::disconnected() {
+    dead=true;
+    timer.stop();
+
+    // wait for the worker to notice
+    if (stream) {
+        stream->abort();
+    }
+    else {
+        deleteLater();
+    }
+}
@@ -0,0 +1,160 @@
+/**
+  @file
+  @author Stefan Frings
+*/
+
+#ifndef HTTPCONNECTION_H
+#define HTTPCONNECTION_H
+
+#include <QIODevice>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+#include "httpglobal.h"
+#include "httprequest.h"
+#include "httpconnectionhandler.h"
+
+class HttpDispatcher;
+
+/**
+  Carries a response from the worker thread that generates it to the
+  connection that sends it. HttpResponse writes to it as if it were the
+  socket, and blocks in waitForBytesWritten() whilst the connection has
+  not yet passed enough of it on to the socket, so a slow client holds
+  up the worker rather than the response piling up in memory.
+  <p>
+  If the client stops reading for longer than the timeout, or goes away,
+  the stream is aborted and further writes fail.
+*/
+class DECLSPEC HttpResponseStream : public QIODevice {
+    Q_DISABLE_COPY(HttpResponseStream)
+
+public:
+
+    /**
+      Constructor.
+      @param connection Receives the drain() signal when there is data to send
+      @param timeout Maximum time in milliseconds to wait for the client to read
+    */
+    HttpResponseStream(QObject* connection, int timeout);
+
+    /** Take everything written so far, called by the connection */
+    QByteArray take();
+
+    /** Give up, writes will fail from now on */
+    void abort();
+
+    /** True if aborted */
+    bool isAborted() const;
+
+    /** True if the response asked for the connection to be closed */
+    bool isClosing() const;
+
+    /** Called by HttpResponse when the body ends with the connection */
+    void close();
+
+    /** Block until there is room for more, or the stream is aborted */
+    bool waitForBytesWritten(int msecs);
+
+    /** Write only, and no seeking */
+    bool isSequential() const { return true; }
+
+protected:
+
+    qint64 readData(char*, qint64) { return -1; }
+    qint64 writeData(const char* data, qint64 len);
+
+private:
+
+    QObject* connection;
+    int timeout;
+
+    mutable QMutex mutex;
+    QWaitCondition drained;
+    QByteArray buffer;
+    bool aborted;
+    bool closing;
+};
+
+/**
+  A single client connection in the event driven server. Lives in one of the
+  HttpEventLoop threads and never blocks; requests are read as the data arrives
+  and, once complete, are handed to the HttpDispatcher to be served on a worker
+  thread. HTTP/1.1 connections are kept alive between requests and pipelined
+  requests are queued and answered in order, one at a time.
+  <p>
+  When the dispatcher has no room for more requests the connection stops
+  reading until it is resumed, so TCP flow control pushes back on the client.
+*/
+class DECLSPEC HttpConnection : public QObject {
+    Q_OBJECT
+    Q_DISABLE_COPY(HttpConnection)
+
+public:
+
+    /**
+      Constructor.
+      @param dispatcher Serves the requests and holds the settings
+      @param parent The event loop this connection lives in
+    */
+    HttpConnection(HttpDispatcher* dispatcher, QObject* parent);
+
+    /** Destructor */
+    virtual ~HttpConnection();
+
+    /**
+      Start using the accepted connection.
+      @return false if the socket could not be set up
+    */
+    bool open(tSocketDescriptor socketDescriptor);
+
+public slots:
+
+    /** Received from the dispatcher when it can take another request */
+    void resume();
+
+    /** Received from the worker when the current request has been served */
+    void served();
+
+    /** Received from the response stream, or the socket, to send what we can */
+    void drain();
+
+private slots:
+
+    /** Received from the socket when incoming data can be read */
+    void read();
+
+    /** Received from the socket when a connection has been closed */
+    void disconnected();
+
+    /** Received from the timer when the connection has been idle too long */
+    void timeout();
+
+private:
+
+    /** Serve the next queued request, if we can */
+    void next();
+
+    HttpDispatcher* dispatcher;
+    QTcpSocket* socket;
+    QTimer timer;
+
+    /** The request being read, complete requests waiting and the one being served */
+    HttpRequest* currentRequest;
+    QQueue<HttpRequest*> queue;
+    HttpRequest* servingRequest;
+    HttpResponseStream* stream;
+
+    /** close when the current response is complete */
+    bool closeAfter;
+
+    /** a request was too large, reject once those before it have been answered */
+    bool rejected;
+
+    /** the client has gone, waiting for the worker to finish */
+    bool dead;
+};
+
+#endif // HTTPCONNECTION_H
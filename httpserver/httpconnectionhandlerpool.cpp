@@ -13,8 +13,7 @@ HttpConnectionHandlerPool::HttpConnectionHandlerPool(QSettings* settings, HttpRe
     Q_ASSERT(settings!=0);
     this->settings=settings;
     this->requestHandler=requestHandler;
-    this->sslConfiguration=NULL;
-    loadSslConfig();
+    this->sslConfiguration=loadSslConfig(settings);
     cleanupTimer.start(settings->value("cleanupInterval",1000).toInt());
     connect(&cleanupTimer, SIGNAL(timeout()), SLOT(cleanup()));
 }
@@ -73,7 +72,8 @@ void HttpConnectionHandlerPool::cleanup() {
 }
 
 
-void HttpConnectionHandlerPool::loadSslConfig() {
+QSslConfiguration* HttpConnectionHandlerPool::loadSslConfig(QSettings* settings) {
+    QSslConfiguration* sslConfiguration=NULL;
     // If certificate and key files are configured, then load them
     QString sslKeyFileName=settings->value("sslKeyFile","").toString();
     QString sslCertFileName=settings->value("sslCertFile","").toString();
@@ -104,7 +104,7 @@ void HttpConnectionHandlerPool::loadSslConfig() {
             QFile certFile(sslCertFileName);
             if (!certFile.open(QIODevice::ReadOnly)) {
                 qCritical("HttpConnectionHandlerPool: cannot open sslCertFile %s", qPrintable(sslCertFileName));
-                return;
+                return NULL;
             }
             QSslCertificate certificate(&certFile, QSsl::Pem);
             certFile.close();
@@ -113,7 +113,7 @@ void HttpConnectionHandlerPool::loadSslConfig() {
             QFile keyFile(sslKeyFileName);
             if (!keyFile.open(QIODevice::ReadOnly)) {
                 qCritical("HttpConnectionHandlerPool: cannot open sslKeyFile %s", qPrintable(sslKeyFileName));
-                return;
+                return NULL;
             }
             QSslKey sslKey(&keyFile, QSsl::Rsa, QSsl::Pem);
             keyFile.close();
@@ -128,4 +128,5 @@ void HttpConnectionHandlerPool::loadSslConfig() {
             wDebug("HttpConnectionHandlerPool: SSL settings loaded");
          #endif
     }
+    return sslConfiguration;
 }
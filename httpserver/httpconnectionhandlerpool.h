@@ -62,6 +62,12 @@ public:
     /** Get a free connection handler, or 0 if not available. */
     HttpConnectionHandler* getConnectionHandler();
 
+    /**
+      Load the SSL configuration (certificate and key) from the settings.
+      @return the configuration, or 0 if SSL is not configured or supported
+    */
+    static QSslConfiguration* loadSslConfig(QSettings* settings);
+
 private:
 
     /** Settings for this pool */
@@ -82,9 +88,6 @@ private:
     /** The SSL configuration (certificate, key and other settings) */
     QSslConfiguration* sslConfiguration;
 
-    /** Load SSL configuration */
-    void loadSslConfig();
-
 private slots:
 
     /** Received from the clean-up timer.  */
@@ -0,0 +1,149 @@
+/**
+  @file
+  @author Stefan Frings
+*/
+
+#include "httpdispatcher.h"
+#include "httpeventloop.h"
+#include "httpconnection.h"
+#include "httpconnectionhandlerpool.h"
+#include "httpresponse.h"
+#include <QRunnable>
+
+/** Serves a single request on a worker thread */
+class HttpWorker : public QRunnable {
+public:
+    HttpWorker(HttpDispatcher* dispatcher, HttpRequestHandler* requestHandler, HttpConnection* connection,
+               HttpRequest* request, HttpResponseStream* stream, bool close)
+        : dispatcher(dispatcher), requestHandler(requestHandler), connection(connection),
+          request(request), stream(stream), close(close) {}
+
+    void run() {
+        HttpResponse response(stream);
+        if (close) {
+            response.setHeader("Connection","close");
+        }
+        try {
+            requestHandler->service(*request, response);
+        }
+        catch (...) {
+            qCritical("HttpWorker (%p): An uncatched exception occured in the request handler",this);
+        }
+
+        // Finalize sending the response if not already done
+        if (!response.hasSentLastPart()) {
+            response.write(QByteArray(),true);
+        }
+
+        // the connection can have the request and stream back
+        QMetaObject::invokeMethod(connection,"served",Qt::QueuedConnection);
+        dispatcher->release();
+    }
+
+private:
+    HttpDispatcher* dispatcher;
+    HttpRequestHandler* requestHandler;
+    HttpConnection* connection;
+    HttpRequest* request;
+    HttpResponseStream* stream;
+    bool close;
+};
+
+
+HttpDispatcher::HttpDispatcher(QSettings* settings, HttpRequestHandler* requestHandler)
+    : QObject()
+{
+    Q_ASSERT(settings!=0);
+    Q_ASSERT(requestHandler!=0);
+    this->requestHandler=requestHandler;
+
+    // read once, not for every request
+    readTimeout_=settings->value("readTimeout",10000).toInt();
+    maxRequestSize_=settings->value("maxRequestSize","16000").toInt();
+    maxMultiPartSize_=settings->value("maxMultiPartSize","1000000").toInt();
+    maxConnections=settings->value("maxConnections",1000).toInt();
+    sslConfiguration_=HttpConnectionHandlerPool::loadSslConfig(settings);
+
+    int threads=qMax(1,settings->value("workerThreads",QThread::idealThreadCount()).toInt());
+    workers.setMaxThreadCount(threads);
+    maxInflight=threads+qMax(0,settings->value("maxQueuedRequests",64).toInt());
+    inflight=0;
+    closing=false;
+
+    int eventThreads=qMax(1,settings->value("eventThreads",2).toInt());
+    for (int i=0; i<eventThreads; i++) {
+        loops.append(new HttpEventLoop(this));
+    }
+    nextLoop=0;
+    wDebug("HttpDispatcher (%p): %d event loops, %d workers", this, eventThreads, threads);
+}
+
+
+HttpDispatcher::~HttpDispatcher() {
+    // no more requests, let those in progress finish
+    mutex.lock();
+    closing=true;
+    waiting.clear();
+    mutex.unlock();
+    workers.waitForDone();
+
+    // stopping the loops closes the connections
+    qDeleteAll(loops);
+    loops.clear();
+    delete sslConfiguration_;
+    wDebug("HttpDispatcher (%p): destroyed", this);
+}
+
+
+bool HttpDispatcher::handleConnection(tSocketDescriptor socketDescriptor) {
+    if (connections.fetchAndAddOrdered(1)>=maxConnections) {
+        connections.fetchAndAddOrdered(-1);
+        return false;
+    }
+
+    // The descriptor is passed via a queued call because the loop lives in another
+    // thread and cannot open the socket when directly called by another thread.
+    HttpEventLoop* loop=loops[nextLoop++ % loops.count()];
+    QMetaObject::invokeMethod(loop,"handleConnection",Qt::QueuedConnection,Q_ARG(tSocketDescriptor,socketDescriptor));
+    return true;
+}
+
+
+bool HttpDispatcher::acquire(HttpConnection* connection) {
+    QMutexLocker locker(&mutex);
+    if (closing) {
+        return false;
+    }
+    if (inflight<maxInflight) {
+        inflight++;
+        return true;
+    }
+    if (!waiting.contains(connection)) {
+        waiting.append(connection);
+    }
+    return false;
+}
+
+
+void HttpDispatcher::dispatch(HttpConnection* connection, HttpRequest* request, HttpResponseStream* stream, bool close) {
+    workers.start(new HttpWorker(this,requestHandler,connection,request,stream,close));
+}
+
+
+void HttpDispatcher::release() {
+    QMutexLocker locker(&mutex);
+    inflight--;
+
+    // first come first served, it will try to acquire again
+    if (!waiting.isEmpty()) {
+        QMetaObject::invokeMethod(waiting.takeFirst(),"resume",Qt::QueuedConnection);
+    }
+}
+
+
+void HttpDispatcher::closed(HttpConnection* connection) {
+    mutex.lock();
+    waiting.removeAll(connection);
+    mutex.unlock();
+    connections.fetchAndAddOrdered(-1);
+}
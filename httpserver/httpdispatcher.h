@@ -0,0 +1,119 @@
+/**
+  @file
+  @author Stefan Frings
+*/
+
+#ifndef HTTPDISPATCHER_H
+#define HTTPDISPATCHER_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThreadPool>
+#include <QSettings>
+#include "httpglobal.h"
+#include "httpconnectionhandler.h"
+#include "httprequesthandler.h"
+
+class HttpEventLoop;
+class HttpConnection;
+class HttpResponseStream;
+
+/**
+  The event driven alternative to the HttpConnectionHandlerPool. Rather than a
+  thread for every connection, a few HttpEventLoop threads look after all of the
+  connections and the requests they receive are served by a bounded pool of
+  worker threads. Connections are kept alive and requests may be pipelined.
+  <p>
+  Once the workers are busy and the queue of requests waiting for them is full,
+  connections stop reading until there is room again.
+  <p>
+  Example for the configuration settings:
+  <code><pre>
+  mode=events
+  eventThreads=2
+  workerThreads=4
+  maxQueuedRequests=64
+  maxConnections=1000
+  readTimeout=60000
+  ;sslKeyFile=ssl/my.key
+  ;sslCertFile=ssl/my.cert
+  maxRequestSize=16000
+  maxMultiPartSize=1000000
+  </pre></code>
+  The settings are read once, when the dispatcher is created. The readTimeout is
+  how long an idle connection is kept alive, and how long a response will wait
+  for a client that is not reading. The default for workerThreads is one per core.
+  @see HttpConnectionHandlerPool for the ssl settings
+  @see HttpRequest for description of config settings maxRequestSize and maxMultiPartSize
+*/
+class DECLSPEC HttpDispatcher : public QObject {
+    Q_OBJECT
+    Q_DISABLE_COPY(HttpDispatcher)
+
+public:
+
+    /**
+      Constructor.
+      @param settings Configuration settings for the HTTP server. Must not be 0.
+      @param requestHandler The handler that will process each received HTTP request.
+    */
+    HttpDispatcher(QSettings* settings, HttpRequestHandler* requestHandler);
+
+    /** Destructor, waits for the requests being served then closes all connections */
+    virtual ~HttpDispatcher();
+
+    /**
+      Pass a new connection to one of the event loops.
+      @return false if there are too many connections already
+    */
+    bool handleConnection(tSocketDescriptor socketDescriptor);
+
+    /**
+      Reserve room for a request, or remember to resume the connection when
+      there is some. Thread safe.
+    */
+    bool acquire(HttpConnection* connection);
+
+    /**
+      Serve a request on a worker thread, room must have been acquired.
+      The connection gets served() when done, and must not delete the
+      request or stream until then.
+    */
+    void dispatch(HttpConnection* connection, HttpRequest* request, HttpResponseStream* stream, bool close);
+
+    /** A request has been served, called by the worker. Thread safe. */
+    void release();
+
+    /** A connection has gone. Thread safe. */
+    void closed(HttpConnection* connection);
+
+    /** Settings, as read when constructed */
+    int readTimeout() const { return readTimeout_; }
+    int maxRequestSize() const { return maxRequestSize_; }
+    int maxMultiPartSize() const { return maxMultiPartSize_; }
+    QSslConfiguration* sslConfiguration() const { return sslConfiguration_; }
+
+private:
+
+    HttpRequestHandler* requestHandler;
+
+    int readTimeout_, maxRequestSize_, maxMultiPartSize_;
+    int maxConnections;
+    QSslConfiguration* sslConfiguration_;
+
+    /** The event loops, connections are shared round robin */
+    QList<HttpEventLoop*> loops;
+    int nextLoop;
+    QAtomicInt connections;
+
+    /** Workers, the requests being served and waiting, and connections waiting for room */
+    QThreadPool workers;
+    QMutex mutex;
+    int inflight, maxInflight;
+    QList<HttpConnection*> waiting;
+    bool closing;
+};
+
+#endif // HTTPDISPATCHER_H
@@ -0,0 +1,51 @@
+/**
+  @file
+  @author Stefan Frings
+*/
+
+#include "httpeventloop.h"
+#include "httpconnection.h"
+#include "httpdispatcher.h"
+
+HttpEventLoop::HttpEventLoop(HttpDispatcher* dispatcher)
+    : QThread()
+{
+    Q_ASSERT(dispatcher!=0);
+    this->dispatcher=dispatcher;
+
+    // execute signals in my own thread
+    moveToThread(this);
+
+    wDebug("HttpEventLoop (%p): constructed", this);
+    this->start();
+}
+
+
+HttpEventLoop::~HttpEventLoop() {
+    quit();
+    wait();
+    wDebug("HttpEventLoop (%p): destroyed", this);
+}
+
+
+void HttpEventLoop::run() {
+    wDebug("HttpEventLoop (%p): thread started", this);
+    try {
+        exec();
+    }
+    catch (...) {
+        qCritical("HttpEventLoop (%p): an uncatched exception occured in the thread",this);
+    }
+
+    // connections must be deleted in the thread their sockets belong to
+    qDeleteAll(findChildren<HttpConnection*>());
+    wDebug("HttpEventLoop (%p): thread stopped", this);
+}
+
+
+void HttpEventLoop::handleConnection(tSocketDescriptor socketDescriptor) {
+    HttpConnection* connection=new HttpConnection(dispatcher,this);
+    if (!connection->open(socketDescriptor)) {
+        delete connection;
+    }
+}
@@ -0,0 +1,54 @@
+/**
+  @file
+  @author Stefan Frings
+*/
+
+#ifndef HTTPEVENTLOOP_H
+#define HTTPEVENTLOOP_H
+
+#include <QThread>
+#include "httpglobal.h"
+#include "httpconnectionhandler.h"
+
+class HttpDispatcher;
+
+/**
+  A thread running an event loop that looks after many HttpConnections at
+  once. The dispatcher starts a small, fixed number of these and shares the
+  incoming connections between them.
+  <p>
+  When the thread stops, the connections still open are closed.
+*/
+class DECLSPEC HttpEventLoop : public QThread {
+    Q_OBJECT
+    Q_DISABLE_COPY(HttpEventLoop)
+
+public:
+
+    /**
+      Constructor.
+      @param dispatcher Serves the requests received by the connections
+    */
+    HttpEventLoop(HttpDispatcher* dispatcher);
+
+    /** Destructor, stops the thread */
+    virtual ~HttpEventLoop();
+
+private:
+
+    HttpDispatcher* dispatcher;
+
+    /** Executes the threads own event loop */
+    void run();
+
+public slots:
+
+    /**
+      Received from the dispatcher to look after a new connection.
+      @param socketDescriptor references the accepted connection.
+    */
+    void handleConnection(tSocketDescriptor socketDescriptor);
+
+};
+
+#endif // HTTPEVENTLOOP_H
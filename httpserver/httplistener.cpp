@@ -8,14 +8,16 @@
 #include "httpconnectionhandlerpool.h"
 #include <QCoreApplication>
 
-HttpListener::HttpListener(QSettings* settings, HttpRequestHandler* requestHandler, QObject *parent)
+HttpListener::HttpListener(QSettings* settings, HttpRequestHandler* requestHandler, QObject *parent, QString mode)
     : QTcpServer(parent)
 {
     Q_ASSERT(settings!=0);
     Q_ASSERT(requestHandler!=0);
     pool=NULL;
+    dispatcher=NULL;
     this->settings=settings;
     this->requestHandler=requestHandler;
+    this->mode=mode.isEmpty() ? settings->value("mode","threads").toString() : mode;
     // Reqister type of socketDescriptor for signal/slot handling
     qRegisterMetaType<tSocketDescriptor>("tSocketDescriptor");
     // Start listening
@@ -30,8 +32,13 @@ HttpListener::~HttpListener() {
 
 
 void HttpListener::listen() {
-    if (!pool) {
-        pool=new HttpConnectionHandlerPool(settings,requestHandler);
+    if (!pool && !dispatcher) {
+        if (mode=="events") {
+            dispatcher=new HttpDispatcher(settings,requestHandler);
+        }
+        else {
+            pool=new HttpConnectionHandlerPool(settings,requestHandler);
+        }
     }
     QString host = settings->value("host").toString();
     int port=settings->value("port").toInt();
@@ -52,6 +59,10 @@ void HttpListener::close() {
         delete pool;
         pool=NULL;
     }
+    if (dispatcher) {
+        delete dispatcher;
+        dispatcher=NULL;
+    }
 }
 
 void HttpListener::incomingConnection(tSocketDescriptor socketDescriptor) {
@@ -59,6 +70,13 @@ void HttpListener::incomingConnection(tSocketDescriptor socketDescriptor) {
     wDebug("HttpListener: New connection");
 #endif
 
+    if (dispatcher) {
+        if (!dispatcher->handleConnection(socketDescriptor)) {
+            reject(socketDescriptor);
+        }
+        return;
+    }
+
     HttpConnectionHandler* freeHandler=NULL;
     if (pool) {
         freeHandler=pool->getConnectionHandler();
@@ -73,12 +91,16 @@ void HttpListener::incomingConnection(tSocketDescriptor socketDescriptor) {
         disconnect(this,SIGNAL(handleConnection(tSocketDescriptor)),freeHandler,SLOT(handleConnection(tSocketDescriptor)));
     }
     else {
-        // Reject the connection
-        wDebug("HttpListener: Too many incoming connections");
-        QTcpSocket* socket=new QTcpSocket(this);
-        socket->setSocketDescriptor(socketDescriptor);
-        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
-        socket->write("HTTP/1.1 503 too many connections\r\nConnection: close\r\n\r\nToo many connections\r\n");
-        socket->disconnectFromHost();
+        reject(socketDescriptor);
     }
 }
+
+void HttpListener::reject(tSocketDescriptor socketDescriptor) {
+    // Reject the connection
+    wDebug("HttpListener: Too many incoming connections");
+    QTcpSocket* socket=new QTcpSocket(this);
+    socket->setSocketDescriptor(socketDescriptor);
+    connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    socket->write("HTTP/1.1 503 too many connections\r\nConnection: close\r\n\r\nToo many connections\r\n");
+    socket->disconnectFromHost();
+}
@@ -12,6 +12,7 @@
 #include "httpglobal.h"
 #include "httpconnectionhandler.h"
 #include "httpconnectionhandlerpool.h"
+#include "httpdispatcher.h"
 #include "httprequesthandler.h"
 
 /**
@@ -31,10 +32,15 @@
   maxRequestSize=16000
   maxMultiPartSize=1000000
   </pre></code>
+  The optional mode parameter selects how connections are handled, "threads" (the
+  default) uses a thread per connection and "events" uses a few event loop threads
+  for all of the connections with a separate pool of workers to serve the requests.
+  <p>
   The optional host parameter binds the listener to one network interface.
   The listener handles all network interfaces if no host is configured.
   The port number specifies the incoming TCP port that this listener listens to.
   @see HttpConnectionHandlerPool for description of config settings minThreads, maxThreads, cleanupInterval and ssl settings
+  @see HttpDispatcher for description of the config settings used in events mode
   @see HttpConnectionHandler for description of the readTimeout
   @see HttpRequest for description of config settings maxRequestSize and maxMultiPartSize
 */
@@ -50,9 +56,10 @@ public:
       @param settings Configuration settings for the HTTP server. Must not be 0.
       @param requestHandler Processes each received HTTP request, usually by dispatching to controller classes.
       @param parent Parent object.
+      @param mode Overrides the mode in the settings when not empty, without changing them.
       @warning Ensure to close or delete the listener before deleting the request handler.
     */
-    HttpListener(QSettings* settings, HttpRequestHandler* requestHandler, QObject* parent = NULL);
+    HttpListener(QSettings* settings, HttpRequestHandler* requestHandler, QObject* parent = NULL, QString mode = QString());
 
     /** Destructor */
     virtual ~HttpListener();
@@ -78,12 +85,21 @@ private:
     /** Configuration settings for the HTTP server */
     QSettings* settings;
 
+    /** Connection handling, "threads" or "events" */
+    QString mode;
+
     /** Point to the reuqest handler which processes all HTTP requests */
     HttpRequestHandler* requestHandler;
 
     /** Pool of connection handlers */
     HttpConnectionHandlerPool* pool;
 
+    /** Event loops and workers, instead of the pool */
+    HttpDispatcher* dispatcher;
+
+    /** Turn a connection away when we have too many */
+    void reject(tSocketDescriptor socketDescriptor);
+
 signals:
 
     /**
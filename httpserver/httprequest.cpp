@@ -16,6 +16,14 @@ HttpRequest::HttpRequest(QSettings* settings) {
     maxMultiPartSize=settings->value("maxMultiPartSize","1000000").toInt();
 }
 
+HttpRequest::HttpRequest(int maxRequestSize, int maxMultiPartSize) {
+    status=waitForRequest;
+    currentSize=0;
+    expectedBodySize=0;
+    maxSize=maxRequestSize;
+    this->maxMultiPartSize=maxMultiPartSize;
+}
+
 void HttpRequest::readRequest(QTcpSocket* socket) {
     #ifdef SUPERVERBOSE
         wDebug("HttpRequest: read request");
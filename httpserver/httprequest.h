@@ -47,6 +47,13 @@ public:
     */
     HttpRequest(QSettings* settings);
 
+    /**
+      Constructor, with the limits already read from the settings.
+      @param maxRequestSize Maximum size of the request
+      @param maxMultiPartSize Maximum size of a multipart/form-data body
+    */
+    HttpRequest(int maxRequestSize, int maxMultiPartSize);
+
     /**
       Destructor.
     */
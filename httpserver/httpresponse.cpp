@@ -5,7 +5,7 @@
 
 #include "httpresponse.h"
 
-HttpResponse::HttpResponse(QTcpSocket* socket) {
+HttpResponse::HttpResponse(QIODevice* socket) {
     this->socket=socket;
     statusCode=200;
     statusText="OK";
@@ -126,7 +126,14 @@ void HttpResponse::write(QByteArray data, bool lastPart) {
             writeToSocket("0\r\n\r\n");
         }
         else if (!headers.contains("Content-Length")) {
-            socket->disconnectFromHost();
+            // end of body is when the connection closes
+            QAbstractSocket* tcp=qobject_cast<QAbstractSocket*>(socket);
+            if (tcp) {
+                tcp->disconnectFromHost();
+            }
+            else {
+                socket->close();
+            }
         }
         sentLastPart=true;
     }
@@ -40,9 +40,10 @@ public:
 
     /**
       Constructor.
-      @param socket used to write the response
+      @param socket used to write the response, a QTcpSocket or any other
+      device that blocks in waitForBytesWritten() when it has enough buffered
     */
-    HttpResponse(QTcpSocket* socket);
+    HttpResponse(QIODevice* socket);
 
     /**
       Set a HTTP response header
@@ -118,7 +119,7 @@ private:
     QMap<QByteArray,QByteArray> headers;
 
     /** Socket for writing output */
-    QTcpSocket* socket;
+    QIODevice* socket;
 
     /** HTTP status code*/
     int statusCode;
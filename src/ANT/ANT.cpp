@@ -87,6 +87,8 @@ const ant_sensor_type_t ANT::ant_sensor_types[] = {
 //
 ANT::ANT(QObject *parent, DeviceConfiguration *devConf, QString athlete) : QThread(parent), devConf(devConf)
 {
+    ring = NULL;
+
     qRegisterMetaType<ANTMessage>("ANTMessage");
     qRegisterMetaType<uint16_t>("uint16_t");
     qRegisterMetaType<uint8_t>("uint8_t");
@@ -126,11 +128,6 @@ ANT::ANT(QObject *parent, DeviceConfiguration *devConf, QString athlete) : QThre
     if (!elapsedTimer.isMonotonic())
         qDebug() << "Caution: ANT timer is not monotonic";
 
-    // state machine
-    state = ST_WAIT_FOR_SYNC;
-    length = bytes = 0;
-    checksum = ANT_SYNC_BYTE;
-
     // ant ids - may not be configured of course
     if (devConf && devConf->deviceProfile.length())
         antIDs = devConf->deviceProfile.split(",");
@@ -246,9 +243,7 @@ void ANT::run()
 
     for (int i=0; i<ANT_MAX_CHANNELS; i++) antChannel[i]->init();
 
-    state = ST_WAIT_FOR_SYNC;
-    length = bytes = 0;
-    checksum = ANT_SYNC_BYTE;
+    inbound.clear();
 
     if (openPort() == 0) {
 
@@ -263,14 +258,14 @@ void ANT::run()
 
     while(1)
     {
-        // read more bytes from the device
-        uint8_t byte;
+        // read everything available from the device, waking as soon
+        // as it arrives, then process all the complete messages
+        int rc = fillBuffer(5);
 
-        int rc = rawRead(&byte, 1);
-
-        if (rc > 0)
-            receiveByte((unsigned char)byte);
-        else {
+        if (rc > 0) {
+            processBuffer();
+            if (ring) ring->push(telemetry);
+        } else if (rc < 0) {
 
             // Recognise USB device removal. Linux transitions through -5 (I/O error)
             // to -6 (No such device or address). Windows seems to stick on -5
@@ -936,51 +931,62 @@ ANT::sendMessage(ANTMessage m) {
     rawWrite((uint8_t*)padding, 5);
 }
 
+// read whatever the device has for us into the inbound buffer
+// returns bytes read, 0 if there was nothing or <0 on error
+int
+ANT::fillBuffer(int msecs)
+{
+#ifndef WIN32
+#ifdef GC_HAVE_LIBUSB
+    if (usbMode != USB2)
+#endif
+        // serial devices we can wait on
+        return inbound.fill(devicePort, msecs);
+#endif
+
+    // usb reads block until their own timeout
+    Q_UNUSED(msecs);
+    uint8_t chunk[64];
+    int rc = rawRead(chunk, sizeof(chunk));
+    if (rc > 0) inbound.append(chunk, rc);
+    return rc;
+}
+
+// messages are sync, length, id, data[length], checksum
 void
-ANT::receiveByte(unsigned char byte) {
-
-    switch (state) {
-        case ST_WAIT_FOR_SYNC:
-            if (byte == ANT_SYNC_BYTE) {
-                state = ST_GET_LENGTH;
-                checksum = ANT_SYNC_BYTE;
-                rxMessage[0] = byte;
-            }
-            break;
+ANT::processBuffer(void) {
 
-        case ST_GET_LENGTH:
-            if ((byte == 0) || (byte > ANT_MAX_LENGTH)) {
-                state = ST_WAIT_FOR_SYNC;
-            }
-            else {
-              rxMessage[ANT_OFFSET_LENGTH] = byte;
-                checksum ^= byte;
-                length = byte;
-                bytes = 0;
-                state = ST_GET_MESSAGE_ID;
-            }
-            break;
+    while (inbound.count()) {
 
-        case ST_GET_MESSAGE_ID:
-            rxMessage[ANT_OFFSET_ID] = byte;
-            checksum ^= byte;
-            state = ST_GET_DATA;
-            break;
+        // wait for sync
+        if (inbound.at(0) != ANT_SYNC_BYTE) {
+            inbound.discard(1);
+            continue;
+        }
+        if (inbound.count() <= ANT_OFFSET_LENGTH) return;
 
-        case ST_GET_DATA:
-            rxMessage[ANT_OFFSET_DATA + bytes] = byte;
-            checksum ^= byte;
-            if (++bytes >= length){
-                state = ST_VALIDATE_PACKET;
-            }
-            break;
+        int length = inbound.at(ANT_OFFSET_LENGTH);
+        if (length == 0 || length > ANT_MAX_LENGTH) {
+            inbound.discard(1);
+            continue;
+        }
 
-        case ST_VALIDATE_PACKET:
-            if (checksum == byte){
-                processMessage();
-            }
-            state = ST_WAIT_FOR_SYNC;
-            break;
+        // not all here yet
+        int size = ANT_OFFSET_DATA + length + 1;
+        if (inbound.count() < size) return;
+
+        unsigned char checksum = 0;
+        for (int i=0; i<size-1; i++) checksum ^= inbound.at(i);
+
+        // corrupt, resync from the next byte
+        if (checksum != inbound.at(size-1)) {
+            inbound.discard(1);
+            continue;
+        }
+
+        inbound.take(rxMessage, size-1);
+        inbound.discard(1); // checksum
+        processMessage();
     }
 }
 
@@ -1267,17 +1273,10 @@ int ANT::rawRead(uint8_t bytes[], int size)
         return usb2->read((char *)bytes, size);
     }
 #endif
-    int i=0;
-    uint8_t byte;
-
-    // read one byte at a time sleeping when no data ready
-    // until we timeout waiting then return error
-    for (i=0; i<size; i++) {
-        int rc = read(devicePort, &byte, 1);
-        if (rc == -1 || rc == 0) return -1; // error!
-        else bytes[i] = byte;
-    }
-    return i;
+    // take whatever is there, the port is non-blocking
+    int rc = read(devicePort, bytes, size);
+    if (rc == -1 || rc == 0) return -1; // error or nothing
+    return rc;
 
 #endif
     return -1; // keep compiler happy.
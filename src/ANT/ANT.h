@@ -27,6 +27,8 @@
 #include "RealtimeData.h"
 #include "CalibrationData.h"
 #include "DeviceConfiguration.h"
+#include "SerialBuffer.h"
+#include "TelemetryRing.h"
 
 //
 // QT stuff
@@ -496,7 +498,8 @@ public:
 
     // transmission
     void sendMessage(ANTMessage);
-    void receiveByte(unsigned char byte);
+    int fillBuffer(int msecs);
+    void processBuffer(void);
     void handleChannelEvent(void);
     void processMessage(void);
 
@@ -589,6 +592,9 @@ public:
     int rawRead(uint8_t bytes[], int size);
     int rawWrite(uint8_t *bytes, int size);
 
+    // push telemetry as it arrives
+    void setTelemetryRing(TelemetryRing *ring) { this->ring = ring; }
+
     bool modeERGO(void) const;
     bool modeSLOPE(void) const;
     bool modeCALIBRATE(void) const;
@@ -709,12 +715,11 @@ private:
     bool ANT_Reset_Acknowledge;
     unsigned char rxMessage[ANT_MAX_MESSAGE_SIZE];
 
-    // state machine whilst receiving bytes
-    enum States {ST_WAIT_FOR_SYNC, ST_GET_LENGTH, ST_GET_MESSAGE_ID, ST_GET_DATA, ST_VALIDATE_PACKET} state;
-    //enum States state;
-    int length;
-    int bytes;
-    int checksum;
+    // bytes received but not yet processed
+    SerialBuffer inbound;
+
+    // where we push telemetry as it is updated
+    TelemetryRing *ring;
     int powerchannels; // how many power channels do we have?
     QDateTime lastCadenceMessage;
 
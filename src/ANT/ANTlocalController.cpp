@@ -38,6 +38,7 @@ ANTlocalController::ANTlocalController(TrainSidebar *parent, DeviceConfiguration
     }
 
     myANTlocal = new ANT (parent, dc, cyclist);
+    myANTlocal->setTelemetryRing(&samples);
     logger = new ANTLogger(this, athletePath);
 
     connect(myANTlocal, SIGNAL(foundDevice(int,int,int)), this, SIGNAL(foundDevice(int,int,int)));
@@ -58,6 +58,7 @@ public:
 
     // telemetry push pull
     bool doesPush(), doesPull(), doesLoad();
+    int sampleInterval() { return 250; } // sensors broadcast at about 4Hz
     void getRealtimeData(RealtimeData &rtData);
     void pushRealtimeData(RealtimeData &rtData);
 
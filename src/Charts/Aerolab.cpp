@@ -202,6 +202,7 @@ Aerolab::Aerolab(
   context(context),
   parent(parent),
   rideItem(NULL),
+  preparedRide(NULL), prepared(false),
   smooth(1), bydist(true), autoEoffset(true) {
 
   crr       = 0.005;
@@ -247,6 +248,8 @@ Aerolab::Aerolab(
 void
 Aerolab::configChanged(qint32)
 {
+  // units may have changed
+  prepared = false;
 
   // set colors
   setCanvasBackground(GColor(CPLOTBACKGROUND));
@@ -279,18 +282,43 @@ Aerolab::configChanged(qint32)
 void
 Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
 
+  // we only need to go through the ride when it changes, otherwise
+  // it is just the parameters and virtual elevation is recomputed
+  // from the running totals
+  if (!prepared || new_zoom || _rideItem != rideItem || _rideItem->ride() != preparedRide)
+    prepare(_rideItem);
+
+  if( rideItem->ride() ) {
+    computeVE();
+    recalc(new_zoom);
+    adjustEoffset();
+  } else {
+    //setTitle("no data");
+
+  }
+}
+
+void
+Aerolab::prepare(RideItem *_rideItem) {
+
   // HARD-CODED DATA: p1->kph
   double vfactor = 3.600;
-  double m       =  totalMass;
   double small_number = 0.00001;
 
   rideItem = _rideItem;
   RideFile *ride = rideItem->ride();
+  preparedRide = ride;
+  prepared = true;
 
   veArray.clear();
   altArray.clear();
   distanceArray.clear();
   timeArray.clear();
+  powerSum.clear();
+  rollingSum.clear();
+  dragSum.clear();
+  kineticSum.clear();
+  arrayLength = 0;
 
   if( ride ) {
 
@@ -300,13 +328,16 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
     if( dataPresent->watts ) {
 
       // If watts are present, then we can fill the veArray data:
-      const RideFileDataPresent *dataPresent = ride->areDataPresent();
       int npoints = ride->dataPoints().size();
       double dt = ride->recIntSecs();
-      veArray.resize(dataPresent->watts ? npoints : 0);
+      veArray.resize(npoints);
       altArray.resize(dataPresent->alt || constantAlt ? npoints : 0);
-      timeArray.resize(dataPresent->watts ? npoints : 0);
-      distanceArray.resize(dataPresent->watts ? npoints : 0);
+      timeArray.resize(npoints);
+      distanceArray.resize(npoints);
+      powerSum.resize(npoints);
+      rollingSum.resize(npoints);
+      dragSum.resize(npoints);
+      kineticSum.resize(npoints);
 
       // quickly erase old data
       veCurve->setVisible(false);
@@ -314,10 +345,8 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
 
       // detach and re-attach the ve curve:
       veCurve->detach();
-      if (!veArray.empty()) {
-        veCurve->attach(this);
-        veCurve->setVisible(dataPresent->watts);
-      }
+      veCurve->attach(this);
+      veCurve->setVisible(true);
 
       // detach and re-attach the ve curve:
       bool have_recorded_alt_curve = false;
@@ -328,14 +357,13 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
         altCurve->setVisible(dataPresent->alt || constantAlt );
       }
 
-      // Fill the virtual elevation profile with data from the ride data:
-      double t = 0.0;
+      // The slope is
+      //   s = eta*f/(m*g) - crr - cda*rho*headwind^2/(2*m*g) - a/g
+      // and virtual elevation sums s * v * dt, so we keep running
+      // totals of each term without the parameters
       double vlast = 0.0;
-      double e     = 0.0;
-      arrayLength = 0;
+      double power = 0.0, rolling = 0.0, drag = 0.0, kinetic = 0.0;
       foreach(const RideFilePoint *p1, ride->dataPoints()) {
-      if ( arrayLength == 0 )
-        e = eoffset;
 
       timeArray[arrayLength]  = p1->secs / 60.0;
       if ( have_recorded_alt_curve ) {
@@ -353,14 +381,12 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
       }
 
       // Unpack:
-      double power = max(0, p1->watts);
+      double watts = max(0, p1->watts);
       double v     = p1->kph/vfactor;
       double headwind = v;
       if( dataPresent->headwind ) {
         headwind   = p1->headwind/vfactor;
       }
-      double f     = 0.0;
-      double a     = 0.0;
 
       // Use km data instead of formula for file with a stop (gap).
       //d += v * dt;
@@ -368,23 +394,20 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
 
       distanceArray[arrayLength] = p1->km;
 
-
-
+      // f * v * dt and a * v * dt
       if( v > small_number ) {
-        f  = power/v;
-        a  = ( v*v - vlast*vlast ) / ( 2.0 * dt * v );
+        power   += watts * dt;
+        kinetic += ( v*v - vlast*vlast ) / 2.0;
       } else {
-        a = ( v - vlast ) / dt;
+        kinetic += ( v - vlast ) * v;
       }
+      rolling += v * dt;
+      drag    += headwind * headwind * v * dt;
 
-      f *= eta; // adjust for drivetrain efficiency if using a crank-based meter
-      double s   = slope( f, a, m, crr, cda, rho, headwind );
-      double de  = s * v * dt * (context->athlete->useMetricUnits ? 1 : FEET_PER_METER);
-
-      e += de;
-      t += dt;
-
-      veArray[arrayLength] = e;
+      powerSum[arrayLength]   = power;
+      rollingSum[arrayLength] = rolling;
+      dragSum[arrayLength]    = drag;
+      kineticSum[arrayLength] = kinetic;
 
       vlast = v;
 
@@ -395,14 +418,32 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
       veCurve->setVisible(false);
       altCurve->setVisible(false);
   }
-    recalc(new_zoom);
-    adjustEoffset();
-  } else {
-    //setTitle("no data");
-
   }
 }
 
+void
+Aerolab::computeVE() {
+
+  double g = KG_FORCE_PER_METER;
+  double units = context->athlete->useMetricUnits ? 1 : FEET_PER_METER;
+  double m = totalMass;
+
+  // weights for the running totals
+  double cPower   = units * eta / (m * g);
+  double cRolling = units * crr;
+  double cDrag    = units * cda * rho / (2.0 * m * g);
+  double cKinetic = units / g;
+
+  const double *power = powerSum.constData();
+  const double *rolling = rollingSum.constData();
+  const double *drag = dragSum.constData();
+  const double *kinetic = kineticSum.constData();
+  double *ve = veArray.data();
+
+  for (int i=0; i<arrayLength; i++)
+    ve[i] = eoffset + cPower*power[i] - cRolling*rolling[i] - cDrag*drag[i] - cKinetic*kinetic[i];
+}
+
 void
 Aerolab::setAxisTitle(int axis, QString label)
 {
@@ -589,6 +630,7 @@ void
 Aerolab::setConstantAlt(int value)
 {
     constantAlt = value;
+    prepared = false;
 }
 
 void
@@ -895,3 +937,124 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
     }
     return errMsg;
 }
+
+/*
+ * Fit CdA and Crr by least squares, matching virtual elevation to the
+ * recorded elevation over the selected intervals (each run is given its
+ * own elevation offset) or the whole ride if none are selected.
+ *
+ * Virtual elevation is linear in CdA, Crr and the offset, so with the
+ * running totals from prepare() it is a 2x2 system once each segment
+ * has been centred on its mean. Rho only ever appears multiplied by CdA
+ * so the two cannot be fitted together, the current rho is used.
+ *
+ * The confidence intervals allow for the errors in virtual elevation
+ * carrying on from one sample to the next (lag 1 autocorrelation of the
+ * residuals), without that they would be far too optimistic.
+ *
+ * Returns an explanatory error message if it fails, otherwise it updates
+ * cda, crr and eoffset, fills in fit and returns an empty message.
+ */
+QString Aerolab::fitCdACrr(RideItem *rideItem, AerolabFit &fit)
+{
+    if (!rideItem || !rideItem->ride()) return tr("No activity selected");
+
+    if (!prepared || rideItem != this->rideItem || rideItem->ride() != preparedRide) prepare(rideItem);
+    if (veArray.empty() || altArray.empty()) return tr("Altitude and Power data must be present");
+
+    RideFile *ride = rideItem->ride();
+    const double g = KG_FORCE_PER_METER;
+    double units = context->athlete->useMetricUnits ? 1 : FEET_PER_METER;
+    double m = totalMass;
+
+    // alt = offset + cda * x1 + crr * x2 + error
+    // where y is what power and the changes in speed don't account for
+    QVector<double> y(arrayLength), x1(arrayLength), x2(arrayLength);
+    for (int i=0; i<arrayLength; i++) {
+        y[i] = altArray[i] - units * (eta * powerSum[i] / (m * g) - kineticSum[i] / g);
+        x1[i] = -units * rho * dragSum[i] / (2.0 * m * g);
+        x2[i] = -units * rollingSum[i];
+    }
+
+    // the runs to fit
+    QList<QPair<int,int> > segments;
+    foreach(IntervalItem *interval, rideItem->intervalsSelected()) {
+        int from = ride->timeIndex(interval->start);
+        int to = qMin(ride->timeIndex(interval->stop), arrayLength-1);
+        if (from >= 0 && to - from >= 2) segments << QPair<int,int>(from, to);
+    }
+    if (segments.isEmpty()) segments << QPair<int,int>(0, arrayLength-1);
+
+    // normal equations, centred on each segment's means to take out its offset
+    QVector<double> my, mx1, mx2;
+    double A11 = 0, A12 = 0, A22 = 0, B1 = 0, B2 = 0;
+    int samples = 0;
+    for (int s=0; s<segments.count(); s++) {
+        int from = segments[s].first, to = segments[s].second;
+        int n = to - from + 1;
+
+        double sy = 0, s1 = 0, s2 = 0;
+        for (int i=from; i<=to; i++) {
+            sy += y[i];
+            s1 += x1[i];
+            s2 += x2[i];
+        }
+        my << sy/n;
+        mx1 << s1/n;
+        mx2 << s2/n;
+
+        for (int i=from; i<=to; i++) {
+            double dy = y[i] - my[s], d1 = x1[i] - mx1[s], d2 = x2[i] - mx2[s];
+            A11 += d1 * d1;
+            A12 += d1 * d2;
+            A22 += d2 * d2;
+            B1  += d1 * dy;
+            B2  += d2 * dy;
+        }
+        samples += n;
+    }
+
+    int parameters = 2 + segments.count();
+    if (samples <= parameters) return tr("Not enough data to fit CdA and Crr");
+
+    double det = A11 * A22 - A12 * A12;
+    if (det <= 1e-9 * A11 * A22) return tr("CdA and Crr cannot be separated, the speed must vary");
+
+    double cda = (A22 * B1 - A12 * B2) / det;
+    double crr = (A11 * B2 - A12 * B1) / det;
+
+    // residuals, and how much each carries on into the next
+    double rss = 0, lagged = 0;
+    for (int s=0; s<segments.count(); s++) {
+        double last = 0;
+        for (int i=segments[s].first; i<=segments[s].second; i++) {
+            double r = (y[i] - my[s]) - cda * (x1[i] - mx1[s]) - crr * (x2[i] - mx2[s]);
+            rss += r * r;
+            if (i > segments[s].first) lagged += r * last;
+            last = r;
+        }
+    }
+    double r1 = rss > 0 ? lagged / rss : 0;
+    if (r1 < 0) r1 = 0;
+    if (r1 > 0.99) r1 = 0.99;
+    double variance = rss / (samples - parameters) * (1 + r1) / (1 - r1);
+
+    // round and update if the values are in Aerolab's range
+    cda = floor(10000 * cda + 0.5) / 10000;
+    crr = floor(1000000 * crr + 0.5) / 1000000;
+    if (cda < 0.001 || cda > 1.0 || crr < 0.0001 || crr > 0.1) return tr("Estimates out-of-range");
+
+    this->cda = cda;
+    this->crr = crr;
+    this->eoffset = floor(100 * (my[0] - cda * mx1[0] - crr * mx2[0]) + 0.5) / 100;
+
+    fit.cda = cda;
+    fit.crr = crr;
+    fit.cdaError = 1.96 * sqrt(variance * A22 / det);
+    fit.crrError = 1.96 * sqrt(variance * A11 / det);
+    fit.eoffset = this->eoffset;
+    fit.rms = sqrt(rss / samples);
+    fit.samples = samples;
+    fit.segments = segments.count();
+    return "";
+}
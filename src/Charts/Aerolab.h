@@ -35,6 +35,7 @@
 
 // forward references
 class RideItem;
+class RideFile;
 struct RideFilePoint;
 class QwtPlotCurve;
 class QwtPlotGrid;
@@ -45,6 +46,15 @@ class IntervalAerolabData;
 class LTMToolTip;
 class LTMCanvasPicker;
 
+// CdA and Crr fitted to the recorded elevation, with the half width
+// of their 95% confidence intervals and the elevation left unexplained
+struct AerolabFit {
+    double cda, cdaError;
+    double crr, crrError;
+    double eoffset;
+    double rms;
+    int samples, segments;
+};
 
 class Aerolab : public QwtPlot {
 
@@ -108,6 +118,16 @@ class Aerolab : public QwtPlot {
   QVector<double> timeArray;
   QVector<double> distanceArray;
 
+  // Running totals through the ride, virtual elevation is a weighted sum of
+  // them so only these need recomputing when the ride changes:
+  //   power * dt, speed * dt, headwind^2 * speed * dt and speed * dv
+  QVector<double> powerSum;
+  QVector<double> rollingSum;
+  QVector<double> dragSum;
+  QVector<double> kineticSum;
+  RideFile *preparedRide;
+  bool prepared;
+
   int smooth;
   bool bydist;
   bool autoEoffset;
@@ -124,6 +144,8 @@ class Aerolab : public QwtPlot {
 
 
   double   slope(double, double, double, double, double, double, double);
+  void     prepare(RideItem *);
+  void     computeVE();
   void     recalc(bool);
   void     setYMax(bool);
   void     setXTitle();
@@ -146,6 +168,7 @@ class Aerolab : public QwtPlot {
   int      intEta() const { return (int)( eta * 10000); }
   int      intEoffset() const { return (int)( eoffset * 100); }
   QString  estimateCdACrr(RideItem* rideItem);
+  QString  fitCdACrr(RideItem* rideItem, AerolabFit &fit);
 
 };
 
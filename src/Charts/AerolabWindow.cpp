@@ -21,6 +21,7 @@
 #include "Context.h"
 #include "AerolabWindow.h"
 #include "Aerolab.h"
+#include "Athlete.h"
 #include "TabView.h"
 #include "IntervalItem.h"
 #include "RideItem.h"
@@ -225,6 +226,10 @@ AerolabWindow::AerolabWindow(Context *context) :
   QPushButton *btnEstCdACrr = new QPushButton(tr("&Estimate CdA and Crr"), this);
   smoothLayout->addWidget(btnEstCdACrr);
 
+  QPushButton *btnFitCdACrr = new QPushButton(tr("&Fit CdA and Crr"), this);
+  btnFitCdACrr->setToolTip(tr("Fit to the recorded elevation over the selected intervals, or the whole activity"));
+  smoothLayout->addWidget(btnFitCdACrr);
+
   btnSave = new QPushButton(tr("&Save parameters"), this);
   smoothLayout->addWidget(btnSave);
 
@@ -267,6 +272,7 @@ AerolabWindow::AerolabWindow(Context *context) :
   connect(constantAlt, SIGNAL(stateChanged(int)), this, SLOT(setConstantAlt(int)));
   connect(comboDistance, SIGNAL(currentIndexChanged(int)), this, SLOT(setByDistance(int)));
   connect(btnEstCdACrr, SIGNAL(clicked()), this, SLOT(doEstCdACrr()));
+  connect(btnFitCdACrr, SIGNAL(clicked()), this, SLOT(doFitCdACrr()));
   connect(btnSave, SIGNAL(clicked()), this, SLOT(saveParametersInRide()));
   connect(context, SIGNAL(configChanged(qint32)), aerolab, SLOT(configChanged(qint32)));
   connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
@@ -639,6 +645,39 @@ AerolabWindow::doEstCdACrr()
     }
 }
 
+void
+AerolabWindow::doFitCdACrr()
+{
+    RideItem *ride = myRideItem;
+    /* Fit Crr&Cda to the elevation */
+    AerolabFit fit;
+    const QString errMsg = aerolab->fitCdACrr(ride, fit);
+    if (errMsg.isEmpty()) {
+        /* Update Crr/Cda/Eoffset values values in UI */
+        crrLineEdit->setText(QString("%1").arg(aerolab->getCrr()) );
+        crrSlider->setValue(aerolab->intCrr());
+        cdaLineEdit->setText(QString("%1").arg(aerolab->getCda()) );
+        cdaSlider->setValue(aerolab->intCda());
+        eoffsetLineEdit->setText(QString("%1").arg(aerolab->getEoffset()) );
+        eoffsetSlider->setValue(aerolab->intEoffset());
+        /* Refresh */
+        refresh(ride, false);
+
+        QString units = context->athlete->useMetricUnits ? tr("m") : tr("ft");
+        QMessageBox::information(this, tr("Fit CdA and Crr"),
+            tr("CdA %1 +/- %2\nCrr %3 +/- %4\n\n"
+               "95% confidence, from %5 samples in %6 segment(s)\n"
+               "Elevation error %7 %8 rms")
+            .arg(fit.cda, 0, 'f', 4).arg(fit.cdaError, 0, 'f', 4)
+            .arg(fit.crr, 0, 'f', 5).arg(fit.crrError, 0, 'f', 5)
+            .arg(fit.samples).arg(fit.segments)
+            .arg(fit.rms, 0, 'f', 2).arg(units));
+    } else {
+        /* report error: insufficient data to fit Cda&Crr */
+        QMessageBox::warning(this, tr("Fit CdA and Crr"), errMsg);
+    }
+}
+
 
 void
 AerolabWindow::zoomInterval(IntervalItem *which) {
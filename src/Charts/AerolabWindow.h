@@ -62,6 +62,7 @@ class AerolabWindow : public GcChartWindow {
   void setEoffsetFromSlider();
   void setEoffsetFromText(const QString text);
   void doEstCdACrr();
+  void doFitCdACrr();
   void setAutoEoffset(int value);
   void setConstantAlt(int value);
   void setByDistance(int value);
@@ -22,6 +22,7 @@
 #include "Athlete.h"
 #include "AllPlotWindow.h"
 #include "AllPlotSlopeCurve.h"
+#include "AllPlotLOD.h"
 #include "ReferenceLineDialog.h"
 #include "ExhaustionDialog.h"
 #include "RideFile.h"
@@ -35,6 +36,7 @@
 #include "WPrime.h"
 #include "IndendPlotMarker.h"
 #include "Utils.h"
+#include "Trace.h"
 
 #include <qwt_plot_curve.h>
 #include <qwt_plot_canvas.h>
@@ -52,9 +54,42 @@
 #include "qwt_plot_gapped_curve.h"
 
 #include <QMultiMap>
+#if QT_VERSION > 0x050000
+# include <QtConcurrent>
+#else
+# include <QtConcurrentRun>
+#endif
 
 #include <string.h> // for memcpy
 
+// set curve data with level of detail decimation so long rides only
+// draw as many points as the canvas can show, gap is passed for
+// gapped curves (see AllPlotLOD.h)
+static void
+setLODSamples(const QwtPlot *plot, QwtPlotCurve *curve, const double *x, const double *y, int count, double gap=0)
+{
+    AllPlotLODData *data = new AllPlotLODData(plot, x, y, count);
+    if (gap > 0) data->setGap(gap);
+    curve->setData(data);
+}
+
+// clone data from another curve, level of detail data is shared rather
+// than copied. returns the number of samples at full resolution
+static int
+cloneCurveData(const QwtPlot *plot, QwtPlotCurve *ours, const QwtPlotCurve *there)
+{
+    const AllPlotLODData *lod = dynamic_cast<const AllPlotLODData*>(there->data());
+    if (lod) {
+        ours->setData(lod->clone(plot));
+        return lod->fullSize();
+    }
+
+    QVector<QPointF> array;
+    for (size_t i=0; i<there->data()->size(); i++) array << there->data()->sample(i);
+    ours->setSamples(array);
+    return array.size();
+}
+
 class IntervalPlotData : public QwtSeriesData<QPointF>
 {
     public:
@@ -911,6 +946,9 @@ AllPlot::AllPlot(QWidget *parent, AllPlotWindow *window, Context *context, RideF
     bydist(false),
     bytimeofday(false),
     timeoffset(0),
+    generation(0),
+    smoothWindow(0),
+    smoothObject(NULL),
     scope(scope),
     secondaryScope(secScope),
     context(context),
@@ -925,6 +963,7 @@ AllPlot::AllPlot(QWidget *parent, AllPlotWindow *window, Context *context, RideF
 
     smooth = 1;
     standard = NULL; // until its created
+    connect(&smoothWatcher, SIGNAL(finished()), this, SLOT(smoothingFinished()));
     wantxaxis = wantaxis = true;
     setAutoDelete(false); // no - we are managing it via the AllPlotObjects now
     referencePlot = NULL;
@@ -1000,6 +1039,10 @@ AllPlot::AllPlot(QWidget *parent, AllPlotWindow *window, Context *context, RideF
 
 AllPlot::~AllPlot()
 {
+    // abandon any background smoothing
+    generation.fetchAndAddOrdered(1);
+    smoothWatcher.waitForFinished();
+
     // wipe compare curves if there are any
     foreach(QwtPlotCurve *compare, compares) {
         compare->detach(); delete compare;
@@ -1618,30 +1661,6 @@ AllPlot::setHighlightIntervals(bool state)
     }
 }
 
-struct DataPoint {
-
-    double time, hr, watts, atiss, antiss, np, rv, rcad, rgct,
-           smo2, thb, o2hb, hhb, ap, xp, speed, cad, 
-           alt, temp, wind, torque, lrbalance, lte, rte, lps, rps,
-           lpco, rpco, lppb, rppb, lppe, rppe, lpppb, rpppb, lpppe, rpppe,
-           kphd, wattsd, cadd, nmd, hrd, slope, tcore;
-
-    // user values
-    QList<double>user;
-
-    DataPoint(double t, double h, double w, double at, double an, double n, double rv, double rcad, double rgct,
-              double smo2, double thb, double o2hb, double hhb, double l, double x, double s, double c,
-              double a, double te, double wi, double tq, double lrb, double lte, double rte, double lps, double rps,
-              double lpco, double rpco, double lppb, double rppb, double lppe, double rppe, double lpppb, double rpppb, double lpppe, double rpppe,
-              double kphd, double wattsd, double cadd, double nmd, double hrd, double sl, double tcore, QList<double>user) :
-
-              time(t), hr(h), watts(w), atiss(at), antiss(an), np(n), rv(rv), rcad(rcad), rgct(rgct),
-              smo2(smo2), thb(thb), o2hb(o2hb), hhb(hhb), ap(l), xp(x), speed(s), cad(c),
-              alt(a), temp(te), wind(wi), torque(tq), lrbalance(lrb), lte(lte), rte(rte), lps(lps), rps(rps),
-              lpco(lpco), rpco(rpco), lppb(lppb), rppb(rppb), lppe(lppe), rppe(rppe), lpppb(lpppb), rpppb(rpppb), lpppe(lpppe), rpppe(rpppe),
-              kphd(kphd), wattsd(wattsd), cadd(cadd), nmd(nmd), hrd(hrd), slope(sl), tcore(tcore), user(user) {}
-};
-
 bool AllPlot::shadeZones() const
 {
     return shade_zones;
@@ -1734,6 +1753,9 @@ AllPlot::recalc(AllPlotObject *objects)
         return;
     }
 
+    // anything smoothing in the background is now out of date
+    generation.fetchAndAddOrdered(1);
+
     if (objects->timeArray.empty())
         return;
 
@@ -1811,404 +1833,17 @@ AllPlot::recalc(AllPlotObject *objects)
         return;
     }
 
-    // if recintsecs is longer than the smoothing, or equal to the smoothing there is no point in even trying
-    int applysmooth = smooth <= rideItem->ride()->recIntSecs() ? 0 : smooth;
-
-    // compare mode breaks
-    if (context->isCompareIntervals && applysmooth == 0) applysmooth = 1;
-    
-    // we should only smooth the curves if objects->smoothed rate is greater than sample rate
-
-    // user data totals
-    QVector<double> utotals;
-    utotals.resize(objects->U.count());
-    utotals.fill(0);
-
-    // Offset for timeOfDay
-    if (context->isCompareIntervals || !bytimeofday)
-        timeoffset = 0;
-    else
-        timeoffset = QTime(0, 0).secsTo(rideItem->ride()->startTime().time()) / 60.0;
+    int applysmooth = smoothingWindow();
 
     if (applysmooth > 0) {
 
-        double totalWatts = 0.0;
-        double totalNP = 0.0;
-        double totalRCad = 0.0;
-        double totalRV = 0.0;
-        double totalRGCT = 0.0;
-        double totalSmO2 = 0.0;
-        double totaltHb = 0.0;
-        double totalO2Hb = 0.0;
-        double totalHHb = 0.0;
-        double totalATISS = 0.0;
-        double totalANTISS = 0.0;
-        double totalXP = 0.0;
-        double totalAP = 0.0;
-        double totalHr = 0.0;
-        double totalTcore = 0.0;
-        double totalSpeed = 0.0;
-        double totalAccel = 0.0;
-        double totalWattsD = 0.0;
-        double totalCadD = 0.0;
-        double totalNmD = 0.0;
-        double totalHrD = 0.0;
-        double totalCad = 0.0;
-        double totalDist = 0.0;
-        double totalAlt = 0.0;
-        double totalSlope = 0.0;
-        double totalTemp = 0.0;
-        double totalWind = 0.0;
-        double totalTorque = 0.0;
-        double totalBalance = 0.0;
-        double totalLTE = 0.0;
-        double totalRTE = 0.0;
-        double totalLPS = 0.0;
-        double totalRPS = 0.0;
-        double totalLPCO = 0.0;
-        double totalRPCO = 0.0;
-        double totalLPPB = 0.0;
-        double totalRPPB = 0.0;
-        double totalLPPE = 0.0;
-        double totalRPPE = 0.0;
-        double totalLPPPB = 0.0;
-        double totalRPPPB = 0.0;
-        double totalLPPPE = 0.0;
-        double totalRPPPE = 0.0;
-        double currentGearRatio = 0.0;
-
-
-        QList<DataPoint> list;
-
-        objects->smoothWatts.resize(rideTimeSecs + 1);
-        objects->smoothNP.resize(rideTimeSecs + 1);
-        objects->smoothGear.resize(rideTimeSecs + 1);
-        objects->smoothRV.resize(rideTimeSecs + 1);
-        objects->smoothRCad.resize(rideTimeSecs + 1);
-        objects->smoothRGCT.resize(rideTimeSecs + 1);
-        objects->smoothSmO2.resize(rideTimeSecs + 1);
-        objects->smoothtHb.resize(rideTimeSecs + 1);
-        objects->smoothO2Hb.resize(rideTimeSecs + 1);
-        objects->smoothHHb.resize(rideTimeSecs + 1);
-        objects->smoothAT.resize(rideTimeSecs + 1);
-        objects->smoothANT.resize(rideTimeSecs + 1);
-        objects->smoothXP.resize(rideTimeSecs + 1);
-        objects->smoothAP.resize(rideTimeSecs + 1);
-        objects->smoothHr.resize(rideTimeSecs + 1);
-        objects->smoothTcore.resize(rideTimeSecs + 1);
-        objects->smoothSpeed.resize(rideTimeSecs + 1);
-        objects->smoothAccel.resize(rideTimeSecs + 1);
-        objects->smoothWattsD.resize(rideTimeSecs + 1);
-        objects->smoothCadD.resize(rideTimeSecs + 1);
-        objects->smoothNmD.resize(rideTimeSecs + 1);
-        objects->smoothHrD.resize(rideTimeSecs + 1);
-        objects->smoothCad.resize(rideTimeSecs + 1);
-        objects->smoothTime.resize(rideTimeSecs + 1);
-        objects->smoothDistance.resize(rideTimeSecs + 1);
-        objects->smoothAltitude.resize(rideTimeSecs + 1);
-        objects->smoothSlope.resize(rideTimeSecs + 1);
-        objects->smoothTemp.resize(rideTimeSecs + 1);
-        objects->smoothWind.resize(rideTimeSecs + 1);
-        objects->smoothRelSpeed.resize(rideTimeSecs + 1);
-        objects->smoothTorque.resize(rideTimeSecs + 1);
-        objects->smoothBalanceL.resize(rideTimeSecs + 1);
-        objects->smoothBalanceR.resize(rideTimeSecs + 1);
-        objects->smoothLTE.resize(rideTimeSecs + 1);
-        objects->smoothRTE.resize(rideTimeSecs + 1);
-        objects->smoothLPS.resize(rideTimeSecs + 1);
-        objects->smoothRPS.resize(rideTimeSecs + 1);
-        objects->smoothLPCO.resize(rideTimeSecs + 1);
-        objects->smoothRPCO.resize(rideTimeSecs + 1);
-        objects->smoothLPP.resize(rideTimeSecs + 1);
-        objects->smoothRPP.resize(rideTimeSecs + 1);
-        objects->smoothLPPP.resize(rideTimeSecs + 1);
-        objects->smoothRPPP.resize(rideTimeSecs + 1);
-        for(int k=0; k<objects->U.count(); k++) {
-            objects->U[k].smooth.resize(rideTimeSecs + 1);
-        }
-
-        // do the smoothing by calculating the average of the "applysmooth" values left
-        // of the current data point - for points in time smaller than "applysmooth"
-        // only the available datapoints left are used to build the average
-        int i = 0;
-        for (int secs = 0; secs <= rideTimeSecs; ++secs) {
-            while ((i < objects->timeArray.count()) && (objects->timeArray[i] <= secs)) {
-
-                // collect user data if its there
-                QList<double> udata;
-                for (int k=0; k<objects->U.count(); k++) udata << (objects->U[k].array.size() > i ? objects->U[k].array[i] : 0);
-
-                // add to list
-                DataPoint dp(objects->timeArray[i],
-                             (!objects->hrArray.empty() ? objects->hrArray[i] : 0),
-                             (!objects->wattsArray.empty() ? objects->wattsArray[i] : 0),
-                             (!objects->atissArray.empty() ? objects->atissArray[i] : 0),
-                             (!objects->antissArray.empty() ? objects->antissArray[i] : 0),
-                             (!objects->npArray.empty() ? objects->npArray[i] : 0),
-                             (!objects->rvArray.empty() ? objects->rvArray[i] : 0),
-                             (!objects->rcadArray.empty() ? objects->rcadArray[i] : 0),
-                             (!objects->rgctArray.empty() ? objects->rgctArray[i] : 0),
-                             (!objects->smo2Array.empty() ? objects->smo2Array[i] : 0),
-                             (!objects->thbArray.empty() ? objects->thbArray[i] : 0),
-                             (!objects->o2hbArray.empty() ? objects->o2hbArray[i] : 0),
-                             (!objects->hhbArray.empty() ? objects->hhbArray[i] : 0),
-                             (!objects->apArray.empty() ? objects->apArray[i] : 0),
-                             (!objects->xpArray.empty() ? objects->xpArray[i] : 0),
-                             (!objects->speedArray.empty() ? objects->speedArray[i] : 0),
-                             (!objects->cadArray.empty() ? objects->cadArray[i] : 0),
-                             (!objects->altArray.empty() ? objects->altArray[i] : 0),
-                             (!objects->tempArray.empty() ? objects->tempArray[i] : 0),
-                             (!objects->windArray.empty() ? objects->windArray[i] : 0),
-                             (!objects->torqueArray.empty() ? objects->torqueArray[i] : 0),
-                             (!objects->balanceArray.empty() ? objects->balanceArray[i] : 0),
-                             (!objects->lteArray.empty() ? objects->lteArray[i] : 0),
-                             (!objects->rteArray.empty() ? objects->rteArray[i] : 0),
-                             (!objects->lpsArray.empty() ? objects->lpsArray[i] : 0),
-                             (!objects->rpsArray.empty() ? objects->rpsArray[i] : 0),
-                             (!objects->lpcoArray.empty() ? objects->lpcoArray[i] : 0),
-                             (!objects->rpcoArray.empty() ? objects->rpcoArray[i] : 0),
-                             (!objects->lppbArray.empty() ? objects->lppbArray[i] : 0),
-                             (!objects->rppbArray.empty() ? objects->rppbArray[i] : 0),
-                             (!objects->lppeArray.empty() ? objects->lppeArray[i] : 0),
-                             (!objects->rppeArray.empty() ? objects->rppeArray[i] : 0),
-                             (!objects->lpppbArray.empty() ? objects->lpppbArray[i] : 0),
-                             (!objects->rpppbArray.empty() ? objects->rpppbArray[i] : 0),
-                             (!objects->lpppeArray.empty() ? objects->lpppeArray[i] : 0),
-                             (!objects->rpppeArray.empty() ? objects->rpppeArray[i] : 0),
-                             (!objects->accelArray.empty() ? objects->accelArray[i] : 0),
-                             (!objects->wattsDArray.empty() ? objects->wattsDArray[i] : 0),
-                             (!objects->cadDArray.empty() ? objects->cadDArray[i] : 0),
-                             (!objects->nmDArray.empty() ? objects->nmDArray[i] : 0),
-                             (!objects->hrDArray.empty() ? objects->hrDArray[i] : 0),
-                             (!objects->slopeArray.empty() ? objects->slopeArray[i] : 0),
-                             (!objects->tcoreArray.empty() ? objects->tcoreArray[i] : 0),
-                            udata);
-
-                // apend to list
-                list.append(dp);
-
-                // maintain totals
-                if (!objects->wattsArray.empty()) totalWatts += objects->wattsArray[i];
-                if (!objects->npArray.empty()) totalNP += objects->npArray[i];
-                if (!objects->rvArray.empty()) totalRV += objects->rvArray[i];
-                if (!objects->rcadArray.empty()) totalRCad += objects->rcadArray[i];
-                if (!objects->rgctArray.empty()) totalRGCT += objects->rgctArray[i];
-                if (!objects->smo2Array.empty()) totalSmO2 += objects->smo2Array[i];
-                if (!objects->thbArray.empty()) totaltHb += objects->thbArray[i];
-                if (!objects->o2hbArray.empty()) totalO2Hb += objects->o2hbArray[i];
-                if (!objects->hhbArray.empty()) totalHHb += objects->hhbArray[i];
-                if (!objects->atissArray.empty()) totalATISS += objects->atissArray[i];
-                if (!objects->antissArray.empty()) totalANTISS += objects->antissArray[i];
-                if (!objects->xpArray.empty()) totalXP += objects->xpArray[i];
-                if (!objects->apArray.empty()) totalAP += objects->apArray[i];
-                if (!objects->tcoreArray.empty()) totalTcore    += objects->tcoreArray[i];
-                if (!objects->hrArray.empty()) totalHr    += objects->hrArray[i];
-                if (!objects->accelArray.empty()) totalAccel += objects->accelArray[i];
-                if (!objects->wattsDArray.empty()) totalWattsD += objects->wattsDArray[i];
-                if (!objects->cadDArray.empty()) totalCadD += objects->cadDArray[i];
-                if (!objects->nmDArray.empty()) totalNmD += objects->nmDArray[i];
-                if (!objects->hrDArray.empty()) totalHrD += objects->hrDArray[i];
-                if (!objects->speedArray.empty()) totalSpeed += objects->speedArray[i];
-                if (!objects->cadArray.empty()) totalCad   += objects->cadArray[i];
-                if (!objects->altArray.empty()) totalAlt   += objects->altArray[i];
-                if (!objects->slopeArray.empty()) totalSlope   += objects->slopeArray[i];
-                if (!objects->windArray.empty()) totalWind   += objects->windArray[i];
-                if (!objects->torqueArray.empty()) totalTorque   += objects->torqueArray[i];
-                if (!objects->tempArray.empty() ) {
-                    if (objects->tempArray[i] == RideFile::NA) {
-                        dp.temp = (i>0 && !list.empty()?list.back().temp:0.0);
-                        totalTemp   += dp.temp;
-                    }
-                    else {
-                        totalTemp   += objects->tempArray[i];
-                    }
-                }
-                if (!objects->balanceArray.empty()) totalBalance   += (objects->balanceArray[i]>0?objects->balanceArray[i]:50);
-                if (!objects->lteArray.empty()) totalLTE   += (objects->lteArray[i]>0?objects->lteArray[i]:0);
-                if (!objects->rteArray.empty()) totalRTE   += (objects->rteArray[i]>0?objects->rteArray[i]:0);
-                if (!objects->lpsArray.empty()) totalLPS   += (objects->lpsArray[i]>0?objects->lpsArray[i]:0);
-                if (!objects->rpsArray.empty()) totalRPS   += (objects->rpsArray[i]>0?objects->rpsArray[i]:0);
-                if (!objects->lpcoArray.empty()) totalLPCO   += objects->lpcoArray[i];
-                if (!objects->rpcoArray.empty()) totalRPCO   += objects->rpcoArray[i];
-                if (!objects->lppbArray.empty()) totalLPPB   += (objects->lppbArray[i]>0?objects->lppbArray[i]:0);
-                if (!objects->rppbArray.empty()) totalRPPB   += (objects->rppbArray[i]>0?objects->rppbArray[i]:0);
-                if (!objects->lppeArray.empty()) totalLPPE   += (objects->lppeArray[i]>0?objects->lppeArray[i]:0);
-                if (!objects->rppeArray.empty()) totalRPPE   += (objects->rppeArray[i]>0?objects->rppeArray[i]:0);
-                if (!objects->lpppbArray.empty()) totalLPPPB   += (objects->lpppbArray[i]>0?objects->lpppbArray[i]:0);
-                if (!objects->rpppbArray.empty()) totalRPPPB   += (objects->rpppbArray[i]>0?objects->rpppbArray[i]:0);
-                if (!objects->lpppeArray.empty()) totalLPPPE   += (objects->lpppeArray[i]>0?objects->lpppeArray[i]:0);
-                if (!objects->rpppeArray.empty()) totalRPPPE   += (objects->rpppeArray[i]>0?objects->rpppeArray[i]:0);
-
-                // set values which must not be smoothed
-                if (!objects->gearArray.empty()) currentGearRatio = (objects->gearArray[i]>0?objects->gearArray[i]:0);
-                totalDist   = objects->distanceArray[i];
-
-                // totalise user data
-                for(int k=0; k<utotals.count(); k++) utotals[k] += udata[k];
-
-                ++i;
-            }
-
-            // remove data from before smoothing duration (er, really?)
-            while (!list.empty() && (list.front().time < secs - applysmooth)) {
-                DataPoint &dp = list.front();
-                totalWatts -= dp.watts;
-                totalNP -= dp.np;
-                totalRV -= dp.rv;
-                totalRCad -= dp.rcad;
-                totalRGCT -= dp.rgct;
-                totalSmO2 -= dp.smo2;
-                totaltHb -= dp.thb;
-                totalO2Hb -= dp.o2hb;
-                totalHHb -= dp.hhb;
-                totalATISS -= dp.atiss;
-                totalANTISS -= dp.antiss;
-                totalAP -= dp.ap;
-                totalXP -= dp.xp;
-                totalHr    -= dp.hr;
-                totalTcore    -= dp.tcore;
-                totalSpeed -= dp.speed;
-                totalAccel -= dp.kphd;
-                totalWattsD -= dp.wattsd;
-                totalCadD -= dp.cadd;
-                totalNmD -= dp.nmd;
-                totalHrD -= dp.hrd;
-                totalCad   -= dp.cad;
-                totalAlt   -= dp.alt;
-                totalSlope -= dp.slope;
-                totalTemp   -= dp.temp;
-                totalWind   -= dp.wind;
-                totalTorque   -= dp.torque;
-                totalLTE   -= dp.lte;
-                totalRTE   -= dp.rte;
-                totalLPS   -= dp.lps;
-                totalRPS   -= dp.rps;
-                totalLPCO  -= dp.lpco;
-                totalRPCO  -= dp.rpco;
-                totalLPPB   -= dp.lppb;
-                totalRPPB   -= dp.rppb;
-                totalLPPE   -= dp.lppe;
-                totalRPPE   -= dp.rppe;
-                totalLPPPB  -= dp.lpppb;
-                totalRPPPB  -= dp.rpppb;
-                totalLPPPE  -= dp.lpppe;
-                totalRPPPE  -= dp.rpppe;
-                totalBalance   -= (dp.lrbalance>0?dp.lrbalance:50);
-                for(int k=0; k<utotals.count(); k++) utotals[k] -= dp.user[k];
-
-                list.removeFirst();
-            }
+        // prefix sums are built once per ride, so smoothing is O(n)
+        // whatever the size of the window
+        if (!objects->smoothing.isValid()) objects->smoothing.build(objects);
 
-            // TODO: this is wrong.  We should do a weighted average over the
-            // seconds represented by each point...
-            if (list.empty()) {
-
-                for (int k=0; k<objects->U.count(); k++) objects->U[k].smooth[secs] = 0.0;
-                objects->smoothWatts[secs] = 0.0;
-                objects->smoothNP[secs] = 0.0;
-                objects->smoothRV[secs] = 0.0;
-                objects->smoothRCad[secs] = 0.0;
-                objects->smoothRGCT[secs] = 0.0;
-                objects->smoothSmO2[secs] = 0.0;
-                objects->smoothtHb[secs] = 0.0;
-                objects->smoothO2Hb[secs] = 0.0;
-                objects->smoothHHb[secs] = 0.0;
-                objects->smoothAT[secs] = 0.0;
-                objects->smoothANT[secs] = 0.0;
-                objects->smoothXP[secs] = 0.0;
-                objects->smoothAP[secs] = 0.0;
-                objects->smoothHr[secs]    = 0.0;
-                objects->smoothTcore[secs]    = 0.0;
-                objects->smoothSpeed[secs] = 0.0;
-                objects->smoothAccel[secs] = 0.0;
-                objects->smoothWattsD[secs] = 0.0;
-                objects->smoothCadD[secs] = 0.0;
-                objects->smoothNmD[secs] = 0.0;
-                objects->smoothHrD[secs] = 0.0;
-                objects->smoothCad[secs]   = 0.0;
-                objects->smoothAltitude[secs]   = ((secs > 0) ? objects->smoothAltitude[secs - 1] : objects->altArray[secs] ) ;
-                objects->smoothSlope[secs]   =  0.0;
-                objects->smoothTemp[secs]   = 0.0;
-                objects->smoothWind[secs] = 0.0;
-                objects->smoothRelSpeed[secs] =  QwtIntervalSample();
-                objects->smoothTorque[secs] = 0.0;
-                objects->smoothLTE[secs] = 0.0;
-                objects->smoothRTE[secs] = 0.0;
-                objects->smoothLPS[secs] = 0.0;
-                objects->smoothRPS[secs] = 0.0;
-                objects->smoothLPCO[secs] = 0.0;
-                objects->smoothRPCO[secs] = 0.0;
-                objects->smoothLPP[secs] = QwtIntervalSample();
-                objects->smoothRPP[secs] = QwtIntervalSample();
-                objects->smoothLPPP[secs] = QwtIntervalSample();
-                objects->smoothRPPP[secs] = QwtIntervalSample();
-                objects->smoothBalanceL[secs] = 50;
-                objects->smoothBalanceR[secs] = 50;
-
-            } else {
-
-                for(int k=0; k<utotals.count(); k++) objects->U[k].smooth[secs] = utotals[k] / list.size();
-                objects->smoothWatts[secs]    = totalWatts / list.size();
-                objects->smoothNP[secs]    = totalNP / list.size();
-                objects->smoothRV[secs]    = totalRV / list.size();
-                objects->smoothRCad[secs]    = totalRCad / list.size();
-                objects->smoothRGCT[secs]    = totalRGCT / list.size();
-                objects->smoothSmO2[secs]    = totalSmO2 / list.size();
-                objects->smoothtHb[secs]    = totaltHb / list.size();
-                objects->smoothO2Hb[secs]    = totalO2Hb / list.size();
-                objects->smoothHHb[secs]    = totalHHb / list.size();
-                objects->smoothAT[secs]    = totalATISS / list.size();
-                objects->smoothANT[secs]    = totalANTISS / list.size();
-                objects->smoothXP[secs]    = totalXP / list.size();
-                objects->smoothAP[secs]    = totalAP / list.size();
-                objects->smoothHr[secs]       = totalHr / list.size();
-                objects->smoothTcore[secs]       = totalTcore / list.size();
-                objects->smoothSpeed[secs]    = totalSpeed / list.size();
-                objects->smoothAccel[secs]    = totalAccel / double(list.size());
-                objects->smoothWattsD[secs]    = totalWattsD / double(list.size());
-                objects->smoothCadD[secs]    = totalCadD / double(list.size());
-                objects->smoothNmD[secs]    = totalNmD / double(list.size());
-                objects->smoothHrD[secs]    = totalHrD / double(list.size());
-                objects->smoothCad[secs]      = totalCad / list.size();
-                objects->smoothAltitude[secs]      = totalAlt / list.size();
-                objects->smoothSlope[secs]      = totalSlope / double(list.size());
-                objects->smoothTemp[secs]      = totalTemp / list.size();
-                objects->smoothWind[secs]    = totalWind / list.size();
-                objects->smoothTorque[secs]    = totalTorque / list.size();
-                objects->smoothRelSpeed[secs] =  QwtIntervalSample(bydist ? totalDist : secs / 60.0, 
-                                                                   QwtInterval(qMin(totalWind / list.size(),
-                                                                   totalSpeed / list.size()), 
-                                                                   qMax(totalWind / list.size(), 
-                                                                   totalSpeed / list.size())));
-
-                // left /right pedal data
-                double balance = totalBalance / list.size();
-                if (balance == 0) {
-                    objects->smoothBalanceL[secs]    = 50;
-                    objects->smoothBalanceR[secs]    = 50;
-                } else if (balance >= 50) {
-                    objects->smoothBalanceL[secs]    = balance;
-                    objects->smoothBalanceR[secs]    = 50;
-                }
-                else {
-                    objects->smoothBalanceL[secs]    = 50;
-                    objects->smoothBalanceR[secs]    = balance;
-                }
-                objects->smoothLTE[secs]    = totalLTE / list.size();
-                objects->smoothRTE[secs]    = totalRTE / list.size();
-                objects->smoothLPS[secs]    = totalLPS / list.size();
-                objects->smoothRPS[secs]    = totalRPS / list.size();
-                objects->smoothLPCO[secs]   = totalLPCO / list.size();
-                objects->smoothRPCO[secs]   = totalRPCO / list.size();
-                objects->smoothLPP[secs]    = QwtIntervalSample( bydist ? totalDist : secs / 60.0, QwtInterval(totalLPPB / list.size(), totalLPPE / list.size() ) );
-                objects->smoothRPP[secs]    = QwtIntervalSample( bydist ? totalDist : secs / 60.0, QwtInterval(totalRPPB / list.size(), totalRPPE / list.size() ) );
-                objects->smoothLPPP[secs]   = QwtIntervalSample( bydist ? totalDist : secs / 60.0, QwtInterval(totalLPPPB / list.size(), totalLPPPE / list.size() ) );
-                objects->smoothRPPP[secs]   = QwtIntervalSample( bydist ? totalDist : secs / 60.0, QwtInterval(totalRPPPB / list.size(), totalRPPPE / list.size() ) );
-            }
-            objects->smoothGear[secs] = currentGearRatio;
-            objects->smoothDistance[secs] = totalDist;
-            objects->smoothTime[secs]  =  secs / 60.0;
-        }
+        AllPlotSmoothing smoothing = objects->smoothing;
+        smoothing.smooth(applysmooth, rideTimeSecs, bydist);
+        smoothing.apply(objects);
 
     } else {
 
@@ -2325,6 +1960,19 @@ AllPlot::recalc(AllPlotObject *objects)
         }
     }
 
+    setSmoothedCurves(objects, applysmooth);
+}
+
+// smoothed data is ready, so update the curves
+void
+AllPlot::setSmoothedCurves(AllPlotObject *objects, int applysmooth)
+{
+    // Offset for timeOfDay
+    if (context->isCompareIntervals || !bytimeofday)
+        timeoffset = 0;
+    else
+        timeoffset = QTime(0, 0).secsTo(rideItem->ride()->startTime().time()) / 60.0;
+
     QVector<double> &xaxis = bydist ? objects->smoothDistance : objects->smoothTime;
     int startingIndex = qMin(smooth, xaxis.count());
     int totalPoints = xaxis.count() - startingIndex;
@@ -2366,112 +2014,112 @@ AllPlot::recalc(AllPlotObject *objects)
     // set curve.
     for(int k=0; k<objects->U.count(); k++) {
         if (!objects->U[k].array.empty()) {
-            objects->U[k].curve->setSamples(xaxis.data() + startingIndex, objects->U[k].smooth.data() + startingIndex, totalPoints);
+            setLODSamples(this, objects->U[k].curve, xaxis.data() + startingIndex, objects->U[k].smooth.data() + startingIndex, totalPoints, 3);
         }
     }
 
     if (!objects->wattsArray.empty()) {
-        objects->wattsCurve->setSamples(xaxis.data() + startingIndex, objects->smoothWatts.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->wattsCurve, xaxis.data() + startingIndex, objects->smoothWatts.data() + startingIndex, totalPoints, 3);
     }
 
     if (!objects->antissArray.empty()) {
-        objects->antissCurve->setSamples(xaxis.data() + startingIndex, objects->smoothANT.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->antissCurve, xaxis.data() + startingIndex, objects->smoothANT.data() + startingIndex, totalPoints);
     }
 
     if (!objects->atissArray.empty()) {
-        objects->atissCurve->setSamples(xaxis.data() + startingIndex, objects->smoothAT.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->atissCurve, xaxis.data() + startingIndex, objects->smoothAT.data() + startingIndex, totalPoints);
     }
 
     if (!objects->rvArray.empty()) {
-        objects->rvCurve->setSamples(xaxis.data() + startingIndex, objects->smoothRV.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->rvCurve, xaxis.data() + startingIndex, objects->smoothRV.data() + startingIndex, totalPoints);
     }
 
     if (!objects->rcadArray.empty()) {
-        objects->rcadCurve->setSamples(xaxis.data() + startingIndex, objects->smoothRCad.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->rcadCurve, xaxis.data() + startingIndex, objects->smoothRCad.data() + startingIndex, totalPoints);
     }
 
     if (!objects->rgctArray.empty()) {
-        objects->rgctCurve->setSamples(xaxis.data() + startingIndex, objects->smoothRGCT.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->rgctCurve, xaxis.data() + startingIndex, objects->smoothRGCT.data() + startingIndex, totalPoints);
     }
 
     if (!objects->gearArray.empty()) {
-        objects->gearCurve->setSamples(xaxis.data() + startingIndex, objects->smoothGear.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->gearCurve, xaxis.data() + startingIndex, objects->smoothGear.data() + startingIndex, totalPoints);
     }
 
     if (!objects->smo2Array.empty()) {
-        objects->smo2Curve->setSamples(xaxis.data() + startingIndex, objects->smoothSmO2.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->smo2Curve, xaxis.data() + startingIndex, objects->smoothSmO2.data() + startingIndex, totalPoints);
     }
 
     if (!objects->thbArray.empty()) {
-        objects->thbCurve->setSamples(xaxis.data() + startingIndex, objects->smoothtHb.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->thbCurve, xaxis.data() + startingIndex, objects->smoothtHb.data() + startingIndex, totalPoints);
     }
 
     if (!objects->o2hbArray.empty()) {
-        objects->o2hbCurve->setSamples(xaxis.data() + startingIndex, objects->smoothO2Hb.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->o2hbCurve, xaxis.data() + startingIndex, objects->smoothO2Hb.data() + startingIndex, totalPoints);
     }
 
     if (!objects->hhbArray.empty()) {
-        objects->hhbCurve->setSamples(xaxis.data() + startingIndex, objects->smoothHHb.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->hhbCurve, xaxis.data() + startingIndex, objects->smoothHHb.data() + startingIndex, totalPoints);
     }
 
     if (!objects->npArray.empty()) {
-        objects->npCurve->setSamples(xaxis.data() + startingIndex, objects->smoothNP.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->npCurve, xaxis.data() + startingIndex, objects->smoothNP.data() + startingIndex, totalPoints);
     }
 
     if (!objects->xpArray.empty()) {
-        objects->xpCurve->setSamples(xaxis.data() + startingIndex, objects->smoothXP.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->xpCurve, xaxis.data() + startingIndex, objects->smoothXP.data() + startingIndex, totalPoints);
     }
 
     if (!objects->apArray.empty()) {
-        objects->apCurve->setSamples(xaxis.data() + startingIndex, objects->smoothAP.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->apCurve, xaxis.data() + startingIndex, objects->smoothAP.data() + startingIndex, totalPoints);
     }
 
     if (!objects->hrArray.empty()) {
-        objects->hrCurve->setSamples(xaxis.data() + startingIndex, objects->smoothHr.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->hrCurve, xaxis.data() + startingIndex, objects->smoothHr.data() + startingIndex, totalPoints);
     }
 
     if (!objects->tcoreArray.empty()) {
-        objects->tcoreCurve->setSamples(xaxis.data() + startingIndex, objects->smoothTcore.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->tcoreCurve, xaxis.data() + startingIndex, objects->smoothTcore.data() + startingIndex, totalPoints);
     }
 
     if (!objects->speedArray.empty()) {
-        objects->speedCurve->setSamples(xaxis.data() + startingIndex, objects->smoothSpeed.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->speedCurve, xaxis.data() + startingIndex, objects->smoothSpeed.data() + startingIndex, totalPoints);
     }
 
     if (!objects->accelArray.empty()) {
-        objects->accelCurve->setSamples(xaxis.data() + startingIndex, objects->smoothAccel.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->accelCurve, xaxis.data() + startingIndex, objects->smoothAccel.data() + startingIndex, totalPoints);
     }
 
     if (!objects->wattsDArray.empty()) {
-        objects->wattsDCurve->setSamples(xaxis.data() + startingIndex, objects->smoothWattsD.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->wattsDCurve, xaxis.data() + startingIndex, objects->smoothWattsD.data() + startingIndex, totalPoints);
     }
 
     if (!objects->cadDArray.empty()) {
-        objects->cadDCurve->setSamples(xaxis.data() + startingIndex, objects->smoothCadD.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->cadDCurve, xaxis.data() + startingIndex, objects->smoothCadD.data() + startingIndex, totalPoints);
     }
 
     if (!objects->nmDArray.empty()) {
-        objects->nmDCurve->setSamples(xaxis.data() + startingIndex, objects->smoothNmD.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->nmDCurve, xaxis.data() + startingIndex, objects->smoothNmD.data() + startingIndex, totalPoints);
     }
 
     if (!objects->hrDArray.empty()) {
-        objects->hrDCurve->setSamples(xaxis.data() + startingIndex, objects->smoothHrD.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->hrDCurve, xaxis.data() + startingIndex, objects->smoothHrD.data() + startingIndex, totalPoints);
     }
 
     if (!objects->cadArray.empty()) {
-        objects->cadCurve->setSamples(xaxis.data() + startingIndex, objects->smoothCad.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->cadCurve, xaxis.data() + startingIndex, objects->smoothCad.data() + startingIndex, totalPoints);
     }
 
     if (!objects->altArray.empty()) {
-        objects->altCurve->setSamples(xaxis.data() + startingIndex, objects->smoothAltitude.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->altCurve, xaxis.data() + startingIndex, objects->smoothAltitude.data() + startingIndex, totalPoints);
         objects->altSlopeCurve->setSamples(xaxis.data() + startingIndex, objects->smoothAltitude.data() + startingIndex, totalPoints);
     }
     if (!objects->slopeArray.empty()) {
-        objects->slopeCurve->setSamples(xaxis.data() + startingIndex, objects->smoothSlope.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->slopeCurve, xaxis.data() + startingIndex, objects->smoothSlope.data() + startingIndex, totalPoints);
     }
 
     if (!objects->tempArray.empty()) {
-        objects->tempCurve->setSamples(xaxis.data() + startingIndex, objects->smoothTemp.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->tempCurve, xaxis.data() + startingIndex, objects->smoothTemp.data() + startingIndex, totalPoints);
     }
 
 
@@ -2480,29 +2128,21 @@ AllPlot::recalc(AllPlotObject *objects)
     }
 
     if (!objects->torqueArray.empty()) {
-        objects->torqueCurve->setSamples(xaxis.data() + startingIndex, objects->smoothTorque.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->torqueCurve, xaxis.data() + startingIndex, objects->smoothTorque.data() + startingIndex, totalPoints);
     }
 
     // left/right pedals
     if (!objects->balanceArray.empty()) {
-        objects->balanceLCurve->setSamples(xaxis.data() + startingIndex, 
-                                           objects->smoothBalanceL.data() + startingIndex, totalPoints);
-        objects->balanceRCurve->setSamples(xaxis.data() + startingIndex, 
-                                           objects->smoothBalanceR.data() + startingIndex, totalPoints);
-    }
-    if (!objects->lteArray.empty()) objects->lteCurve->setSamples(xaxis.data() + startingIndex, 
-                                             objects->smoothLTE.data() + startingIndex, totalPoints);
-    if (!objects->rteArray.empty()) objects->rteCurve->setSamples(xaxis.data() + startingIndex, 
-                                             objects->smoothRTE.data() + startingIndex, totalPoints);
-    if (!objects->lpsArray.empty()) objects->lpsCurve->setSamples(xaxis.data() + startingIndex, 
-                                             objects->smoothLPS.data() + startingIndex, totalPoints);
-    if (!objects->rpsArray.empty()) objects->rpsCurve->setSamples(xaxis.data() + startingIndex, 
-                                             objects->smoothRPS.data() + startingIndex, totalPoints);
-
-    if (!objects->lpcoArray.empty()) objects->lpcoCurve->setSamples(xaxis.data() + startingIndex,
-                                             objects->smoothLPCO.data() + startingIndex, totalPoints);
-    if (!objects->rpcoArray.empty()) objects->rpcoCurve->setSamples(xaxis.data() + startingIndex,
-                                             objects->smoothRPCO.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->balanceLCurve, xaxis.data() + startingIndex, objects->smoothBalanceL.data() + startingIndex, totalPoints);
+        setLODSamples(this, objects->balanceRCurve, xaxis.data() + startingIndex, objects->smoothBalanceR.data() + startingIndex, totalPoints);
+    }
+    if (!objects->lteArray.empty()) setLODSamples(this, objects->lteCurve, xaxis.data() + startingIndex, objects->smoothLTE.data() + startingIndex, totalPoints);
+    if (!objects->rteArray.empty()) setLODSamples(this, objects->rteCurve, xaxis.data() + startingIndex, objects->smoothRTE.data() + startingIndex, totalPoints);
+    if (!objects->lpsArray.empty()) setLODSamples(this, objects->lpsCurve, xaxis.data() + startingIndex, objects->smoothLPS.data() + startingIndex, totalPoints);
+    if (!objects->rpsArray.empty()) setLODSamples(this, objects->rpsCurve, xaxis.data() + startingIndex, objects->smoothRPS.data() + startingIndex, totalPoints);
+
+    if (!objects->lpcoArray.empty()) setLODSamples(this, objects->lpcoCurve, xaxis.data() + startingIndex, objects->smoothLPCO.data() + startingIndex, totalPoints);
+    if (!objects->rpcoArray.empty()) setLODSamples(this, objects->rpcoCurve, xaxis.data() + startingIndex, objects->smoothRPCO.data() + startingIndex, totalPoints);
     if (!objects->lppbArray.empty()) {
         objects->lppCurve->setSamples(new QwtIntervalSeriesData(objects->smoothLPP));
     }
@@ -4093,16 +3733,14 @@ AllPlot::setDataFromPlot(AllPlot *plot)
             ourCurve->attach(this);
 
             // lets clone the data
-            QVector<QPointF> array;
-            for (size_t i=0; i<thereCurve->data()->size(); i++) array << thereCurve->data()->sample(i);
+            int samples = cloneCurveData(this, ourCurve, thereCurve);
 
-            ourCurve->setSamples(array);
             ourCurve->setYAxis(yLeft);
             ourCurve->setBaseline(thereCurve->baseline());
             ourCurve->setStyle(thereCurve->style());
 
             // symbol when zoomed in super close
-            if (array.size() < 150) {
+            if (samples < 150) {
                 QwtSymbol *sym = new QwtSymbol;
                 sym->setPen(QPen(GColor(CPLOTMARKER)));
                 sym->setStyle(QwtSymbol::Ellipse);
@@ -4122,15 +3760,13 @@ AllPlot::setDataFromPlot(AllPlot *plot)
             ourCurve2->attach(this);
 
             // lets clone the data
-            QVector<QPointF> array;
-            for (size_t i=0; i<thereCurve2->data()->size(); i++) array << thereCurve2->data()->sample(i);
+            int samples = cloneCurveData(this, ourCurve2, thereCurve2);
 
-            ourCurve2->setSamples(array);
             ourCurve2->setYAxis(yLeft);
             ourCurve2->setBaseline(thereCurve2->baseline());
 
             // symbol when zoomed in super close
-            if (array.size() < 150) {
+            if (samples < 150) {
                 QwtSymbol *sym = new QwtSymbol;
                 sym->setPen(QPen(GColor(CPLOTMARKER)));
                 sym->setStyle(QwtSymbol::Ellipse);
@@ -4193,10 +3829,14 @@ AllPlot::setDataFromPlot(AllPlot *plot)
         if (scope == RideFile::thb && thereCurve) {
 
             // minimum non-zero value... worst case its zero !
+            // look at all samples, not just those currently drawn
             double minNZ = 0.00f;
-            for (size_t i=0; i<thereCurve->data()->size(); i++) {
-                if (!minNZ) minNZ = thereCurve->data()->sample(i).y();
-                else if (thereCurve->data()->sample(i).y()<minNZ) minNZ = thereCurve->data()->sample(i).y();
+            const AllPlotLODData *lod = dynamic_cast<const AllPlotLODData*>(thereCurve->data());
+            size_t n = lod ? lod->fullSize() : thereCurve->data()->size();
+            for (size_t i=0; i<n; i++) {
+                double y = lod ? lod->fullSample(i).y() : thereCurve->data()->sample(i).y();
+                if (!minNZ) minNZ = y;
+                else if (y<minNZ) minNZ = y;
             }
             setAxisScale(QwtPlot::yLeft, minNZ, thereCurve->maxYValue() + 0.10f);
 
@@ -4855,13 +4495,8 @@ AllPlot::setDataFromPlots(QList<AllPlot *> plots)
                     ourCurve->attach(this);
 
                     // lets clone the data
-                    QVector<double> x,y;
-                    for (size_t i=0; i<thereCurve->data()->size(); i++) {
-                        x << thereCurve->data()->sample(i).x();
-                        y << thereCurve->data()->sample(i).y();
-                    }
+                    int samples = cloneCurveData(this, ourCurve, thereCurve);
 
-                    ourCurve->setSamples(x,y);
                     ourCurve->setYAxis(yLeft);
                     ourCurve->setBaseline(thereCurve->baseline());
 
@@ -4869,7 +4504,7 @@ AllPlot::setDataFromPlots(QList<AllPlot *> plots)
                     if (ourCurve->minYValue() < MINY) MINY = ourCurve->minYValue();
 
                     // symbol when zoomed in super close
-                    if (x.size() < 150) {
+                    if (samples < 150) {
                         QwtSymbol *sym = new QwtSymbol;
                         sym->setPen(QPen(GColor(CPLOTMARKER)));
                         sym->setStyle(QwtSymbol::Ellipse);
@@ -4896,10 +4531,8 @@ AllPlot::setDataFromPlots(QList<AllPlot *> plots)
                     ourCurve2->setPen(pen);
 
                     // lets clone the data
-                    QVector<QPointF> array;
-                    for (size_t i=0; i<thereCurve2->data()->size(); i++) array << thereCurve2->data()->sample(i);
+                    int samples = cloneCurveData(this, ourCurve2, thereCurve2);
 
-                    ourCurve2->setSamples(array);
                     ourCurve2->setYAxis(yLeft);
                     ourCurve2->setBaseline(thereCurve2->baseline());
 
@@ -4907,7 +4540,7 @@ AllPlot::setDataFromPlots(QList<AllPlot *> plots)
                     if (ourCurve2->minYValue() < MINY) MINY = ourCurve2->minYValue();
 
                     // symbol when zoomed in super close
-                    if (array.size() < 150) {
+                    if (samples < 150) {
                         QwtSymbol *sym = new QwtSymbol;
                         sym->setPen(QPen(GColor(CPLOTMARKER)));
                         sym->setStyle(QwtSymbol::Ellipse);
@@ -5484,6 +5117,11 @@ AllPlot::setDataFromRide(RideItem *_rideItem, QList<UserData*>user)
 void
 AllPlot::setDataFromRideFile(RideFile *ride, AllPlotObject *here, QList<UserData*>user)
 {
+    GC_TRACE("AllPlot::setDataFromRideFile");
+
+    // abandon any background smoothing of the old data
+    generation.fetchAndAddOrdered(1);
+
     if (ride && ride->dataPoints().size()) {
         const RideFileDataPresent *dataPresent = ride->areDataPresent();
         int npoints = ride->dataPoints().size();
@@ -5798,6 +5436,9 @@ AllPlot::setDataFromRideFile(RideFile *ride, AllPlotObject *here, QList<UserData
                                                : point->nm * FEET_LB_PER_NM));
             ++arrayLength;
         }
+
+        // new data so smoothing needs new prefix sums
+        here->smoothing.invalidate();
         recalc(here);
 
     }
@@ -6805,7 +6446,74 @@ AllPlot::setSmoothing(int value)
     isolation = false;
     curveColors->restoreState();
 
-    recalc(standard);
+    // compare mode smooths all the compare objects straight
+    // after, so just get it done, otherwise keep the GUI responsive
+    if (context->isCompareIntervals) recalc(standard);
+    else recalcInBackground(standard);
+}
+
+int
+AllPlot::smoothingWindow() const
+{
+    // if recintsecs is longer than the smoothing, or equal to the smoothing there is no point in even trying
+    int applysmooth = smooth <= rideItem->ride()->recIntSecs() ? 0 : smooth;
+
+    // compare mode breaks
+    if (context->isCompareIntervals && applysmooth == 0) applysmooth = 1;
+
+    return applysmooth;
+}
+
+static AllPlotSmoothing
+smoothInBackground(AllPlotSmoothing smoothing, int applysmooth, int rideTimeSecs, bool bydist)
+{
+    smoothing.smooth(applysmooth, rideTimeSecs, bydist);
+    return smoothing;
+}
+
+//
+// Smoothing a long ride can take a while, so when the smoothing slider is
+// dragged we compute in a background thread. If the smoothing changes again
+// before its done the generation changes and the old one gives up early.
+//
+void
+AllPlot::recalcInBackground(AllPlotObject *objects)
+{
+    // same as recalc for the simple cases
+    if (referencePlot != NULL || objects->timeArray.empty() || !rideItem || !rideItem->ride() ||
+        ceil(objects->timeArray.last()) > SECONDS_IN_A_WEEK || smoothingWindow() == 0) {
+        recalc(objects);
+        emit smoothed();
+        return;
+    }
+
+    // anything in progress is now out of date
+    int expected = generation.fetchAndAddOrdered(1) + 1;
+
+    // prefix sums are built once per ride
+    if (!objects->smoothing.isValid()) objects->smoothing.build(objects);
+
+    AllPlotSmoothing smoothing = objects->smoothing;
+    smoothing.setCancel(&generation, expected);
+
+    smoothObject = objects;
+    smoothWindow = smoothingWindow();
+    int rideTimeSecs = (int) ceil(objects->timeArray.last());
+
+    smoothWatcher.setFuture(QtConcurrent::run(smoothInBackground, smoothing, smoothWindow, rideTimeSecs, bydist));
+}
+
+void
+AllPlot::smoothingFinished()
+{
+    AllPlotSmoothing smoothing = smoothWatcher.result();
+
+    // cancelled, or something else has happened since
+    if (!smoothing.isComplete() || !smoothing.isCurrent() || smoothObject == NULL) return;
+
+    smoothing.apply(smoothObject);
+    setSmoothedCurves(smoothObject, smoothWindow);
+    emit smoothed();
 }
 
 void
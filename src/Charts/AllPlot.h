@@ -21,6 +21,7 @@
 #include "GoldenCheetah.h"
 #include "Colors.h"
 #include "AllPlotSlopeCurve.h"
+#include "AllPlotSmoothing.h"
 
 #include <qwt_plot.h>
 #include <qwt_axis_id.h>
@@ -40,6 +41,10 @@
 #include <QStackedWidget>
 #include <QTextEdit>
 
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+
 // span slider specials
 #include <qxtspanslider.h>
 #include <QStyleFactory>
@@ -534,6 +539,9 @@ class AllPlotObject : public QObject
     QVector<QwtIntervalSample> smoothRPPP;
     QVector<QwtIntervalSample> smoothRelSpeed;
 
+    // prefix sums for smoothing, reset when the data above changes
+    AllPlotSmoothing smoothing;
+
     // setup as copy from user data
     void setUserData(QList<UserData*>); // reset below to reflect current
     QList<UserObject> U;
@@ -592,6 +600,7 @@ class AllPlot : public QwtPlot
 
         // refresh data / plot parameters
         void recalc(AllPlotObject *objects);
+        void recalcInBackground(AllPlotObject *objects); // emits smoothed() when done
         void setYMax();
         void setLeftOnePalette(); // color of yLeft,1 axis
         void setRightPalette(); // color of yRight,0 axis
@@ -665,8 +674,12 @@ class AllPlot : public QwtPlot
         void pointHover(QwtPlotCurve*, int);
         void intervalHover(IntervalItem *h);
 
+        // background smoothing completed
+        void smoothingFinished();
+
     signals:
         void resized();
+        void smoothed();
 
     protected:
 
@@ -736,6 +749,12 @@ class AllPlot : public QwtPlot
 
         int timeoffset;
 
+        // background smoothing, generation is bumped to cancel
+        QAtomicInt generation;
+        int smoothWindow;
+        AllPlotObject *smoothObject;
+        QFutureWatcher<AllPlotSmoothing> smoothWatcher;
+
         // scope of plot (none means all, or just for a specific series
         RideFile::SeriesType scope;
         RideFile::SeriesType secondaryScope;
@@ -755,6 +774,8 @@ class AllPlot : public QwtPlot
         LTMCanvasPicker *_canvasPicker; // allow point selection/hover
         QFont labelFont;
 
+        int smoothingWindow() const;
+        void setSmoothedCurves(AllPlotObject *objects, int applysmooth);
         void setAltSlopePlotStyle (AllPlotSlopeCurve *curve);
         void setAxisScaleDiv(const QwtAxisId&, double, double, double);
         static inline void nextStep( int& step ) {
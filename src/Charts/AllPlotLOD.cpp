@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "AllPlotLOD.h"
+
+#include <qwt_plot.h>
+#include <QWidget>
+#include <algorithm>
+#include <cmath>
+
+// when we don't know how wide the canvas is
+static const int DEFAULT_PIXELS = 1024;
+
+AllPlotLODData::AllPlotLODData(const QwtPlot *plot, const double *xdata, const double *ydata, size_t count) :
+    plot(plot), spacing(0), maxLevel(0), level_(0), first(0), count(count)
+{
+    x.resize(count);
+    y.resize(count);
+    for (size_t i=0; i<count; i++) {
+        x[i] = xdata[i];
+        y[i] = ydata[i];
+    }
+    build();
+}
+
+AllPlotLODData *
+AllPlotLODData::clone(const QwtPlot *plot) const
+{
+    // vectors are implicitly shared so this is cheap
+    AllPlotLODData *copy = new AllPlotLODData;
+    copy->plot = plot;
+    copy->x = x;
+    copy->y = y;
+    copy->lo = lo;
+    copy->hi = hi;
+    copy->spacing = spacing;
+    copy->maxLevel = maxLevel;
+    copy->level_ = 0;
+    copy->first = 0;
+    copy->count = x.count();
+    copy->d_boundingRect = d_boundingRect;
+    return copy;
+}
+
+void
+AllPlotLODData::build()
+{
+    int n = x.count();
+
+    // bounding rect is needed for autoscaling, so cache it
+    if (n) {
+        double miny = y[0], maxy = y[0];
+        for (int i=1; i<n; i++) {
+            if (y[i] < miny) miny = y[i];
+            if (y[i] > maxy) maxy = y[i];
+        }
+        d_boundingRect = QRectF(x[0], miny, x[n-1]-x[0], maxy-miny);
+    }
+
+    // level 1 from the raw samples, then each level from the one below
+    const QVector<int> *belowlo = NULL, *belowhi = NULL;
+    int buckets = n;
+    while (buckets > 1) {
+
+        int above = (buckets+1) / 2;
+        QVector<int> l(above), h(above);
+
+        for (int b=0; b<above; b++) {
+
+            int i = 2*b, j = 2*b+1;
+            if (belowlo == NULL) {
+                // raw samples
+                if (j < n) {
+                    l[b] = y[j] < y[i] ? j : i;
+                    h[b] = y[j] > y[i] ? j : i;
+                } else l[b] = h[b] = i;
+            } else {
+                if (j < buckets) {
+                    int li = (*belowlo)[i], lj = (*belowlo)[j];
+                    int hi_ = (*belowhi)[i], hj = (*belowhi)[j];
+                    l[b] = y[lj] < y[li] ? lj : li;
+                    h[b] = y[hj] > y[hi_] ? hj : hi_;
+                } else {
+                    l[b] = (*belowlo)[i];
+                    h[b] = (*belowhi)[i];
+                }
+            }
+        }
+
+        lo << l;
+        hi << h;
+        belowlo = &lo.last();
+        belowhi = &hi.last();
+        buckets = above;
+    }
+    maxLevel = lo.count();
+
+    // average spacing between samples, used to limit decimation of gapped curves
+    if (n > 1) spacing = (x[n-1] - x[0]) / double(n-1);
+}
+
+void
+AllPlotLODData::setGap(double gap)
+{
+    if (gap <= 0 || spacing <= 0) return;
+
+    // output points can be up to two buckets apart
+    int allowed = 0;
+    while (allowed < lo.count() && double(2 << (allowed+1)) * spacing <= gap) allowed++;
+    maxLevel = allowed;
+}
+
+size_t
+AllPlotLODData::size() const
+{
+    return level_ ? points.count() : count;
+}
+
+QPointF
+AllPlotLODData::sample(size_t i) const
+{
+    if (level_) return points[i];
+    return QPointF(x[first+i], y[first+i]);
+}
+
+QRectF
+AllPlotLODData::boundingRect() const
+{
+    return d_boundingRect;
+}
+
+void
+AllPlotLODData::setRectOfInterest(const QRectF &rect)
+{
+    int n = x.count();
+    if (n == 0) return;
+
+    // visible samples, plus one either side so the curve reaches the edges
+    int i0 = 0, i1 = n-1;
+    if (rect.width() > 0) {
+        i0 = std::lower_bound(x.constBegin(), x.constEnd(), rect.left()) - x.constBegin();
+        i1 = std::upper_bound(x.constBegin(), x.constEnd(), rect.right()) - x.constBegin();
+        if (i0 > 0) i0--;
+        if (i1 > n-1) i1 = n-1;
+        if (i1 < i0) i1 = i0;
+    }
+    int visible = i1 - i0 + 1;
+
+    int pixels = (plot && plot->canvas()) ? plot->canvas()->width() : 0;
+    if (pixels <= 0) pixels = DEFAULT_PIXELS;
+
+    // coarsest level with at least one bucket per pixel
+    int wanted = 0;
+    while (wanted < maxLevel && (visible >> (wanted+1)) >= pixels) wanted++;
+
+    level_ = wanted;
+    points.clear();
+
+    if (level_ == 0) {
+        first = i0;
+        count = visible;
+        return;
+    }
+
+    // min and max of each bucket, in the order they occurred
+    const QVector<int> &l = lo[level_-1];
+    const QVector<int> &h = hi[level_-1];
+    int b0 = i0 >> level_;
+    int b1 = i1 >> level_;
+
+    points.reserve(2 * (b1-b0+1));
+    for (int b=b0; b<=b1; b++) {
+        int a = qMin(l[b], h[b]);
+        int c = qMax(l[b], h[b]);
+        points << QPointF(x[a], y[a]);
+        if (c != a) points << QPointF(x[c], y[c]);
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_AllPlotLOD_h
+#define _GC_AllPlotLOD_h 1
+
+#include <qwt_series_data.h>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+
+class QwtPlot;
+
+//
+// Level of detail series data for the ride plot
+//
+// A min/max pyramid is built when the data is set, level k holds the index of
+// the lowest and highest sample in each bucket of 2^k samples. When Qwt tells
+// us the visible x range (setRectOfInterest is called on every replot) we pick
+// the coarsest level that still has at least one bucket per pixel across the
+// plot canvas and return the min and max of each bucket in time order. So
+// peaks and troughs are preserved but the curve only ever gets ~2x the canvas
+// width of points. Once zoomed in far enough we return the raw samples.
+//
+// The x values must be ascending (time or distance).
+//
+class AllPlotLODData : public QwtSeriesData<QPointF>
+{
+    public:
+
+        AllPlotLODData(const QwtPlot *plot, const double *xdata, const double *ydata, size_t count);
+
+        // copy sharing the same samples and pyramid for another plot
+        AllPlotLODData *clone(const QwtPlot *plot) const;
+
+        // gapped curves treat points further apart than gap as a
+        // gap in recording, so don't decimate beyond that spacing
+        void setGap(double gap);
+
+        // QwtSeriesData, these are the points to draw for the current view
+        size_t size() const;
+        QPointF sample(size_t i) const;
+        QRectF boundingRect() const;
+        void setRectOfInterest(const QRectF &rect);
+
+        // full resolution data
+        size_t fullSize() const { return x.count(); }
+        QPointF fullSample(size_t i) const { return QPointF(x[i], y[i]); }
+
+        // current level, 0 is full resolution
+        int level() const { return level_; }
+
+    private:
+
+        AllPlotLODData() {}
+        void build();
+
+        const QwtPlot *plot;
+        QVector<double> x, y;
+
+        // lo[k-1] and hi[k-1] are level k
+        QVector<QVector<int> > lo, hi;
+
+        // average spacing of samples, ignoring gaps
+        double spacing;
+        int maxLevel;
+
+        // the current view
+        int level_;
+        size_t first, count;
+        QVector<QPointF> points;
+};
+
+#endif // _GC_AllPlotLOD_h
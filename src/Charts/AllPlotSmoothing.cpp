@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "AllPlotSmoothing.h"
+#include "AllPlot.h"
+#include "RideFile.h"
+
+// the source array for each series
+static QVector<double> AllPlotObject::* const inputs[AllPlotSmoothing::Series] = {
+    &AllPlotObject::wattsArray, &AllPlotObject::npArray, &AllPlotObject::rvArray,
+    &AllPlotObject::rcadArray, &AllPlotObject::rgctArray, &AllPlotObject::smo2Array,
+    &AllPlotObject::thbArray, &AllPlotObject::o2hbArray, &AllPlotObject::hhbArray,
+    &AllPlotObject::atissArray, &AllPlotObject::antissArray, &AllPlotObject::xpArray,
+    &AllPlotObject::apArray, &AllPlotObject::hrArray, &AllPlotObject::tcoreArray,
+    &AllPlotObject::speedArray, &AllPlotObject::accelArray, &AllPlotObject::wattsDArray,
+    &AllPlotObject::cadDArray, &AllPlotObject::nmDArray, &AllPlotObject::hrDArray,
+    &AllPlotObject::cadArray, &AllPlotObject::altArray, &AllPlotObject::slopeArray,
+    &AllPlotObject::tempArray, &AllPlotObject::windArray, &AllPlotObject::torqueArray,
+    &AllPlotObject::lteArray, &AllPlotObject::rteArray, &AllPlotObject::lpsArray,
+    &AllPlotObject::rpsArray, &AllPlotObject::lpcoArray, &AllPlotObject::rpcoArray,
+    &AllPlotObject::balanceArray,
+    &AllPlotObject::lppbArray, &AllPlotObject::rppbArray, &AllPlotObject::lppeArray,
+    &AllPlotObject::rppeArray, &AllPlotObject::lpppbArray, &AllPlotObject::rpppbArray,
+    &AllPlotObject::lpppeArray, &AllPlotObject::rpppeArray
+};
+
+// where the smoothed series goes, balance and pedal power phase are
+// split into left/right and intervals so are handled separately
+static QVector<double> AllPlotObject::* const outputs[AllPlotSmoothing::Series] = {
+    &AllPlotObject::smoothWatts, &AllPlotObject::smoothNP, &AllPlotObject::smoothRV,
+    &AllPlotObject::smoothRCad, &AllPlotObject::smoothRGCT, &AllPlotObject::smoothSmO2,
+    &AllPlotObject::smoothtHb, &AllPlotObject::smoothO2Hb, &AllPlotObject::smoothHHb,
+    &AllPlotObject::smoothAT, &AllPlotObject::smoothANT, &AllPlotObject::smoothXP,
+    &AllPlotObject::smoothAP, &AllPlotObject::smoothHr, &AllPlotObject::smoothTcore,
+    &AllPlotObject::smoothSpeed, &AllPlotObject::smoothAccel, &AllPlotObject::smoothWattsD,
+    &AllPlotObject::smoothCadD, &AllPlotObject::smoothNmD, &AllPlotObject::smoothHrD,
+    &AllPlotObject::smoothCad, &AllPlotObject::smoothAltitude, &AllPlotObject::smoothSlope,
+    &AllPlotObject::smoothTemp, &AllPlotObject::smoothWind, &AllPlotObject::smoothTorque,
+    &AllPlotObject::smoothLTE, &AllPlotObject::smoothRTE, &AllPlotObject::smoothLPS,
+    &AllPlotObject::smoothRPS, &AllPlotObject::smoothLPCO, &AllPlotObject::smoothRPCO,
+    NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+// how often to check if we've been cancelled
+static const int CHECK_EVERY = 4096;
+
+AllPlotSmoothing::AllPlotSmoothing() : valid(false), complete(false), generation(NULL), expected(0)
+{
+}
+
+void
+AllPlotSmoothing::invalidate()
+{
+    *this = AllPlotSmoothing();
+}
+
+static QVector<double>
+prefixSum(const QVector<double> &data, int count, int series)
+{
+    QVector<double> sum(count+1);
+    double total = 0, last = 0;
+    sum[0] = 0;
+
+    for (int i=0; i<count; i++) {
+        double v = i < data.count() ? data[i] : 0;
+
+        switch (series) {
+        case AllPlotSmoothing::Balance:
+            // no balance means 50/50
+            if (v <= 0) v = 50;
+            break;
+
+        case AllPlotSmoothing::Temp:
+            // carry last known temperature
+            if (v == RideFile::NA) v = last;
+            last = v;
+            break;
+
+        case AllPlotSmoothing::LTE: case AllPlotSmoothing::RTE:
+        case AllPlotSmoothing::LPS: case AllPlotSmoothing::RPS:
+        case AllPlotSmoothing::LPPB: case AllPlotSmoothing::RPPB:
+        case AllPlotSmoothing::LPPE: case AllPlotSmoothing::RPPE:
+        case AllPlotSmoothing::LPPPB: case AllPlotSmoothing::RPPPB:
+        case AllPlotSmoothing::LPPPE: case AllPlotSmoothing::RPPPE:
+            if (v < 0) v = 0;
+            break;
+
+        default:
+            break;
+        }
+
+        total += v;
+        sum[i+1] = total;
+    }
+    return sum;
+}
+
+void
+AllPlotSmoothing::build(const AllPlotObject *object)
+{
+    invalidate();
+
+    int count = object->timeArray.count();
+    time = object->timeArray;
+    distance = object->distanceArray;
+    gear = object->gearArray;
+    alt = object->altArray;
+
+    for (int s=0; s<Series; s++) {
+        const QVector<double> &data = object->*inputs[s];
+        if (!data.empty()) sums[s] = prefixSum(data, count, s);
+    }
+
+    foreach(UserObject u, object->U) {
+        usums << (u.array.empty() ? QVector<double>() : prefixSum(u.array, count, -1));
+    }
+
+    valid = true;
+}
+
+bool
+AllPlotSmoothing::smooth(int window, int rideTimeSecs, bool bydist)
+{
+    complete = false;
+    if (!valid) return false;
+
+    int points = rideTimeSecs + 1;
+    for (int s=0; s<Series; s++) {
+        smoothed[s].resize(points);
+        smoothed[s].fill(0);
+    }
+    usmoothed.resize(usums.count());
+    for (int k=0; k<usums.count(); k++) {
+        usmoothed[k].resize(points);
+        usmoothed[k].fill(0);
+    }
+    smoothTime.resize(points);
+    smoothDistance.resize(points);
+    smoothGear.resize(points);
+    smoothBalanceL.resize(points);
+    smoothBalanceR.resize(points);
+    smoothLPP.resize(points);
+    smoothRPP.resize(points);
+    smoothLPPP.resize(points);
+    smoothRPPP.resize(points);
+    smoothRelSpeed.resize(points);
+
+    // samples [lo,hi) are within the window
+    int n = time.count();
+    int lo = 0, hi = 0;
+
+    for (int secs=0; secs<points; secs++) {
+
+        if (secs % CHECK_EVERY == 0 && cancelled()) return false;
+
+        while (hi < n && time[hi] <= secs) hi++;
+        while (lo < hi && time[lo] < secs - window) lo++;
+
+        int count = hi - lo;
+        double x = secs / 60.0;
+
+        // values which must not be smoothed
+        smoothTime[secs] = x;
+        smoothGear[secs] = (hi > 0 && hi <= gear.count() && gear[hi-1] > 0) ? gear[hi-1] : 0;
+        smoothDistance[secs] = (hi > 0 && hi <= distance.count()) ? distance[hi-1] : 0;
+
+        if (count == 0) {
+
+            // all zero, apart from altitude which is held
+            smoothed[Alt][secs] = secs > 0 ? smoothed[Alt][secs-1] : (alt.empty() ? 0 : alt[0]);
+            smoothBalanceL[secs] = 50;
+            smoothBalanceR[secs] = 50;
+            smoothLPP[secs] = QwtIntervalSample();
+            smoothRPP[secs] = QwtIntervalSample();
+            smoothLPPP[secs] = QwtIntervalSample();
+            smoothRPPP[secs] = QwtIntervalSample();
+            smoothRelSpeed[secs] = QwtIntervalSample();
+            continue;
+        }
+
+        for (int s=0; s<Series; s++) {
+            if (!sums[s].empty()) smoothed[s][secs] = (sums[s][hi] - sums[s][lo]) / double(count);
+        }
+        for (int k=0; k<usums.count(); k++) {
+            if (!usums[k].empty()) usmoothed[k][secs] = (usums[k][hi] - usums[k][lo]) / double(count);
+        }
+
+        // left /right pedal data
+        double balance = smoothed[Balance][secs];
+        if (balance == 0) {
+            smoothBalanceL[secs] = 50;
+            smoothBalanceR[secs] = 50;
+        } else if (balance >= 50) {
+            smoothBalanceL[secs] = balance;
+            smoothBalanceR[secs] = 50;
+        } else {
+            smoothBalanceL[secs] = 50;
+            smoothBalanceR[secs] = balance;
+        }
+
+        double xv = bydist ? smoothDistance[secs] : x;
+        smoothLPP[secs] = QwtIntervalSample(xv, QwtInterval(smoothed[LPPB][secs], smoothed[LPPE][secs]));
+        smoothRPP[secs] = QwtIntervalSample(xv, QwtInterval(smoothed[RPPB][secs], smoothed[RPPE][secs]));
+        smoothLPPP[secs] = QwtIntervalSample(xv, QwtInterval(smoothed[LPPPB][secs], smoothed[LPPPE][secs]));
+        smoothRPPP[secs] = QwtIntervalSample(xv, QwtInterval(smoothed[RPPPB][secs], smoothed[RPPPE][secs]));
+
+        double wind = smoothed[Wind][secs];
+        double speed = smoothed[Speed][secs];
+        smoothRelSpeed[secs] = QwtIntervalSample(xv, QwtInterval(qMin(wind, speed), qMax(wind, speed)));
+    }
+
+    complete = true;
+    return true;
+}
+
+void
+AllPlotSmoothing::apply(AllPlotObject *object) const
+{
+    for (int s=0; s<Series; s++) {
+        if (outputs[s]) object->*outputs[s] = smoothed[s];
+    }
+    for (int k=0; k<object->U.count() && k<usmoothed.count(); k++) {
+        object->U[k].smooth = usmoothed[k];
+    }
+
+    object->smoothTime = smoothTime;
+    object->smoothDistance = smoothDistance;
+    object->smoothGear = smoothGear;
+    object->smoothBalanceL = smoothBalanceL;
+    object->smoothBalanceR = smoothBalanceR;
+    object->smoothLPP = smoothLPP;
+    object->smoothRPP = smoothRPP;
+    object->smoothLPPP = smoothLPPP;
+    object->smoothRPPP = smoothRPPP;
+    object->smoothRelSpeed = smoothRelSpeed;
+}
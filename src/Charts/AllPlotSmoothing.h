@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_AllPlotSmoothing_h
+#define _GC_AllPlotSmoothing_h 1
+
+#include <qwt_series_data.h>
+#include <QVector>
+#include <QAtomicInt>
+
+class AllPlotObject;
+
+//
+// Smoothing for the ride plot
+//
+// When the ride data is loaded we build a prefix sum for every series, so the
+// mean over any window of samples [lo,hi) is (sum[hi]-sum[lo])/(hi-lo). As the
+// smoothing changes we just walk two indexes along the samples and each output
+// point is O(1) regardless of the size of the smoothing window.
+//
+// As the plot always has, each sample counts the same however many seconds
+// it covers, so where the recording interval varies the mean is by sample
+// rather than by time.
+//
+// This is a value class; the prefix sums are implicitly shared so a copy can be
+// handed to a background thread to compute the smoothed series and then applied
+// to the AllPlotObject back on the GUI thread.
+//
+class AllPlotSmoothing
+{
+    public:
+
+        // the series we smooth
+        enum series { Watts=0, NP, RV, RCad, RGCT, SmO2, tHb, O2Hb, HHb, ATISS, ANTISS,
+                      XP, AP, Hr, Tcore, Speed, Accel, WattsD, CadD, NmD, HrD, Cad, Alt,
+                      Slope, Temp, Wind, Torque, LTE, RTE, LPS, RPS, LPCO, RPCO, Balance,
+                      LPPB, RPPB, LPPE, RPPE, LPPPB, RPPPB, LPPPE, RPPPE, Series };
+
+        AllPlotSmoothing();
+
+        // prefix sums of the object's ride data, built once per ride
+        void build(const AllPlotObject *object);
+        void invalidate();
+        bool isValid() const { return valid; }
+
+        // smooth over window seconds, checking *generation still matches
+        // expected as we go so a background run can be abandoned
+        void setCancel(const QAtomicInt *generation, int expected) { this->generation = generation; this->expected = expected; }
+        bool smooth(int window, int rideTimeSecs, bool bydist);
+        bool isComplete() const { return complete; }
+        bool isCurrent() const { return !cancelled(); }
+
+        // copy the smoothed series into the object
+        void apply(AllPlotObject *object) const;
+
+    private:
+
+        bool cancelled() const { return generation && generation->loadAcquire() != expected; }
+
+        bool valid, complete;
+        const QAtomicInt *generation;
+        int expected;
+
+        // ride data
+        QVector<double> time, distance, gear, alt;
+        QVector<double> sums[Series];       // count+1 entries, or empty if no data
+        QVector<QVector<double> > usums;    // user data
+
+        // results
+        QVector<double> smoothed[Series];
+        QVector<QVector<double> > usmoothed;
+        QVector<double> smoothTime, smoothDistance, smoothGear;
+        QVector<double> smoothBalanceL, smoothBalanceR;
+        QVector<QwtIntervalSample> smoothLPP, smoothRPP, smoothLPPP, smoothRPPP, smoothRelSpeed;
+};
+
+#endif // _GC_AllPlotSmoothing_h
@@ -672,6 +672,7 @@ AllPlotWindow::AllPlotWindow(Context *context) :
     static_cast<QwtPlotCanvas*>(fullPlot->canvas())->setBorderRadius(0);
     fullPlot->setWantAxis(false);
     fullPlot->setContentsMargins(0,0,0,0);
+    connect(fullPlot, SIGNAL(smoothed()), this, SLOT(fullPlotSmoothed()));
 
     HelpWhatsThis *helpFull = new HelpWhatsThis(fullPlot);
     fullPlot->setWhatsThis(helpFull->getWhatsThisText(HelpWhatsThis::ChartRides_Performance));
@@ -1830,6 +1831,7 @@ AllPlotWindow::rideSelected()
 
     // ok, its now the current ride
     current = ride;
+    currentPin.reset(ride);
 
     // setup user data if needed
     setRideForUserData();
@@ -3417,16 +3419,24 @@ AllPlotWindow::setSmoothing(int value)
 
     } else {
 
-        // recalculate etc
+        // recalculate etc, this happens in the background
+        // and we redraw when fullPlot tells us its done
         fullPlot->setSmoothing(value);
-
-        // redraw
-        redrawFullPlot();
-        redrawAllPlot();
-        redrawStackPlot();
     }
 }
 
+void
+AllPlotWindow::fullPlotSmoothed()
+{
+    // compare mode redraws as it goes
+    if (context->isCompareIntervals) return;
+
+    // redraw
+    redrawFullPlot();
+    redrawAllPlot();
+    redrawStackPlot();
+}
+
 void
 AllPlotWindow::resetSeriesStackedDatas()
 {
@@ -27,6 +27,7 @@
 #include <QStyleFactory>
 
 #include "UserData.h"
+#include "RideFileLRU.h"
 
 class AllPlot;
 class AllPlotInterval;
@@ -233,6 +234,7 @@ class AllPlotWindow : public GcChartWindow
         void setShowInterval(int state);
         void setShowHelp(int state);
         void setSmoothing(int value);
+        void fullPlotSmoothed();
         void setByDistance(int value);
         void setStacked(int value);
         void setBySeries(int value);
@@ -276,6 +278,7 @@ class AllPlotWindow : public GcChartWindow
 
         // cached state
         RideItem *current;
+        RidePin currentPin; // keep it open whilst plotted
         int selection;
         Context *context;
 
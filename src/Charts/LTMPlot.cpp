@@ -32,6 +32,7 @@
 #include "IndendPlotMarker.h"
 #include "DataFilter.h" // formulas
 #include "Utils.h"
+#include "Trace.h"
 
 #include "PMCData.h" // for LTS/STS calculation
 #include "Zones.h"
@@ -216,6 +217,8 @@ LTMPlot::setAxisTitle(QwtAxisId axis, QString label)
 void
 LTMPlot::setData(LTMSettings *set)
 {
+    GC_TRACE("LTMPlot::setData");
+
     QTime timer;
     timer.start();
 
@@ -1493,6 +1493,7 @@ RideEditor::rideSelected()
     }
 
     ride = current;
+    pin.reset(ride);
 
     // get/or setup ridefile state data
     if (ride->ride()->editorData() == NULL) {
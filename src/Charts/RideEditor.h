@@ -143,6 +143,7 @@ class RideEditor : public GcChartWindow
     protected:
         EditorData *data;
         RideItem *ride;
+        RidePin pin; // keep it open whilst editing
         RideFileTableModel *model;
         QStringList copyHeadings;
         FindDialog *findTool;
@@ -47,6 +47,9 @@
 #include "IntervalSummaryWindow.h"
 #include <QDebug>
 
+#include <algorithm>
+#include <cmath>
+
 RideMapWindow::RideMapWindow(Context *context, int mapType) : GcChartWindow(context), context(context),
                                                        range(-1), current(NULL), firstShow(true), stale(false)
 {
@@ -319,6 +322,9 @@ RideMapWindow::rideSelected()
         if (range >= 0) rideCP = context->athlete->zones(ride->isRun)->getCP(range);
     }
 
+    // points and levels for the route, and the index for mouse events
+    route.set(ride->ride());
+
     loadRide();
     smallPlot->setData(ride);
 }
@@ -429,6 +435,8 @@ void RideMapWindow::createHtml()
     "var intervalList;\n"  // array of intervals
     "var markerList;\n"  // array of markers
     "var polyList;\n"  // array of polylines
+    "var routeList;\n"  // array of polylines that follow the route
+    "var routeZoom;\n"  // zoom level they were drawn for
     "var tmpIntervalHighlighter;\n"  // temp interval
 
     // Draw the entire route, we use a local webbridge
@@ -438,12 +446,59 @@ void RideMapWindow::createHtml()
     "function drawRoute() {\n"
 #ifdef NOWEBKIT
     // load the GPS co-ordinates
-    "   webBridge.getLatLons(0, drawRouteForLatLons);\n"
+    "   webBridge.getRoute(0, drawRouteForLatLons);\n"
 #else
     // load the GPS co-ordinates
-    "    var latlons = webBridge.getLatLons(0);\n" // interval "0" is the entire route
-    "   drawRouteForLatLons(latlons);\n"
+    "    var encoded = webBridge.getRoute(0);\n" // interval "0" is the entire route
+    "   drawRouteForLatLons(encoded);\n"
 #endif
+    "}\n"
+    "\n"
+
+    // routes arrive as an encoded polyline, with the zoom
+    // level each point is needed from encoded alongside
+    "function decodeRoute(encoded) {\n"
+    "    var points = encoded[0], levels = encoded[1];\n"
+    "    var route = new Array();\n"
+    "    var index = 0, lat = 0, lng = 0;\n"
+    "    while (index < points.length) {\n"
+    "        var b, shift = 0, result = 0;\n"
+    "        do {\n"
+    "            b = points.charCodeAt(index++) - 63;\n"
+    "            result |= (b & 0x1f) << shift;\n"
+    "            shift += 5;\n"
+    "        } while (b >= 0x20);\n"
+    "        lat += (result & 1) ? ~(result >> 1) : (result >> 1);\n"
+    "        shift = result = 0;\n"
+    "        do {\n"
+    "            b = points.charCodeAt(index++) - 63;\n"
+    "            result |= (b & 0x1f) << shift;\n"
+    "            shift += 5;\n"
+    "        } while (b >= 0x20);\n"
+    "        lng += (result & 1) ? ~(result >> 1) : (result >> 1);\n"
+    "        route.push({ lat: lat * 1e-5, lng: lng * 1e-5, level: levels.charCodeAt(route.length) - 63 });\n"
+    "    }\n"
+    "    return route;\n"
+    "}\n"
+
+    // the points of a route worth drawing at this zoom
+    "function routeAt(route, zoom) {\n"
+    "    var points = new Array();\n"
+    "    if (zoom === undefined || route == null) return points;\n"
+    "    for (var j=0; j<route.length; j++) {\n"
+    "        if (route[j].level <= zoom) points.push(route[j]);\n"
+    "    }\n"
+    "    return points;\n"
+    "}\n"
+
+    // zoomed, so thin out or fill in everything on the route
+    "function redrawRoutes() {\n"
+    "    var zoom = map.getZoom();\n"
+    "    if (zoom === routeZoom) return;\n"
+    "    routeZoom = zoom;\n"
+    "    for (var j=0; j<routeList.length; j++) setRoutePath(routeList[j]);\n"
+    "    for (var j=0; j<intervalList.length; j++) setRoutePath(intervalList[j]);\n"
+    "    if (tmpIntervalHighlighter) setRoutePath(tmpIntervalHighlighter);\n"
     "}\n"
     "\n");
 
@@ -452,7 +507,23 @@ void RideMapWindow::createHtml()
         // when we have style options we draw the route in cplotmarker colors
         // and no opacity since its just a stylised map used for dashboards or
         // small thumbnails.
-        currentPage += QString("function drawRouteForLatLons(latlons) {\n"
+        currentPage += QString("function setRoutePath(polyline) {\n"
+            "    var points = routeAt(polyline.route, map.getZoom());\n"
+            "    var path = new Array();\n"
+            "    for (var j=0; j<points.length; j++) {\n"
+            "        path.push(new google.maps.LatLng(points[j].lat, points[j].lng));\n"
+            "    }\n"
+            "    polyline.setPath(path);\n"
+            "}\n"
+
+            // Listen mouse events
+            "function listenRoute(polyline) {\n"
+            "    google.maps.event.addListener(polyline, 'mousedown', function(event) { map.setOptions({draggable: false, zoomControl: false, scrollwheel: false, disableDoubleClickZoom: true}); webBridge.clickPath(event.latLng.lat(), event.latLng.lng(), map.getZoom()); });\n"
+            "    google.maps.event.addListener(polyline, 'mouseup',   function(event) { map.setOptions({draggable: true, zoomControl: true, scrollwheel: true, disableDoubleClickZoom: false}); webBridge.mouseup(); });\n"
+            "    google.maps.event.addListener(polyline, 'mouseover', function(event) { webBridge.hoverPath(event.latLng.lat(), event.latLng.lng(), map.getZoom()); });\n"
+            "}\n"
+
+            "function drawRouteForLatLons(encoded) {\n"
 
             // route will be drawn with these options
             "    var routeOptionsYellow = {\n"
@@ -467,23 +538,30 @@ void RideMapWindow::createHtml()
             "    routeYellow.setMap(map);\n"
 
             // lastly, populate the route path
-            "    var path = routeYellow.getPath();\n"
-            "    var j=0;\n"
-            "    while (j < latlons.length) { \n"
-            "        path.push(new google.maps.LatLng(latlons[j], latlons[j+1]));\n"
-            "        j += 2;\n"
-            "    }\n"
+            "    routeYellow.route = decodeRoute(encoded);\n"
+            "    setRoutePath(routeYellow);\n"
+            "    routeList.push(routeYellow);\n"
 
-            // Listen mouse events
-            "    google.maps.event.addListener(routeYellow, 'mousedown', function(event) { map.setOptions({draggable: false, zoomControl: false, scrollwheel: false, disableDoubleClickZoom: true}); webBridge.clickPath(event.latLng.lat(), event.latLng.lng()); });\n"
-            "    google.maps.event.addListener(routeYellow, 'mouseup',   function(event) { map.setOptions({draggable: true, zoomControl: true, scrollwheel: true, disableDoubleClickZoom: false}); webBridge.mouseup(); });\n"
-            "    google.maps.event.addListener(routeYellow, 'mouseover', function(event) { webBridge.hoverPath(event.latLng.lat(), event.latLng.lng()); });\n"
+            "    listenRoute(routeYellow);\n"
 
             "}\n").arg(styleoptions == "" ? "#FFFF00" : GColor(CPLOTMARKER).name())
                   .arg(styleoptions == "" ? 0.4f : 1.0f);
     }
     else if (mapCombo->currentIndex() == BING) {
-        currentPage += QString("function drawRouteForLatLons(latlons) {\n"
+        currentPage += QString("function routeLocations(route) {\n"
+              "    var points = routeAt(route, map.getZoom());\n"
+              "    var locations = new Array();\n"
+              "    for (var j=0; j<points.length; j++) {\n"
+              "        locations.push(new Microsoft.Maps.Location(points[j].lat, points[j].lng));\n"
+              "    }\n"
+              "    return locations;\n"
+              "}\n"
+
+              "function setRoutePath(polyline) {\n"
+              "    if (polyline.route) polyline.setLocations(routeLocations(polyline.route));\n"
+              "}\n"
+
+              "function drawRouteForLatLons(encoded) {\n"
               // route will be drawn with these options
               "    var routeOptionsYellow = {\n"
               "        strokeColor: new Microsoft.Maps.Color(100, 255, 255, 0),\n"
@@ -493,16 +571,13 @@ void RideMapWindow::createHtml()
               "    };\n"
 
               // create the route path
-              "    var route = new Array();\n"
-              "    var j=0;\n"
-              "    while (j < latlons.length) { \n"
-              "        route.push(new Microsoft.Maps.Location(latlons[j],latlons[j+1]));\n"
-              "        j += 2;\n"
-              "    }\n"
+              "    var route = decodeRoute(encoded);\n"
 
               // create the route Polyline
-              "    var routeYellow = new Microsoft.Maps.Polyline(route, routeOptionsYellow);\n"
+              "    var routeYellow = new Microsoft.Maps.Polyline(routeLocations(route), routeOptionsYellow);\n"
+              "    routeYellow.route = route;\n"
               "    map.entities.push(routeYellow);\n"
+              "    routeList.push(routeYellow);\n"
 
               "}\n");
     }
@@ -527,16 +602,16 @@ void RideMapWindow::createHtml()
 
     "   while (intervals > 0) {\n"
 #ifdef NOWEBKIT
-    "       webBridge.getLatLons(intervals, drawInterval);\n"
+    "       webBridge.getRoute(intervals, drawInterval);\n"
 #else
-    "       drawInterval(webBridge.getLatLons(intervals));\n"
+    "       drawInterval(webBridge.getRoute(intervals));\n"
 #endif
     "       intervals--;\n"
     "   }\n"
     "}\n");
 
     if (mapCombo->currentIndex() == GOOGLE || mapCombo->currentIndex() == OSM) {
-        currentPage += QString("function drawInterval(latlons) { \n"
+        currentPage += QString("function drawInterval(encoded) { \n"
             // intervals will be drawn with these options
             "   var polyOptions = {\n"
             "       strokeColor: '#0000FF',\n"
@@ -547,12 +622,8 @@ void RideMapWindow::createHtml()
             "   var intervalHighlighter = new google.maps.Polyline(polyOptions);\n"
             "   intervalHighlighter.setMap(map);\n"
             "   intervalList.push(intervalHighlighter);\n"
-            "   var path = intervalHighlighter.getPath();\n"
-            "   var j=0;\n"
-            "   while (j<latlons.length) {\n"
-            "       path.push(new google.maps.LatLng(latlons[j], latlons[j+1]));\n"
-            "       j += 2;\n"
-            "   }\n"
+            "   intervalHighlighter.route = decodeRoute(encoded);\n"
+            "   setRoutePath(intervalHighlighter);\n"
             "}\n"
 
             // initialise function called when map loaded
@@ -663,6 +734,11 @@ void RideMapWindow::createHtml()
             "    markerList = new Array();\n"
             "    intervalList = new Array();\n"
             "    polyList = new Array();\n"
+            "    routeList = new Array();\n"
+
+            // the route is thinned out for the zoom level, which is
+            // only known once the map has been fitted to the route
+            "    google.maps.event.addListener(map, 'zoom_changed', redrawRoutes);\n"
 
             // draw the main route data, getting the geo
             // data from the webbridge - reduces data sent/received
@@ -690,7 +766,7 @@ void RideMapWindow::createHtml()
         "</body>\n"
         "</html>\n");
     } else if (mapCombo->currentIndex() == BING) {
-        currentPage += QString("function drawInterval(latlons) { \n"
+        currentPage += QString("function drawInterval(encoded) { \n"
             // intervals will be drawn with these options
             "    var polyOptions = {\n"
             "        strokeColor: new Microsoft.Maps.Color(100, 0, 0, 255),\n"
@@ -700,15 +776,11 @@ void RideMapWindow::createHtml()
             "    };\n"
 
             // create the route path
-            "   var route = new Array();\n"
-            "   var j=0;\n"
-            "   while (j < latlons.length) { \n"
-            "        route.push(new Microsoft.Maps.Location(latlons[j],latlons[j+1]));\n"
-            "        j += 2;\n"
-            "    }\n"
+            "   var route = decodeRoute(encoded);\n"
 
             // create the route Polyline
-            "    var intervalHighlighter = new Microsoft.Maps.Polyline(route, polyOptions);\n"
+            "    var intervalHighlighter = new Microsoft.Maps.Polyline(routeLocations(route), polyOptions);\n"
+            "    intervalHighlighter.route = route;\n"
             "    map.entities.push(intervalHighlighter);\n"
             "    intervalList.push(intervalHighlighter);\n"
             "}\n"
@@ -736,6 +808,11 @@ void RideMapWindow::createHtml()
             "    markerList = new Array();\n"
             "    intervalList = new Array();\n"
             "    polyList = new Array();\n"
+            "    routeList = new Array();\n"
+            "    routeZoom = map.getZoom();\n"
+
+            // thin out or fill in the route when zooming
+            "    Microsoft.Maps.Events.addHandler(map, 'viewchangeend', redrawRoutes);\n"
 
             // draw the main route data, getting the geo
             // data from the webbridge - reduces data sent/received
@@ -769,6 +846,13 @@ QColor RideMapWindow::GetColor(int watts)
     else return zoneColor(context->athlete->zones(myRideItem ? myRideItem->isRun : false)->whichZone(range, watts), 7);
 }
 
+// quote a string for javascript, encoded polylines can contain backslashes
+static QString
+jsString(QString text)
+{
+    return "'" + text.replace("\\", "\\\\").replace("'", "\\'") + "'";
+}
+
 // create the ride line
 void
 RideMapWindow::drawShadedRoute()
@@ -778,32 +862,15 @@ RideMapWindow::drawShadedRoute()
     int count=0;  // how many samples ?
     int rwatts=0; // running total of watts
     double prevtime=0; // time for previous point
+    int begin=0; // first sample in this segment
 
-    QString code;
+    // the segments are sent in one go, each drawn from
+    // the encoded route points and coloured for power
+    QString segments;
 
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
-        if (mapCombo->currentIndex() == GOOGLE || mapCombo->currentIndex() == OSM) {
-            if (count == 0) {
-                code = QString("{\nvar polyline = new google.maps.Polyline();\n"
-                       "   polyline.setMap(map);\n"
-                       "   path = polyline.getPath();\n");
-
-                // Listen mouse events
-                code += QString("google.maps.event.addListener(polyline, 'mousedown', function(event) { map.setOptions({draggable: false, zoomControl: false, scrollwheel: false, disableDoubleClickZoom: true}); webBridge.clickPath(event.latLng.lat(), event.latLng.lng()); });\n"
-                                "google.maps.event.addListener(polyline, 'mouseup',   function(event) { map.setOptions({draggable: true, zoomControl: true, scrollwheel: true, disableDoubleClickZoom: false}); webBridge.mouseup(); });\n"
-                                "google.maps.event.addListener(polyline, 'mouseover', function(event) { webBridge.hoverPath(event.latLng.lat(), event.latLng.lng()); });\n");
-            } else {
-                if (rfp->lat || rfp->lon)
-                    code += QString("path.push(new google.maps.LatLng(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
-            }
-        } else if (mapCombo->currentIndex() == BING) {
-            if (count == 0) {
-                code = QString("{\nvar route = new Array();\n");
-            } else {
-                if (rfp->lat || rfp->lon)
-                    code += QString("route.push(new Microsoft.Maps.Location(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
-            }
-        }
+    const QVector<RideFilePoint*> &points = myRideItem->ride()->dataPoints();
+    for (int i=0; i<points.count(); i++) {
+        RideFilePoint *rfp = points[i];
 
         // running total of time
         rtime += rfp->secs - prevtime;
@@ -816,53 +883,79 @@ RideMapWindow::drawShadedRoute()
 
             int avgWatts = rwatts / count;
             QColor color = GetColor(avgWatts);
-            // thats this segment done, so finish off and
-            // add tooltip junk
             count = rwatts = rtime = 0;
 
-            if (mapCombo->currentIndex() == GOOGLE || mapCombo->currentIndex() == OSM) {
-                // color the polyline
-                code += QString("var polyOptions = {\n"
-                                "    strokeColor: '%1',\n"
-                                "    strokeWeight: 3,\n"
-                                "    strokeOpacity: %2,\n" // for out and backs, we need both
-                                "    zIndex: 0,\n"
-                                "}\n"
-                                "polyline.setOptions(polyOptions);\n"
-                                "}\n").arg(styleoptions == "" ? color.name() : GColor(CPLOTMARKER).name())
-                                      .arg(styleoptions == "" ? 0.5f : 1.0f);
+            // joined to the end of the last segment
+            int from = qMax(0, route.at(begin) - 1);
+            int to = route.at(i+1) - 1;
+            begin = i+1;
+            if (to <= from) continue;
+
+            QString encoded, levels;
+            route.encode(from, to, encoded, levels);
 
+            if (mapCombo->currentIndex() == GOOGLE || mapCombo->currentIndex() == OSM) {
+                segments += QString("[%1,%2,'%3'],\n").arg(jsString(encoded)).arg(jsString(levels))
+                                    .arg(styleoptions == "" ? color.name() : GColor(CPLOTMARKER).name());
             } else if (mapCombo->currentIndex() == BING) {
-                // color the polyline
-                code += QString("    var polyOptions = {\n"
-                                "        strokeColor: new Microsoft.Maps.Color(200, %1, %2, %3),\n"
-                                "        strokeThickness: 3,\n"
-                                "        strokeDashArray: '5 0',\n"
-                                "        zIndex: 1\n"
-                                "    };\n"
-                                "    var polyline = new Microsoft.Maps.Polyline(route, polyOptions);\n"
-                                "    polyline.setOptions(polyOptions);\n"
-                                "    map.entities.push(polyline);\n"
-                                "}\n").arg(color.red())
-                                      .arg(color.green())
-                                      .arg(color.blue());
+                segments += QString("[%1,%2,%3,%4,%5],\n").arg(jsString(encoded)).arg(jsString(levels))
+                                    .arg(color.red()).arg(color.green()).arg(color.blue());
             }
+        }
+    }
 
-        #ifdef NOWEBKIT
-            view->page()->runJavaScript(code);
-        #else
-            view->page()->mainFrame()->evaluateJavaScript(code);
-        #endif
+    QString code;
+    if (mapCombo->currentIndex() == GOOGLE || mapCombo->currentIndex() == OSM) {
+        code = QString("{\nvar segments = [\n%1];\n"
+                       "for (var j=0; j<segments.length; j++) {\n"
+                       "    var polyOptions = {\n"
+                       "        strokeColor: segments[j][2],\n"
+                       "        strokeWeight: 3,\n"
+                       "        strokeOpacity: %2,\n" // for out and backs, we need both
+                       "        zIndex: 0,\n"
+                       "    }\n"
+                       "    var polyline = new google.maps.Polyline(polyOptions);\n"
+                       "    polyline.route = decodeRoute(segments[j]);\n"
+                       "    setRoutePath(polyline);\n"
+                       "    polyline.setMap(map);\n"
+                       "    routeList.push(polyline);\n"
+                       "    listenRoute(polyline);\n"
+                       "}\n"
+                       "}\n").arg(segments)
+                             .arg(styleoptions == "" ? 0.5f : 1.0f);
 
-        }
+    } else if (mapCombo->currentIndex() == BING) {
+        code = QString("{\nvar segments = [\n%1];\n"
+                       "for (var j=0; j<segments.length; j++) {\n"
+                       "    var polyOptions = {\n"
+                       "        strokeColor: new Microsoft.Maps.Color(200, segments[j][2], segments[j][3], segments[j][4]),\n"
+                       "        strokeThickness: 3,\n"
+                       "        strokeDashArray: '5 0',\n"
+                       "        zIndex: 1\n"
+                       "    };\n"
+                       "    var route = decodeRoute(segments[j]);\n"
+                       "    var polyline = new Microsoft.Maps.Polyline(routeLocations(route), polyOptions);\n"
+                       "    polyline.route = route;\n"
+                       "    map.entities.push(polyline);\n"
+                       "    routeList.push(polyline);\n"
+                       "}\n"
+                       "}\n").arg(segments);
     }
 
+#ifdef NOWEBKIT
+    view->page()->runJavaScript(code);
+#else
+    view->page()->mainFrame()->evaluateJavaScript(code);
+#endif
 }
 
 void
 RideMapWindow::clearTempInterval() {
     QString code = QString( "{ \n"
-                            "    tmpIntervalHighlighter.getPath().clear();\n"
+                            "    if (tmpIntervalHighlighter) {\n"
+                            "        tmpIntervalHighlighter.route = null;\n"
+                            "        tmpIntervalHighlighter.getPath().clear();\n"
+                            "    }\n"
                             "}\n" );
 
 #ifdef NOWEBKIT
@@ -888,22 +981,15 @@ RideMapWindow::drawTempInterval(IntervalItem *current) {
                     "       tmpIntervalHighlighter = new google.maps.Polyline(polyOptions);\n"
                     "       tmpIntervalHighlighter.setMap(map);\n"
                     "       google.maps.event.addListener(tmpIntervalHighlighter, 'mouseup',   function(event) { map.setOptions({draggable: true, zoomControl: true, scrollwheel: true, disableDoubleClickZoom: false}); webBridge.mouseup(); });\n"
-                    "    } \n"
-
-                    "    var path = tmpIntervalHighlighter.getPath();\n"
-                    "    path.clear();\n");
-
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
-        if (rfp->secs+myRideItem->ride()->recIntSecs() > current->start
-            && rfp->secs< current->stop) {
-
-            if (rfp->lat || rfp->lon) {
-                code += QString("    path.push(new google.maps.LatLng(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
-            }
-        }
-    }
+                    "    } \n");
 
+    // same points as the interval when it is drawn
+    int from, to;
+    QString encoded, levels;
+    if (route.range(current->start, current->stop, from, to)) route.encode(from, to, encoded, levels);
 
+    code += QString("    tmpIntervalHighlighter.route = decodeRoute([%1,%2]);\n"
+                    "    setRoutePath(tmpIntervalHighlighter);\n").arg(jsString(encoded)).arg(jsString(levels));
 
     code += QString("}\n" );
 
@@ -1206,12 +1292,13 @@ MapWebBridge::intervalCount()
     return 0;
 }
 
-// get a latlon array for the i'th selected interval
-QVariantList
-MapWebBridge::getLatLons(int i)
+// get the encoded route for the i'th selected interval
+QStringList
+MapWebBridge::getRoute(int i)
 {
-    QVariantList latlons;
+    QString points, levels;
     RideItem *rideItem = mw->property("ride").value<RideItem*>();
+    const MapRoute &route = mw->mapRoute();
 
     if (rideItem && i > 0 && rideItem->intervalsSelected().count() >= i) {
 
@@ -1219,29 +1306,16 @@ MapWebBridge::getLatLons(int i)
 
         // so this one is the interval we need.. lets
         // snaffle up the points in this section
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->secs+rideItem->ride()->recIntSecs() > current->start
-                && p1->secs< current->stop) {
-
-                if (p1->lat || p1->lon) {
-                    latlons << p1->lat;
-                    latlons << p1->lon;
-                }
-            }
-        }
-        return latlons;
+        int from, to;
+        if (route.range(current->start, current->stop, from, to))
+            route.encode(from, to, points, levels);
 
     } else if (rideItem) {
 
         // get latlons for entire route
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->lat || p1->lon) {
-                latlons << p1->lat;
-                latlons << p1->lon;
-            }
-        }
+        route.encode(0, route.count()-1, points, levels);
     }
-    return latlons;
+    return QStringList() << points << levels;
 }
 
 // once the basic map and route have been marked, overlay markers, shaded areas etc
@@ -1283,33 +1357,33 @@ MapWebBridge::clearHover()
 {
 }
 
+// mouse positions are where the line is drawn, which is within a few
+// pixels of the samples, wherever the map is zoomed to
+static const double SEARCH_PIXELS = 3;
+static const double SEARCH_MINIMUM = 0.0001;
+
 QList<RideFilePoint*>
-MapWebBridge::searchPoint(double lat, double lng)
+MapWebBridge::searchPoint(double lat, double lng, int zoom)
 {
     QList<RideFilePoint*> list;
 
     RideItem *rideItem = mw->property("ride").value<RideItem*>();
+    if (!rideItem || !rideItem->ride()) return list;
 
-    RideFilePoint *candidat = NULL;
-    foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-        if (p1->lat == 0 && p1->lon == 0)
-            continue;
-
-        if (((p1->lat-lat> 0 && p1->lat-lat< 0.0001) || (p1->lat-lat< 0 && p1->lat-lat> -0.0001)) &&
-            ((p1->lon-lng> 0 && p1->lon-lng< 0.0001) || (p1->lon-lng< 0 && p1->lon-lng> -0.0001))) {
-            // Vérifie distance avec dernier candidat
-            candidat = p1;
-        } else if (candidat)  {
-            list.append(candidat);
-            candidat = NULL;
-        }
+    double radius = SEARCH_MINIMUM;
+    if (zoom >= 0 && zoom <= 30) radius = qMax(SEARCH_MINIMUM, SEARCH_PIXELS * 360.0 / (256.0 * (1 << zoom)));
+
+    // the nearest sample each time the ride passed by
+    const QVector<RideFilePoint*> &points = rideItem->ride()->dataPoints();
+    foreach (int sample, mw->mapRoute().search(lat, lng, radius)) {
+        if (sample < points.count()) list.append(points[sample]);
     }
 
     return list;
 }
 
 void
-MapWebBridge::hoverPath(double lat, double lng)
+MapWebBridge::hoverPath(double lat, double lng, int zoom)
 {
     if (point) {
 
@@ -1322,7 +1396,7 @@ MapWebBridge::hoverPath(double lat, double lng)
 
             if (last->name.startsWith(name) && last->rideInterval) { 
 
-                QList<RideFilePoint*> list = searchPoint(lat, lng);
+                QList<RideFilePoint*> list = searchPoint(lat, lng, zoom);
 
                 if (list.count() > 0)  {
 
@@ -1363,12 +1437,12 @@ MapWebBridge::hoverPath(double lat, double lng)
 }
 
 void
-MapWebBridge::clickPath(double lat, double lng)
+MapWebBridge::clickPath(double lat, double lng, int zoom)
 {
     selection++;
     RideItem *rideItem = mw->property("ride").value<RideItem*>();
     QString name = QString(tr("Selection #%1 ")).arg(selection);
-    QList<RideFilePoint*> list = searchPoint(lat, lng);
+    QList<RideFilePoint*> list = searchPoint(lat, lng, zoom);
 
     if (list.count() > 0)  {
 
@@ -1396,6 +1470,246 @@ MapWebBridge::mouseup()
 }
 
 
+//
+// MapRoute
+//
+
+// zoom levels go up to 22, a point needed at none of them is never drawn
+static const int MAXZOOM = 22;
+
+// simplify to within half a pixel, lines look the same
+static const double TOLERANCE = 0.5;
+
+// grid for searching, about 50m
+static const double CELL = 0.0005;
+
+// degrees of longitude per pixel at a zoom level
+static double pixelAt(int zoom) { return 360.0 / (256.0 * (1 << zoom)); }
+
+static qint64 cellKey(int y, int x) { return (qint64(y) << 32) | quint32(x); }
+
+// distance from p to the line segment a-b
+static double
+offset(double px, double py, double ax, double ay, double bx, double by)
+{
+    double dx = bx - ax, dy = by - ay;
+    double length = dx*dx + dy*dy;
+    double t = length > 0 ? ((px-ax)*dx + (py-ay)*dy) / length : 0;
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    double ex = ax + t*dx - px, ey = ay + t*dy - py;
+    return sqrt(ex*ex + ey*ey);
+}
+
+// part of the route still to simplify, and the most its points can be kept for
+struct MapSpan { int from, to; double limit; };
+
+// add a value to an encoded polyline
+static void
+encodeValue(QString &out, int value)
+{
+    value = value < 0 ? ~(value << 1) : (value << 1);
+    while (value >= 0x20) {
+        out += QChar((0x20 | (value & 0x1f)) + 63);
+        value >>= 5;
+    }
+    out += QChar(value + 63);
+}
+
+void
+MapRoute::clear()
+{
+    recInt = 0;
+    index.clear();
+    lats.clear();
+    lons.clear();
+    times.clear();
+    zooms.clear();
+    grid.clear();
+}
+
+void
+MapRoute::set(RideFile *ride)
+{
+    clear();
+    if (!ride) return;
+
+    recInt = ride->recIntSecs();
+
+    // the samples we can draw
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    for (int i=0; i<points.count(); i++) {
+        RideFilePoint *p = points[i];
+        if (p->lat || p->lon) {
+            index << i;
+            lats << p->lat;
+            lons << p->lon;
+            times << p->secs;
+        }
+    }
+
+    simplify();
+
+    // and where they are
+    for (int i=0; i<lats.count(); i++) {
+        grid[cellKey(int(floor(lats[i] / CELL)), int(floor(lons[i] / CELL)))] << i;
+    }
+}
+
+// Douglas-Peucker, but rather than for a single tolerance we record the
+// distance each point was kept for, limited by the points it was found
+// between, so any tolerance can be applied later by comparing them
+void
+MapRoute::simplify()
+{
+    int n = lats.count();
+    zooms = QVector<unsigned char>(n, MAXZOOM);
+    if (n == 0) return;
+
+    // web mercator, so distances are in pixels at any zoom
+    QVector<double> x(n), y(n);
+    for (int i=0; i<n; i++) {
+        double lat = qBound(-85.0, lats[i], 85.0) * DEG_TO_RAD;
+        x[i] = lons[i];
+        y[i] = log(tan(M_PI/4 + lat/2)) / DEG_TO_RAD;
+    }
+
+    QVector<double> kept(n, 0);
+    kept[0] = kept[n-1] = HUGE_VAL;
+
+    // spans left to look at, rather than recursing
+    QVector<MapSpan> todo;
+    MapSpan all = { 0, n-1, HUGE_VAL };
+    todo << all;
+
+    while (!todo.isEmpty()) {
+        MapSpan s = todo.last();
+        todo.pop_back();
+        if (s.to - s.from < 2) continue;
+
+        // furthest from the line between the ends
+        int furthest = s.from + 1;
+        double distance = -1;
+        for (int i=s.from+1; i<s.to; i++) {
+            double d = offset(x[i], y[i], x[s.from], y[s.from], x[s.to], y[s.to]);
+            if (d > distance) {
+                distance = d;
+                furthest = i;
+            }
+        }
+
+        kept[furthest] = qMin(distance, s.limit);
+        MapSpan left = { s.from, furthest, kept[furthest] };
+        MapSpan right = { furthest, s.to, kept[furthest] };
+        todo << left << right;
+    }
+
+    // the first zoom level each point makes a difference at
+    for (int i=0; i<n; i++) {
+        int level = 0;
+        while (level < MAXZOOM && kept[i] <= TOLERANCE * pixelAt(level)) level++;
+        zooms[i] = level;
+    }
+}
+
+int
+MapRoute::at(int sample) const
+{
+    return std::lower_bound(index.begin(), index.end(), sample) - index.begin();
+}
+
+bool
+MapRoute::range(double start, double stop, int &from, int &to) const
+{
+    // same test as used when selecting samples for intervals
+    // secs + recIntSecs > start && secs < stop
+    from = std::upper_bound(times.begin(), times.end(), start - recInt) - times.begin();
+    to = (std::lower_bound(times.begin(), times.end(), stop) - times.begin()) - 1;
+    return from <= to;
+}
+
+void
+MapRoute::encode(int from, int to, QString &points, QString &levels) const
+{
+    points.clear();
+    levels.clear();
+
+    from = qMax(0, from);
+    to = qMin(count()-1, to);
+    if (from > to) return;
+
+    points.reserve((to - from + 1) * 8);
+    levels.reserve(to - from + 1);
+
+    int lat=0, lon=0;
+    for (int i=from; i<=to; i++) {
+
+        int nlat = qRound(lats[i] * 1e5);
+        int nlon = qRound(lons[i] * 1e5);
+        encodeValue(points, nlat - lat);
+        encodeValue(points, nlon - lon);
+        lat = nlat;
+        lon = nlon;
+
+        // the ends are always drawn
+        levels += QChar((i == from || i == to ? 0 : zooms[i]) + 63);
+    }
+}
+
+QList<int>
+MapRoute::search(double lat, double lon, double radius) const
+{
+    QList<int> returning;
+    if (count() == 0) return returning;
+
+    int y0 = int(floor((lat - radius) / CELL)), y1 = int(floor((lat + radius) / CELL));
+    int x0 = int(floor((lon - radius) / CELL)), x1 = int(floor((lon + radius) / CELL));
+
+    // route points inside the box, in order
+    QVector<int> near;
+    if (qint64(y1 - y0 + 1) * qint64(x1 - x0 + 1) > grid.count()) {
+
+        // zoomed well out, quicker to look at them all
+        for (int i=0; i<count(); i++) {
+            if (fabs(lats[i] - lat) < radius && fabs(lons[i] - lon) < radius) near << i;
+        }
+
+    } else {
+
+        for (int y=y0; y<=y1; y++) {
+            for (int x=x0; x<=x1; x++) {
+                QHash<qint64, QVector<int> >::const_iterator cell = grid.find(cellKey(y, x));
+                if (cell == grid.end()) continue;
+                foreach (int i, cell.value()) {
+                    if (fabs(lats[i] - lat) < radius && fabs(lons[i] - lon) < radius) near << i;
+                }
+            }
+        }
+        std::sort(near.begin(), near.end());
+    }
+
+    // each run of consecutive points is one pass, keep the nearest
+    double scale = cos(lat * DEG_TO_RAD);
+    int nearest = -1;
+    double distance = 0;
+    for (int j=0; j<near.count(); j++) {
+        int i = near[j];
+        if (nearest >= 0 && i != near[j-1] + 1) {
+            returning << index[nearest];
+            nearest = -1;
+        }
+        double dy = lats[i] - lat, dx = (lons[i] - lon) * scale;
+        double d = dx*dx + dy*dy;
+        if (nearest < 0 || d < distance) {
+            nearest = i;
+            distance = d;
+        }
+    }
+    if (nearest >= 0) returning << index[nearest];
+
+    return returning;
+}
+
 bool
 RideMapWindow::event(QEvent *event)
 {
@@ -24,6 +24,8 @@
 
 #include <QWidget>
 #include <QDialog>
+#include <QHash>
+#include <QVector>
 
 #include <string>
 #include <iostream>
@@ -72,6 +74,46 @@ class mapWebPage : public QWebPage
 };
 #endif
 
+// The route as drawn on the map, built once when the ride is selected.
+//
+// Every point is sent to the page only once, as an encoded polyline along with the
+// zoom level it first matters at (when Douglas-Peucker would keep it at a tolerance
+// of half a pixel), so the page can thin the route out as it zooms without coming
+// back to us. Mouse events on the route are mapped back to samples using a grid so
+// we don't need to search the whole ride each time the mouse moves.
+class MapRoute
+{
+    public:
+        MapRoute() : recInt(0) {}
+
+        void set(RideFile *ride);
+        void clear();
+
+        // route points, the samples that have a position
+        int count() const { return lats.count(); }
+
+        // first route point at or after a sample
+        int at(int sample) const;
+
+        // route points in the time range, as selected for intervals
+        bool range(double start, double stop, int &from, int &to) const;
+
+        // route points from..to as an encoded polyline and the zoom level for each
+        void encode(int from, int to, QString &points, QString &levels) const;
+
+        // samples within radius degrees, the nearest each time the ride passes by
+        QList<int> search(double lat, double lon, double radius) const;
+
+    private:
+        void simplify();
+
+        double recInt;
+        QVector<int> index; // sample in the ride
+        QVector<double> lats, lons, times;
+        QVector<unsigned char> zooms; // first zoom level each point is drawn at
+        QHash<qint64, QVector<int> > grid;
+};
+
 class MapWebBridge : public QObject
 {
     Q_OBJECT
@@ -83,17 +125,17 @@ class MapWebBridge : public QObject
         RideFilePoint* point;
         int selection;
 
-        QList<RideFilePoint*> searchPoint(double lat, double lng);
+        QList<RideFilePoint*> searchPoint(double lat, double lng, int zoom);
 
     public:
-        MapWebBridge(Context *context, RideMapWindow *mw) : context(context), mw(mw), selection(0) {}
+        MapWebBridge(Context *context, RideMapWindow *mw) : context(context), mw(mw), point(NULL), selection(0) {}
 
     public slots:
         Q_INVOKABLE void call(int count);
 
         // drawing basic route, and interval polylines
         Q_INVOKABLE int intervalCount();
-        Q_INVOKABLE QVariantList getLatLons(int i); // get array of latitudes for highlighted n
+        Q_INVOKABLE QStringList getRoute(int i); // get encoded route for highlighted n
 
         // once map and basic route is loaded
         // this slot is called to draw additional
@@ -104,8 +146,8 @@ class MapWebBridge : public QObject
         Q_INVOKABLE void toggleInterval(int);
         Q_INVOKABLE void hoverInterval(int);
         Q_INVOKABLE void clearHover();
-        Q_INVOKABLE void hoverPath(double lat, double lng);
-        Q_INVOKABLE void clickPath(double lat, double lng);
+        Q_INVOKABLE void hoverPath(double lat, double lng, int zoom);
+        Q_INVOKABLE void clickPath(double lat, double lng, int zoom);
         Q_INVOKABLE void mouseup();
 
         void intervalsChanged() { emit drawIntervals(); }
@@ -171,6 +213,8 @@ class RideMapWindow : public GcChartWindow
         QString getStyleOptions() const { return styleoptions; }
         void setStyleOptions(QString x) { styleoptions=x; }
 
+        const MapRoute &mapRoute() const { return route; }
+
     public slots:
         void mapTypeSelected(int x);
         void tileTypeSelected(int x);
@@ -211,6 +255,7 @@ class RideMapWindow : public GcChartWindow
 #endif
 
         MapWebBridge *webBridge;
+        MapRoute route;
 
         RideMapWindow();  // default ctor
         int range;
@@ -17,6 +17,7 @@
  */
 
 #include "CloudService.h"
+#include "CloudServiceScheduler.h"
 
 #include "Athlete.h"
 #include "RideCache.h"
@@ -271,20 +272,18 @@ CloudService::uncompressRide(QByteArray *data, QString name, QStringList &errors
         jsonData = *data;
     }
 
-    // uncompress and write to tmp preserviing the file extension
-    QString tmp = context->athlete->home->temp().absolutePath() + "/" + QFileInfo(name).baseName() + "." + QFileInfo(name).suffix();
-
-    // uncompress and write a file
-    QFile file(tmp);
-    file.open(QFile::WriteOnly);
-    file.write(jsonData);
-    file.close();
+    // uncompress and write to tmp preserving the base name and file extension, but
+    // unique since the sync dialog may be unpacking several at once on worker threads
+    QTemporaryFile tmp(context->athlete->home->temp().absolutePath() + "/" + QFileInfo(name).baseName() + ".XXXXXX." + QFileInfo(name).suffix());
+    tmp.open();
+    tmp.write(jsonData);
+    tmp.close();
 
     // read the file in using the correct ridefile reader
+    QFile file(tmp.fileName());
     RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
 
-    // remove temp
-    file.remove();
+    // temp is removed when it goes out of scope
 
     // return whatever we got
     return ride;
@@ -661,7 +660,8 @@ FolderNameDialog::FolderNameDialog(QWidget *parent) : QDialog(parent)
 }
 
 CloudServiceSyncDialog::CloudServiceSyncDialog(Context *context, CloudService *store)
-    : QDialog(context->mainWindow, Qt::Dialog), context(context), store(store), downloading(false), aborted(false)
+    : QDialog(context->mainWindow, Qt::Dialog), context(context), store(store), scheduler(NULL), transferring(NULL),
+      transferTab(0), downloading(false), aborted(false)
 {
     setWindowTitle(tr("Synchronise ") + store->uiName());
     setMinimumSize(850 *dpiXFactor,450 *dpiYFactor);
@@ -699,9 +699,13 @@ CloudServiceSyncDialog::CloudServiceSyncDialog(Context *context, CloudService *s
     QVBoxLayout *uploadLayout = new QVBoxLayout(upload);
     QVBoxLayout *syncLayout = new QVBoxLayout(sync);
 
-    // notification when upload/download completes
-    connect (store, SIGNAL(writeComplete(QString,QString)), this, SLOT(completedWrite(QString,QString)));
-    connect (store, SIGNAL(readComplete(QByteArray*,QString,QString)), this, SLOT(completedRead(QByteArray*,QString,QString)));
+    // moves the activities, several at a time
+    scheduler = new CloudServiceScheduler(context, store, this);
+    connect(scheduler, SIGNAL(started(int)), this, SLOT(transferStarted(int)));
+    connect(scheduler, SIGNAL(retrying(int,int)), this, SLOT(transferRetrying(int,int)));
+    connect(scheduler, SIGNAL(downloaded(int,RideFile*,QStringList)), this, SLOT(transferDownloaded(int,RideFile*,QStringList)));
+    connect(scheduler, SIGNAL(uploaded(int,bool,QString)), this, SLOT(transferUploaded(int,bool,QString)));
+    connect(scheduler, SIGNAL(finished()), this, SLOT(transfersFinished()));
 
     // combo box
     athleteCombo = new QComboBox(this);
@@ -1214,328 +1218,216 @@ void
 CloudServiceSyncDialog::downloadClicked()
 {
     if (downloading == true) {
+
+        // mark those in flight, the rest never started
+        foreach(int id, scheduler->abort()) {
+            QTreeWidgetItem *curr = transferItem(id);
+            if (curr) curr->setText(statusColumn(), tr("Aborted"));
+        }
+
         rideListDown->setSortingEnabled(true);
         rideListUp->setSortingEnabled(true);
+        rideListSync->setSortingEnabled(true);
         progressLabel->setText("");
         downloadButton->setText(tr("Download"));
         downloading=false;
         aborted=true;
         cancelButton->show();
         return;
-    } else {
-        rideListDown->setSortingEnabled(false);
-        rideListUp->setSortingEnabled(true);
-        downloading=true;
-        aborted=false;
-        downloadButton->setText(tr("Abort"));
-        cancelButton->hide();
     }
 
+    // rows are referenced by index whilst transferring
+    // so the list must stay in the same order
+    transferTab = tabs->currentIndex();
+    switch(transferTab) {
+        case 0 : transferring = rideListDown; break;
+        case 1 : transferring = rideListUp; break;
+        default:
+        case 2 : transferring = rideListSync; break;
+    }
+    transferring->setSortingEnabled(false);
+
+    downloading=true;
+    aborted=false;
+    sync = (transferTab == 2);
+    downloadButton->setText(tr("Abort"));
+    cancelButton->hide();
+
     // keeping track of progress...
     downloadcounter = 0;
     successful = 0;
     downloadtotal = 0;
-    listindex = 0;
 
-    QTreeWidget *which = NULL;
-    switch(tabs->currentIndex()) {
-        case 0 : which = rideListDown; break;
-        case 1 : which = rideListUp; break;
-        default:
-        case 2 : which = rideListSync; break;
-    }
+    for (int i=0; i<transferring->invisibleRootItem()->childCount(); i++) {
+        QTreeWidgetItem *curr = transferring->invisibleRootItem()->child(i);
+        QCheckBox *check = (QCheckBox*)transferring->itemWidget(curr, 0);
+
+        if (!check->isChecked()) continue;
+        downloadtotal++;
+
+        switch(transferTab) {
+        case 0 :
+            {
+                // skip existing if overwrite not set
+                QCheckBox *exists = (QCheckBox*)transferring->itemWidget(curr, 4);
+                if (exists->isChecked() && !overwrite->isChecked()) {
+                    curr->setText(5, tr("File exists"));
+                    downloadcounter++;
+                } else {
+                    scheduler->download(i, curr->text(1), curr->text(6));
+                }
+            }
+            break;
+
+        case 1 :
+            {
+                // skip existing if overwrite not set
+                QCheckBox *exists = (QCheckBox*)transferring->itemWidget(curr, 6);
+                if (exists->isChecked() && !overwrite->isChecked()) {
+                    curr->setText(7, tr("File exists"));
+                    downloadcounter++;
+                } else {
+                    scheduler->upload(i, curr->text(1));
+                }
+            }
+            break;
 
-    for (int i=0; i<which->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = which->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)which->itemWidget(curr, 0);
-        if (check->isChecked()) {
-            downloadtotal++;
+        default:
+        case 2 :
+            if (curr->text(6) == tr("Download")) scheduler->download(i, curr->text(1), curr->text(8));
+            else scheduler->upload(i, curr->text(1));
+            break;
         }
     }
 
-    if (downloadtotal) {
-        progressBar->setMaximum(downloadtotal);
-        progressBar->setMinimum(0);
-        progressBar->setValue(0);
-    }
+    progressBar->setMinimum(0);
+    progressBar->setMaximum(downloadtotal ? downloadtotal : 1);
+    progressBar->setValue(downloadcounter);
+    refreshProgress();
 
-    // even if nothing to download this
+    // even if nothing to transfer this
     // cleans up variables et al
-    sync = false;
-    switch(tabs->currentIndex()) {
-        case 0 : downloadNext(); break;
-        case 1 : uploadNext(); break;
-        case 2 : sync = true; syncNext(); break;
-    }
+    scheduler->start();
 }
 
-bool
-CloudServiceSyncDialog::syncNext()
+QTreeWidgetItem *
+CloudServiceSyncDialog::transferItem(int id)
 {
-    // the actual download/upload is kicked off using the uploader / downloader
-    // if in sync mode the completedRead / completedWrite functions
-    // just call completedSync to get the next Sync done
-    for (int i=listindex; i<rideListSync->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListSync->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListSync->itemWidget(curr, 0);
-
-        if (check->isChecked()) {
-
-            listindex = i+1; // start from the next one
-
-            progressLabel->setText(QString(tr("Processed %1 of %2")).arg(downloadcounter).arg(downloadtotal));
-            if (curr->text(6) == tr("Download")) {
-                curr->setText(7, tr("Downloading"));
-                rideListSync->setCurrentItem(curr);
-
-                QByteArray *data = new QByteArray;
-                store->readFile(data, curr->text(1), curr->text(8)); // filename
-                QApplication::processEvents();
-
-            } else {
-                curr->setText(7, tr("Uploading"));
-                rideListSync->setCurrentItem(curr);
-
-                // read in the file
-                QStringList errors;
-                QFile file(context->athlete->home->activities().canonicalPath() + "/" + curr->text(1));
-                RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
-
-                if (ride) {
-
-                    // get a compressed version
-                    QByteArray data;
-                    store->compressRide(ride, data, QFileInfo(curr->text(1)).baseName() + ".json");
-
-                    store->writeFile(data, QFileInfo(curr->text(1)).baseName() + store->uploadExtension(), ride);
-                    QApplication::processEvents();
-                    delete ride; // clean up!
-                    return true;
-
-                } else {
-                    curr->setText(7, tr("Parse failure"));
-                    QApplication::processEvents();
-                }
-
-            }
-            return true;
-        }
-    }
-
-    //
-    // Our work is done!
-    //
-    rideListDown->setSortingEnabled(true);
-    rideListUp->setSortingEnabled(true);
-    rideListSync->setSortingEnabled(true);
-    progressLabel->setText(tr("Sync complete"));
-    downloadButton->setText(tr("Synchronize"));
-    downloading=false;
-    aborted=false;
-    sync=false;
-    cancelButton->show();
-    selectAllSync->setChecked(Qt::Unchecked);
-    for (int i=0; i<rideListSync->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListSync->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListSync->itemWidget(curr, 0);
-        check->setChecked(false);
-    }
-    progressLabel->setText(QString(tr("Processed %1 of %2 successfully")).arg(successful).arg(downloadtotal));
-
-    // save the ride cache, we don't want to lose that if we crash etc.
-    context->athlete->rideCache->save();
-
-    return false;
+    // may have been refreshed whilst we were busy
+    if (transferring == NULL || id >= transferring->invisibleRootItem()->childCount()) return NULL;
+    return transferring->invisibleRootItem()->child(id);
 }
 
-bool
-CloudServiceSyncDialog::downloadNext()
+int
+CloudServiceSyncDialog::statusColumn() const
 {
-    for (int i=listindex; i<rideListDown->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListDown->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListDown->itemWidget(curr, 0);
-        QCheckBox *exists = (QCheckBox*)rideListDown->itemWidget(curr, 4);
-
-        // skip existing if overwrite not set
-        if (check->isChecked() && exists->isChecked() && !overwrite->isChecked()) {
-            curr->setText(5, tr("File exists"));
-            progressBar->setValue(++downloadcounter);
-            continue;
-        }
-
-        if (check->isChecked()) {
-
-            listindex = i+1; // start from the next one
-            curr->setText(5, tr("Downloading"));
-            rideListDown->setCurrentItem(curr);
-            progressLabel->setText(QString(tr("Downloaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
-
-            QByteArray *data = new QByteArray; // gets deleted when read completes
-            store->readFile(data, curr->text(1), curr->text(6));
-            QApplication::processEvents();
-            //delete data;
-            return true;
-        }
-    }
-
-    //
-    // Our work is done!
-    //
-    rideListDown->setSortingEnabled(true);
-    rideListUp->setSortingEnabled(true);
-    progressLabel->setText(tr("Downloads complete"));
-    downloadButton->setText(tr("Download"));
-    downloading=false;
-    aborted=false;
-    cancelButton->show();
-    selectAll->setChecked(Qt::Unchecked);
-    for (int i=0; i<rideListDown->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListDown->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListDown->itemWidget(curr, 0);
-        check->setChecked(false);
-    }
-    progressLabel->setText(QString(tr("Downloaded %1 of %2 successfully")).arg(successful).arg(downloadtotal));
-
-    // save the ride cache, we don't want to lose that if we crash etc.
-    context->athlete->rideCache->save();
-
-    return false;
+    return transferTab == 0 ? 5 : 7;
 }
 
 void
-CloudServiceSyncDialog::completedRead(QByteArray *data, QString name, QString /*message*/)
+CloudServiceSyncDialog::refreshProgress()
 {
-    QTreeWidget *which = sync ? rideListSync : rideListDown;
-    int col = sync ? 7 : 5;
-
-    // was abort pressed?
-    if (aborted == true) {
-        QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
-        curr->setText(col, tr("Aborted"));
-        return;
+    QString progress;
+    switch(transferTab) {
+        case 0 : progress = tr("Downloaded %1 of %2"); break;
+        case 1 : progress = tr("Uploaded %1 of %2"); break;
+        default:
+        case 2 : progress = tr("Processed %1 of %2"); break;
     }
+    progressLabel->setText(progress.arg(downloadcounter).arg(downloadtotal));
+}
 
-    // uncompress and parse, note the filename is passed and may be
-    // different to what we asked for (sometimes the data is converted
-    // from one file format to another).
-    QStringList errors;
-    RideFile *ride = store->uncompressRide(data, name, errors);
-
-    // was allocated in before calling readfile
-    delete data;
+void
+CloudServiceSyncDialog::transferStarted(int id)
+{
+    QTreeWidgetItem *curr = transferItem(id);
+    if (curr == NULL) return;
 
-    progressBar->setValue(++downloadcounter);
+    bool down = transferTab == 0 || (transferTab == 2 && curr->text(6) == tr("Download"));
+    curr->setText(statusColumn(), down ? tr("Downloading") : tr("Uploading"));
+    transferring->scrollToItem(curr);
+}
 
-    QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
-    if (ride) {
-        if (saveRide(ride, errors) == true) {
-            curr->setText(col, tr("Saved"));
-            successful++;
-        } else {
-            curr->setText(col, errors.join(" "));
-        }
+void
+CloudServiceSyncDialog::transferRetrying(int id, int attempt)
+{
+    QTreeWidgetItem *curr = transferItem(id);
+    if (curr) curr->setText(statusColumn(), QString(tr("Retrying (%1)")).arg(attempt));
+}
 
-        // delete once saved
-        delete ride;
+void
+CloudServiceSyncDialog::transferDownloaded(int id, RideFile *ride, QStringList errors)
+{
+    QString status;
+    if (ride && saveRide(ride, errors) == true) {
+        status = tr("Saved");
+        successful++;
     } else {
-        curr->setText(col, errors.join(" "));
+        status = errors.join(" ");
     }
 
-    QApplication::processEvents();
+    QTreeWidgetItem *curr = transferItem(id);
+    if (curr) curr->setText(statusColumn(), status);
 
-    if (sync)
-        syncNext();
-    else
-        downloadNext();
+    progressBar->setValue(++downloadcounter);
+    refreshProgress();
 }
 
-bool
-CloudServiceSyncDialog::uploadNext()
+void
+CloudServiceSyncDialog::transferUploaded(int id, bool success, QString message)
 {
-    for (int i=listindex; i<rideListUp->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListUp->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListUp->itemWidget(curr, 0);
-        QCheckBox *exists = (QCheckBox*)rideListUp->itemWidget(curr, 6);
+    if (success) successful++;
 
-        // skip existing if overwrite not set
-        if (check->isChecked() && exists->isChecked() && !overwrite->isChecked()) {
-            curr->setText(7, tr("File exists"));
-            progressBar->setValue(++downloadcounter);
-            continue;
-        }
-
-        if (check->isChecked()) {
-
-            listindex = i+1; // start from the next one
-            curr->setText(7, tr("Uploading"));
-            rideListUp->setCurrentItem(curr);
-            progressLabel->setText(QString(tr("Uploaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
-
-            // read in the file - TEMPORARILY *** WE DON'T USE IN MEMORY VERSION ***
-            QStringList errors;
-            QFile file(context->athlete->home->activities().canonicalPath() + "/" + curr->text(1));
-            RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
+    QTreeWidgetItem *curr = transferItem(id);
+    if (curr) curr->setText(statusColumn(), message);
 
-            if (ride) {
-
-                    // get a compressed version
-                    QByteArray data;
-                    store->compressRide(ride, data, QFileInfo(curr->text(1)).baseName() + ".json");
-                    store->writeFile(data, QFileInfo(curr->text(1)).baseName() + store->uploadExtension(), ride);
-                    QApplication::processEvents();
-                    delete ride; // clean up!
-                    return true;
-
-            } else {
-                curr->setText(7, tr("Parse failure"));
-                QApplication::processEvents();
-            }
-        }
-    }
+    progressBar->setValue(++downloadcounter);
+    refreshProgress();
+}
 
+void
+CloudServiceSyncDialog::transfersFinished()
+{
     //
     // Our work is done!
     //
     rideListDown->setSortingEnabled(true);
     rideListUp->setSortingEnabled(true);
-    progressLabel->setText(tr("Uploads complete"));
-    downloadButton->setText(tr("Upload"));
+    rideListSync->setSortingEnabled(true);
     downloading=false;
     aborted=false;
+    sync=false;
     cancelButton->show();
-    selectAllUp->setChecked(Qt::Unchecked);
-    for (int i=0; i<rideListUp->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListUp->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListUp->itemWidget(curr, 0);
-        check->setChecked(false);
-    }
-    progressLabel->setText(QString(tr("Uploaded %1 of %2 successfully")).arg(successful).arg(downloadtotal));
-    return false;
-}
 
-void
-CloudServiceSyncDialog::completedWrite(QString, QString result)
-{
-    QTreeWidget *which = sync ? rideListSync : rideListUp;
-
-    // was abort pressed?
-    if (aborted == true) {
-        QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
-        curr->setText(7, tr("Aborted"));
-        return;
+    QString done;
+    switch(transferTab) {
+    case 0 :
+        downloadButton->setText(tr("Download"));
+        selectAll->setChecked(Qt::Unchecked);
+        done = tr("Downloaded %1 of %2 successfully");
+        break;
+    case 1 :
+        downloadButton->setText(tr("Upload"));
+        selectAllUp->setChecked(Qt::Unchecked);
+        done = tr("Uploaded %1 of %2 successfully");
+        break;
+    default:
+    case 2 :
+        downloadButton->setText(tr("Synchronize"));
+        selectAllSync->setChecked(Qt::Unchecked);
+        done = tr("Processed %1 of %2 successfully");
+        break;
     }
 
-    progressBar->setValue(++downloadcounter);
-
-    QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
-    curr->setText(7, result);
-    if (result == tr("Completed.")) successful++;
-    QApplication::processEvents();
+    for (int i=0; i<transferring->invisibleRootItem()->childCount(); i++) {
+        QTreeWidgetItem *curr = transferring->invisibleRootItem()->child(i);
+        QCheckBox *check = (QCheckBox*)transferring->itemWidget(curr, 0);
+        check->setChecked(false);
+    }
+    progressLabel->setText(done.arg(successful).arg(downloadtotal));
 
-    if (sync)
-        syncNext();
-    else
-        uploadNext();
+    // save the ride cache, we don't want to lose that if we crash etc.
+    if (transferTab != 1) context->athlete->rideCache->save();
 }
 
 bool
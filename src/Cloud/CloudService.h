@@ -50,6 +50,7 @@
 
 class RideItem;
 class CloudServiceEntry;
+class CloudServiceScheduler;
 
 // Representing an Athlete when the service allows for
 // a coach or manager relationship -- i.e. it lists athletes
@@ -129,6 +130,11 @@ class CloudService : public QObject {
         }
         void notifyReadComplete(QByteArray *data, QString name, QString message) { emit readComplete(data,name,message); }
 
+        // how hard can we push the service when syncing lots of activities
+        // maximum transfers in flight and started per minute (0 = no limit)
+        virtual int maxTransfers() const { return 4; }
+        virtual int transfersPerMinute() const { return 0; }
+
         // list and select an athlete - list will need to block rather than notify asynchronously
         virtual QList<CloudServiceAthlete> listAthletes() { return QList<CloudServiceAthlete>(); }
         virtual bool selectAthlete(CloudServiceAthlete) { return false; }
@@ -330,13 +336,26 @@ class CloudServiceSyncDialog : public QDialog
         void selectAllUpChanged(int);
         void selectAllSyncChanged(int);
 
-        void completedRead(QByteArray *data, QString name, QString message);
-        void completedWrite(QString name,QString message);
+        // from the scheduler
+        void transferStarted(int id);
+        void transferRetrying(int id, int attempt);
+        void transferDownloaded(int id, RideFile *ride, QStringList errors);
+        void transferUploaded(int id, bool success, QString message);
+        void transfersFinished();
+
     private:
         Context *context;
         CloudService *store;
         QList<CloudServiceEntry*> workouts;
 
+        // transfers, id is the row in the list being transferred
+        CloudServiceScheduler *scheduler;
+        QTreeWidget *transferring;
+        int transferTab;
+        QTreeWidgetItem *transferItem(int id);
+        int statusColumn() const;
+        void refreshProgress();
+
         bool downloading;
         bool sync;
         bool aborted;
@@ -349,16 +368,9 @@ class CloudServiceSyncDialog : public QDialog
         // keeping track of progress...
         int downloadcounter,    // *x* of n downloading
             downloadtotal,      // x of *n* downloading
-            successful,         // how many downloaded ok?
-            listindex;          // where in rideList we've got to
+            successful;         // how many downloaded ok?
 
         bool saveRide(RideFile *, QStringList &);
-        bool syncNext();        // kick off another download/upload
-                                // returns false if none left
-        bool downloadNext();    // kick off another download
-                                // returns false if none left
-        bool uploadNext();     // kick off another upload
-                                // returns false if none left
 
         // tabs - Upload/Download
         QTabWidget *tabs;
@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "CloudServiceScheduler.h"
+#include "CloudService.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideFile.h"
+#include "Settings.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#if QT_VERSION > 0x050000
+# include <QtConcurrent>
+#else
+# include <QtConcurrentRun>
+#endif
+
+// default number of transfers in flight
+static const int DEFAULT_TRANSFERS = 4;
+
+// give up waiting for the service after 5 minutes
+static const qint64 TIMEOUT = 5 * 60 * 1000;
+
+// attempts before we report a failure, waiting 2s, 4s ... between them
+static const int ATTEMPTS = 3;
+
+struct CloudTransfer
+{
+    enum { Download, Upload } type;
+    enum { Queued, Preparing, Sending, Unpacking } state;
+
+    int id;
+    int attempts;
+    qint64 due;         // when queued: not before, when sending: timeout
+    bool replied;       // the service completed inside the call
+    bool aborted;       // abandoned whilst a worker had it
+
+    Context *context;
+    CloudService *store;
+
+    QString remotename, remoteid;   // what we asked for
+    QString name;                   // what the service called it
+    QString filename;               // local file to upload
+
+    QByteArray *data;               // download
+    QByteArray payload;             // compressed upload
+    RideFile *ride;
+    QStringList errors;
+    QString message;
+};
+
+//
+// Worker thread functions, only touch the transfer they are given
+//
+static CloudTransfer *
+prepareUpload(CloudTransfer *t)
+{
+    QFile file(t->filename);
+    t->ride = RideFileFactory::instance().openRideFile(t->context, file, t->errors);
+    if (t->ride) t->store->compressRide(t->ride, t->payload, QFileInfo(t->filename).baseName() + ".json");
+    return t;
+}
+
+static CloudTransfer *
+unpackDownload(CloudTransfer *t)
+{
+    // the name passed back may be different to what we asked for
+    // (sometimes the data is converted from one file format to another)
+    t->ride = t->store->uncompressRide(t->data, t->name, t->errors);
+    return t;
+}
+
+CloudServiceScheduler::CloudServiceScheduler(Context *context, CloudService *store, QObject *parent) :
+    QObject(parent), context(context), store(store), running(false), timeout(TIMEOUT), calling(NULL)
+{
+    parallel_ = qMax(1, qMin(appsettings->value(NULL, GC_CLOUD_TRANSFERS, DEFAULT_TRANSFERS).toInt(), store->maxTransfers()));
+    perMinute = store->transfersPerMinute();
+
+    timer.setInterval(1000);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(schedule()));
+
+    connect(store, SIGNAL(writeComplete(QString,QString)), this, SLOT(writeComplete(QString,QString)));
+    connect(store, SIGNAL(readComplete(QByteArray*,QString,QString)), this, SLOT(readComplete(QByteArray*,QString,QString)));
+
+    clock.start();
+}
+
+CloudServiceScheduler::~CloudServiceScheduler()
+{
+    abort();
+
+    // wait for the workers, nobody else wants their results now
+    foreach(QFutureWatcher<CloudTransfer*> *watcher, watchers) {
+        watcher->waitForFinished();
+        CloudTransfer *t = watcher->result();
+        delete t->data;
+        delete t->ride;
+        delete t;
+    }
+
+    // buffers in abandonedReads are left alone, the service may still write to them
+}
+
+void
+CloudServiceScheduler::download(int id, QString remotename, QString remoteid)
+{
+    CloudTransfer *t = new CloudTransfer;
+    t->type = CloudTransfer::Download;
+    t->state = CloudTransfer::Queued;
+    t->id = id;
+    t->attempts = 0;
+    t->due = 0;
+    t->replied = t->aborted = false;
+    t->context = context;
+    t->store = store;
+    t->remotename = t->name = remotename;
+    t->remoteid = remoteid;
+    t->data = NULL;
+    t->ride = NULL;
+    queue << t;
+}
+
+void
+CloudServiceScheduler::upload(int id, QString filename)
+{
+    CloudTransfer *t = new CloudTransfer;
+    t->type = CloudTransfer::Upload;
+    t->state = CloudTransfer::Queued;
+    t->id = id;
+    t->attempts = 0;
+    t->due = 0;
+    t->replied = t->aborted = false;
+    t->context = context;
+    t->store = store;
+    t->filename = context->athlete->home->activities().canonicalPath() + "/" + filename;
+    t->remotename = t->name = QFileInfo(filename).baseName() + store->uploadExtension();
+    t->data = NULL;
+    t->ride = NULL;
+    queue << t;
+}
+
+void
+CloudServiceScheduler::start()
+{
+    if (running) return;
+
+    running = true;
+    timer.start();
+    schedule();
+}
+
+QList<int>
+CloudServiceScheduler::abort()
+{
+    QList<int> returning;
+
+    running = false;
+    timer.stop();
+
+    foreach(CloudTransfer *t, queue) {
+        if (t->attempts) returning << t->id; // waiting to retry
+        discard(t);
+    }
+    queue.clear();
+
+    foreach(CloudTransfer *t, active) {
+        returning << t->id;
+
+        if (t->state == CloudTransfer::Sending) {
+
+            // the service may still complete it, ignore it when it does
+            if (t->type == CloudTransfer::Download) {
+                reading.remove(t->data);
+                abandonedReads.insert(t->data);
+                t->data = NULL;
+            } else {
+                writing.removeOne(t);
+                abandonedWrites << t->remotename;
+            }
+        }
+
+        // a worker or the service call still has it, they clean up
+        if (t->state != CloudTransfer::Sending || t == calling) t->aborted = true;
+        else discard(t);
+    }
+    active.clear();
+
+    return returning;
+}
+
+bool
+CloudServiceScheduler::ready()
+{
+    if (active.count() >= parallel_) return false;
+
+    // no more than perMinute started in the last minute
+    if (perMinute > 0) {
+        qint64 now = clock.elapsed();
+        while (!recent.isEmpty() && now - recent.first() >= 60000) recent.removeFirst();
+        if (recent.count() >= perMinute) return false;
+    }
+    return true;
+}
+
+void
+CloudServiceScheduler::schedule()
+{
+    if (!running) return;
+
+    qint64 now = clock.elapsed();
+
+    // has the service gone quiet?
+    foreach(CloudTransfer *t, active) {
+        if (t->state != CloudTransfer::Sending || now < t->due) continue;
+
+        if (t->type == CloudTransfer::Download) {
+            reading.remove(t->data);
+            abandonedReads.insert(t->data);
+            t->data = NULL;
+            retry(t, tr("Timed out."));
+        } else {
+            writing.removeOne(t);
+            abandonedWrites << t->remotename;
+
+            // it was sent and may well have arrived, sending it
+            // again could leave a duplicate on the service
+            emit uploaded(t->id, false, tr("Timed out, the upload may still have completed."));
+            done(t);
+        }
+    }
+
+    // start what we can in order, skipping any waiting to retry
+    for (int i=0; running && i<queue.count() && ready();) {
+
+        CloudTransfer *t = queue[i];
+        if (t->due > now) { i++; continue; }
+
+        queue.removeAt(i);
+        active << t;
+        recent << now;
+
+        if (t->attempts == 0) emit started(t->id);
+        transfer(t);
+    }
+
+    checkFinished();
+}
+
+void
+CloudServiceScheduler::background(CloudTransfer *t, CloudTransfer *(*work)(CloudTransfer*), const char *slot)
+{
+    QFutureWatcher<CloudTransfer*> *watcher = new QFutureWatcher<CloudTransfer*>(this);
+    watchers.insert(watcher);
+    connect(watcher, SIGNAL(finished()), this, slot);
+    watcher->setFuture(QtConcurrent::run(work, t));
+}
+
+void
+CloudServiceScheduler::transfer(CloudTransfer *t)
+{
+    // read and compress the activity first, we come back once it's done
+    if (t->type == CloudTransfer::Upload && t->ride == NULL) {
+        t->state = CloudTransfer::Preparing;
+        background(t, prepareUpload, SLOT(prepared()));
+        return;
+    }
+
+    t->state = CloudTransfer::Sending;
+    t->due = clock.elapsed() + timeout;
+    t->replied = false;
+    t->attempts++;
+
+    // some services complete before returning, the completion
+    // slots spot that and leave it for us to handle below
+    bool ok;
+    calling = t;
+    if (t->type == CloudTransfer::Download) {
+        t->data = new QByteArray;
+        reading.insert(t->data, t);
+        ok = store->readFile(t->data, t->remotename, t->remoteid);
+    } else {
+        writing << t;
+        ok = store->writeFile(t->payload, t->remotename, t->ride);
+    }
+    calling = NULL;
+
+    // aborted whilst the service was busy
+    if (t->aborted) {
+        discard(t);
+        return;
+    }
+
+    if (t->replied) {
+        received(t);
+        return;
+    }
+
+    // the service refused and won't call back
+    if (!ok) {
+        if (t->type == CloudTransfer::Download) {
+            reading.remove(t->data);
+            emit downloaded(t->id, NULL, QStringList() << tr("Download failed."));
+        } else {
+            writing.removeOne(t);
+            emit uploaded(t->id, false, tr("Upload failed."));
+        }
+        done(t);
+    }
+}
+
+void
+CloudServiceScheduler::readComplete(QByteArray *data, QString name, QString)
+{
+    // we gave up on it
+    if (abandonedReads.remove(data)) {
+        delete data;
+        return;
+    }
+
+    CloudTransfer *t = reading.take(data);
+    if (t == NULL) return; // not one of ours
+
+    t->name = name;
+    if (t == calling) t->replied = true;
+    else received(t);
+}
+
+void
+CloudServiceScheduler::writeComplete(QString name, QString message)
+{
+    // local stores complete inside writeFile and don't name it
+    CloudTransfer *t = NULL;
+    if (calling && calling->type == CloudTransfer::Upload) {
+        t = calling;
+    } else {
+        if (abandonedWrites.removeOne(name)) return;
+        foreach(CloudTransfer *w, writing) {
+            if (w->remotename == name) { t = w; break; }
+        }
+    }
+    if (t == NULL) return; // not one of ours
+
+    writing.removeOne(t);
+    t->message = message;
+    if (t == calling) t->replied = true;
+    else received(t);
+}
+
+void
+CloudServiceScheduler::received(CloudTransfer *t)
+{
+    if (t->type == CloudTransfer::Download) {
+
+        // nothing came back, most likely the network
+        if (t->data->isEmpty()) {
+            delete t->data;
+            t->data = NULL;
+            retry(t, tr("No data received."));
+            return;
+        }
+
+        // uncompress and parse, we come back once it's done
+        t->state = CloudTransfer::Unpacking;
+        background(t, unpackDownload, SLOT(unpacked()));
+
+    } else {
+
+        // the service accepted or rejected it, either way we're done
+        emit uploaded(t->id, t->message == tr("Completed."), t->message);
+        done(t);
+    }
+}
+
+void
+CloudServiceScheduler::prepared()
+{
+    QFutureWatcher<CloudTransfer*> *watcher = static_cast<QFutureWatcher<CloudTransfer*>*>(QObject::sender());
+    CloudTransfer *t = watcher->result();
+    watchers.remove(watcher);
+    watcher->deleteLater();
+
+    if (t->aborted) {
+        discard(t);
+        return;
+    }
+
+    if (t->ride == NULL) {
+        emit uploaded(t->id, false, tr("Parse failure"));
+        done(t);
+        return;
+    }
+
+    transfer(t);
+}
+
+void
+CloudServiceScheduler::unpacked()
+{
+    QFutureWatcher<CloudTransfer*> *watcher = static_cast<QFutureWatcher<CloudTransfer*>*>(QObject::sender());
+    CloudTransfer *t = watcher->result();
+    watchers.remove(watcher);
+    watcher->deleteLater();
+
+    if (t->aborted) {
+        discard(t);
+        return;
+    }
+
+    emit downloaded(t->id, t->ride, t->errors);
+    done(t);
+}
+
+void
+CloudServiceScheduler::retry(CloudTransfer *t, QString error)
+{
+    active.removeOne(t);
+
+    if (t->attempts >= ATTEMPTS) {
+        if (t->type == CloudTransfer::Download) emit downloaded(t->id, NULL, QStringList() << error);
+        else emit uploaded(t->id, false, error);
+        discard(t);
+        QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+        return;
+    }
+
+    // back of the queue would be fairer, but the user is watching the list go by
+    t->state = CloudTransfer::Queued;
+    t->due = clock.elapsed() + 1000 * (1 << t->attempts);
+    queue.prepend(t);
+
+    emit retrying(t->id, t->attempts);
+}
+
+void
+CloudServiceScheduler::done(CloudTransfer *t)
+{
+    active.removeOne(t);
+    discard(t);
+
+    // next one, via the event loop since services that complete
+    // inside the call would otherwise recurse through the queue
+    QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+}
+
+void
+CloudServiceScheduler::discard(CloudTransfer *t)
+{
+    delete t->data;
+    delete t->ride;
+    delete t;
+}
+
+void
+CloudServiceScheduler::checkFinished()
+{
+    if (running && queue.isEmpty() && active.isEmpty()) {
+        running = false;
+        timer.stop();
+        emit finished();
+    }
+}
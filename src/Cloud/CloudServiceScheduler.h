@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_CloudServiceScheduler_h
+#define _GC_CloudServiceScheduler_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QStringList>
+
+class Context;
+class CloudService;
+class RideFile;
+struct CloudTransfer;
+
+//
+// Moves activities to and from a cloud service for the sync dialog
+//
+// The dialog used to start a transfer and wait for it to complete before
+// starting the next, so syncing a few thousand activities was bound by the
+// round trip to the service. We keep several transfers in flight instead,
+// limited by the user (GC_CLOUD_TRANSFERS) and by what the service says it
+// will tolerate (CloudService::maxTransfers and transfersPerMinute).
+//
+// Reading and compressing the activity for an upload, and uncompressing and
+// parsing a download, are done on a worker thread. The service calls are all
+// made on the GUI thread since that is where the network access lives.
+//
+// Downloads that timeout or come back empty are retried a couple of times with
+// an increasing delay, anything the service rejected is reported as is. An
+// upload that times out is reported as failed rather than sent again, since
+// the service may have got it and we'd end up with a duplicate.
+//
+class CloudServiceScheduler : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        CloudServiceScheduler(Context *context, CloudService *store, QObject *parent=NULL);
+        ~CloudServiceScheduler();
+
+        // queue work, the id is the caller's and is passed back in the signals
+        void download(int id, QString remotename, QString remoteid);
+        void upload(int id, QString filename); // in the activities folder
+
+        // work through the queue, finished() is emitted when it is empty
+        void start();
+
+        // drop everything, returns the ids that had started so the caller
+        // can mark them; no more signals are emitted for any of them
+        QList<int> abort();
+
+        bool isRunning() const { return running; }
+        int parallel() const { return parallel_; }
+
+        // how long to wait for the service before giving up on a transfer
+        void setTimeout(qint64 msecs) { timeout = msecs; }
+
+    signals:
+
+        void started(int id);
+        void retrying(int id, int attempt);
+
+        // the ride is NULL if it could not be read, and is deleted after the signal
+        void downloaded(int id, RideFile *ride, QStringList errors);
+        void uploaded(int id, bool success, QString message);
+
+        void finished();
+
+    private slots:
+
+        // start whatever we can and check for timeouts
+        void schedule();
+
+        // from the service
+        void readComplete(QByteArray *data, QString name, QString message);
+        void writeComplete(QString name, QString message);
+
+        // from the worker threads
+        void prepared();
+        void unpacked();
+
+    private:
+
+        void transfer(CloudTransfer *t);
+        void received(CloudTransfer *t);
+        void retry(CloudTransfer *t, QString error);
+        void done(CloudTransfer *t);
+        void discard(CloudTransfer *t);
+        void background(CloudTransfer *t, CloudTransfer *(*work)(CloudTransfer*), const char *slot);
+        bool ready();
+        void checkFinished();
+
+        Context *context;
+        CloudService *store;
+
+        int parallel_, perMinute;
+        bool running;
+        qint64 timeout;
+
+        QTimer timer;
+        QElapsedTimer clock;
+        QList<qint64> recent;                   // when transfers started, for rate limiting
+
+        QList<CloudTransfer*> queue;            // not started yet or waiting to retry
+        QList<CloudTransfer*> active;           // started, in any state
+        QHash<QByteArray*, CloudTransfer*> reading;
+        QList<CloudTransfer*> writing;
+        CloudTransfer *calling;                 // inside a synchronous service call
+        QSet<QFutureWatcher<CloudTransfer*>*> watchers;
+
+        // transfers we gave up on that the service may still complete
+        QSet<QByteArray*> abandonedReads;
+        QStringList abandonedWrites;
+};
+
+#endif // _GC_CloudServiceScheduler_h
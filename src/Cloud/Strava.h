@@ -51,6 +51,11 @@ class Strava : public CloudService {
         // read a file
         bool readFile(QByteArray *data, QString remotename, QString remoteid);
 
+        // API is limited to 100 requests every 15 minutes and
+        // a download makes a couple of requests
+        int maxTransfers() const { return 2; }
+        int transfersPerMinute() const { return 3; }
+
         // dirent style api
         CloudServiceEntry *root() { return root_; }
         QList<CloudServiceEntry*> readdir(QString path, QStringList &errors, QDateTime from, QDateTime to);
@@ -24,14 +24,160 @@
 
 #include "RideFile.h"
 #include "RideFileCache.h"
+#include "RideExporter.h"
 #include "CsvRideFile.h"
 
 #include "Zones.h"
+#include "Trace.h"
 #include "HrZones.h"
 #include "PaceZones.h"
 
-#include <QTemporaryFile>
 #include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QLocale>
+#include <QThread>
+
+#include "../qzip/zipwriter.h"
+
+// exports are sent in chunks of this size as they are written
+static const int CHUNK_SIZE = 64 * 1024;
+
+// rendered activities are cached up to this size each and in total
+static const int EXPORT_CACHE_ENTRY = 8 * 1024 * 1024;
+static const int EXPORT_CACHE_TOTAL = 64 * 1024 * 1024;
+
+// The zip writer and the ride file writers only ever append to their
+// device, so we can give them a device that passes the bytes straight on
+// to the http response as chunks, rather than build the whole thing
+// before sending it. Optionally a copy is kept so it can be cached.
+class ResponseDevice : public QIODevice
+{
+    public:
+        ResponseDevice(HttpResponse &response, int keep=0) : response(response), keep(keep), written(0), sent_(false) {
+            open(QIODevice::WriteOnly);
+        }
+
+        // send whatever has been written so far
+        void flush(bool last=false) {
+            if (pending.count() || last) {
+                response.write(pending, last);
+                sent_ = true;
+            }
+            pending.clear();
+        }
+
+        // has anything gone to the client yet
+        bool sent() const { return sent_; }
+
+        // everything written, if it was no more than keep bytes
+        bool kept() const { return keep > 0 && written <= keep; }
+        QByteArray copy() const { return copy_; }
+
+        // only seeking to where we already are is supported
+        bool seek(qint64 pos) { return pos == this->pos() && QIODevice::seek(pos); }
+
+    protected:
+        qint64 readData(char *, qint64) { return -1; }
+        qint64 writeData(const char *data, qint64 len) {
+            pending.append(data, len);
+            written += len;
+            if (written <= keep) copy_.append(data, len);
+            else copy_.clear();
+            if (pending.count() >= CHUNK_SIZE) flush();
+            return len;
+        }
+
+    private:
+        HttpResponse &response;
+        QByteArray pending, copy_;
+        qint64 keep, written;
+        bool sent_;
+};
+
+// header names are case insensitive, but HttpRequest doesn't know that
+static QByteArray
+requestHeader(HttpRequest &request, QByteArray name)
+{
+    QMultiMap<QByteArray,QByteArray> headers = request.getHeaderMap();
+    QMapIterator<QByteArray,QByteArray> it(headers);
+    while (it.hasNext()) {
+        it.next();
+        if (it.key().toLower() == name.toLower()) return it.value();
+    }
+    return QByteArray();
+}
+
+// RFC 7231 date, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+static QByteArray
+httpDate(QDateTime when)
+{
+    return QLocale::c().toString(when.toUTC(), "ddd, dd MMM yyyy hh:mm:ss").toLatin1() + " GMT";
+}
+
+static QDateTime
+fromHttpDate(QByteArray date)
+{
+    QDateTime returning = QLocale::c().toDateTime(QString(date).left(25), "ddd, dd MMM yyyy hh:mm:ss");
+    returning.setTimeSpec(Qt::UTC);
+    return returning;
+}
+
+// does the client already have this version? If-None-Match wins when
+// both are present as etags are more precise than a date to the second
+static bool
+notModified(HttpRequest &request, QByteArray etag, QDateTime modified)
+{
+    QByteArray match = requestHeader(request, "If-None-Match");
+    if (match != "") {
+        foreach(QByteArray tag, match.split(',')) {
+            tag = tag.trimmed();
+            if (tag.startsWith("W/")) tag = tag.mid(2);
+            if (tag == "*" || tag == etag) return true;
+        }
+        return false;
+    }
+
+    QByteArray since = requestHeader(request, "If-Modified-Since");
+    if (since != "") {
+        QDateTime date = fromHttpDate(since);
+        return date.isValid() && modified.toUTC().toTime_t() <= date.toTime_t();
+    }
+    return false;
+}
+
+bool
+APIExportCache::lookup(QString key, QByteArray etag, QByteArray &data)
+{
+    QMutexLocker locker(&mutex);
+
+    entry *found = cache.object(key);
+    if (found == NULL) return false;
+
+    // stale, the file has changed
+    if (found->etag != etag) {
+        cache.remove(key);
+        return false;
+    }
+    data = found->data;
+    return true;
+}
+
+void
+APIExportCache::insert(QString key, QByteArray etag, QByteArray data)
+{
+    entry *add = new entry;
+    add->etag = etag;
+    add->data = data;
+
+    QMutexLocker locker(&mutex);
+    cache.insert(key, add, data.size()); // takes ownership
+}
+
+APIWebService::APIWebService(QDir home, QObject *parent) :
+    HttpRequestHandler(parent), home(home), exports(EXPORT_CACHE_TOTAL)
+{
+}
 
 void
 APIWebService::service(HttpRequest &request, HttpResponse &response)
@@ -39,6 +185,7 @@ APIWebService::service(HttpRequest &request, HttpResponse &response)
     // remove trailing '/' from request, just to be consistent
     QString fullPath = request.getPath();
     while (fullPath.endsWith("/")) fullPath.chop(1);
+    GC_TRACE_DETAIL("APIWebService::service", fullPath);
 
     // get the paths, strip empty stuff
     QStringList paths = QString(request.getPath()).split("/");
@@ -54,11 +201,45 @@ APIWebService::service(HttpRequest &request, HttpResponse &response)
         return;
     }
 
+    // TRACING, the underscore keeps it apart from athlete names
+    // http://localhost:12021/_trace[/start|/stop]
+    if (paths[0] == "_trace" && paths.count() <= 2) {
+        trace(paths, request, response);
+        return;
+    }
+
     // Call to retreive athlete data, downstream will resolve
     // which functions to call for different data requests
     athleteData(paths, request, response);
 }
 
+void
+APIWebService::trace(QStringList paths, HttpRequest &, HttpResponse &response)
+{
+    QString action = paths.count() == 2 ? paths[1] : "";
+
+    if (action == "start") {
+
+        // begin collecting events, they stay in memory until fetched
+        Trace::start();
+        response.setHeader("Content-Type", "text; charset=ISO-8859-1");
+        response.write("tracing started\n", true);
+        return;
+
+    } else if (action == "stop" || action == "") {
+
+        // return what we have so far in chrome trace-event format
+        if (action == "stop") Trace::stop();
+        response.setHeader("Content-Type", "application/json; charset=UTF-8");
+        response.write(Trace::json(), true);
+        return;
+    }
+
+    response.setStatus(404);
+    response.setHeader("Content-Type", "text; charset=ISO-8859-1");
+    response.write("malformed url");
+}
+
 void
 APIWebService::athleteData(QStringList &paths, HttpRequest &request, HttpResponse &response)
 {
@@ -98,6 +279,18 @@ APIWebService::athleteData(QStringList &paths, HttpRequest &request, HttpRespons
             return;
         }
 
+        // BULK EXPORT AS A ZIP
+        // http://localhost:12021/athlete/export
+        // optional query parameters:
+        //      ?format=json    (default)
+        //      ?format=<xx>    xx = one of (csv, tcx, pwx)
+        //      ?since=yyyy/mm/dd&before=yyyy/mm/dd
+        //      ?threads=n      (default is one per core)
+        if (paths[0] == "export") {
+            exportActivities(athlete, paths, request, response);
+            return;
+        }
+
     } else if (paths.count() == 3) {
 
         QString athlete = paths[0];
@@ -277,121 +470,197 @@ APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &req
     // does it exist ?
     QString filename = QString("%1/%2/activities/%3").arg(home.absolutePath()).arg(athlete).arg(paths[0]);
 
-    QString contents;
-    QFile file(filename);
-    if (file.exists() && file.open(QFile::ReadOnly | QFile::Text)) {
-
-        // close as we will open properly below
-        file.close();
-
-        // what format to use ?
-        QString format(request.getParameter("format"));
-        if (format == "") {
-
-            // if not passed in the URL then is content type
-            // caller can accept listed in the header?
-            // there is probably a more complete way of handling
-            // wildcards etc, but the user can always force via     
-            // the format parameter in the URL
-            foreach(QByteArray accepts, request.getHeaders("Accept")) {
-                if (accepts == "application/json") format="json";
-                if (accepts == "text/csv") format="csv";
-                if (accepts == "application/vnd.garmin.tcx") format="tcx";
-                if (accepts == "application/vnd.trainingpeaks.pwx") format="pwx";
-                if (accepts == "application/xml" || accepts == "text/xml") format="tcx";
-                if (format != "") break;
-            }
-        }
+    QFileInfo info(filename);
+    if (!info.exists() || !info.isFile() || !info.isReadable()) {
 
-        // default to json
-        if (format == "") format = "json";
-
-        // lets go with tcx/pwx as xml, full csv (not powertap) and GC json
-        QStringList formats;
-        formats << "tcx"; // garmin training centre
-        formats << "csv"; // full csv list (not powertap)
-        formats << "json"; // gc json
-        formats << "pwx"; // gc json
-
-        // unsupported format
-        if (!formats.contains(format)) {
-            response.setStatus(500);
-            response.write("unsupported format; we support:");
-            foreach(QString fmt, formats) {
-                response.write(" ");
-                response.write(fmt.toLocal8Bit());
-            }
-            response.write("\r\n");
-            return;
-        } else {
+       // nope?
+       response.setStatus(404);
+       response.write("file not found");
+       return;
+    }
 
-            // set the content type appropriately
-            if (format == "tcx") response.setHeader("Content-Type", "application/vnd.garmin.tcx+xml; charset=ISO-8859-1");
-            if (format == "csv") response.setHeader("Content-Type", "text/csv; charset=ISO-8859-1");
-            if (format == "json") response.setHeader("Content-Type", "application/json; charset=ISO-8859-1");
-            if (format == "pwx") response.setHeader("Content-Type", "application/vnd.trainingpeaks.pwx+xml; charset=ISO-8859-1");
+    // what format to use ?
+    QString format(request.getParameter("format"));
+    if (format == "") {
+
+        // if not passed in the URL then is content type
+        // caller can accept listed in the header?
+        // there is probably a more complete way of handling
+        // wildcards etc, but the user can always force via     
+        // the format parameter in the URL
+        foreach(QByteArray accepts, request.getHeaders("Accept")) {
+            if (accepts == "application/json") format="json";
+            if (accepts == "text/csv") format="csv";
+            if (accepts == "application/vnd.garmin.tcx") format="tcx";
+            if (accepts == "application/vnd.trainingpeaks.pwx") format="pwx";
+            if (accepts == "application/xml" || accepts == "text/xml") format="tcx";
+            if (format != "") break;
         }
+    }
 
-        // lets read the file in as a ridefile
-        QStringList errors;
-        RideFile *f = RideFileFactory::instance().openRideFile(NULL, file, errors);
-
-        // error reading (!)
-        if (f == NULL) {
-            response.setStatus(500);
-            foreach(QString error, errors) {
-                response.write(error.toLocal8Bit());
-                response.write("\r\n");
-            }
-            return;
-        }
+    // default to json
+    if (format == "") format = "json";
 
-        // write out to a temporary file in
-        // the format requested
-        bool success;
-        QTemporaryFile tempfile; // deletes file when goes out of scope
-        QString tempname;
-        if (tempfile.open()) tempname = tempfile.fileName();
-        else {
-            response.setStatus(500);
-            response.write("error opening temporary file");
-            return;
-        }
-        QFile out(tempname);
+    // lets go with tcx/pwx as xml, full csv (not powertap) and GC json
+    QStringList formats;
+    formats << "tcx"; // garmin training centre
+    formats << "csv"; // full csv list (not powertap)
+    formats << "json"; // gc json
+    formats << "pwx"; // gc json
 
-        if (format == "csv") {
-            CsvFileReader writer;
-            success = writer.writeRideFile(NULL, f, out, CsvFileReader::gc);
-        } else {
-            success = RideFileFactory::instance().writeRideFile(NULL, f, out, format);
+    // unsupported format
+    if (!formats.contains(format)) {
+        response.setStatus(500);
+        response.write("unsupported format; we support:");
+        foreach(QString fmt, formats) {
+            response.write(" ");
+            response.write(fmt.toLocal8Bit());
         }
+        response.write("\r\n");
+        return;
+    } else {
 
-        if (success) {
+        // set the content type appropriately, the writers all use utf-8
+        if (format == "tcx") response.setHeader("Content-Type", "application/vnd.garmin.tcx+xml; charset=UTF-8");
+        if (format == "csv") response.setHeader("Content-Type", "text/csv; charset=ISO-8859-1");
+        if (format == "json") response.setHeader("Content-Type", "application/json; charset=UTF-8");
+        if (format == "pwx") response.setHeader("Content-Type", "application/vnd.trainingpeaks.pwx+xml; charset=UTF-8");
+    }
 
-            // read in the whole thing
-            out.open(QFile::ReadOnly | QFile::Text);
-            QTextStream in(&out);
-            in.setCodec ("UTF-8");
-            contents = in.readAll();
-            out.close();
+    // the size and time of the file fingerprint the ride, saving
+    // it changes both, so clients can make conditional requests
+    QDateTime modified = info.lastModified();
+    QByteArray etag = QString("\"%1-%2-%3\"").arg(info.size(), 0, 16)
+                                             .arg(modified.toMSecsSinceEpoch(), 0, 16)
+                                             .arg(format).toLatin1();
+    response.setHeader("ETag", etag);
+    response.setHeader("Last-Modified", httpDate(modified));
+
+    if (notModified(request, etag, modified)) {
+        response.setStatus(304, "Not Modified");
+        response.write(QByteArray(), true);
+        return;
+    }
 
-            // write back in one hit
-            response.write(contents.toLocal8Bit(), true);
-            return;
+    // sent recently ?
+    QString key = info.absoluteFilePath() + "|" + format;
+    QByteArray data;
+    if (exports.lookup(key, etag, data)) {
+        response.write(data, true);
+        return;
+    }
 
-        } else {
-            response.setStatus(500);
-            response.write("unable to write output, internal error.\n");
-            return;
+    // lets read the file in as a ridefile
+    QFile file(filename);
+    QStringList errors;
+    RideFile *f = RideFileFactory::instance().openRideFile(NULL, file, errors);
+
+    // error reading (!)
+    if (f == NULL) {
+        response.setStatus(500);
+        foreach(QString error, errors) {
+            response.write(error.toLocal8Bit());
+            response.write("\r\n");
         }
+        return;
+    }
 
+    // write out in the format requested straight to the client,
+    // in chunks, keeping a copy for the cache if it isn't too big
+    bool success;
+    ResponseDevice device(response, EXPORT_CACHE_ENTRY);
+    if (format == "csv") {
+        CsvFileReader writer;
+        success = writer.writeRideData(NULL, f, device, CsvFileReader::gc);
     } else {
+        success = RideFileFactory::instance().writeRideData(NULL, f, device, format);
+    }
+    delete f; // free memory!
 
-       // nope?
-       response.setStatus(404);
-       response.write("file not found");
-       return;
+    // we can only report an error if nothing has been sent yet,
+    // otherwise the client will see a truncated response
+    if (!success && !device.sent()) {
+        response.setStatus(500);
+        response.write("unable to write output, internal error.\n");
+        return;
+    }
+    device.flush(true);
+
+    if (success && device.kept()) exports.insert(key, etag, device.copy());
+}
+
+void
+APIWebService::exportActivities(QString athlete, QStringList, HttpRequest &request, HttpResponse &response)
+{
+    // what format to use ?
+    QString format(request.getParameter("format"));
+    if (format == "") format = "json";
+
+    // same formats as when getting a single activity
+    QStringList formats;
+    formats << "tcx" << "csv" << "json" << "pwx";
+    if (!formats.contains(format)) {
+        response.setStatus(500);
+        response.write("unsupported format; we support: tcx csv json pwx\r\n");
+        return;
     }
+
+    // honour the since parameter
+    QString sincep(request.getParameter("since"));
+    QDate since(1900,01,01);
+    if (sincep != "") since = QDate::fromString(sincep,"yyyy/MM/dd");
+
+    // before parameter
+    QString beforep(request.getParameter("before"));
+    QDate before(3000,01,01);
+    if (beforep != "") before = QDate::fromString(beforep,"yyyy/MM/dd");
+
+    // degree of parallelism, default is one per core and
+    // clients can ask for fewer but never more than that
+    int threads = QString(request.getParameter("threads")).toInt();
+    if (threads < 1 || threads > QThread::idealThreadCount()) threads = 0;
+
+    // queue up all the activities in the date range, exported into memory
+    // csv here is the full GC csv, as for a single activity, not powertap
+    RideExporter exporter(NULL, format == "csv" ? "gccsv" : format, threads);
+    QDir activities(home.absolutePath() + "/" + athlete + "/activities");
+    foreach(QString name, activities.entryList(QStringList() << "*", QDir::Files, QDir::Name)) {
+
+        // parse it into date and time
+        QDateTime dateTime;
+        if (!RideFile::parseRideFileName(name, &dateTime)) continue;
+
+        // in range?
+        if (dateTime.date() < since || dateTime.date() > before) continue;
+
+        // is it a backup ?
+        if (name.endsWith(".bak")) continue;
+
+        exporter.addFile(activities.absolutePath() + "/" + name);
+    }
+
+    response.setHeader("Content-Type", "application/zip");
+    response.setHeader("Content-Disposition", QString("attachment; filename=\"%1.zip\"").arg(athlete).toLocal8Bit());
+
+    // workers run ahead whilst we add to the zip in order
+    // and send each entry as soon as it has been added
+    ResponseDevice device(response);
+    ZipWriter zip(&device);
+    exporter.start();
+
+    for (int i=0; i<exporter.count(); i++) {
+
+        QByteArray data;
+        QStringList errors;
+        if (exporter.take(i, data, errors) != RideExporter::Exported) continue;
+
+        zip.addFile(QFileInfo(exporter.source(i)).completeBaseName() + "." + format, data);
+        device.flush();
+    }
+
+    // central directory and last chunk
+    zip.close();
+    device.flush(true);
 }
 
 void
@@ -23,6 +23,8 @@
 #include "RideItem.h"
 #include "RideMetadata.h"
 #include <QDir>
+#include <QCache>
+#include <QMutex>
 
 struct listRideSettings {
     bool intervals;
@@ -31,13 +33,32 @@ struct listRideSettings {
     QList<QString> metawanted; // metadata to list
 };
 
+// activities rendered recently by listActivity, keyed on filename and format
+// and only returned whilst the etag still matches. Bounded by total size and
+// shared by the connection handler threads.
+class APIExportCache
+{
+    public:
+
+        APIExportCache(int bytes) : cache(bytes) {}
+
+        bool lookup(QString key, QByteArray etag, QByteArray &data);
+        void insert(QString key, QByteArray etag, QByteArray data);
+
+    private:
+
+        struct entry { QByteArray etag, data; };
+
+        QMutex mutex;
+        QCache<QString, entry> cache;
+};
+
 class APIWebService : public HttpRequestHandler
 {
 
     public:
 
-        // nothing to do in constructor
-        APIWebService(QDir home, QObject *parent=NULL) : HttpRequestHandler(parent), home(home) {}
+        APIWebService(QDir home, QObject *parent=NULL);
 
         // request despatchers
         void service(HttpRequest &request, HttpResponse &response);
@@ -49,12 +70,15 @@ class APIWebService : public HttpRequestHandler
         void listActivity(QString athlete, QStringList paths, HttpRequest &request, HttpResponse &response);
         void listMMP(QString athlete, QStringList paths, HttpRequest &request, HttpResponse &response);
         void listZones(QString athlete, QStringList paths, HttpRequest &request, HttpResponse &response);
+        void exportActivities(QString athlete, QStringList paths, HttpRequest &request, HttpResponse &response);
+        void trace(QStringList paths, HttpRequest &request, HttpResponse &response);
 
         // utility
         void writeRideLine(RideItem &item, HttpRequest *request, HttpResponse *response);
 
     private:
         QDir home;
+        APIExportCache exports;
 };
 
 #endif
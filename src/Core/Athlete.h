@@ -44,6 +44,7 @@ class Seasons;
 class RideNavigator;
 class NamedSearches;
 class RideFileCache;
+class PeakTable;
 class RideItem;
 class IntervalItem;
 class IntervalTreeView;
@@ -99,6 +100,7 @@ class Athlete : public QObject
         QList<PDEstimate> PDEstimates_;
         Routes *routes;
         QList<RideFileCache*> cpxCache;
+        PeakTable *peaks;
         RideCache *rideCache;
         QList<BodyMeasure> bodyMeasures_;
         QList<HrvMeasure> hrvMeasures_;
@@ -0,0 +1,430 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Benchmark.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "IntervalItem.h"
+#include "RideFile.h"
+#include "RideFileCache.h"
+#include "RideMetric.h"
+#include "Specification.h"
+#include "DataFilter.h"
+#include "ErgFile.h"
+#include "GcUpgrade.h"
+#include "Settings.h"
+
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QThreadPool>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+// filters evaluated against every ride in the synthetic athlete
+static const char *filters[] = {
+    "isRun || Duration > 3600",
+    "Distance > 40 && Average_Power > 150",
+    "TSS > 100 && IF > 0.8",
+    NULL
+};
+
+// stages quicker than this are too noisy to compare
+static const double NOISE_MS = 5;
+
+static bool
+removeDir(const QString &dirName)
+{
+    bool result = true;
+    QDir dir(dirName);
+
+    if (dir.exists(dirName)) {
+        foreach(QFileInfo info, dir.entryInfoList(QDir::NoDotAndDotDot | QDir::System | QDir::Hidden | QDir::AllDirs | QDir::Files, QDir::DirsFirst)) {
+            if (info.isDir()) result = removeDir(info.absoluteFilePath());
+            else result = QFile::remove(info.absoluteFilePath());
+
+            if (!result) return result;
+        }
+        result = dir.rmdir(dirName);
+    }
+    return result;
+}
+
+Benchmark::Benchmark(QString corpus, int scale) : corpusDir(corpus), scale(scale), context(NULL)
+{
+}
+
+Benchmark::~Benchmark()
+{
+    closeAthlete();
+    removeAthlete();
+}
+
+void
+Benchmark::add(QString stage, qint64 nsecs, qint64 samples)
+{
+    Stage &here = stages[stage];
+    here.nsecs += nsecs;
+    here.samples += samples;
+    here.count++;
+}
+
+bool
+Benchmark::run()
+{
+    if (!QDir(corpusDir + "/rides").exists()) {
+        error = tr("No test corpus found at %1").arg(corpusDir);
+        return false;
+    }
+
+    // stages that need an athlete run against an empty one
+    if (!createAthlete() || !openAthlete()) return false;
+
+    fprintf(stderr, "Benchmarking corpus in %s\n", corpusDir.toLocal8Bit().constData());
+    corpus();
+    workouts();
+
+    if (items.isEmpty()) {
+        error = tr("No rides with data in the test corpus");
+        return false;
+    }
+
+    // clone the corpus to make the synthetic athlete, then
+    // reopen it so the rides are found and refreshed
+    if (scale > 0) {
+        fprintf(stderr, "Generating %d rides\n", scale);
+        generate();
+    }
+    closeAthlete();
+
+    if (scale > 0) {
+        fprintf(stderr, "Benchmarking synthetic athlete\n");
+        library();
+        closeAthlete();
+    }
+    return true;
+}
+
+//
+// Synthetic athlete
+//
+bool
+Benchmark::createAthlete()
+{
+    QDir root(QDir::tempPath());
+    athleteName = QString("gcbench-%1").arg(QCoreApplication::applicationPid());
+
+    removeDir(root.absoluteFilePath(athleteName));
+    if (!root.mkdir(athleteName)) {
+        error = tr("Unable to create athlete folder in %1").arg(root.absolutePath());
+        athleteName = "";
+        return false;
+    }
+    athleteHome = QDir(root.absoluteFilePath(athleteName));
+
+    AthleteDirectoryStructure home(athleteHome);
+    home.createAllSubdirs();
+
+    // new athlete, so no upgrade required
+    appsettings->initializeQSettingsNewAthlete(root.canonicalPath(), athleteName);
+    appsettings->setCValue(athleteName, GC_UPGRADE_FOLDER_SUCCESS, true);
+    appsettings->setCValue(athleteName, GC_VERSION_USED, QVariant(VERSION_LATEST));
+
+    // zones so the metrics and intervals that need CP get computed
+    QFile::copy(corpusDir + "/rides/power.zones", home.config().absoluteFilePath("power.zones"));
+
+    return true;
+}
+
+bool
+Benchmark::openAthlete()
+{
+    // no mainwindow, nothing in the athlete or ride cache needs
+    // one unless rides are deleted, which we never do
+    context = new Context(NULL);
+    context->athlete = new Athlete(context, athleteHome);
+
+    if (context->athlete->rideCache == NULL) {
+        error = tr("Unable to open athlete %1").arg(athleteName);
+        closeAthlete();
+        return false;
+    }
+    return true;
+}
+
+void
+Benchmark::closeAthlete()
+{
+    // the corpus rides belong to the athlete that opened them
+    foreach(RideItem *item, items) {
+        foreach(IntervalItem *interval, item->intervals()) delete interval;
+        delete item;
+    }
+    items.clear();
+
+    if (context) {
+        delete context->athlete;
+        delete context;
+        context = NULL;
+    }
+}
+
+void
+Benchmark::removeAthlete()
+{
+    if (athleteName != "") removeDir(athleteHome.absolutePath());
+    athleteName = "";
+}
+
+//
+// Stages
+//
+void
+Benchmark::corpus()
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    QStringList suffixes = RideFileFactory::instance().suffixes();
+    QStringList folders;
+    folders << "rides" << "runs" << "swims";
+
+    QElapsedTimer timer;
+    foreach(QString folder, folders) {
+
+        QDirIterator it(corpusDir + "/" + folder, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+
+            QFileInfo info(it.next());
+            QString suffix = info.suffix().toLower();
+            if (!suffixes.contains(suffix)) continue;
+
+            // parse
+            QFile file(info.absoluteFilePath());
+            QStringList errors;
+            timer.start();
+            RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
+            qint64 elapsed = timer.nsecsElapsed();
+
+            if (ride == NULL) {
+                fprintf(stderr, "  failed to read %s\n", info.fileName().toLocal8Bit().constData());
+                continue;
+            }
+
+            qint64 samples = ride->dataPoints().count();
+            add("parse." + suffix, elapsed, samples);
+
+            // nothing more to do without data
+            if (samples == 0) {
+                delete ride;
+                continue;
+            }
+
+            timer.start();
+            ride->recalculateDerivedSeries(true);
+            add("derived", timer.nsecsElapsed(), samples);
+
+            timer.start();
+            ride->wstale = true;
+            ride->wprimeData();
+            add("wbal", timer.nsecsElapsed(), samples);
+
+            timer.start();
+            ride->sstale = true;
+            ride->powerSums();
+            add("sums", timer.nsecsElapsed(), samples);
+
+            timer.start();
+            { RideFileCache meanmax(ride); }
+            add("meanmax", timer.nsecsElapsed(), samples);
+
+            // set up a ride item as RideItem::refresh would
+            RideItem *item = new RideItem(ride, context);
+            item->dateTime = ride->startTime();
+            item->metadata_ = ride->tags();
+            item->getWeight();
+            item->isRun = ride->isRun();
+            item->isSwim = ride->isSwim();
+            item->present = ride->getTag("Data", "");
+            item->samples = true;
+            if (context->athlete->zones(item->isRun)) item->zoneRange = context->athlete->zones(item->isRun)->whichRange(item->dateTime.date());
+            if (context->athlete->hrZones(item->isRun)) item->hrZoneRange = context->athlete->hrZones(item->isRun)->whichRange(item->dateTime.date());
+            if (context->athlete->paceZones(item->isSwim)) item->paceZoneRange = context->athlete->paceZones(item->isSwim)->whichRange(item->dateTime.date());
+
+            timer.start();
+            item->setFrom(RideMetric::computeMetrics(item, Specification(), factory.allMetrics()));
+            add("metrics", timer.nsecsElapsed(), samples);
+
+            timer.start();
+            item->updateIntervals();
+            add("intervals", timer.nsecsElapsed(), samples);
+
+            items << item;
+        }
+    }
+}
+
+void
+Benchmark::workouts()
+{
+    QElapsedTimer timer;
+    QDirIterator it(corpusDir + "/workouts", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+
+        QString name = it.next();
+        if (!ErgFile::isWorkout(name)) continue;
+
+        timer.start();
+        ErgFile workout(name, 0, context);
+        qint64 elapsed = timer.nsecsElapsed();
+
+        if (workout.isValid()) add("workout." + QFileInfo(name).suffix().toLower(), elapsed, workout.Points.count());
+    }
+}
+
+void
+Benchmark::generate()
+{
+    QDir activities = context->athlete->home->activities();
+    QDate first = QDate::currentDate().addDays(-scale);
+
+    // one a day, cycling through the corpus
+    QElapsedTimer timer;
+    for (int i=0; i<scale; i++) {
+
+        RideFile *ride = items[i % items.count()]->ride_;
+        QDateTime original = ride->startTime();
+        QDateTime start(first.addDays(i), original.time());
+
+        ride->setStartTime(start);
+        QFile file(activities.absoluteFilePath(start.toString("yyyy_MM_dd_hh_mm_ss") + ".json"));
+
+        timer.start();
+        RideFileFactory::instance().writeRideFile(context, ride, file, "json");
+        add("generate", timer.nsecsElapsed(), ride->dataPoints().count());
+
+        ride->setStartTime(original);
+    }
+}
+
+void
+Benchmark::library()
+{
+    // open lists the rides and loads rideDB.json, there is
+    // no rideDB.json yet so everything is refreshed
+    QElapsedTimer timer;
+    timer.start();
+    if (!openAthlete()) return;
+    add("athlete.open", timer.nsecsElapsed());
+
+    RideCache *cache = context->athlete->rideCache;
+
+    // the refresh was started by the ride cache, and ends
+    // after it has been saved to rideDB.json
+    QEventLoop loop;
+    QObject::connect(context, SIGNAL(refreshEnd()), &loop, SLOT(quit()));
+    timer.start();
+    loop.exec();
+    add("athlete.refresh", timer.nsecsElapsed(), cache->count());
+
+    timer.start();
+    cache->save();
+    add("ridedb.save", timer.nsecsElapsed(), cache->count());
+
+    timer.start();
+    cache->load();
+    add("ridedb.load", timer.nsecsElapsed(), cache->count());
+
+    for (int i=0; filters[i]; i++) {
+
+        DataFilter filter(NULL, context, filters[i]);
+
+        timer.start();
+        foreach(RideItem *item, cache->rides()) filter.evaluate(item, NULL);
+        add("datafilter", timer.nsecsElapsed(), cache->count());
+    }
+}
+
+//
+// Results
+//
+QByteArray
+Benchmark::toJson() const
+{
+    QJsonObject results;
+    QMapIterator<QString, Stage> it(stages);
+    while (it.hasNext()) {
+        it.next();
+
+        QJsonObject stage;
+        stage.insert("ms", double(it.value().nsecs) / 1000000.0);
+        stage.insert("count", it.value().count);
+        stage.insert("samples", double(it.value().samples));
+        results.insert(it.key(), stage);
+    }
+
+    QJsonObject root;
+    root.insert("version", QString(VERSION_STRING));
+    root.insert("build", VERSION_LATEST);
+    root.insert("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+    root.insert("threads", QThreadPool::globalInstance()->maxThreadCount());
+    root.insert("scale", scale);
+    root.insert("stages", results);
+
+    return QJsonDocument(root).toJson();
+}
+
+int
+Benchmark::compare(QString baseline, double tolerance) const
+{
+    QFile file(baseline);
+    if (!file.open(QFile::ReadOnly)) return -1;
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    if (!doc.isObject()) return -1;
+
+    QJsonObject before = doc.object().value("stages").toObject();
+    if (doc.object().value("scale").toInt() != scale)
+        fprintf(stderr, "Warning: baseline was run with --bench-scale=%d\n", doc.object().value("scale").toInt());
+
+    int regressions = 0;
+    fprintf(stderr, "\n%-20s %12s %12s %8s\n", "stage", "baseline ms", "now ms", "change");
+
+    QMapIterator<QString, Stage> it(stages);
+    while (it.hasNext()) {
+        it.next();
+
+        double now = double(it.value().nsecs) / 1000000.0;
+        if (!before.contains(it.key())) {
+            fprintf(stderr, "%-20s %12s %12.1f\n", it.key().toLocal8Bit().constData(), "-", now);
+            continue;
+        }
+
+        double then = before.value(it.key()).toObject().value("ms").toDouble();
+        double change = then > 0 ? 100.0 * (now - then) / then : 0;
+        bool slower = (now - then) > NOISE_MS && change > tolerance;
+        if (slower) regressions++;
+
+        fprintf(stderr, "%-20s %12.1f %12.1f %+7.1f%%%s\n", it.key().toLocal8Bit().constData(),
+                then, now, change, slower ? " REGRESSION" : "");
+    }
+
+    return regressions;
+}
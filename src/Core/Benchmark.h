@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Benchmark_h
+#define _GC_Benchmark_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMap>
+#include <QDir>
+#include <QByteArray>
+#include <QCoreApplication>
+
+class Context;
+class RideItem;
+
+//
+// Headless benchmark, run with GoldenCheetah --bench
+//
+// Times each stage of the ride pipeline over the sample files in the test/
+// corpus; parsing (by file format), derived series, W'bal, mean-max and
+// distributions, metrics and interval discovery. Then it generates a
+// synthetic athlete with thousands of rides cloned from the corpus and times
+// opening it, the background refresh, rideDB.json save/load and DataFilter
+// evaluation across the whole library.
+//
+// The synthetic athlete lives in a temporary folder and is removed when
+// we're done, nothing in the user's library is touched.
+//
+// Results are written as JSON so they can be kept and passed back via
+// --bench-baseline to check for regressions after an upgrade.
+//
+class Benchmark
+{
+    Q_DECLARE_TR_FUNCTIONS(Benchmark)
+
+    public:
+
+        // corpus is the test folder, scale is the number of synthetic rides
+        Benchmark(QString corpus, int scale);
+        ~Benchmark();
+
+        // run all the stages, false if it couldn't get going
+        bool run();
+        QString errorString() const { return error; }
+
+        // results
+        QByteArray toJson() const;
+
+        // compare against a previous run and report any stage that
+        // got slower by more than tolerance percent, returns the
+        // number of regressions found or -1 if baseline unreadable
+        int compare(QString baseline, double tolerance) const;
+
+    private:
+
+        struct Stage {
+            Stage() : nsecs(0), count(0), samples(0) {}
+            qint64 nsecs;   // total elapsed
+            int count;      // times it was run
+            qint64 samples; // data points processed
+        };
+        void add(QString stage, qint64 nsecs, qint64 samples=0);
+
+        // the synthetic athlete
+        bool createAthlete();
+        bool openAthlete();
+        void closeAthlete();
+        void removeAthlete();
+
+        // the stages
+        void corpus();
+        void workouts();
+        void generate();
+        void library();
+
+        QString corpusDir, error;
+        int scale;
+
+        QString athleteName;
+        QDir athleteHome;
+        Context *context;
+
+        // corpus rides with data, cloned to make the synthetic athlete
+        QList<RideItem*> items;
+
+        QMap<QString, Stage> stages;
+};
+
+#endif // _GC_Benchmark_h
@@ -25,6 +25,7 @@
 #include "CompareInterval.h" // what intervals are being compared?
 #include "CompareDateRange.h" // what intervals are being compared?
 #include "RideFile.h"
+#include "RideFileLRU.h" // for class RidePin
 
 #ifdef GC_HAS_CLOUD_DB
 #include "CloudDBChart.h"
@@ -93,6 +94,7 @@ class Context : public QObject
         Tab *tab;
         Athlete *athlete;
         RideItem *ride;  // the currently selected ride
+        RidePin ridePin; // which is kept open
         DateRange dr_;
         ErgFile *workout; // the currently selected workout file
         VideoSyncFile *videosync; // the currently selected videosync file
@@ -108,6 +110,7 @@ class Context : public QObject
         // train mode state
         bool isRunning;
         bool isPaused;
+        RealtimeSnapshot telemetry; // latest telemetry, never modified
 
         // comparing things
         bool isCompareIntervals;
@@ -148,7 +151,12 @@ class Context : public QObject
         void setIndex(int i) { viewIndex = i; emit viewChanged(i); }
 
         // realtime signals
-        void notifyTelemetryUpdate(const RealtimeData &rtData) { telemetryUpdate(rtData); }
+        void notifyTelemetryUpdate(const RealtimeData &rtData) {
+            // charts are passed a reference to the shared snapshot, hold on to
+            // context->telemetry if you need it after returning
+            telemetry = RealtimeSnapshot(new RealtimeData(rtData));
+            telemetryUpdate(*telemetry);
+        }
         void notifyErgFileSelected(ErgFile *x) { workout=x; ergFileSelected(x); }
         void notifyVideoSyncFileSelected(VideoSyncFile *x) { videosync=x; videoSyncFileSelected(x); }
         ErgFile *currentErgFile() { return workout; }
@@ -169,8 +177,8 @@ class Context : public QObject
         void notifyWorkoutsChanged() { emit workoutsChanged(); }
         void notifyVideoSyncChanged() { emit VideoSyncChanged(); }
 
-        void notifyRideSelected(RideItem*x) { ride=x; rideSelected(x); }
-        void notifyRideAdded(RideItem *x) { ride=x; rideAdded(x); }
+        void notifyRideSelected(RideItem*x) { ride=x; ridePin.reset(x); rideSelected(x); }
+        void notifyRideAdded(RideItem *x) { ride=x; ridePin.reset(x); rideAdded(x); }
         void notifyRideDeleted(RideItem *x) { ride=x; rideDeleted(x); }
         void notifyRideChanged(RideItem *x) { rideChanged(x); }
         void notifyRideSaved(RideItem *x) { rideSaved(x); }
@@ -256,7 +264,7 @@ class Context : public QObject
         void rideClean(RideItem*);
 
         // realtime
-        void telemetryUpdate(RealtimeData rtData);
+        void telemetryUpdate(const RealtimeData &rtData);
         void ergFileSelected(ErgFile *);
         void videoSyncFileSelected(VideoSyncFile *);
         void mediaSelected(QString);
@@ -22,6 +22,7 @@
 #include "RideItem.h"
 #include "RideNavigator.h"
 #include "RideFileCache.h"
+#include "PeakTable.h"
 #include "PMCData.h"
 #include "VDOTCalculator.h"
 #include "DataProcessor.h"
@@ -1129,6 +1130,14 @@ void Leaf::validateFilter(Context *context, DataFilterRuntime *df, Leaf *leaf)
                 if (leaf->function == "best" || leaf->function == "tiz") {
                     // now set the series type used as parameter 1 to best/tiz
                     leaf->seriesType = nameToSeries(symbol);
+
+                    // fixed durations can be read for all rides up front
+                    if (leaf->function == "best" && leaf->lvalue.l) {
+                        if (leaf->lvalue.l->type == Leaf::Integer)
+                            df->peaks << QPair<RideFile::SeriesType,int>(leaf->seriesType, leaf->lvalue.l->lvalue.i);
+                        else if (leaf->lvalue.l->type == Leaf::Float)
+                            df->peaks << QPair<RideFile::SeriesType,int>(leaf->seriesType, leaf->lvalue.l->lvalue.f);
+                    }
                 }
 
             } else { // generic functions, math etc
@@ -1563,6 +1572,7 @@ QStringList DataFilter::parseFilter(Context *context, QString query, QStringList
     rt.isdynamic=false;
     rt.snips.clear();
     rt.symbols.clear();
+    rt.peaks.clear();
 
     // regardless of fail/pass set the signature
     setSignature(query);
@@ -1605,6 +1615,7 @@ QStringList DataFilter::parseFilter(Context *context, QString query, QStringList
 
         // clear current filter list
         filenames.clear();
+        prefetchPeaks();
 
         // get all fields...
         foreach(RideItem *item, context->athlete->rideCache->rides()) {
@@ -1631,6 +1642,7 @@ DataFilter::dynamicParse()
 
         // clear current filter list
         filenames.clear();
+        prefetchPeaks();
 
         // get all fields...
         foreach(RideItem *item, context->athlete->rideCache->rides()) {
@@ -1645,6 +1657,20 @@ DataFilter::dynamicParse()
     }
 }
 
+// read the peaks used by best() for every ride in one pass per series
+// rather than ride by ride as the filter is evaluated
+void DataFilter::prefetchPeaks()
+{
+    QMap<RideFile::SeriesType, QList<int> > wanted;
+    for (int i=0; i<rt.peaks.count(); i++) wanted[rt.peaks[i].first] << rt.peaks[i].second;
+
+    QMapIterator<RideFile::SeriesType, QList<int> > it(wanted);
+    while (it.hasNext()) {
+        it.next();
+        context->athlete->peaks->prefetch(it.key(), it.value());
+    }
+}
+
 void DataFilter::clearFilter()
 {
     if (treeRoot) {
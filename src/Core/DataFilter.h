@@ -25,6 +25,7 @@
 #include <QList>
 #include <QMap>
 #include <QHash>
+#include <QPair>
 #include <QStringList>
 #include <QTextDocument>
 #include "RideCache.h"
@@ -141,6 +142,9 @@ public:
 
     // pd models for estimates
     QList <PDModel*>models;
+
+    // best() series and fixed durations used
+    QList<QPair<RideFile::SeriesType, int> > peaks;
 };
 
 class DataFilter : public QObject
@@ -189,6 +193,7 @@ class DataFilter : public QObject
 
     private:
         void setSignature(QString &query);
+        void prefetchPeaks();
 
         Leaf *treeRoot;
         QStringList errors;
@@ -19,11 +19,18 @@
 #include "IntervalItem.h"
 #include "Specification.h"
 #include "RideFile.h"
+#include "RideFileLRU.h"
 #include "Context.h"
 #include "Athlete.h"
 #include "Colors.h"
 #include "ColorButton.h"
 
+#if QT_VERSION > 0x050000
+# include <QtConcurrent>
+#else
+# include <QtConcurrentMap>
+#endif
+
 IntervalItem::IntervalItem(const RideItem *ride, QString name, double start, double stop, 
                            double startKM, double stopKM, int displaySequence, QColor color,
                            RideFileInterval::IntervalType type)
@@ -88,6 +95,13 @@ IntervalItem::setValues(QString name, double duration1, double duration2,
 
 void
 IntervalItem::refresh()
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    refresh(factory.allMetrics(), RideMetric::computeOrder(factory.allMetrics()));
+}
+
+void
+IntervalItem::refresh(const QStringList &metrics, const QStringList &order)
 {
     // don't open on our account - we should be called with a ride available
     RideFile *f = rideItem_->ride_;
@@ -101,7 +115,7 @@ IntervalItem::refresh()
     count_.fill(0, factory.metricCount());
 
     // ok, lets collect the metrics
-    QHash<QString,RideMetricPtr> computed=RideMetric::computeMetrics(rideItem_, Specification(this, f->recIntSecs()), factory.allMetrics());
+    QHash<QString,RideMetricPtr> computed=RideMetric::computeMetrics(rideItem_, Specification(this, f->recIntSecs()), metrics, order);
     // take a deep copy, quick before the thread exits.
     //XXXcomputed.detach();
 
@@ -127,6 +141,52 @@ IntervalItem::refresh()
         }
 }
 
+// one interval for the batch refresh below
+struct IntervalRefresh {
+    IntervalItem *interval;
+    const QStringList *metrics, *order;
+};
+
+static void
+intervalRefresh(IntervalRefresh &work)
+{
+    work.interval->refresh(*work.metrics, *work.order);
+}
+
+void
+IntervalItem::refresh(QList<IntervalItem*> intervals)
+{
+    if (intervals.isEmpty()) return;
+
+    // don't open on our account - we should be called with a ride available
+    // and it must stay open whilst the workers share it
+    RidePin pin(intervals.first()->rideItem_);
+    RideFile *f = intervals.first()->rideItem_->ride_;
+    if (!f) return;
+
+    // same metrics for all of them, so resolve dependencies once
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    QStringList metrics = factory.allMetrics();
+    QStringList order = RideMetric::computeOrder(metrics);
+
+    // W' and the power sums are computed on first use, get that
+    // done before the intervals share the ride across threads
+    f->wprimeData();
+    f->powerSums();
+
+    QVector<IntervalRefresh> work(intervals.count());
+    for (int i=0; i<intervals.count(); i++) {
+        work[i].interval = intervals[i];
+        work[i].metrics = &metrics;
+        work[i].order = &order;
+    }
+
+    // we may be on a RideCache refresh thread already, but
+    // the calling thread joins in so we won't starve the pool
+    if (work.count() > 1) QtConcurrent::blockingMap(work, intervalRefresh);
+    else intervalRefresh(work[0]);
+}
+
 
 double
 IntervalItem::getForSymbol(QString name, bool useMetricUnits)
@@ -70,6 +70,11 @@ class IntervalItem
 
         // precomputed metrics
         void refresh();
+
+        // refresh lots of intervals from the same ride together, the
+        // metric order is worked out once and they're computed in parallel
+        static void refresh(QList<IntervalItem*> intervals);
+        void refresh(const QStringList &metrics, const QStringList &order);
         QVector<double> metrics_;
         QVector<double> count_;
         QMap <int, double>stdmean_;
@@ -22,7 +22,9 @@
 #include "Athlete.h"
 #include "RideFileCache.h"
 #include "RideCacheModel.h"
+#include "RideFileLRU.h"
 #include "Specification.h"
+#include "Trace.h"
 #include "DataProcessor.h"
 
 #include "Route.h"
@@ -56,6 +58,10 @@ RideCache::RideCache(Context *context) : context(context)
     progress_ = 100;
     refreshingEstimates = false;
     exiting = false;
+    traceStart = -1;
+
+    // before any rides get opened
+    lru_ = new RideFileLRU(context, this);
 
     // initial load of user defined metrics - do once we have an initial context
     // but before we refresh or check metrics for the first time
@@ -138,6 +144,8 @@ RideCache::RideCache(Context *context) : context(context)
     connect(&watcher, SIGNAL(finished()), this, SLOT(garbageCollect()));
     connect(&watcher, SIGNAL(finished()), this, SLOT(save()));
     connect(&watcher, SIGNAL(finished()), context, SLOT(notifyRefreshEnd()));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(refreshTraced()));
+    connect(&watcher, SIGNAL(finished()), lru_, SLOT(trim()));
     connect(&watcher, SIGNAL(started()), context, SLOT(notifyRefreshStart()));
     connect(&watcher, SIGNAL(progressValueChanged(int)), this, SLOT(progressing(int)));
 }
@@ -456,6 +464,14 @@ RideCache::cancel()
     }
 }
 
+void
+RideCache::refreshTraced()
+{
+    if (traceStart >= 0 && Trace::isEnabled())
+        Trace::complete("RideCache::refresh", QString("%1 rides").arg(reverse_.count()), traceStart);
+    traceStart = -1;
+}
+
 // check if we need to refresh the metrics then start the thread if needed
 void
 RideCache::refresh()
@@ -478,6 +494,9 @@ RideCache::refresh()
     if (staleCount)  {
         reverse_ = rides_;
         qSort(reverse_.begin(), reverse_.end(), rideCacheGreaterThan);
+
+        // the span runs until the workers have all finished
+        traceStart = Trace::isEnabled() ? Trace::now() : -1;
         future = QtConcurrent::map(reverse_, itemRefresh);
         watcher.setFuture(future);
     } else {
@@ -37,6 +37,7 @@
 #endif
 
 class Context;
+class RideFileLRU;
 class RideCacheBackgroundRefresh;
 class Specification;
 class AthleteBest;
@@ -54,6 +55,9 @@ class RideCache : public QObject
         // table models
         RideCacheModel *model() { return model_; }
 
+        // keeps open ride files within a memory budget
+        RideFileLRU *lru() { return lru_; }
+
         // query the cache
         int count() const { return rides_.count(); }
         RideItem *getRide(QString filename);
@@ -121,6 +125,9 @@ class RideCache : public QObject
         // clear deleted objects
         void garbageCollect();
 
+        // background refresh has finished
+        void refreshTraced();
+
     signals:
 
         void modelProgress(int, int); // let others know when we're refreshing the model estimates
@@ -137,9 +144,11 @@ class RideCache : public QObject
 
         QVector<RideItem*> rides_, reverse_, delete_;
         RideCacheModel *model_;
+        RideFileLRU *lru_;
         bool exiting;
         bool refreshingEstimates;
 	    double progress_; // percent
+        qint64 traceStart; // when the refresh started, if tracing
 
         QFuture<void> future;
         QFutureWatcher<void> watcher;
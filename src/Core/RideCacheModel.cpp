@@ -30,6 +30,10 @@ RideCacheModel::RideCacheModel(Context *context, RideCache *cache) : QAbstractTa
     factory = &RideMetricFactory::instance();
     configChanged(CONFIG_FIELDS | CONFIG_NOTECOLOR);
 
+    // item changes are batched up, during a refresh there are lots
+    notifier.setSingleShot(true);
+    connect(&notifier, SIGNAL(timeout()), this, SLOT(notifyChanged()));
+
     connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
     connect(context, SIGNAL(refreshStart()), this, SLOT(refreshStart()));
     connect(context, SIGNAL(refreshEnd()), this, SLOT(refreshEnd()));
@@ -38,6 +42,11 @@ RideCacheModel::RideCacheModel(Context *context, RideCache *cache) : QAbstractTa
     connect(rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(itemChanged(RideItem*)));
 }
 
+RideCacheModel::~RideCacheModel()
+{
+    clearCells();
+}
+
 // must reimplement these
 int 
 RideCacheModel::rowCount(const QModelIndex &parent) const
@@ -62,14 +71,53 @@ RideCacheModel::flags(const QModelIndex &index) const
 QVariant 
 RideCacheModel::data(const QModelIndex &index, int role) const
 {
-    Q_UNUSED(role);
-
     if (!index.isValid() || index.row() < 0 || index.row() >= rideCache->count() ||
         index.column() < 0 || index.column() >= columns_) return QVariant();
 
-    RideItem *item = rideCache->rides()[index.row()];
+    const RideCacheCell &c = cell(index.row(), index.column());
+    return role == SortRole ? c.sort : c.display;
+}
+
+// the navigator has always sorted strings of digits as numbers
+// and everything else as text, so work out which once, here
+static QVariant
+sortKey(const QVariant &display)
+{
+    if (display.type() == QVariant::DateTime) return display;
+
+    QString text = display.toString();
+    for (int i=0; i<text.length(); i++) {
+        ushort c = text.at(i).unicode();
+        if ((c < '0' || c > '9') && c != '.' && c != ',') return text;
+    }
+    return text.toDouble();
+}
 
-    switch (index.column()) {
+const RideCacheCell &
+RideCacheModel::cell(int row, int column) const
+{
+    QVector<RideCacheCell> &rows = cells[column];
+    if (rows.count() != rideCache->count()) rows.resize(rideCache->count());
+
+    RideItem *item = rideCache->rides().at(row);
+    RideCacheCell &c = rows[row];
+
+    // read before formatting, if it is refreshed whilst
+    // we are formatting it we will do it again next time
+    int revision = item->revision_.fetchAndAddOrdered(0);
+    if (c.item != item || c.revision != revision) {
+        c.display = format(item, column);
+        c.sort = sortKey(c.display);
+        c.item = item;
+        c.revision = revision;
+    }
+    return c;
+}
+
+QVariant
+RideCacheModel::format(RideItem *item, int column) const
+{
+    switch (column) {
         case 0 : return item->path;
         case 1 : return item->fileName;
         case 2 : return item->dateTime;
@@ -81,30 +129,27 @@ RideCacheModel::data(const QModelIndex &index, int role) const
         {
             // from here we're either a metric or meta
             // lets work that out ...
-            if (index.column()-5 < factory->metricCount()) {
+            if (column-5 < factory->metricCount()) {
 
                 // is a metric
-                int i=index.column()-5;
+                RideMetric *m = formatters[column-5];
 
-                // unpack metric value into ridemetric and use it to get a stringified
-                // version using the right metric/imperial conversion
-                RideMetric *m = const_cast<RideMetric*>(factory->rideMetric(factory->metricName(i)));
+                // not computed yet, e.g. a user metric was just added
+                double value = m->index() < item->metrics_.count() ? item->metrics_[m->index()] : 0;
 
                 // bit of a kludge, but will return times as QTime,
                 // stuff with no decimal places as a number,
                 // but not if high precision, which means
                 // metrics with high precision don't sort this is crap XXX
                 if (m->isTime()) {
-                    return QTime(0,0,0).addSecs(rideCache->rides().at(index.row())->metrics_[m->index()]);
+                    return QTime(0,0,0).addSecs(value);
                 } else if (m->units(true) != "km" && m->precision() > 0) {
-                    m->setValue(rideCache->rides().at(index.row())->metrics_[m->index()]);
+                    m->setValue(value);
                     return m->toString(context->athlete->useMetricUnits); // string
                 } else {
 
                     // make low precision numbers sort, including distance which we picked
                     // up as a special case. not sure about pace ....
-                    double value = rideCache->rides().at(index.row())->metrics_[m->index()];
-
                     // convert to imperial if needed
                     if (context->athlete->useMetricUnits == false) 
                         value = (value * m->conversion()) + m->conversionSum();
@@ -115,7 +160,7 @@ RideCacheModel::data(const QModelIndex &index, int role) const
             } else {
 
                 // is a metadata
-                int i = index.column() -5 - factory->metricCount();
+                int i = column -5 - factory->metricCount();
                 return item->getText(metadata[i].name, "");
             }
         }
@@ -125,17 +170,65 @@ RideCacheModel::data(const QModelIndex &index, int role) const
 void
 RideCacheModel::itemChanged(RideItem *item)
 {
-    // ok so lets signal that
-    int row = rideCache->rides().indexOf(item);
-    if (row >= 0 && row <= rideCache->count()) {
-        emit dataChanged(createIndex(row,0), createIndex(row,columns_-1));
+    // cells formatted from it are now stale
+    item->revision_.fetchAndAddOrdered(1);
+
+    // and we'll let the views know, in a moment if refreshing
+    if (!notifier.isActive()) notifier.start(rideCache->isRunning() ? 250 : 0);
+}
+
+void
+RideCacheModel::notifyChanged()
+{
+    // find the items whose revision moved on since the views last
+    // heard, and signal each run of them, rather than every item
+    // as it changes. This also catches the background refresh,
+    // which updates items without telling anyone.
+    int count = rideCache->count();
+    if (notified.count() != count) notified.fill(-1, count);
+
+    bool changed = false;
+    int from = -1;
+    for (int row=0; row <= count; row++) {
+
+        bool moved = false;
+        if (row < count) {
+            int revision = rideCache->rides().at(row)->revision_.fetchAndAddOrdered(0);
+            moved = notified[row] != revision;
+            notified[row] = revision;
+        }
+
+        if (moved && from < 0) from = row;
+        else if (!moved && from >= 0) {
+            emit dataChanged(createIndex(from,0), createIndex(row-1,columns_-1));
+            changed = true;
+            from = -1;
+        }
     }
+
     //XXX hack to get the navigator to redraw
-    context->tab->view(1)->sidebar()->update();
+    if (changed) context->tab->view(1)->sidebar()->update();
+}
+
+void
+RideCacheModel::synced()
+{
+    int count = rideCache->count();
+    notified.resize(count);
+    for (int row=0; row < count; row++)
+        notified[row] = rideCache->rides().at(row)->revision_.fetchAndAddOrdered(0);
+}
+
+void
+RideCacheModel::clearCells()
+{
+    cells.clear();
+    qDeleteAll(formatters);
+    formatters.clear();
 }
 
 void RideCacheModel::beginReset() { beginResetModel(); }
-void RideCacheModel::endReset() { endResetModel(); }
+void RideCacheModel::endReset() { synced(); endResetModel(); }
 
 void 
 RideCacheModel::itemAdded(RideItem*)
@@ -152,8 +245,13 @@ RideCacheModel::startRemove(int index)
 }
 
 void
-RideCacheModel::endRemove(int)
+RideCacheModel::endRemove(int index)
 {
+    // the rows after it move up
+    for (int i=0; i<cells.count(); i++)
+        if (index < cells[i].count()) cells[i].remove(index);
+    if (index < notified.count()) notified.remove(index);
+
     endRemoveRows();
 }
 
@@ -189,6 +287,12 @@ RideCacheModel::configChanged(qint32)
     // get field config
     metadata = context->athlete->rideMetadata()->getFields();
 
+    // everything will be formatted again, with our own copy
+    // of each metric so we don't need to touch the factory's
+    clearCells();
+    for (int i=0; i<factory->metricCount(); i++)
+        formatters << factory->rideMetric(factory->metricName(i))->clone();
+
     // set new column count
     // 0    QString path;
     // 1    QString fileName;
@@ -232,6 +336,8 @@ RideCacheModel::configChanged(qint32)
     }
 
     headerDataChanged (Qt::Horizontal, 0, columns_-1);
+    cells.resize(columns_);
+    synced();
 
     // all good
     endResetModel();
@@ -241,6 +347,8 @@ RideCacheModel::configChanged(qint32)
 void 
 RideCacheModel::refreshUpdate(QDate)
 {
+    // refreshed items will be picked up when it fires
+    if (!notifier.isActive()) notifier.start(250);
 }
 
 void 
@@ -251,4 +359,7 @@ RideCacheModel::refreshStart()
 void 
 RideCacheModel::refreshEnd()
 {
+    // last of the changes
+    notifier.stop();
+    notifyChanged();
 }
@@ -30,15 +30,34 @@
 #include <QAbstractTableModel>
 #include <QModelIndex>
 #include <QVariant>
+#include <QTimer>
 
 class Context;
 
+// A formatted cell, we keep these so painting and sorting the ride list
+// doesn't format every metric again on every call to data(). A cell is
+// valid for the item and revision it was formatted from, so it goes
+// stale by itself when an item is refreshed in the background.
+struct RideCacheCell
+{
+    RideCacheCell() : item(NULL), revision(-1) {}
+
+    QVariant display;       // as returned for the display role
+    QVariant sort;          // double if it sorts as a number, otherwise as display
+    const RideItem *item;   // formatted from
+    int revision;           // RideItem::revision_ when formatted
+};
+
 class RideCacheModel : public QAbstractTableModel
 {
     Q_OBJECT
 
     public:
         RideCacheModel(Context *, RideCache *);
+        ~RideCacheModel();
+
+        // data() returns the sort key for this role
+        enum { SortRole = Qt::UserRole + 16 };
 
         // must reimplement these
         int rowCount(const QModelIndex &parent = QModelIndex()) const; 
@@ -70,7 +89,21 @@ class RideCacheModel : public QAbstractTableModel
         void startRemove(int);
         void endRemove(int);
 
+        // tell the views about the items that changed since last time
+        void notifyChanged();
+
     private:
+
+        // format a cell, or return the one we already have
+        const RideCacheCell &cell(int row, int column) const;
+        QVariant format(RideItem *item, int column) const;
+
+        // the views have seen the items as they are now
+        void synced();
+
+        // drop all cells and metric formatters
+        void clearCells();
+
         Context *context;
         RideCache *rideCache;
         RideMetricFactory *factory;
@@ -80,6 +113,18 @@ class RideCacheModel : public QAbstractTableModel
 
         // the fields as defined
         QList<FieldDefinition> metadata;
+
+        // our own copies of the metrics, by column, to format values
+        QVector<RideMetric*> formatters;
+
+        // cells by column then row, a column is empty until it is used
+        mutable QVector<QVector<RideCacheCell> > cells;
+
+        // item revisions the views have been told about, by row
+        QVector<int> notified;
+
+        // changes are collected and notified together
+        QTimer notifier;
 };
 
 #endif
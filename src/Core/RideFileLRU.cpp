@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideFileLRU.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "RideFile.h"
+#include "Settings.h"
+
+#include <QMetaObject>
+#include <QtAlgorithms>
+
+// default budget in MB
+static const int DEFAULT_BUDGET = 1024;
+
+// for sorting, least recently used first
+bool
+RideFileLRU::lessRecentlyUsed(const RideItem *a, const RideItem *b)
+{
+    return a->lastUsed_.loadAcquire() < b->lastUsed_.loadAcquire();
+}
+
+RideFileLRU::RideFileLRU(Context *context, QObject *parent) :
+    QObject(parent), context(context), budget_(0), bytes_(0), loads_(0), evictions_(0), pending(false)
+{
+    setBudget(qint64(appsettings->value(NULL, GC_RIDEFILE_MEMORY, DEFAULT_BUDGET).toInt()) * 1024 * 1024);
+}
+
+void
+RideFileLRU::setBudget(qint64 bytes)
+{
+    mutex.lock();
+    budget_ = bytes;
+    mutex.unlock();
+
+    // may need to shed some now
+    QMetaObject::invokeMethod(this, "trim", Qt::QueuedConnection);
+}
+
+qint64
+RideFileLRU::footprint(RideFile *ride)
+{
+    if (!ride) return 0;
+
+    qint64 bytes = sizeof(RideFile);
+    bytes += qint64(ride->dataPoints().count()) * (sizeof(RideFilePoint) + sizeof(RideFilePoint*));
+
+    foreach(XDataSeries *series, ride->xdata()) {
+        bytes += sizeof(XDataSeries);
+        bytes += qint64(series->datapoints.count()) * (sizeof(XDataPoint) + sizeof(XDataPoint*));
+    }
+    return bytes;
+}
+
+void
+RideFileLRU::opened(RideItem *item, bool loaded)
+{
+    qint64 bytes = footprint(item->ride_);
+
+    QMutexLocker locker(&mutex);
+
+    if (open_.contains(item)) bytes_ -= item->footprint_;
+    item->footprint_ = bytes;
+    open_.insert(item);
+    bytes_ += bytes;
+    if (loaded) loads_++;
+
+    // we never close here, the caller is about to use it and may
+    // be holding other rides too, so wait for the event loop
+    if (budget_ > 0 && bytes_ > budget_ && !pending) {
+        pending = true;
+        QMetaObject::invokeMethod(this, "trim", Qt::QueuedConnection);
+    }
+}
+
+void
+RideFileLRU::closed(RideItem *item)
+{
+    QMutexLocker locker(&mutex);
+
+    if (open_.remove(item)) bytes_ -= item->footprint_;
+    item->footprint_ = 0;
+}
+
+// called with mutex held, on the GUI thread
+bool
+RideFileLRU::evictable(RideItem *item) const
+{
+    // on screen, unsaved or being edited
+    if (item->pins_.loadAcquire() > 0 || item->isdirty || item->isedit) return false;
+
+    // the selected ride is always pinned, but just in case
+    if (item == context->currentRideItem()) return false;
+
+    return item->ride_ != NULL;
+}
+
+void
+RideFileLRU::trim()
+{
+    mutex.lock();
+    pending = false;
+    bool over = budget_ > 0 && bytes_ > budget_;
+    mutex.unlock();
+
+    if (!over) return;
+
+    // not whilst rides are being refreshed in the background
+    // we get called again when the refresh completes
+    RideCache *cache = context->athlete ? context->athlete->rideCache : NULL;
+    if (cache == NULL || cache->isRunning()) return;
+
+    QList<RideItem*> candidates;
+    mutex.lock();
+    foreach(RideItem *item, open_) if (evictable(item)) candidates << item;
+    mutex.unlock();
+
+    qSort(candidates.begin(), candidates.end(), lessRecentlyUsed);
+
+    int evicted = 0;
+    foreach(RideItem *item, candidates) {
+
+        mutex.lock();
+        over = bytes_ > budget_;
+        bool still = evictable(item); // may have been pinned since
+        mutex.unlock();
+        if (!over) break;
+        if (!still) continue;
+
+        item->close(); // will call closed()
+        evicted++;
+    }
+
+    mutex.lock();
+    evictions_ += evicted;
+    qint64 bytes = bytes_;
+    mutex.unlock();
+
+    if (evicted) emit trimmed(evicted, bytes);
+}
+
+RideFileLRU::Stats
+RideFileLRU::stats()
+{
+    QMutexLocker locker(&mutex);
+
+    Stats returning;
+    returning.open = open_.count();
+    returning.pinned = 0;
+    foreach(RideItem *item, open_) if (!evictable(item)) returning.pinned++;
+    returning.bytes = bytes_;
+    returning.budget = budget_;
+    returning.loads = loads_;
+    returning.evictions = evictions_;
+    return returning;
+}
+
+//
+// RidePin
+//
+RidePin::RidePin(RideItem *item) : item_(item)
+{
+    if (item_) item_->pins_.ref();
+}
+
+RidePin::RidePin(const RidePin &other) : item_(other.item_)
+{
+    if (item_) item_->pins_.ref();
+}
+
+RidePin::~RidePin()
+{
+    reset(NULL);
+}
+
+RideItem *
+RidePin::item() const
+{
+    return item_;
+}
+
+RidePin &
+RidePin::operator=(const RidePin &other)
+{
+    reset(other.item_);
+    return *this;
+}
+
+void
+RidePin::reset(RideItem *item)
+{
+    if (item == item_) return;
+
+    // pin new before unpinning old
+    if (item) item->pins_.ref();
+
+    RideItem *old = item_;
+    item_ = item;
+
+    // the lru may want to close it now, if it is still open
+    if (old && !old->pins_.deref() && old->ride_ && old->lru())
+        QMetaObject::invokeMethod(old->lru(), "trim", Qt::QueuedConnection);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideFileLRU_h
+#define _GC_RideFileLRU_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QMutex>
+#include <QSet>
+
+class Context;
+class RideItem;
+class RideFile;
+
+//
+// Keeps the ride files opened via RideItem::ride() within a memory budget
+//
+// Lots of things open rides (charts, DataFilter, R, UserData) and until now
+// they stayed open until something called RideItem::close(), so a long session
+// could end up holding hundreds of fully expanded RideFiles.
+//
+// RideItem tells us when a file is opened and closed, and stamps itself each
+// time ride() is called. When the rides open exceed the budget we close the
+// least recently used ones that are not pinned, dirty or being edited. Closing
+// is always deferred to the event loop on the GUI thread, so a RideFile pointer
+// from ride() is safe until control returns to the event loop. Anything that
+// holds it longer, or uses it on another thread, must hold a RidePin. We also
+// leave it alone whilst the RideCache is refreshing in the background.
+//
+class RideFileLRU : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideFileLRU(Context *context, QObject *parent=NULL);
+
+        // memory budget in bytes, 0 means no limit
+        void setBudget(qint64 bytes);
+        qint64 budget() const { return budget_; }
+
+        // RideItem tells us what is going on, safe from any thread
+        // loaded is false when the ride was handed to it, not read
+        void opened(RideItem *item, bool loaded=true);
+        void closed(RideItem *item);
+
+        // instrumentation
+        struct Stats {
+            int open, pinned;   // rides open and how many are pinned/dirty
+            qint64 bytes;       // estimate of memory they use
+            qint64 budget;      // limit
+            quint64 loads;      // times a file was read from disk
+            quint64 evictions;  // times we closed one
+        };
+        Stats stats();
+
+        // estimate of the memory used by a ride file
+        static qint64 footprint(RideFile *ride);
+
+    public slots:
+
+        // close rides until within budget
+        void trim();
+
+    signals:
+
+        void trimmed(int evicted, qint64 bytes);
+
+    private:
+
+        bool evictable(RideItem *item) const;
+        static bool lessRecentlyUsed(const RideItem *a, const RideItem *b);
+
+        Context *context;
+        QMutex mutex;
+        QSet<RideItem*> open_;
+        qint64 budget_, bytes_;
+        quint64 loads_, evictions_;
+        bool pending;
+};
+
+//
+// Pin a ride whilst it is on screen, or whilst anything holds on to the
+// RideFile from ride() across the event loop or on another thread. The
+// LRU will not close a pinned ride. Pins are counted so they nest, and
+// released when the pin goes out of scope or is reset to another ride.
+// Safe to copy and reset on any thread.
+//
+class RidePin
+{
+    public:
+
+        RidePin(RideItem *item=NULL);
+        RidePin(const RidePin &other);
+        ~RidePin();
+
+        RidePin &operator=(const RidePin &other);
+        void reset(RideItem *item=NULL);
+        RideItem *item() const;
+
+    private:
+
+        QPointer<RideItem> item_;
+};
+
+#endif // _GC_RideFileLRU_h
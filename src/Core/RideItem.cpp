@@ -20,6 +20,8 @@
 #include "RideMetric.h"
 #include "RideFile.h"
 #include "RideFileCache.h"
+#include "RideFileLRU.h"
+#include "RideCache.h"
 #include "RideMetadata.h"
 #include "IntervalItem.h"
 #include "Route.h"
@@ -28,6 +30,7 @@
 #include "HrZones.h"
 #include "PaceZones.h"
 #include "Settings.h"
+#include "Trace.h"
 #include "Colors.h" // for ColorEngine
 #include "AddIntervalDialog.h" // till we fixup ridefilecache to have offsets
 #include "TimeUtils.h" // time_to_string()
@@ -44,7 +47,7 @@
 // merge wizard and interval navigator
 RideItem::RideItem() 
     : 
-    ride_(NULL), fileCache_(NULL), context(NULL), isdirty(false), isstale(true), isedit(false), skipsave(false), path(""), fileName(""),
+    ride_(NULL), fileCache_(NULL), pins_(0), lastUsed_(0), footprint_(0), revision_(0), context(NULL), isdirty(false), isstale(true), isedit(false), skipsave(false), path(""), fileName(""),
     color(QColor(1,1,1)), isRun(false), isSwim(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0) {
     metrics_.fill(0, RideMetricFactory::instance().metricCount());
     count_.fill(0, RideMetricFactory::instance().metricCount());
@@ -52,7 +55,7 @@ RideItem::RideItem()
 
 RideItem::RideItem(RideFile *ride, Context *context) 
     : 
-    ride_(ride), fileCache_(NULL), context(context), isdirty(false), isstale(true), isedit(false), skipsave(false), path(""), fileName(""),
+    ride_(ride), fileCache_(NULL), pins_(0), lastUsed_(0), footprint_(0), revision_(0), context(context), isdirty(false), isstale(true), isedit(false), skipsave(false), path(""), fileName(""),
     color(QColor(1,1,1)), isRun(false), isSwim(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0) 
 {
     metrics_.fill(0, RideMetricFactory::instance().metricCount());
@@ -61,7 +64,7 @@ RideItem::RideItem(RideFile *ride, Context *context)
 
 RideItem::RideItem(QString path, QString fileName, QDateTime &dateTime, Context *context, bool planned)
     :
-    ride_(NULL), fileCache_(NULL), context(context), isdirty(false), isstale(true), isedit(false), skipsave(false), path(path), fileName(fileName),
+    ride_(NULL), fileCache_(NULL), pins_(0), lastUsed_(0), footprint_(0), revision_(0), context(context), isdirty(false), isstale(true), isedit(false), skipsave(false), path(path), fileName(fileName),
     dateTime(dateTime), color(QColor(1,1,1)), planned(planned), isRun(false), isSwim(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0),
     metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0) 
 {
@@ -73,7 +76,7 @@ RideItem::RideItem(QString path, QString fileName, QDateTime &dateTime, Context
 // pre-computed metrics and storing ride metadata
 RideItem::RideItem(RideFile *ride, QDateTime &dateTime, Context *context)
     :
-    ride_(ride), fileCache_(NULL), context(context), isdirty(true), isstale(true), isedit(false), skipsave(false), dateTime(dateTime),
+    ride_(ride), fileCache_(NULL), pins_(0), lastUsed_(0), footprint_(0), revision_(0), context(context), isdirty(true), isstale(true), isedit(false), skipsave(false), dateTime(dateTime),
     zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0)
 {
     metrics_.fill(0, RideMetricFactory::instance().metricCount());
@@ -124,6 +127,9 @@ RideItem::setFrom(RideItem&here, bool temp) // used when loading cache/rideDB.js
 	weight = here.weight;
 	overrides_ = here.overrides_;
     samples = here.samples;
+
+    // anything showing our values needs to update
+    revision_.fetchAndAddOrdered(1);
 }
 
 // set the metric array
@@ -164,15 +170,32 @@ RideItem::metaCRC()
     return qChecksum(ba, ba.length());
 }
 
+// used to order rides for the LRU, ride() is called from
+// the refresh threads as well as the GUI thread
+static QAtomicInteger<quint64> rideClock(0);
+
+RideFileLRU *
+RideItem::lru()
+{
+    if (context && context->athlete && context->athlete->rideCache) return context->athlete->rideCache->lru();
+    return NULL;
+}
+
 RideFile *RideItem::ride(bool open)
 {
-    if (!open || ride_) return ride_;
+    if (!open) return ride_;
+
+    lastUsed_.storeRelease(rideClock.fetchAndAddRelaxed(1) + 1);
+    if (ride_) return ride_;
 
     // open the ride file
     QFile file(path + "/" + fileName);
     ride_ = RideFileFactory::instance().openRideFile(context, file, errors_);
     if (ride_ == NULL) return NULL; // failed to read ride
 
+    // account for it, may get closed later if memory is short
+    if (lru()) lru()->opened(this);
+
     // update the overrides
     overrides_.clear();
     QMap<QString,QMap<QString, QString> >::const_iterator k;
@@ -258,6 +281,14 @@ RideItem::setRide(RideFile *overwrite)
     RideFile *old = ride_;
     ride_ = overwrite; // overwrite
 
+    // the lru accounts for it as if we had opened it
+    if (lru()) {
+        if (ride_) {
+            lastUsed_.storeRelease(rideClock.fetchAndAddRelaxed(1) + 1);
+            lru()->opened(this, false);
+        } else lru()->closed(this);
+    }
+
     // connect up to new one - if its not null
     if (ride_) {
         connect(ride_, SIGNAL(modified()), this, SLOT(modified()));
@@ -350,7 +381,7 @@ RideItem::notifyRideDataChanged()
 
     // force a recompute of derived data series
     if (ride_) {
-        ride_->wstale = true;
+        ride_->wstale = ride_->sstale = true;
         ride_->recalculateDerivedSeries(true);
     }
 
@@ -432,6 +463,8 @@ RideItem::close()
 {
     // ride data
     if (ride_) {
+        if (lru()) lru()->closed(this);
+
         // break link to ride file
         foreach(IntervalItem *x, intervals()) x->rideInterval = NULL;
         delete ride_;
@@ -540,11 +573,16 @@ RideItem::checkStale()
 void
 RideItem::refresh()
 {
+    GC_TRACE_DETAIL("RideItem::refresh", fileName);
+
     if (!isstale) return;
 
     // update current state coz we'll fix it below
     isstale = false;
 
+    // not to be closed under us whilst we compute
+    RidePin pin(this);
+
     // open ride file will extract details too, but only if not
     // already open since its a user entry point and will call
     // refresh when opened. We don't want a recursion here.
@@ -656,6 +694,9 @@ RideItem::refresh()
         // Construct the summary text used on the calendar
         metadata_.insert("Calendar Text", context->athlete->rideMetadata()->calendarText(this));
 
+        // models caching our values can tell they are out of date
+        revision_.fetchAndAddOrdered(1);
+
         // close if we opened it
         if (doclose) {
             close();
@@ -663,7 +704,7 @@ RideItem::refresh()
 
             // if it is open then recompute
             userCache.clear();
-            ride_->wstale = true;
+            ride_->wstale = ride_->sstale = true;
             ride_->recalculateDerivedSeries(true);
         }
 
@@ -829,6 +870,8 @@ static bool intervalGreaterThanZone(const IntervalItem *a, const IntervalItem *b
 void
 RideItem::updateIntervals()
 {
+    GC_TRACE_DETAIL("RideItem::updateIntervals", fileName);
+
     // what do we need ?
     int discovery = appsettings->cvalue(context->athlete->cyclist, GC_DISCOVERY, 57).toInt(); // 57 does not include search for PEAKS
 
@@ -838,6 +881,9 @@ RideItem::updateIntervals()
     QList<IntervalItem*> deletelist = intervals_;
     intervals_.clear();
 
+    // intervals found, their metrics are computed together once we have them all
+    QList<IntervalItem*> fresh;
+
     // no ride data available ?
     if (!samples) {
         context->notifyIntervalsUpdate(this);
@@ -928,7 +974,7 @@ RideItem::updateIntervals()
                                                       standardColor(count++),
                                                       RideFileInterval::USER);
         intervalItem->rideInterval = interval;
-        intervalItem->refresh();        // XXX will get called in constructor when refactor
+        fresh << intervalItem;
         intervals_ << intervalItem;
 
         //qDebug()<<"interval:"<<interval.name<<interval.start<<interval.stop<<"f:"<<begin->secs<<end->secs;
@@ -963,7 +1009,7 @@ RideItem::updateIntervals()
                                                             QColor(Qt::gray),
                                                             RideFileInterval::PEAKPOWER);
                 intervalItem->rideInterval = NULL;
-                intervalItem->refresh();        // XXX will get called in constructore when refactor
+                fresh << intervalItem;
                 intervals_ << intervalItem;
             }
         }
@@ -999,7 +1045,7 @@ RideItem::updateIntervals()
                                                             QColor(Qt::gray),
                                                             RideFileInterval::PEAKPACE);
                 intervalItem->rideInterval = NULL;
-                intervalItem->refresh();        // XXX will get called in constructore when refactor
+                fresh << intervalItem;
                 intervals_ << intervalItem;
             }
         }
@@ -1286,7 +1332,7 @@ RideItem::updateIntervals()
             }
 
             intervalItem->rideInterval = NULL;
-            intervalItem->refresh();        // XXX will get called in constructore when refactor
+            fresh << intervalItem;
             intervals_ << intervalItem;
 
             //qDebug()<<fileName<<"IS EFFORT"<<x.quality<<"at"<<x.start<<"duration"<<x.duration;
@@ -1307,7 +1353,7 @@ RideItem::updateIntervals()
 
 
             intervalItem->rideInterval = NULL;
-            intervalItem->refresh();        // XXX will get called in constructore when refactor
+            fresh << intervalItem;
             intervals_ << intervalItem;
 
             //qDebug()<<fileName<<"IS EFFORT"<<x.quality<<"at"<<x.start<<"duration"<<x.duration;
@@ -1417,7 +1463,7 @@ RideItem::updateIntervals()
                                                                           QColor(Qt::green),
                                                                           RideFileInterval::CLIMB);
                             intervalItem->rideInterval = NULL;
-                            intervalItem->refresh();        // XXX will get called in constructore when refactor
+                            fresh << intervalItem;
                             intervals_ << intervalItem;
                         } else {
                             out << "        NOT HILL " << "at " << pstart->km << "km " << pstart->secs/60.0 <<"-"<< pstop->secs/60.0 << "min " << distance << "km " << height/distance/10.0 << "%\r\n";
@@ -1444,12 +1490,14 @@ RideItem::updateIntervals()
         // add to ride !
         foreach(IntervalItem *add, here) {
             add->rideInterval = NULL;
-            add->refresh();
+            fresh << add;
             intervals_ << add;
         }
     }
 
     // Search W' MATCHES incl. those that take us to EXHAUSTION
+    QList<IntervalItem*> matches;
+    QList<struct Match> matched;
     if ((discovery & RideFileInterval::intervalTypeBits(RideFileInterval::EFFORT)) &&
         f->isDataPresent(RideFile::watts) && f->wprimeData()) {
 
@@ -1467,26 +1515,37 @@ RideItem::updateIntervals()
                                                             match.exhaust ? QColor(255,69,0) : QColor(255,165,0),
                                                             RideFileInterval::EFFORT);
                 intervalItem->rideInterval = NULL;
-                intervalItem->refresh();        // XXX will get called in constructore when refactor
+                fresh << intervalItem;
+                intervals_ << intervalItem;
+
+                // named below once AP computed
+                matches << intervalItem;
+                matched << match;
+            }
+        }
+    }
 
-                // now all the metrics are computed update the name to
-                // reflect the AP which was calculated for it, and duration
+    // compute metrics for everything we found in one go
+    IntervalItem::refresh(fresh);
 
-                // which zone was this match ?
-                double ap = intervalItem->getForSymbol("average_power");
-                double duration = intervalItem->getForSymbol("workout_time");
-                int zone = zoneok ? 1 + context->athlete->zones(isRun)->whichZone(zoneRange, ap) : 1;
+    // now all the metrics are computed update the name to
+    // reflect the AP which was calculated for it, and duration
+    for (int i=0; i<matches.count(); i++) {
 
-                intervalItem->name = QString(tr("L%1 %5 %2 (%3w %4 kJ)"))
-                                                 .arg(zone)
-                                                 .arg(time_to_string(duration))
-                                                 .arg((int)ap)
-                                                 .arg(match.cost/1000)
-                                                 .arg(match.exhaust ? tr("TE MATCH") : tr("MATCH"));
+        IntervalItem *intervalItem = matches[i];
+        const struct Match &match = matched[i];
 
-                intervals_ << intervalItem;
-            }
-        }
+        // which zone was this match ?
+        double ap = intervalItem->getForSymbol("average_power");
+        double duration = intervalItem->getForSymbol("workout_time");
+        int zone = zoneok ? 1 + context->athlete->zones(isRun)->whichZone(zoneRange, ap) : 1;
+
+        intervalItem->name = QString(tr("L%1 %5 %2 (%3w %4 kJ)"))
+                                         .arg(zone)
+                                         .arg(time_to_string(duration))
+                                         .arg((int)ap)
+                                         .arg(match.cost/1000)
+                                         .arg(match.exhaust ? tr("TE MATCH") : tr("MATCH"));
     }
 
     // we now calculate sustained time in zone metrics
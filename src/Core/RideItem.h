@@ -28,6 +28,7 @@
 #include <QString>
 #include <QMap>
 #include <QVector>
+#include <QAtomicInt>
 
 class RideFile;
 class RideFileCache;
@@ -38,6 +39,9 @@ class IntervalSummaryWindow;
 class Context;
 class UserData;
 class ComparePane;
+class RideFileLRU;
+class RidePin;
+class Benchmark;
 
 Q_DECLARE_METATYPE(RideItem*)
 
@@ -56,11 +60,23 @@ class RideItem : public QObject
         friend class ::IntervalSummaryWindow;
         friend class ::UserData;
         friend class ::ComparePane;
+        friend class ::RideFileLRU;
+        friend class ::RidePin;
+        friend class ::Benchmark;
 
         // ridefile
         RideFile *ride_;
         RideFileCache *fileCache_;
 
+        // memory management, see RideFileLRU
+        QAtomicInt pins_;       // pinned whilst on screen or in use, see RidePin
+        QAtomicInteger<quint64> lastUsed_; // stamped when ride() is called
+        qint64 footprint_;      // estimated memory used when opened
+        RideFileLRU *lru();
+
+        // bumped when metrics or metadata are updated, see RideCacheModel
+        QAtomicInt revision_;
+
         // precomputed metrics & user overrides
         QVector<double> metrics_;
         QVector<double> count_;
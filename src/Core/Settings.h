@@ -110,6 +110,13 @@
 // batch export last options
 #define GC_BE_LASTDIR                   "<system>batchexport/lastdir"
 #define GC_BE_LASTFMT                   "<system>batchexport/lastfmt"
+#define GC_BE_THREADS                   "<system>batchexport/threads"
+
+// memory budget for open activities (MB)
+#define GC_RIDEFILE_MEMORY              "<system>ridecache/memory"
+
+// cloud sync transfers in flight
+#define GC_CLOUD_TRANSFERS              "<system>cloud/transfers"
 // Fonts
 #define GC_FONT_DEFAULT                 "<system>font/default"
 #define GC_FONT_CHARTLABELS             "<system>font/chartlabels"
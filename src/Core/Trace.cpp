@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Trace.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QHash>
+#include <QThread>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+
+// a huge library refresh generates a few events per ride
+// so this is plenty, after which we drop them
+static const int MAX_EVENTS = 1000000;
+
+struct TraceEvent {
+    const char *name;
+    QString detail;
+    int tid;
+    qint64 ts, dur;
+};
+
+QAtomicInt Trace::enabled(0);
+
+static QMutex mutex;
+static QElapsedTimer timer;
+static QString filename;
+static QVector<TraceEvent> events;
+static QHash<Qt::HANDLE, int> threads;
+static QThread *gui = NULL;
+static int dropped = 0;
+
+// Escape special characters (JSON compliance)
+static QString
+protect(const QString &string)
+{
+    QString s = string;
+    s.replace("\\", "\\\\");
+    s.replace("\"", "\\\"");
+    s.replace("\t", "\\t");
+    s.replace("\n", "\\n");
+    s.replace("\r", "\\r");
+    return s;
+}
+
+// with the mutex held
+static QByteArray
+toJson()
+{
+    QString out;
+    out.reserve(events.count() * 96);
+    out += "{\n\"displayTimeUnit\":\"ms\",\n\"traceEvents\":[\n";
+
+    // name the threads, 0 is the gui
+    QString pid = QString::number(QCoreApplication::applicationPid());
+    bool first = true;
+    foreach(int tid, threads) {
+        out += QString("%1{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%2,\"tid\":%3,\"args\":{\"name\":\"%4\"}}")
+               .arg(first ? "" : ",\n").arg(pid).arg(tid)
+               .arg(tid ? QString("Worker %1").arg(tid) : QString("GUI"));
+        first = false;
+    }
+
+    foreach(const TraceEvent &event, events) {
+        out += QString("%1{\"name\":\"%2\",\"ph\":\"X\",\"pid\":%3,\"tid\":%4,\"ts\":%5,\"dur\":%6")
+               .arg(first ? "" : ",\n").arg(event.name).arg(pid).arg(event.tid).arg(event.ts).arg(event.dur);
+        if (event.detail != "") out += QString(",\"args\":{\"detail\":\"%1\"}").arg(protect(event.detail));
+        out += "}";
+        first = false;
+    }
+    out += QString("\n],\n\"otherData\":{\"dropped\":%1}\n}\n").arg(dropped);
+
+    return out.toUtf8();
+}
+
+void
+Trace::start(QString file)
+{
+    QMutexLocker locker(&mutex);
+
+    if (isEnabled()) return;
+
+    events.clear();
+    threads.clear();
+    dropped = 0;
+    filename = file;
+    gui = QCoreApplication::instance() ? QCoreApplication::instance()->thread() : NULL;
+    timer.start();
+
+    enabled.storeRelease(1);
+}
+
+void
+Trace::stop()
+{
+    QMutexLocker locker(&mutex);
+
+    if (!isEnabled()) return;
+    enabled.storeRelease(0);
+
+    // spans still open will add themselves as
+    // they close, but nobody will see them
+    if (filename != "") {
+        QFile out(filename);
+        if (out.open(QFile::WriteOnly)) {
+            out.write(toJson());
+            out.close();
+        }
+    }
+}
+
+qint64
+Trace::now()
+{
+    return timer.nsecsElapsed() / 1000;
+}
+
+void
+Trace::complete(const char *name, const QString &detail, qint64 start)
+{
+    qint64 end = now();
+    Qt::HANDLE handle = QThread::currentThreadId();
+
+    QMutexLocker locker(&mutex);
+
+    if (events.count() >= MAX_EVENTS) {
+        dropped++;
+        return;
+    }
+
+    // small thread ids are easier to read
+    int tid = threads.value(handle, -1);
+    if (tid < 0) {
+        tid = QThread::currentThread() == gui ? 0 : threads.count() + 1;
+        threads.insert(handle, tid);
+    }
+
+    TraceEvent add;
+    add.name = name;
+    add.detail = detail;
+    add.tid = tid;
+    add.ts = start;
+    add.dur = end - start;
+    events << add;
+}
+
+QByteArray
+Trace::json()
+{
+    QMutexLocker locker(&mutex);
+    return toJson();
+}
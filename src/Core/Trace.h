@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Trace_h
+#define _GC_Trace_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QAtomicInt>
+
+//
+// Lightweight tracing of where the time goes
+//
+// Drop a GC_TRACE("Class::method") at the top of a function and whilst
+// tracing is enabled its duration is recorded along with the thread it ran
+// on. When tracing is disabled a span is a single test of a flag so it can be
+// left in hot code like RideItem::refresh.
+//
+// Events are kept in memory and written as Chrome trace-event JSON, so the
+// file can be loaded into chrome://tracing or ui.perfetto.dev to see what the
+// refresh threads and charts were doing. Tracing is started with --trace=file
+// on the command line or via /_trace/start on the API web-service.
+//
+class Trace
+{
+    public:
+
+        // start collecting, if filename is set the events are
+        // written there when tracing is stopped
+        static void start(QString filename = QString());
+        static void stop();
+        static bool isEnabled() { return enabled.loadAcquire() != 0; }
+
+        // events so far, as trace-event json
+        static QByteArray json();
+
+        // used by TraceSpan, microseconds since tracing started
+        static qint64 now();
+        static void complete(const char *name, const QString &detail, qint64 start);
+
+    private:
+        static QAtomicInt enabled;
+};
+
+class TraceSpan
+{
+    public:
+
+        TraceSpan(const char *name) : name(name), start(Trace::isEnabled() ? Trace::now() : -1) {}
+        TraceSpan(const char *name, const QString &detail) : name(name), start(-1) {
+            if (Trace::isEnabled()) {
+                this->detail = detail;
+                start = Trace::now();
+            }
+        }
+        ~TraceSpan() { if (start >= 0) Trace::complete(name, detail, start); }
+
+    private:
+        const char *name;
+        QString detail;
+        qint64 start;
+};
+
+#define GC_TRACE(name) TraceSpan gcTraceSpan(name)
+#define GC_TRACE_DETAIL(name, detail) TraceSpan gcTraceSpan(name, detail)
+
+#endif // _GC_Trace_h
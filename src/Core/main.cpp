@@ -25,6 +25,8 @@
 #include "Colors.h"
 #include "GcUpgrade.h"
 #include "IdleTimer.h"
+#include "Benchmark.h"
+#include "Trace.h"
 
 #include <QApplication>
 #include <QDesktopWidget>
@@ -88,6 +90,9 @@ void terminate(int code)
     if (listener) listener->close();
 #endif
 
+    // write out the trace if one was asked for
+    Trace::stop();
+
     // tidy up static stuff (our globals) that are not tied
     // to a mainwindow instance (which will be deleted on close)
     delete appsettings;
@@ -101,6 +106,50 @@ void terminate(int code)
     else _Exit(code);
 }
 
+//
+// Headless benchmark, returns the exit code
+//
+static int
+runBenchmark(QString corpus, int scale, QString output, QString baseline, double tolerance)
+{
+    // works on a temporary athlete so the athlete library is never touched
+    // and it is removed when the benchmark goes out of scope
+    Benchmark benchmark(QFileInfo(corpus).absoluteFilePath(), scale);
+
+    if (!benchmark.run()) {
+        fprintf(stderr, "Benchmark failed: %s\n", benchmark.errorString().toLocal8Bit().constData());
+        return 1;
+    }
+
+    // results
+    if (output != "") {
+        QFile out(output);
+        if (!out.open(QFile::WriteOnly)) {
+            fprintf(stderr, "Unable to write %s\n", output.toLocal8Bit().constData());
+            return 1;
+        }
+        out.write(benchmark.toJson());
+        out.close();
+    } else {
+        fprintf(stdout, "%s", benchmark.toJson().constData());
+        fflush(stdout);
+    }
+
+    // and did we get slower ?
+    if (baseline != "") {
+        int regressions = benchmark.compare(baseline, tolerance);
+        if (regressions < 0) {
+            fprintf(stderr, "Unable to read baseline %s\n", baseline.toLocal8Bit().constData());
+            return 1;
+        }
+        if (regressions > 0) {
+            fprintf(stderr, "%d stage(s) slower than baseline\n", regressions);
+            return 2;
+        }
+    }
+    return 0;
+}
+
 //
 // redirect logging
 //
@@ -191,6 +240,15 @@ main(int argc, char *argv[])
     nogui = false;
     bool help = false;
 
+    // benchmark options
+    bool bench = false;
+    int benchScale = 2000;
+    double benchTolerance = 10;
+    QString benchCorpus = "test", benchBaseline, benchOutput;
+
+    // chrome trace-event file
+    QString traceFile;
+
     // honour command line switches
     foreach (QString arg, sargs) {
 
@@ -201,8 +259,15 @@ main(int argc, char *argv[])
             fprintf(stderr, "GoldenCheetah %s (%d)\nusage: GoldenCheetah [[directory] athlete]\n\n", VERSION_STRING, VERSION_LATEST);
             fprintf(stderr, "--help or --version to print this message and exit\n");
 #ifdef GC_WANT_HTTP
-            fprintf(stderr, "--server            to run as an API server\n");
-#endif
+            fprintf(stderr, "--server            to run as an API server, /_trace/start and /_trace/stop record timings\n");
+#endif
+            fprintf(stderr, "--trace=file        to record timings of refresh, caches and charts to file\n");
+            fprintf(stderr, "--bench             to run the headless benchmark and exit, options are:\n");
+            fprintf(stderr, "  --bench-corpus=folder      test corpus to use [test]\n");
+            fprintf(stderr, "  --bench-scale=n            rides in the synthetic athlete [2000]\n");
+            fprintf(stderr, "  --bench-output=file        write JSON results to file instead of stdout\n");
+            fprintf(stderr, "  --bench-baseline=file      compare with a previous run's JSON results\n");
+            fprintf(stderr, "  --bench-tolerance=percent  slowdown allowed before reporting a regression [10]\n");
 #ifdef GC_DEBUG
             fprintf(stderr, "--debug             to turn on redirection of messages to goldencheetah.log [debug build]\n");
 #else
@@ -230,6 +295,34 @@ main(int argc, char *argv[])
 
             noR = true;
 #endif
+        } else if (arg.startsWith("--trace=")) {
+
+            traceFile = QFileInfo(arg.mid(arg.indexOf('=')+1)).absoluteFilePath();
+
+        } else if (arg == "--bench") {
+
+            nogui = bench = true;
+
+        } else if (arg.startsWith("--bench-corpus=")) {
+
+            benchCorpus = arg.mid(arg.indexOf('=')+1);
+
+        } else if (arg.startsWith("--bench-scale=")) {
+
+            benchScale = arg.mid(arg.indexOf('=')+1).toInt();
+
+        } else if (arg.startsWith("--bench-output=")) {
+
+            benchOutput = arg.mid(arg.indexOf('=')+1);
+
+        } else if (arg.startsWith("--bench-baseline=")) {
+
+            benchBaseline = arg.mid(arg.indexOf('=')+1);
+
+        } else if (arg.startsWith("--bench-tolerance=")) {
+
+            benchTolerance = arg.mid(arg.indexOf('=')+1).toDouble();
+
         } else if (arg == "--debug") {
 
 #ifdef GC_DEBUG
@@ -304,6 +397,9 @@ main(int argc, char *argv[])
 
     // create the application -- only ever ONE regardless of restarts
     application = new QApplication(argc, argv);
+
+    // start tracing as early as we can
+    if (traceFile != "") Trace::start(traceFile);
     //XXXIdleEventFilter idleFilter;
     //XXXapplication->installEventFilter(&idleFilter);
 
@@ -479,7 +575,7 @@ main(int argc, char *argv[])
 
         // now redirect stderr
 #ifndef WIN32
-        if (!debug) nostderr(home.canonicalPath());
+        if (!debug && !bench) nostderr(home.canonicalPath());
 #else
         Q_UNUSED(debug)
 #endif
@@ -511,6 +607,14 @@ main(int argc, char *argv[])
         // initialise the trainDB
         trainDB = new TrainDB(home);
 
+        // run the benchmark and exit
+        if (bench) {
+
+            ret = runBenchmark(benchCorpus, benchScale, benchOutput, benchBaseline, benchTolerance);
+            delete trainDB;
+            terminate(ret);
+        }
+
         // lets do what the command line says ...
         QVariant lastOpened;
         if(args.count() == 2) { // $ ./GoldenCheetah Mark -or- ./GoldenCheetah --server ~/athletedir
@@ -593,12 +697,16 @@ main(int argc, char *argv[])
             // use the default handler (just get an error page)
             QSettings* settings=new QSettings(httpini,QSettings::IniFormat,application);
 
+            // a dedicated server should be event driven, the gui keeps
+            // a thread per connection, unless the ini file sets a mode
+            QString mode = (server && !settings->contains("mode")) ? "events" : "";
+
             if (listener) {
                 // when changing the Athlete Directory, there is already a listener running
                 // close first to avoid errors
                 listener->close();
             }
-            listener=new HttpListener(settings,new APIWebService(home, application),application);
+            listener=new HttpListener(settings,new APIWebService(home, application),application,mode);
 
             // if not going on to launch a gui...
             if (nogui) {
@@ -693,6 +801,7 @@ main(int argc, char *argv[])
 
     } while (restarting);
 
+    Trace::stop();
     delete application;
 
     return ret;
@@ -29,8 +29,11 @@
 #include <QRegExp>
 #include <QTextStream>
 #include <QVector>
+#include <QByteArray>
 #include <algorithm> // for std::sort
 #include "cmath"
+#include <climits>
+#include <cstring>
 
 static int csvFileReaderRegistered =
     RideFileFactory::instance().registerReader(
@@ -88,6 +91,168 @@ static int moxySeconds(QString time)
     return seconds;
 }
 
+// powers of ten that are exact as doubles
+static const double exactPowers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                      1e20, 1e21, 1e22 };
+
+// same as QString::toDouble(), 0 if it isn't a number, but without making
+// a QString. When there are no more than 15 significant digits and a small
+// exponent the mantissa and power of ten are both exact, so a single multiply
+// or divide is correctly rounded, anything else goes the long way round
+static double csvDouble(const char *s, int len)
+{
+    int i=0;
+    while (i<len && (s[i] == ' ' || s[i] == '\t')) i++;
+    while (len>i && (s[len-1] == ' ' || s[len-1] == '\t')) len--;
+    if (i == len) return 0;
+
+    bool negative = false;
+    if (s[i] == '-' || s[i] == '+') negative = (s[i++] == '-');
+
+    quint64 mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool seen = false, point = false;
+    for (; i<len; i++) {
+        char c = s[i];
+        if (c >= '0' && c <= '9') {
+            seen = true;
+            if (mantissa == 0 && c == '0') {
+                if (point) exponent--;
+                continue; // leading zeroes aren't significant
+            }
+            if (++digits > 15) return QString::fromLatin1(s, len).toDouble();
+            mantissa = mantissa * 10 + (c - '0');
+            if (point) exponent--;
+        } else if (c == '.' && !point) {
+            point = true;
+        } else break;
+    }
+    if (!seen) return QString::fromLatin1(s, len).toDouble(); // nan, inf or junk
+
+    if (i<len) {
+        if (s[i] != 'e' && s[i] != 'E') return QString::fromLatin1(s, len).toDouble();
+        i++;
+        bool eneg = false;
+        if (i<len && (s[i] == '-' || s[i] == '+')) eneg = (s[i++] == '-');
+        if (i == len) return 0;
+        int e = 0;
+        for (; i<len; i++) {
+            if (s[i] < '0' || s[i] > '9') return QString::fromLatin1(s, len).toDouble();
+            if (e < 10000) e = e * 10 + (s[i] - '0');
+        }
+        exponent += eneg ? -e : e;
+    }
+
+    double value = mantissa;
+    if (mantissa != 0) {
+        if (exponent < -22 || exponent > 22) return QString::fromLatin1(s, len).toDouble();
+        value = exponent < 0 ? value / exactPowers[-exponent] : value * exactPowers[exponent];
+    }
+    return negative ? -value : value;
+}
+
+// same as QString::toInt(), 0 if it isn't an integer or doesn't fit
+static int csvInt(const char *s, int len)
+{
+    int i=0;
+    while (i<len && (s[i] == ' ' || s[i] == '\t')) i++;
+    while (len>i && (s[len-1] == ' ' || s[len-1] == '\t')) len--;
+    if (i == len) return 0;
+
+    bool negative = false;
+    if (s[i] == '-' || s[i] == '+') negative = (s[i++] == '-');
+    if (i == len) return 0;
+
+    qint64 value = 0;
+    for (; i<len; i++) {
+        if (s[i] < '0' || s[i] > '9') return 0;
+        value = value * 10 + (s[i] - '0');
+        if (value > qint64(INT_MAX) + 1) return 0;
+    }
+    if (negative) value = -value;
+    if (value > INT_MAX || value < INT_MIN) return 0;
+    return int(value);
+}
+
+//
+// One line of a CSV file split into fields
+//
+// QString::section() scans the line from the start every time it is called
+// and makes a new string for the field, so with 20 or more columns most of
+// the time importing a big file was spent finding and copying fields. We split
+// each line once into offsets, reusing the same storage for every line, and
+// parse numbers straight from the bytes. Field n is the same as section(sep,n,n)
+// so asking for a field beyond the end returns empty or 0.
+//
+class CsvFields
+{
+    public:
+
+        CsvFields(bool utf8) : utf8(utf8), line(NULL), count_(0) {}
+
+        void split(const char *text, int length, char separator) {
+            line = text;
+            count_ = 0;
+            int from = 0;
+            for (int i=0; i<=length; i++) {
+                if (i == length || text[i] == separator) {
+                    if (bounds.count() < (count_+1)*2) bounds.resize((count_+1)*2 + 32);
+                    bounds[count_*2] = from;
+                    bounds[count_*2+1] = i;
+                    count_++;
+                    from = i+1;
+                }
+            }
+        }
+
+        int count() const { return count_; }
+
+        bool isEmpty(int n) const { return n < 0 || n >= count_ || start(n) == end(n); }
+
+        QString text(int n) const {
+            if (isEmpty(n)) return QString();
+            return utf8 ? QString::fromUtf8(line + start(n), end(n) - start(n))
+                        : QString::fromLocal8Bit(line + start(n), end(n) - start(n));
+        }
+
+        double number(int n, bool decimalComma=false) const {
+            if (isEmpty(n)) return 0;
+            if (decimalComma && memchr(line + start(n), ',', end(n) - start(n))) {
+                QByteArray field(line + start(n), end(n) - start(n));
+                field.replace(',', '.');
+                return csvDouble(field.constData(), field.length());
+            }
+            return csvDouble(line + start(n), end(n) - start(n));
+        }
+
+        // as above, but ignoring any quotes
+        double unquoted(int n) const {
+            if (isEmpty(n)) return 0;
+            if (memchr(line + start(n), '"', end(n) - start(n))) {
+                QByteArray field(line + start(n), end(n) - start(n));
+                field.replace("\"", "");
+                return csvDouble(field.constData(), field.length());
+            }
+            return csvDouble(line + start(n), end(n) - start(n));
+        }
+
+        int integer(int n) const {
+            if (isEmpty(n)) return 0;
+            return csvInt(line + start(n), end(n) - start(n));
+        }
+
+    private:
+
+        int start(int n) const { return bounds[n*2]; }
+        int end(int n) const { return bounds[n*2+1]; }
+
+        bool utf8;
+        const char *line;
+        int count_;
+        QVector<int> bounds; // start and end of each field
+};
+
 RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
 {
     CsvType csvType = generic;
@@ -119,7 +284,7 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
     QRegExp motoActvCSV("activity_id", Qt::CaseInsensitive);
     bool epoch_set = false;
     quint64 epoch_offset=0;
-    QChar ergomo_separator;
+    char ergomo_separator = ',';
     int unitsHeader = 1;
     int total_pause = 0;
     int currentInterval = 0;
@@ -170,7 +335,6 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
         return NULL;
     }
     int lineno = 1;
-    QTextStream is(&file);
     RideFile *rideFile = new RideFile();
     int iBikeInterval = 0;
     bool dfpmExists   = false;
@@ -197,873 +361,898 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
     double accruedseconds=0;
     double accruedkm=0;
 
+    // we read the whole file and split it into lines and fields ourselves
+    // rather than via QTextStream and QString::section, numbers are parsed
+    // straight from the bytes and only header lines and the formats that
+    // need to look at the text are decoded into a QString
+    QByteArray data = file.readAll();
+    bool utf8 = false;
+    int pos = 0;
+    if (data.startsWith("\xEF\xBB\xBF")) {
+
+        // UTF-8 with a BOM
+        utf8 = true;
+        pos = 3;
+
+    } else if (data.startsWith("\xFF\xFE") || data.startsWith("\xFE\xFF")) {
+
+        // UTF-16, the text stream will detect the byte order
+        QTextStream is(&data);
+        data = is.readAll().toUtf8();
+        utf8 = true;
+    }
+    const char *bytes = data.constData();
+    int size = data.size();
+
+    CsvFields fields(utf8), ergomoFields(utf8);
+    QString line;
+
     bool eof = false;
-    while (!is.atEnd() && !eof) {
-        // the readLine() method doesn't handle old Macintosh CR line endings
-        // this workaround will load the the entire file if it has CR endings
-        // then split and loop through each line
-        // otherwise, there will be nothing to split and it will read each line as expected.
-        QString linesIn = is.readLine();
-        QStringList lines = linesIn.split('\r');
-        // workaround for empty lines
-        if(lines.isEmpty()) {
-            lineno++;
-            continue;
-        }
-        for (int li = 0; li < lines.size(); ++li) {
-            QString line = lines[li];
+    while (pos < size && !eof) {
 
-            if (line.length()==0) {
-                continue;
-            }
+        // next line, we handle \n, \r\n and old Macintosh \r endings
+        int start = pos;
+        while (pos < size && bytes[pos] != '\n' && bytes[pos] != '\r') pos++;
+        int length = pos - start;
+        if (pos < size) pos += (bytes[pos] == '\r' && pos+1 < size && bytes[pos+1] == '\n') ? 2 : 1;
 
-            if (lineno == 1) {
-                if (ergomoCSV.indexIn(line) != -1) {
-                    csvType = ergomo;
-                    rideFile->setDeviceType("Ergomo");
-                    rideFile->setFileFormat("Ergomo CSV (csv)");
-                    unitsHeader = 2;
+        // empty lines are ignored
+        if (length == 0) continue;
 
-                    QStringList headers = line.split(';');
+        fields.split(bytes + start, length, ',');
+        if (csvType == ergomo && ergomo_separator != ',') ergomoFields.split(bytes + start, length, ergomo_separator);
 
-                    if (headers.size()>1)
-                        ergomo_separator = ';';
-                    else
-                        ergomo_separator = ',';
+        // only decode the text when we need it, the first few lines
+        // always since formats look for their start time in them
+        if (lineno <= qMax(unitsHeader, 10) || csvType == moxy || csvType == freemotion ||
+            csvType == peripedal || csvType == rowpro || csvType == rp3)
+            line = utf8 ? QString::fromUtf8(bytes + start, length) : QString::fromLocal8Bit(bytes + start, length);
+        else
+            line = QString();
 
-                    ++lineno;
-                    continue;
-                }
-                else if(iBikeCSV.indexIn(line) != -1) {
-                    csvType = ibike;
-                    rideFile->setDeviceType("iBike");
-                    rideFile->setFileFormat("iBike CSV (csv)");
+        if (lineno == 1) {
+            if (ergomoCSV.indexIn(line) != -1) {
+                csvType = ergomo;
+                rideFile->setDeviceType("Ergomo");
+                rideFile->setFileFormat("Ergomo CSV (csv)");
+                unitsHeader = 2;
+
+                QStringList headers = line.split(';');
+
+                if (headers.size()>1)
+                    ergomo_separator = ';';
+                else
+                    ergomo_separator = ',';
+
+                ++lineno;
+                continue;
+            }
+            else if(iBikeCSV.indexIn(line) != -1) {
+                csvType = ibike;
+                rideFile->setDeviceType("iBike");
+                rideFile->setFileFormat("iBike CSV (csv)");
+                unitsHeader = 5;
+                iBikeVersion = line.section( ',', 1, 1 ).toInt();
+                ++lineno;
+                continue;
+            }
+            else if(motoActvCSV.indexIn(line) != -1) {
+                csvType = motoactv;
+                rideFile->setDeviceType("MotoACTV");
+                rideFile->setFileFormat("MotoACTV CSV (csv)");
+                unitsHeader = -1;
+                /* MotoACTV files are always metric */
+                metric = true;
+                ++lineno;
+                continue;
+             }
+             else if(jouleCSV.indexIn(line) != -1) {
+                csvType = joule;
+                rideFile->setDeviceType("Joule");
+                rideFile->setFileFormat("Joule CSV (csv)");
+                if(jouleMetriCSV.indexIn(line) != -1) {
                     unitsHeader = 5;
-                    iBikeVersion = line.section( ',', 1, 1 ).toInt();
-                    ++lineno;
-                    continue;
-                }
-                else if(motoActvCSV.indexIn(line) != -1) {
-                    csvType = motoactv;
-                    rideFile->setDeviceType("MotoACTV");
-                    rideFile->setFileFormat("MotoACTV CSV (csv)");
-                    unitsHeader = -1;
-                    /* MotoACTV files are always metric */
                     metric = true;
-                    ++lineno;
-                    continue;
-                 }
-                 else if(jouleCSV.indexIn(line) != -1) {
-                    csvType = joule;
-                    rideFile->setDeviceType("Joule");
-                    rideFile->setFileFormat("Joule CSV (csv)");
-                    if(jouleMetriCSV.indexIn(line) != -1) {
-                        unitsHeader = 5;
-                        metric = true;
-                    }
-                    else { /* ? */ }
-                    ++lineno;
-                    continue;
-                 }
-                 else if(moxyCSV.indexIn(line) != -1) {
-                    csvType = moxy;
-                    rideFile->setDeviceType("Moxy");
-                    rideFile->setFileFormat("Moxy CSV (csv)");
-                    unitsHeader = 4;
-                    recInterval = 1;
-                    ++lineno;
-                    continue;
                 }
-                else if(smo2CSV.indexIn(line) != -1) {
-                   csvType = bsx;
-                   rideFile->setDeviceType("BSX Insight");
-                   rideFile->setFileFormat("BSX Insight CSV (csv)");
-                   unitsHeader = 6;
-                   recInterval = 1;
-                   ++lineno;
-                   continue;
-               }
-                else if(gcCSV.indexIn(line) != -1 || gcCSVold.indexIn(line) != -1) {
-                    csvType = gc;
-                    rideFile->setDeviceType("GoldenCheetah");
-                    rideFile->setFileFormat("GoldenCheetah CSV (csv)");
-                    unitsHeader = 1;
-                    recInterval = 1;
-
-                    ++lineno;
-                    continue;
-               }
-                else if(periCSV.indexIn(line) != -1) {
-                    csvType = peripedal;
-                    rideFile->setDeviceType("Peripedal");
-                    rideFile->setFileFormat("Peripedal CSV (csv)");
-                    unitsHeader = 1;
-                    recInterval = 1;
-                    ++lineno;
-                    continue;
-               }
-               else if(powertapCSV.indexIn(line) != -1) {
-                    csvType = powertap;
-                    rideFile->setDeviceType("PowerTap");
-                    rideFile->setFileFormat("PowerTap CSV (csv)");
-                    unitsHeader = 1;
-                    ++lineno;
-                    continue;
-               }
-               else if(freemotionCSV.indexIn(line) != -1) {
-                    csvType = freemotion;
-                    rideFile->setDeviceType("Freemotion Bike");
-                    rideFile->setFileFormat("Stages Data (csv)");
-                    unitsHeader = 3;
-                    ++lineno;
-                    continue;
-               }
-               else if(cpexportCSV.indexIn(line) != -1) {
-                    csvType = cpexport;
-                    rideFile->setDeviceType("CP Plot Export");
-                    rideFile->setFileFormat("CP Plot Export (csv)");
-                    unitsHeader = 1;
-                    ++lineno;
-                    continue;
-               }
-               else if(rowproCSV.indexIn(line) != -1) {
-                     csvType = rowpro;
-                     rideFile->setDeviceType("RowPro");
-                     rideFile->setFileFormat("RowPro CSV (csv)");
-                     unitsHeader = 10;
-                     ++lineno;
-                     continue;
-               }
-               else if(wahooMACSV.indexIn(line) != -1) {
-                   csvType = wahooMA;
-                   rideFile->setDeviceType("Wahoo Fitness");
-                   rideFile->setFileFormat("Wahoo Motion Analysis CSV (csv)");
-                   unitsHeader = 1;
-                   recInterval = 1;
-                   //++lineno;
-                   //continue;
-               } else if (rp3CSV.indexIn(line) != -1) {
-
-                   csvType = rp3;
-                   rideFile->setDeviceType("Row Perfect 3");
-                   rideFile->setFileFormat("Row Perfect CSV (csv)");
-                   unitsHeader = 1;
-                   recInterval = 1; // oh.. its variable (!)
-
-                   // add XDATA
-                   rowSeries = new XDataSeries();
-                   rowSeries->name = "ROW";
-                   rowSeries->valuename << "ID"
-                                        << "INTERVAL"
-                                        << "REF"
-                                        << "STROKE"
-                                        << "POWER"
-                                        << "AVGPOWER"
-                                        << "STROKERATE"
-                                        << "TIME"
-                                        << "STROKELENGTH"
-                                        << "DISTANCE"
-                                        << "STROKEDISTANCE"
-                                        << "ESTIMATE500MTIME"
-                                        << "STROKEENERGY"
-                                        << "ENERGYSUM"
-                                        << "PULSE"
-                                        << "WORKPERPULSE"
-                                        << "PEAKFORCE"
-                                        << "PEAKFORCEPOS"
-                                        << "PEAKFORCERELPOS"
-                                        << "DRIVETIME"
-                                        << "RECOVERTIME"
-                                        << "K"
-                                        << "CURVEDATA"
-                                        << "STROKENUMINTERVAL"
-                                        << "AVGPOWER";
-
-                    // and the associated units
-                    rowSeries->unitname << "" << "" << "" << "" << "watts"
-                                        << "watts" << "spm" << "" << "meters" << "meters"
-                                        << "meters" << "" << "joules" << "joules" << "bpm"
-                                        << "joules" << "newtons" << "" << "" << "secs"
-                                        << "secs" << "" << "" << "" << "watts";
-
-                    rideFile->addXData("ROW", rowSeries);
-
-
-               } else {  // default
-                    csvType = generic;
-                    rideFile->setDeviceType("Unknow");
-                    rideFile->setFileFormat("Generic CSV (csv)");
-               }
+                else { /* ? */ }
+                ++lineno;
+                continue;
+             }
+             else if(moxyCSV.indexIn(line) != -1) {
+                csvType = moxy;
+                rideFile->setDeviceType("Moxy");
+                rideFile->setFileFormat("Moxy CSV (csv)");
+                unitsHeader = 4;
+                recInterval = 1;
+                ++lineno;
+                continue;
             }
-            if (csvType == ibike) {
-                if (lineno == 2) {
-                    QStringList f = line.split(",");
-                    if (f.size() == 6) {
-                        startTime = QDateTime(
-                            QDate(f[0].toInt(), f[1].toInt(), f[2].toInt()),
-                            QTime(f[3].toInt(), f[4].toInt(), f[5].toInt()));
-                    }
-                }
-                else if (lineno == 4) {
-                    // this is the line with the iBike configuration data
-                    // recording interval is in the [4] location (zero-based array)
-                    // the trailing zeroes in the configuration area seem to be causing an error
-                    // the number is in the format 5.000000
-                    recInterval = (int)line.section(',',4,4).toDouble();
-                    rideFile->setDeviceType(line.section(',',26,26));
-                    rideFile->setTag("Device Info", line.section(',',20,21).remove(QChar('"')));
+            else if(smo2CSV.indexIn(line) != -1) {
+               csvType = bsx;
+               rideFile->setDeviceType("BSX Insight");
+               rideFile->setFileFormat("BSX Insight CSV (csv)");
+               unitsHeader = 6;
+               recInterval = 1;
+               ++lineno;
+               continue;
+           }
+            else if(gcCSV.indexIn(line) != -1 || gcCSVold.indexIn(line) != -1) {
+                csvType = gc;
+                rideFile->setDeviceType("GoldenCheetah");
+                rideFile->setFileFormat("GoldenCheetah CSV (csv)");
+                unitsHeader = 1;
+                recInterval = 1;
+
+                ++lineno;
+                continue;
+           }
+            else if(periCSV.indexIn(line) != -1) {
+                csvType = peripedal;
+                rideFile->setDeviceType("Peripedal");
+                rideFile->setFileFormat("Peripedal CSV (csv)");
+                unitsHeader = 1;
+                recInterval = 1;
+                ++lineno;
+                continue;
+           }
+           else if(powertapCSV.indexIn(line) != -1) {
+                csvType = powertap;
+                rideFile->setDeviceType("PowerTap");
+                rideFile->setFileFormat("PowerTap CSV (csv)");
+                unitsHeader = 1;
+                ++lineno;
+                continue;
+           }
+           else if(freemotionCSV.indexIn(line) != -1) {
+                csvType = freemotion;
+                rideFile->setDeviceType("Freemotion Bike");
+                rideFile->setFileFormat("Stages Data (csv)");
+                unitsHeader = 3;
+                ++lineno;
+                continue;
+           }
+           else if(cpexportCSV.indexIn(line) != -1) {
+                csvType = cpexport;
+                rideFile->setDeviceType("CP Plot Export");
+                rideFile->setFileFormat("CP Plot Export (csv)");
+                unitsHeader = 1;
+                ++lineno;
+                continue;
+           }
+           else if(rowproCSV.indexIn(line) != -1) {
+                 csvType = rowpro;
+                 rideFile->setDeviceType("RowPro");
+                 rideFile->setFileFormat("RowPro CSV (csv)");
+                 unitsHeader = 10;
+                 ++lineno;
+                 continue;
+           }
+           else if(wahooMACSV.indexIn(line) != -1) {
+               csvType = wahooMA;
+               rideFile->setDeviceType("Wahoo Fitness");
+               rideFile->setFileFormat("Wahoo Motion Analysis CSV (csv)");
+               unitsHeader = 1;
+               recInterval = 1;
+               //++lineno;
+               //continue;
+           } else if (rp3CSV.indexIn(line) != -1) {
+
+               csvType = rp3;
+               rideFile->setDeviceType("Row Perfect 3");
+               rideFile->setFileFormat("Row Perfect CSV (csv)");
+               unitsHeader = 1;
+               recInterval = 1; // oh.. its variable (!)
+
+               // add XDATA
+               rowSeries = new XDataSeries();
+               rowSeries->name = "ROW";
+               rowSeries->valuename << "ID"
+                                    << "INTERVAL"
+                                    << "REF"
+                                    << "STROKE"
+                                    << "POWER"
+                                    << "AVGPOWER"
+                                    << "STROKERATE"
+                                    << "TIME"
+                                    << "STROKELENGTH"
+                                    << "DISTANCE"
+                                    << "STROKEDISTANCE"
+                                    << "ESTIMATE500MTIME"
+                                    << "STROKEENERGY"
+                                    << "ENERGYSUM"
+                                    << "PULSE"
+                                    << "WORKPERPULSE"
+                                    << "PEAKFORCE"
+                                    << "PEAKFORCEPOS"
+                                    << "PEAKFORCERELPOS"
+                                    << "DRIVETIME"
+                                    << "RECOVERTIME"
+                                    << "K"
+                                    << "CURVEDATA"
+                                    << "STROKENUMINTERVAL"
+                                    << "AVGPOWER";
+
+                // and the associated units
+                rowSeries->unitname << "" << "" << "" << "" << "watts"
+                                    << "watts" << "spm" << "" << "meters" << "meters"
+                                    << "meters" << "" << "joules" << "joules" << "bpm"
+                                    << "joules" << "newtons" << "" << "" << "secs"
+                                    << "secs" << "" << "" << "" << "watts";
+
+                rideFile->addXData("ROW", rowSeries);
+
+
+           } else {  // default
+                csvType = generic;
+                rideFile->setDeviceType("Unknow");
+                rideFile->setFileFormat("Generic CSV (csv)");
+           }
+        }
+        if (csvType == ibike) {
+            if (lineno == 2) {
+                QStringList f = line.split(",");
+                if (f.size() == 6) {
+                    startTime = QDateTime(
+                        QDate(f[0].toInt(), f[1].toInt(), f[2].toInt()),
+                        QTime(f[3].toInt(), f[4].toInt(), f[5].toInt()));
                 }
             }
+            else if (lineno == 4) {
+                // this is the line with the iBike configuration data
+                // recording interval is in the [4] location (zero-based array)
+                // the trailing zeroes in the configuration area seem to be causing an error
+                // the number is in the format 5.000000
+                recInterval = (int)line.section(',',4,4).toDouble();
+                rideFile->setDeviceType(line.section(',',26,26));
+                rideFile->setTag("Device Info", line.section(',',20,21).remove(QChar('"')));
+            }
+        }
 
-            if (csvType == freemotion) {
-                if (lineno == 2) {
-                    if (line == "English")
-                        metric = false;
-                }
+        if (csvType == freemotion) {
+            if (lineno == 2) {
+                if (line == "English")
+                    metric = false;
             }
+        }
 
 
 
-            if (csvType == joule && lineno == 2) {
-                // 6,2012-11-27 13:40:41,0,0,0,,55.8,788,227,1,Joule,18.018,,0,
-                QStringList f = line.split(",");
-                if (f.size() >= 2) {
-                    int f0l;
-                    QStringList f0 = f[1].split("|");
-                    // new format? due to new PowerAgent version (7.5.7.34)?
-                    // 6,2011-01-02 21:22:20|2011-01-02 21:22|01/02/2011 21:22|2011-01-02 21-22-20,0,0, ...
-
-                    f0l = f0.size();
-                    if (f0l >= 2) {
-                       startTime = QDateTime::fromString(f0[0], "yyyy-MM-dd H:mm:ss");
-                    } else {
-                       startTime = QDateTime::fromString(f[1], "yyyy-MM-dd H:mm:ss");
-                    }
+        if (csvType == joule && lineno == 2) {
+            // 6,2012-11-27 13:40:41,0,0,0,,55.8,788,227,1,Joule,18.018,,0,
+            QStringList f = line.split(",");
+            if (f.size() >= 2) {
+                int f0l;
+                QStringList f0 = f[1].split("|");
+                // new format? due to new PowerAgent version (7.5.7.34)?
+                // 6,2011-01-02 21:22:20|2011-01-02 21:22|01/02/2011 21:22|2011-01-02 21-22-20,0,0, ...
+
+                f0l = f0.size();
+                if (f0l >= 2) {
+                   startTime = QDateTime::fromString(f0[0], "yyyy-MM-dd H:mm:ss");
+                } else {
+                   startTime = QDateTime::fromString(f[1], "yyyy-MM-dd H:mm:ss");
+                }
+            }
+        }
+        if (csvType == rowpro && lineno == 8) {
+            startTime = QDateTime::fromString(line.section(',', 0, 0), "dd/MM/yyyy H:mm:ss");
+        }
+        if (lineno == unitsHeader && (csvType == generic || csvType == bsx || csvType == wahooMA)) {
+            QRegExp timeHeaderSecs("( )*(secs|sec|time|timestamp)( )*", Qt::CaseInsensitive);
+            //QRegExp timeHeaderTimestamp("( )*(timestamp)( )*", Qt::CaseInsensitive);
+            //QRegExp timeHeaderMins("( )*(min|minutes)( )*", Qt::CaseInsensitive);
+            QRegExp wattsHeader("( )*(watts|power)( )*", Qt::CaseInsensitive);
+            QRegExp cadenceHeader("( )*(cadence)( )*", Qt::CaseInsensitive);
+            QRegExp smo2Header("( )*(smo2)( )*", Qt::CaseInsensitive);
+            QRegExp hrHeader("( )*(hr|heart_rate)( )*", Qt::CaseInsensitive);
+            QRegExp gctHeader("( )*(groundcontacttime)( )*", Qt::CaseInsensitive);
+            QRegExp voHeader("( )*(verticaloscillation)( )*", Qt::CaseInsensitive);
+            QRegExp kphHeader("( )*(speed)( )*", Qt::CaseInsensitive);
+            QStringList headers = line.split(",");
+
+            QStringListIterator i(headers);
+
+            while (i.hasNext()) {
+                QString header = i.next();
+                if (timeHeaderSecs.indexIn(header) == 0)  {
+                    secsIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        secsIndex++;
+                }
+                /* UNUSEDelse if (timeHeaderTimestamp.indexIn(header) != -1)  {
+                    timestampIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        timestampIndex++;
+                } */
+                /* UNUSED else if (timeHeaderMins.indexIn(header) != -1)  {
+                    minutesIndex = headers.indexOf(header);
+                } */
+
+                if (wattsHeader.indexIn(header) == 0)  {
+                    wattsIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        wattsIndex++;
+                }
+                if (cadenceHeader.indexIn(header) != -1)  {
+                    cadenceIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        cadenceIndex++;
+                }
+                if (hrHeader.indexIn(header) != -1)  {
+                    hrIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        hrIndex++;
+                }
+                if (smo2Header.indexIn(header) != -1)  {
+                    smo2Index = headers.indexOf(header);
+                    if (csvType == bsx)
+                        smo2Index++;
+                }
+                if (gctHeader.indexIn(header) != -1)  {
+                    gctIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        gctIndex++;
+                }
+                if (voHeader.indexIn(header) != -1)  {
+                    voIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        voIndex++;
+                }
+                if (kphHeader.indexIn(header) != -1)  {
+                    kphIndex = headers.indexOf(header);
+                    if (csvType == bsx)
+                        kphIndex++;
                 }
             }
-            if (csvType == rowpro && lineno == 8) {
-                startTime = QDateTime::fromString(line.section(',', 0, 0), "dd/MM/yyyy H:mm:ss");
+
+        } else if (lineno == unitsHeader && csvType != moxy && csvType != peripedal && csvType != rowpro && csvType != rp3) {
+
+            if (metricUnits.indexIn(line) != -1)
+                metric = true;
+            else if (englishUnits.indexIn(line) != -1)
+                metric = false;
+            else {
+                errors << "Can't find units in first line: \"" + line + "\" of file \"" + file.fileName() + "\".";
+                delete rideFile;
+                file.close();
+                return NULL;
             }
-            if (lineno == unitsHeader && (csvType == generic || csvType == bsx || csvType == wahooMA)) {
-                QRegExp timeHeaderSecs("( )*(secs|sec|time|timestamp)( )*", Qt::CaseInsensitive);
-                //QRegExp timeHeaderTimestamp("( )*(timestamp)( )*", Qt::CaseInsensitive);
-                //QRegExp timeHeaderMins("( )*(min|minutes)( )*", Qt::CaseInsensitive);
-                QRegExp wattsHeader("( )*(watts|power)( )*", Qt::CaseInsensitive);
-                QRegExp cadenceHeader("( )*(cadence)( )*", Qt::CaseInsensitive);
-                QRegExp smo2Header("( )*(smo2)( )*", Qt::CaseInsensitive);
-                QRegExp hrHeader("( )*(hr|heart_rate)( )*", Qt::CaseInsensitive);
-                QRegExp gctHeader("( )*(groundcontacttime)( )*", Qt::CaseInsensitive);
-                QRegExp voHeader("( )*(verticaloscillation)( )*", Qt::CaseInsensitive);
-                QRegExp kphHeader("( )*(speed)( )*", Qt::CaseInsensitive);
-                QStringList headers = line.split(",");
-
-                QStringListIterator i(headers);
-
-                while (i.hasNext()) {
-                    QString header = i.next();
-                    if (timeHeaderSecs.indexIn(header) == 0)  {
-                        secsIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            secsIndex++;
-                    }
-                    /* UNUSEDelse if (timeHeaderTimestamp.indexIn(header) != -1)  {
-                        timestampIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            timestampIndex++;
-                    } */
-                    /* UNUSED else if (timeHeaderMins.indexIn(header) != -1)  {
-                        minutesIndex = headers.indexOf(header);
-                    } */
-
-                    if (wattsHeader.indexIn(header) == 0)  {
-                        wattsIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            wattsIndex++;
-                    }
-                    if (cadenceHeader.indexIn(header) != -1)  {
-                        cadenceIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            cadenceIndex++;
-                    }
-                    if (hrHeader.indexIn(header) != -1)  {
-                        hrIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            hrIndex++;
-                    }
-                    if (smo2Header.indexIn(header) != -1)  {
-                        smo2Index = headers.indexOf(header);
-                        if (csvType == bsx)
-                            smo2Index++;
-                    }
-                    if (gctHeader.indexIn(header) != -1)  {
-                        gctIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            gctIndex++;
-                    }
-                    if (voHeader.indexIn(header) != -1)  {
-                        voIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            voIndex++;
-                    }
-                    if (kphHeader.indexIn(header) != -1)  {
-                        kphIndex = headers.indexOf(header);
-                        if (csvType == bsx)
-                            kphIndex++;
+
+            if (degCUnits.indexIn(line) != -1)
+                tempType = degC;
+            else if (degFUnits.indexIn(line) != -1)
+                tempType = degF;
+
+        } else if (lineno > unitsHeader) {
+            double minutes=0,nm=0,kph=0,watts=0,km=0,cad=0,alt=0,hr=0,dfpm=0, seconds=0.0;
+            double temp=RideFile::NA;
+            double slope=0.0;
+            bool ok;
+            double lat = 0.0, lon = 0.0;
+            double headwind = 0.0;
+            double lrbalance = RideFile::NA;
+            double lte = 0.0, rte = 0.0;
+            double lps = 0.0, rps = 0.0;
+            double smo2 = 0.0, thb = 0.0;
+            double gct = 0.0, vo = 0.0, rcad = 0.0;
+            //UNUSED double o2hb = 0.0, hhb = 0.0;
+            double target = 0.0;
+
+            int interval=0;
+            int pause=0;
+
+
+            quint64 ms;
+
+            if (csvType == powertap || csvType == joule) {
+                 minutes = fields.number(0);
+                 nm = fields.number(1);
+                 kph = fields.number(2);
+                 watts = fields.number(3);
+                 km = fields.number(4);
+                 cad = fields.number(5);
+                 hr = fields.number(6);
+                 interval = fields.integer(7);
+                 alt = fields.number(8);
+                if (csvType == joule && tempType != degNone) {
+                    // is the position always the same?
+                    // should we read the header and assign positions
+                    // to each item instead?
+                    temp = fields.number(9);
+                    if (tempType == degF) {
+                       // convert to deg C
+                       temp *= FAHRENHEIT_PER_CENTIGRADE + FAHRENHEIT_ADD_CENTIGRADE;
                     }
                 }
+                if (!metric) {
+                    km *= KM_PER_MILE;
+                    kph *= KM_PER_MILE;
+                    alt *= METERS_PER_FOOT;
+                }
 
-            } else if (lineno == unitsHeader && csvType != moxy && csvType != peripedal && csvType != rowpro && csvType != rp3) {
-
-                if (metricUnits.indexIn(line) != -1)
-                    metric = true;
-                else if (englishUnits.indexIn(line) != -1)
-                    metric = false;
-                else {
-                    errors << "Can't find units in first line: \"" + line + "\" of file \"" + file.fileName() + "\".";
-                    delete rideFile;
-                    file.close();
-                    return NULL;
+            } else if (csvType == gc) {
+                // GoldenCheetah CVS Format "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb\n";
+
+                seconds = fields.number(0);
+                minutes = seconds / 60.0f;
+                cad = fields.number(1);
+                hr = fields.number(2);
+                km = fields.number(3);
+                kph = fields.number(4);
+                nm = fields.number(5);
+                watts = fields.number(6);
+                alt = fields.number(7);
+                lon = fields.number(8);
+                lat = fields.number(9);
+                headwind = fields.number(10);
+                slope = fields.number(11);
+                temp = fields.isEmpty(12) ? double(RideFile::NA) : fields.number(12);
+                interval = fields.integer(13);
+                lrbalance = fields.number(14);
+                lte = fields.number(15);
+                rte = fields.number(16);
+                lps = fields.number(17);
+                rps = fields.number(18);
+                smo2 = fields.number(19);
+                thb = fields.number(20);
+                //UNUSED o2hb = fields.number(21);
+                //UNUSED hhb = fields.number(22);
+                target = fields.integer(23);
+
+            } else if (csvType == peripedal) {
+
+                //mm-dd,hh:mm:ss,SmO2 Live,SmO2 Averaged,THb,Target Power,Heart Rate,Speed,Power,Cadence
+                // ignore lines with wrong number of entries
+                if (fields.count() != 10) continue;
+
+                seconds = moxySeconds(fields.text(1));
+                minutes = seconds / 60.0f;
+
+                if (startTime == QDateTime()) {
+                    QDate date = periDate(fields.text(0));
+                    QTime time = QTime(0,0,0).addSecs(seconds);
+                    startTime = QDateTime(date,time);
                 }
 
-                if (degCUnits.indexIn(line) != -1)
-                    tempType = degC;
-                else if (degFUnits.indexIn(line) != -1)
-                    tempType = degF;
-
-            } else if (lineno > unitsHeader) {
-                double minutes=0,nm=0,kph=0,watts=0,km=0,cad=0,alt=0,hr=0,dfpm=0, seconds=0.0;
-                double temp=RideFile::NA;
-                double slope=0.0;
-                bool ok;
-                double lat = 0.0, lon = 0.0;
-                double headwind = 0.0;
-                double lrbalance = RideFile::NA;
-                double lte = 0.0, rte = 0.0;
-                double lps = 0.0, rps = 0.0;
-                double smo2 = 0.0, thb = 0.0;
-                double gct = 0.0, vo = 0.0, rcad = 0.0;
-                //UNUSED double o2hb = 0.0, hhb = 0.0;
-                double target = 0.0;
-
-                int interval=0;
-                int pause=0;
-
-
-                quint64 ms;
-
-                if (csvType == powertap || csvType == joule) {
-                     minutes = line.section(',', 0, 0).toDouble();
-                     nm = line.section(',', 1, 1).toDouble();
-                     kph = line.section(',', 2, 2).toDouble();
-                     watts = line.section(',', 3, 3).toDouble();
-                     km = line.section(',', 4, 4).toDouble();
-                     cad = line.section(',', 5, 5).toDouble();
-                     hr = line.section(',', 6, 6).toDouble();
-                     interval = line.section(',', 7, 7).toInt();
-                     alt = line.section(',', 8, 8).toDouble();
-                    if (csvType == joule && tempType != degNone) {
-                        // is the position always the same?
-                        // should we read the header and assign positions
-                        // to each item instead?
-                        temp = line.section(',', 9, 9).toDouble();
-                        if (tempType == degF) {
-                           // convert to deg C
-                           temp *= FAHRENHEIT_PER_CENTIGRADE + FAHRENHEIT_ADD_CENTIGRADE;
-                        }
-                    }
-                    if (!metric) {
-                        km *= KM_PER_MILE;
-                        kph *= KM_PER_MILE;
-                        alt *= METERS_PER_FOOT;
-                    }
+                double aSmo2 = fields.number(3);
+                smo2 = fields.number(2);
+
+                // use average if live not available
+                if (aSmo2 && !smo2) smo2 = aSmo2;
+
+                thb = fields.number(4);
+                hr = fields.number(6);
+                kph = fields.number(7);
+                watts = fields.number(8);
+                cad = fields.number(10);
+
+                // dervice distance from speed
+                km = lastKM + (kph/3600.0f);
+                lastKM = km;
+
+                nm = 0;
+                alt = 0;
+                lon = 0;
+                lat = 0;
+                headwind = 0;
+                slope = 0;
+                temp = 0;
+                interval = 0;
+                lrbalance = 0;
+                lte = 0;
+                rte = 0;
+                lps = 0;
+                rps = 0;
+                //UNUSED o2hb = 0;
+                //UNUSED hhb = 0;
+
+            } else if (csvType == freemotion) {
+                if (line == "Ride_Totals") {
+                    eof = true;
+                    continue;
+                }
 
-                } else if (csvType == gc) {
-                    // GoldenCheetah CVS Format "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb\n";
+                QRegExp timestampRegEx("^([0-9]*):([0-9]*)$");
+                QString timestamp = fields.text(0);
 
-                    seconds = line.section(',', 0, 0).toDouble();
-                    minutes = seconds / 60.0f;
-                    cad = line.section(',', 1, 1).toDouble();
-                    hr = line.section(',', 2, 2).toDouble();
-                    km = line.section(',', 3, 3).toDouble();
-                    kph = line.section(',', 4, 4).toDouble();
-                    nm = line.section(',', 5, 5).toDouble();
-                    watts = line.section(',', 6, 6).toDouble();
-                    alt = line.section(',', 7, 7).toDouble();
-                    lon = line.section(',', 8, 8).toDouble();
-                    lat = line.section(',', 9, 9).toDouble();
-                    headwind = line.section(',', 10, 10).toDouble();
-                    slope = line.section(',', 11, 11).toDouble();
-                    temp = line.section(',', 12, 12)=="" ? double(RideFile::NA) : line.section(',', 12, 12).toDouble();
-                    interval = line.section(',', 13, 13).toInt();
-                    lrbalance = line.section(',', 14, 14).toDouble();
-                    lte = line.section(',', 15, 15).toDouble();
-                    rte = line.section(',', 16, 16).toDouble();
-                    lps = line.section(',', 17, 17).toDouble();
-                    rps = line.section(',', 18, 18).toDouble();
-                    smo2 = line.section(',', 19, 19).toDouble();
-                    thb = line.section(',', 20, 20).toDouble();
-                    //UNUSED o2hb = line.section(',', 21, 21).toDouble();
-                    //UNUSED hhb = line.section(',', 22, 22).toDouble();
-                    target = line.section(',', 23, 23).toInt();
-
-                } else if (csvType == peripedal) {
-
-                    //mm-dd,hh:mm:ss,SmO2 Live,SmO2 Averaged,THb,Target Power,Heart Rate,Speed,Power,Cadence
-                    // ignore lines with wrong number of entries
-                    if (line.split(",").count() != 10) continue;
-
-                    seconds = moxySeconds(line.section(',',1,1));
-                    minutes = seconds / 60.0f;
 
-                    if (startTime == QDateTime()) {
-                        QDate date = periDate(line.section(',',0,0));
-                        QTime time = QTime(0,0,0).addSecs(seconds);
-                        startTime = QDateTime(date,time);
-                    }
+                // Time,Miles,MPH,Watts,HR,RPM
+                if (!timestampRegEx.exactMatch(timestamp)) continue;
 
-                    double aSmo2 = line.section(',', 3, 3).toDouble();
-                    smo2 = line.section(',', 2, 2).toDouble();
-
-                    // use average if live not available
-                    if (aSmo2 && !smo2) smo2 = aSmo2;
-
-                    thb = line.section(',', 4, 4).toDouble();
-                    hr = line.section(',', 6, 6).toDouble();
-                    kph = line.section(',', 7, 7).toDouble();
-                    watts = line.section(',', 8, 8).toDouble();
-                    cad = line.section(',', 10, 10).toDouble();
-
-                    // dervice distance from speed
-                    km = lastKM + (kph/3600.0f);
-                    lastKM = km;
-
-                    nm = 0;
-                    alt = 0;
-                    lon = 0;
-                    lat = 0;
-                    headwind = 0;
-                    slope = 0;
-                    temp = 0;
-                    interval = 0;
-                    lrbalance = 0;
-                    lte = 0;
-                    rte = 0;
-                    lps = 0;
-                    rps = 0;
-                    //UNUSED o2hb = 0;
-                    //UNUSED hhb = 0;
-
-                } else if (csvType == freemotion) {
-                    if (line == "Ride_Totals") {
-                        eof = true;
-                        continue;
-                    }
+                int sec = timestampRegEx.cap(2).toInt();
+                int min = timestampRegEx.cap(1).toInt();
+                minutes = (double(min) + double(sec)/60.0f);
 
-                    QRegExp timestampRegEx("^([0-9]*):([0-9]*)$");
-                    QString timestamp = line.section(',', 0, 0);
+                cad = fields.number(5);
+                hr = fields.number(4);
+                km = fields.number(1);
+                kph = fields.number(2);
+                watts = fields.number(3);
 
+                if (!metric) {
+                    km *= KM_PER_MILE;
+                    kph *= KM_PER_MILE;
+                }
 
-                    // Time,Miles,MPH,Watts,HR,RPM
-                    if (!timestampRegEx.exactMatch(timestamp)) continue;
+           } else if (csvType == ibike) {
+                // this must be iBike
+                // can't find time as a column.
+                // will we have to extrapolate based on the recording interval?
+                // reading recording interval from config data in ibike csv file
+                //
+                // For iBike software version 11 or higher:
+                // use "power" field until a the "dfpm" field becomes non-zero.
+                 minutes = (recInterval * lineno - unitsHeader)/60.0;
+                 nm = 0; //no torque
+                 kph = fields.number(0);
+                 dfpm = fields.number(11);
+                 headwind = fields.number(1);
+                 if( iBikeVersion >= 11 && ( dfpm > 0.0 || dfpmExists ) ) {
+                     dfpmExists = true;
+                     watts = dfpm;
+                 }
+                 else {
+                     watts = fields.number(2);
+                 }
+                 km = fields.number(3);
+                 cad = fields.number(4);
+                 hr = fields.number(5);
+                 alt = fields.number(6);
+                 slope = fields.number(7);
+                 temp = fields.number(8);
+                 lat = fields.number(12);
+                 lon = fields.number(13);
+
+
+                 int lap = fields.integer(9);
+                 if (lap > 0) {
+                     iBikeInterval += 1;
+                     interval = iBikeInterval;
+                 }
+                if (!metric) {
+                    km *= KM_PER_MILE;
+                    kph *= KM_PER_MILE;
+                    alt *= METERS_PER_FOOT;
+                    headwind *= KM_PER_MILE;
+                }
 
-                    int sec = timestampRegEx.cap(2).toInt();
-                    int min = timestampRegEx.cap(1).toInt();
-                    minutes = (double(min) + double(sec)/60.0f);
+            } else if (csvType == moxy)  {
 
-                    cad = line.section(',', 5, 5).toDouble();
-                    hr = line.section(',', 4, 4).toDouble();
-                    km = line.section(',', 1, 1).toDouble();
-                    kph = line.section(',', 2, 2).toDouble();
-                    watts = line.section(',', 3, 3).toDouble();
+                // we get crappy lines with no data so ignore them
+                // I think they're supposed to be delimiters for the file
+                // content, but are just noise to us !
+                if (line == (" ,,,,,") || line == ",,,,," ||
+                    line == "" || line == " ") continue;
 
-                    if (!metric) {
-                        km *= KM_PER_MILE;
-                        kph *= KM_PER_MILE;
-                    }
+                // need to get time from second column and note that
+                // there will be gaps when recording drops so shouldn't
+                // assume it is a continuous stream
+                double seconds = moxySeconds(fields.text(1));
 
-               } else if (csvType == ibike) {
-                    // this must be iBike
-                    // can't find time as a column.
-                    // will we have to extrapolate based on the recording interval?
-                    // reading recording interval from config data in ibike csv file
-                    //
-                    // For iBike software version 11 or higher:
-                    // use "power" field until a the "dfpm" field becomes non-zero.
-                     minutes = (recInterval * lineno - unitsHeader)/60.0;
-                     nm = 0; //no torque
-                     kph = line.section(',', 0, 0).toDouble();
-                     dfpm = line.section( ',', 11, 11).toDouble();
-                     headwind = line.section(',', 1, 1).toDouble();
-                     if( iBikeVersion >= 11 && ( dfpm > 0.0 || dfpmExists ) ) {
-                         dfpmExists = true;
-                         watts = dfpm;
-                     }
-                     else {
-                         watts = line.section(',', 2, 2).toDouble();
-                     }
-                     km = line.section(',', 3, 3).toDouble();
-                     cad = line.section(',', 4, 4).toDouble();
-                     hr = line.section(',', 5, 5).toDouble();
-                     alt = line.section(',', 6, 6).toDouble();
-                     slope = line.section(',', 7, 7).toDouble();
-                     temp = line.section(',', 8, 8).toDouble();
-                     lat = line.section(',', 12, 12).toDouble();
-                     lon = line.section(',', 13, 13).toDouble();
-
-
-                     int lap = line.section(',', 9, 9).toInt();
-                     if (lap > 0) {
-                         iBikeInterval += 1;
-                         interval = iBikeInterval;
-                     }
-                    if (!metric) {
-                        km *= KM_PER_MILE;
-                        kph *= KM_PER_MILE;
-                        alt *= METERS_PER_FOOT;
-                        headwind *= KM_PER_MILE;
-                    }
+                if (startTime == QDateTime()) {
+                    QDate date = moxyDate(fields.text(0));
+                    QTime time = QTime(0,0,0).addSecs(seconds);
+                    startTime = QDateTime(date,time);
+                }
 
-                } else if (csvType == moxy)  {
+                if (seconds >0) {
+                    minutes = seconds / 60.0f;
+                    smo2 = fields.unquoted(2);
+                    thb = fields.unquoted(4);
+                }
+            }
+            else if (csvType == bsx || csvType == wahooMA)  {
+                if (secsIndex > -1) {
+                    seconds = fields.number(secsIndex);
 
-                    // we get crappy lines with no data so ignore them
-                    // I think they're supposed to be delimiters for the file
-                    // content, but are just noise to us !
-                    if (line == (" ,,,,,") || line == ",,,,," ||
-                        line == "" || line == " ") continue;
+                    QDateTime time;
 
-                    // need to get time from second column and note that
-                    // there will be gaps when recording drops so shouldn't
-                    // assume it is a continuous stream
-                    double seconds = moxySeconds(line.section(',',1,1));
+                    if (seconds < 1000000000000.0L)
+                        time = QDateTime::fromTime_t(seconds);
+                    else
+                        time = QDateTime::fromMSecsSinceEpoch(seconds);
 
                     if (startTime == QDateTime()) {
-                        QDate date = moxyDate(line.section(',',0,0));
-                        QTime time = QTime(0,0,0).addSecs(seconds);
-                        startTime = QDateTime(date,time);
+                        startTime = time;
+                        seconds = 1;
                     }
-
-                    if (seconds >0) {
-                        minutes = seconds / 60.0f;
-                        smo2 = line.section(',', 2, 2).remove("\"").toDouble();
-                        thb = line.section(',', 4, 4).remove("\"").toDouble();
+                    else {
+                        seconds = startTime.secsTo(time)+1;
                     }
+                    minutes = seconds / 60.0f;
                 }
-                else if (csvType == bsx || csvType == wahooMA)  {
-                    if (secsIndex > -1) {
-                        seconds = line.section(',', secsIndex, secsIndex).toDouble();
-
-                        QDateTime time;
-
-                        if (seconds < 1000000000000.0L)
-                            time = QDateTime::fromTime_t(seconds);
-                        else
-                            time = QDateTime::fromMSecsSinceEpoch(seconds);
-
-                        if (startTime == QDateTime()) {
-                            startTime = time;
-                            seconds = 1;
-                        }
-                        else {
-                            seconds = startTime.secsTo(time)+1;
-                        }
-                        minutes = seconds / 60.0f;
-                    }
 
-                    if (wattsIndex > -1) {
-                        watts = line.section(',', wattsIndex, wattsIndex).toDouble();
-                    }
-                    if (cadenceIndex > -1) {
-                        cad = line.section(',', cadenceIndex, cadenceIndex).toDouble();
-                    }
-                    if (hrIndex > -1) {
-                        hr = line.section(',', hrIndex, hrIndex).toDouble();
-                    }
-                    if (smo2Index > -1) {
-                        smo2 = line.section(',', smo2Index, smo2Index).toDouble();
-                    }
-                    if (gctIndex > -1) {
-                        gct = line.section(',', gctIndex, gctIndex).toDouble();
-                    }
-                    if (voIndex > -1) {
-                        vo = line.section(',', voIndex, voIndex).toDouble();
-                    }
-                    if (kphIndex > -1) {
-                        kph = line.section(',', kphIndex, kphIndex).toDouble() * 3.6f; // running speed is given in m/s, convert to km/h
-                        if (!metric) {
-                           kph *= KM_PER_MILE;
-                        }
-                    }
+                if (wattsIndex > -1) {
+                    watts = fields.number(wattsIndex);
                 }
-               else if(csvType == motoactv) {
-                    /* MotoActv saves it all as kind of SI (m, ms, m/s, NM etc)
-                     *  "double","double",.. so we need to filter out "
-                     */
-
-                    km = line.section(',', 0,0).remove("\"").toDouble()/1000;
-                    hr = line.section(',', 2, 2).remove("\"").toDouble();
-                    kph = line.section(',', 3, 3).remove("\"").toDouble()*3.6;
-
-                    lat = line.section(',', 5, 5).remove("\"").toDouble();
-                    /* Item 8 is crank torque, 13 is wheel torque */
-                    nm = line.section(',', 8, 8).remove("\"").toDouble();
-
-                    /* Ok there's no crank torque, try the wheel */
-                    if(nm == 0.0) {
-                         nm = line.section(',', 13, 13).remove("\"").toDouble();
-                    }
-                    if(epoch_set == false) {
-                         epoch_set = true;
-                         epoch_offset = line.section(',', 9,9).remove("\"").toULongLong(&ok, 10);
-
-                         /* We use this first value as the start time */
-                         startTime = QDateTime();
-                         startTime.setMSecsSinceEpoch(epoch_offset);
-                         rideFile->setStartTime(startTime);
-                    }
-
-                    ms = line.section(',', 9,9).remove("\"").toULongLong(&ok, 10);
-                    ms -= epoch_offset;
-                    seconds = ms/1000;
-
-                    alt = line.section(',', 10, 10).remove("\"").toDouble();
-                    watts = line.section(',', 11, 11).remove("\"").toDouble();
-                    lon = line.section(',', 15, 15).remove("\"").toDouble();
-                    cad = line.section(',', 16, 16).remove("\"").toDouble();
-               }
-                else if (csvType == ergomo) {
-                     // for ergomo formatted CSV files
-                     minutes     = line.section(ergomo_separator, 0, 0).toDouble() + total_pause;
-                     QString km_string = line.section(ergomo_separator, 1, 1);
-                     km_string.replace(",",".");
-                     km = km_string.toDouble();
-                     watts = line.section(ergomo_separator, 2, 2).toDouble();
-                     cad = line.section(ergomo_separator, 3, 3).toDouble();
-                     QString kph_string = line.section(ergomo_separator, 4, 4);
-                     kph_string.replace(",",".");
-                     kph = kph_string.toDouble();
-                     hr = line.section(ergomo_separator, 5, 5).toDouble();
-                     alt = line.section(ergomo_separator, 6, 6).toDouble();
-                     interval = line.section(',', 8, 8).toInt();
-                     if (interval != prevInterval) {
-                         prevInterval = interval;
-                         if (interval != 0) currentInterval++;
-                     }
-                     if (interval != 0) interval = currentInterval;
-                     pause = line.section(ergomo_separator, 9, 9).toInt();
-                     total_pause += pause;
-                     nm = 0; // torque is not provided in the Ergomo file
-
-                     // the ergomo records the time in whole seconds
-                     // RECORDING INT. 1, 2, 5, 10, 15 or 30 per sec
-                     // Time is *always* perfectly sequential.  To find pauses,
-                     // you need to read the PAUSE column.
-                     minutes = minutes/60.0;
-
-                     if (!metric) {
-                         km *= KM_PER_MILE;
-                         kph *= KM_PER_MILE;
-                         alt *= METERS_PER_FOOT;
-                     }
-                } else if (csvType == cpexport) {
-                    // seconds, value, (model), date
-                    seconds = line.section(',',0,0).toDouble();
-                    if (seconds == precSecs)
-                        continue;
-                    minutes = seconds / 60.0f;
-
-
-                    //seconds = lineno -1 ;
-                    double avgWatts = line.section(',', 1, 1).toDouble();
-                    if ( avgWatts > maxWatts ) {
-                        maxWatts = avgWatts;
-                    }
-
-                    //watts = (avgwatts * seconds - precSecs * precWatts) / (seconds - precSecs);
-                    watts = (avgWatts * seconds - precSecs * precAvg) / (seconds - precSecs);
-                    if ( watts > maxWatts ) {
-                        watts = maxWatts;
+                if (cadenceIndex > -1) {
+                    cad = fields.number(cadenceIndex);
+                }
+                if (hrIndex > -1) {
+                    hr = fields.number(hrIndex);
+                }
+                if (smo2Index > -1) {
+                    smo2 = fields.number(smo2Index);
+                }
+                if (gctIndex > -1) {
+                    gct = fields.number(gctIndex);
+                }
+                if (voIndex > -1) {
+                    vo = fields.number(voIndex);
+                }
+                if (kphIndex > -1) {
+                    kph = fields.number(kphIndex) * 3.6f; // running speed is given in m/s, convert to km/h
+                    if (!metric) {
+                       kph *= KM_PER_MILE;
                     }
+                }
+            }
+           else if(csvType == motoactv) {
+                /* MotoActv saves it all as kind of SI (m, ms, m/s, NM etc)
+                 *  "double","double",.. so we need to filter out "
+                 */
+
+                km = fields.unquoted(0)/1000;
+                hr = fields.unquoted(2);
+                kph = fields.unquoted(3)*3.6;
+
+                lat = fields.unquoted(5);
+                /* Item 8 is crank torque, 13 is wheel torque */
+                nm = fields.unquoted(8);
+
+                /* Ok there's no crank torque, try the wheel */
+                if(nm == 0.0) {
+                     nm = fields.unquoted(13);
+                }
+                if(epoch_set == false) {
+                     epoch_set = true;
+                     epoch_offset = fields.text(9).remove("\"").toULongLong(&ok, 10);
+
+                     /* We use this first value as the start time */
+                     startTime = QDateTime();
+                     startTime.setMSecsSinceEpoch(epoch_offset);
+                     rideFile->setStartTime(startTime);
+                }
 
+                ms = fields.text(9).remove("\"").toULongLong(&ok, 10);
+                ms -= epoch_offset;
+                seconds = ms/1000;
+
+                alt = fields.unquoted(10);
+                watts = fields.unquoted(11);
+                lon = fields.unquoted(15);
+                cad = fields.unquoted(16);
+           }
+            else if (csvType == ergomo) {
+                 // for ergomo formatted CSV files, which may use ; as the separator
+                 const CsvFields &values = ergomo_separator == ',' ? fields : ergomoFields;
+                 minutes     = values.number(0) + total_pause;
+                 km = values.number(1, true);
+                 watts = values.number(2);
+                 cad = values.number(3);
+                 kph = values.number(4, true);
+                 hr = values.number(5);
+                 alt = values.number(6);
+                 interval = fields.integer(8);
+                 if (interval != prevInterval) {
+                     prevInterval = interval;
+                     if (interval != 0) currentInterval++;
+                 }
+                 if (interval != 0) interval = currentInterval;
+                 pause = values.integer(9);
+                 total_pause += pause;
+                 nm = 0; // torque is not provided in the Ergomo file
+
+                 // the ergomo records the time in whole seconds
+                 // RECORDING INT. 1, 2, 5, 10, 15 or 30 per sec
+                 // Time is *always* perfectly sequential.  To find pauses,
+                 // you need to read the PAUSE column.
+                 minutes = minutes/60.0;
+
+                 if (!metric) {
+                     km *= KM_PER_MILE;
+                     kph *= KM_PER_MILE;
+                     alt *= METERS_PER_FOOT;
+                 }
+            } else if (csvType == cpexport) {
+                // seconds, value, (model), date
+                seconds = fields.number(0);
+                if (seconds == precSecs)
+                    continue;
+                minutes = seconds / 60.0f;
 
-                    for (int gap=1; seconds-gap>precSecs; gap++) {
-                        rideFile->appendPoint(seconds-gap, cad, hr, km,
-                                              kph, nm, watts, alt, lon, lat,
-                                              headwind, slope, temp, lrbalance,
-                                              lte, rte, lps, rps,
-                                              0.0, 0.0,
-                                              0.0, 0.0, 0.0, 0.0,
-                                              0.0, 0.0, 0.0, 0.0,
-                                              smo2, thb,
-                                              0.0, 0.0, 0.0, 0.0, interval);
-                    }
 
-                    precAvg = (precAvg * precSecs + (watts>0?watts:0) * (seconds - precSecs)) / seconds;
-                    //qDebug() << seconds << avgwatts << precSecs << precWatts << ":" <<watts << "->" << precAvg;
-                    precSecs = seconds;
-                    //precWatts = avgwatts;
-                } else if (csvType == rowpro) {
-                    // RowPro CSV type "Time,Distance,Pace,Watts,Cals,SPM,HR,DutyCycle,Rowfile_Id"
-                    //                  0   , 1      , 2  , 3   , 4  , 5 , 6, 7       , 8
-                    // Time is milliseconds
-                    // Distance in meters
-                    // Pace is seconds per meter
-
-                    // Skip the summary at the end of the file
-                    if (line == "Type,Time,Distance,AvgPace,AvgWatts,Cals,SPM,EndHR,Rowfile_Id,AvgHR") {
-                        unitsHeader = lineno + 1000;
-                        continue;
-                    }
-                    seconds = line.section(',', 0, 0).toDouble() / 1000;
-                    minutes = seconds / 60.0f;
-                    km = line.section(',', 1, 1).toDouble() / 1000;
-                    double pace = line.section(',', 2, 2).toDouble();
-                    if (pace > 0 ) {
-                        kph = 3.6 / pace;
-                    }
-                    watts = line.section(',', 3, 3).toDouble();
-                    cad = line.section(',', 5, 5).toDouble();
-                    hr = line.section(',', 6, 6).toDouble();
-
-               } else {
-                    if (secsIndex > -1) {
-                        seconds = line.section(',', secsIndex, secsIndex).toDouble();
-                        minutes = seconds / 60.0f;
-                     }
+                //seconds = lineno -1 ;
+                double avgWatts = fields.number(1);
+                if ( avgWatts > maxWatts ) {
+                    maxWatts = avgWatts;
                 }
 
-                // PT reports no data as watts == -1.
-                if (watts == -1)
-                    watts = 0;
+                //watts = (avgwatts * seconds - precSecs * precWatts) / (seconds - precSecs);
+                watts = (avgWatts * seconds - precSecs * precAvg) / (seconds - precSecs);
+                if ( watts > maxWatts ) {
+                    watts = maxWatts;
+                }
 
-               if(csvType == motoactv)
-                    rideFile->appendPoint(seconds, cad, hr, km,
-                                          kph, nm, watts, alt, lon, lat, 0.0,
-                                          0.0, temp, 0.0, 0.0, 0.0, 0.0, 0.0,
-                                          0.0, 0.0, 0.0, 0.0,
-                                          0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
-                                          0.0, 0.0, 0.0, 0.0, 0.0, 0.0, interval);
-               else if (csvType == moxy) {
 
-                    // hack it in for now
-                    // XXX IT COULD BE RECORDED WITH DIFFERENT INTERVALS XXX
-                    rideFile->appendPoint(minutes * 60.0, cad, hr, km,
+                for (int gap=1; seconds-gap>precSecs; gap++) {
+                    rideFile->appendPoint(seconds-gap, cad, hr, km,
                                           kph, nm, watts, alt, lon, lat,
-                                          headwind, slope, temp, 0.0,
-                                          0.0, 0.0, 0.0, 0.0,
-                                          0.0, 0.0,
-                                          0.0, 0.0, 0.0, 0.0,
-                                          0.0, 0.0, 0.0, 0.0,
-                                          smo2, thb, 0.0, 0.0, 0.0, 0.0, interval);
-                    rideFile->appendPoint((minutes * 60.0)+1, cad, hr, km, // dupe it so we have 1s recording easier to merge
-                                          kph, nm, watts, alt, lon, lat,
-                                          headwind, slope, temp, 0.0,
-                                          0.0, 0.0, 0.0, 0.0,
+                                          headwind, slope, temp, lrbalance,
+                                          lte, rte, lps, rps,
                                           0.0, 0.0,
                                           0.0, 0.0, 0.0, 0.0,
                                           0.0, 0.0, 0.0, 0.0,
-                                          smo2, thb, 0.0, 0.0, 0.0, 0.0, interval);
-
-               } else if (csvType == rp3) {
-
-                    // row perfect is variable rate (for every stroke)
-                    // we add time, distance and power to standard fields
-                    // and the rest becomes XDATA
-
-                    // we need to handle data surrounded by quotes for RP3
-                    QStringList els;
-                    QString word;
-                    bool inquote=false;
-                    for(int i=0; i<line.length(); i++) {
-                        switch(line[i].toLatin1()) {
-                            case ',' : if (inquote) word.append(line.mid(i,1));
-                                       else {
-                                            els << word;
-                                            word="";
-                                       }
-                                       break;
-                            case '\"': inquote = !inquote;
-                                       break;
-                            default:   word.append(line.mid(i,1));
-                                       break;
-                        }
-                    }
-                    els << word; // last entry not comma delimeted
-
-                    if (els.count() == 25) {
-
-                        if (els[1].toInt() != lastinterval) {
-                            // we have a new interval marker!
-                            lastinterval = els[1].toInt();
-                            accruedseconds = lastsecs >= 0 ? lastsecs : 0;
-                            accruedkm = lastKM;
-                            currentInterval++;
-                        }
-
-                        // ignore time goes backwards
-                        lastsecs=accruedseconds + els[7].toDouble();
-                        lastKM=accruedkm + (els[9].toDouble()/1000);
-
-                        rideFile->appendPoint(lastsecs,      // time in seconds
-                                              0,                      // cad
-                                              els[14].toDouble(),     // hr
-                                              lastKM, // distance (km, not meters)
-                                              0, 0,                   // kph, nm
-                                              els[4].toDouble(),      // power
-                                              0, 0, 0, 0, 0,          // alt, lon, lat, headw, slope
-                                              -255, 0, 0, 0, 0, 0,    // temp, lrb, lte, rte, lps, rps
-                                              0.0, 0.0,
-                                              0.0, 0.0, 0.0, 0.0,
-                                              0.0, 0.0, 0.0, 0.0,
-                                              0, 0,                   // smo2, thb
-                                              0, 0, 0, 0.0,
-                                              currentInterval);
-
-                        // add ALL data series to XDATA
-                        // with NO conversion, stored exactly as found
-                        XDataPoint *p = new XDataPoint();
-                        p->secs = lastsecs;
-                        p->km = lastKM;
-                        for(int i=0; i<25; i++)
-                            p->number[i] = els[i].toDouble();
-
-                        rowSeries->datapoints.append(p);
+                                          smo2, thb,
+                                          0.0, 0.0, 0.0, 0.0, interval);
+                }
+
+                precAvg = (precAvg * precSecs + (watts>0?watts:0) * (seconds - precSecs)) / seconds;
+                //qDebug() << seconds << avgwatts << precSecs << precWatts << ":" <<watts << "->" << precAvg;
+                precSecs = seconds;
+                //precWatts = avgwatts;
+            } else if (csvType == rowpro) {
+                // RowPro CSV type "Time,Distance,Pace,Watts,Cals,SPM,HR,DutyCycle,Rowfile_Id"
+                //                  0   , 1      , 2  , 3   , 4  , 5 , 6, 7       , 8
+                // Time is milliseconds
+                // Distance in meters
+                // Pace is seconds per meter
+
+                // Skip the summary at the end of the file
+                if (line == "Type,Time,Distance,AvgPace,AvgWatts,Cals,SPM,EndHR,Rowfile_Id,AvgHR") {
+                    unitsHeader = lineno + 1000;
+                    continue;
+                }
+                seconds = fields.number(0) / 1000;
+                minutes = seconds / 60.0f;
+                km = fields.number(1) / 1000;
+                double pace = fields.number(2);
+                if (pace > 0 ) {
+                    kph = 3.6 / pace;
+                }
+                watts = fields.number(3);
+                cad = fields.number(5);
+                hr = fields.number(6);
+
+           } else {
+                if (secsIndex > -1) {
+                    seconds = fields.number(secsIndex);
+                    minutes = seconds / 60.0f;
+                 }
+            }
+
+            // PT reports no data as watts == -1.
+            if (watts == -1)
+                watts = 0;
+
+           if(csvType == motoactv)
+                rideFile->appendPoint(seconds, cad, hr, km,
+                                      kph, nm, watts, alt, lon, lat, 0.0,
+                                      0.0, temp, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0, 0.0, 0.0, interval);
+           else if (csvType == moxy) {
+
+                // hack it in for now
+                // XXX IT COULD BE RECORDED WITH DIFFERENT INTERVALS XXX
+                rideFile->appendPoint(minutes * 60.0, cad, hr, km,
+                                      kph, nm, watts, alt, lon, lat,
+                                      headwind, slope, temp, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      smo2, thb, 0.0, 0.0, 0.0, 0.0, interval);
+                rideFile->appendPoint((minutes * 60.0)+1, cad, hr, km, // dupe it so we have 1s recording easier to merge
+                                      kph, nm, watts, alt, lon, lat,
+                                      headwind, slope, temp, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      smo2, thb, 0.0, 0.0, 0.0, 0.0, interval);
+
+           } else if (csvType == rp3) {
+
+                // row perfect is variable rate (for every stroke)
+                // we add time, distance and power to standard fields
+                // and the rest becomes XDATA
+
+                // we need to handle data surrounded by quotes for RP3
+                QStringList els;
+                QString word;
+                bool inquote=false;
+                for(int i=0; i<line.length(); i++) {
+                    switch(line[i].toLatin1()) {
+                        case ',' : if (inquote) word.append(line.mid(i,1));
+                                   else {
+                                        els << word;
+                                        word="";
+                                   }
+                                   break;
+                        case '\"': inquote = !inquote;
+                                   break;
+                        default:   word.append(line.mid(i,1));
+                                   break;
                     }
+                }
+                els << word; // last entry not comma delimeted
+
+                if (els.count() == 25) {
 
-               } else {
-                    if (vo>0 || gct>0) {
-                       rcad = cad;
-                       cad = 0.0;
+                    if (els[1].toInt() != lastinterval) {
+                        // we have a new interval marker!
+                        lastinterval = els[1].toInt();
+                        accruedseconds = lastsecs >= 0 ? lastsecs : 0;
+                        accruedkm = lastKM;
+                        currentInterval++;
                     }
-                    rideFile->appendPoint(minutes * 60.0, cad, hr, km,
-                                          kph, nm, watts, alt, lon, lat,
-                                          headwind, slope, temp, lrbalance,
-                                          lte, rte, lps, rps,
+
+                    // ignore time goes backwards
+                    lastsecs=accruedseconds + els[7].toDouble();
+                    lastKM=accruedkm + (els[9].toDouble()/1000);
+
+                    rideFile->appendPoint(lastsecs,      // time in seconds
+                                          0,                      // cad
+                                          els[14].toDouble(),     // hr
+                                          lastKM, // distance (km, not meters)
+                                          0, 0,                   // kph, nm
+                                          els[4].toDouble(),      // power
+                                          0, 0, 0, 0, 0,          // alt, lon, lat, headw, slope
+                                          -255, 0, 0, 0, 0, 0,    // temp, lrb, lte, rte, lps, rps
                                           0.0, 0.0,
                                           0.0, 0.0, 0.0, 0.0,
                                           0.0, 0.0, 0.0, 0.0,
-                                          smo2, thb,
-                                          vo, rcad, gct, 0.0, interval);
-
-                    if (target > 0.0) {
-                        if (trainSeries == NULL)  {
-                            // add XDATA
-                            trainSeries = new XDataSeries();
-                            trainSeries->name = "TRAIN";
-                            trainSeries->valuename << "TARGET";
-                            trainSeries->unitname << "Watts";
-                        }
-
-                        XDataPoint *p = new XDataPoint();
-                        p->secs = minutes * 60.0;
-                        p->km = km;
-                        p->number[0] = target;
-
-                        trainSeries->datapoints.append(p);
+                                          0, 0,                   // smo2, thb
+                                          0, 0, 0, 0.0,
+                                          currentInterval);
+
+                    // add ALL data series to XDATA
+                    // with NO conversion, stored exactly as found
+                    XDataPoint *p = new XDataPoint();
+                    p->secs = lastsecs;
+                    p->km = lastKM;
+                    for(int i=0; i<25; i++)
+                        p->number[i] = els[i].toDouble();
+
+                    rowSeries->datapoints.append(p);
+                }
+
+           } else {
+                if (vo>0 || gct>0) {
+                   rcad = cad;
+                   cad = 0.0;
+                }
+                rideFile->appendPoint(minutes * 60.0, cad, hr, km,
+                                      kph, nm, watts, alt, lon, lat,
+                                      headwind, slope, temp, lrbalance,
+                                      lte, rte, lps, rps,
+                                      0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      0.0, 0.0, 0.0, 0.0,
+                                      smo2, thb,
+                                      vo, rcad, gct, 0.0, interval);
+
+                if (target > 0.0) {
+                    if (trainSeries == NULL)  {
+                        // add XDATA
+                        trainSeries = new XDataSeries();
+                        trainSeries->name = "TRAIN";
+                        trainSeries->valuename << "TARGET";
+                        trainSeries->unitname << "Watts";
                     }
-               }
-            }
-            ++lineno;
+
+                    XDataPoint *p = new XDataPoint();
+                    p->secs = minutes * 60.0;
+                    p->km = km;
+                    p->number[0] = target;
+
+                    trainSeries->datapoints.append(p);
+                }
+           }
         }
+        ++lineno;
     }
     file.close();
 
@@ -1171,16 +1360,23 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
 }
 
 bool
-CsvFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file, CsvType format) const
+CsvFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file, CsvType format) const
 {
     if (!file.open(QIODevice::WriteOnly)) return(false);
+    bool success = writeRideData(context, ride, file, format);
+    file.close();
+    return success;
+}
 
+bool
+CsvFileReader::writeRideData(Context *, const RideFile *ride, QIODevice &device, CsvType format) const
+{
     // always save CSV in metric format
     bool bIsMetric = true;
 
     // Use the column headers that make WKO+ happy.
     double convertUnit;
-    QTextStream out(&file);
+    QTextStream out(&device);
 
     if (format == gc) {
         // CSV File header
@@ -1293,6 +1489,6 @@ CsvFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file, CsvTy
         }
     }
 
-    file.close();
-    return true;
+    out.flush();
+    return out.status() == QTextStream::Ok;
 }
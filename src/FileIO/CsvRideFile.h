@@ -34,6 +34,11 @@ struct CsvFileReader : public RideFileReader {
 
     // write but able to select format
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file, CsvType format) const;
+
+    // same again to an open device
+    bool writeRideData(Context *context, const RideFile *ride, QIODevice &out) const
+    { return writeRideData(context, ride, out, powertap); }
+    bool writeRideData(Context *context, const RideFile *ride, QIODevice &out, CsvType format) const;
     bool hasWrite() const { return true; }
 };
 
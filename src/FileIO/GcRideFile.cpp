@@ -19,7 +19,9 @@
 #include "GcRideFile.h"
 #include <algorithm> // for std::sort
 #include <QDomDocument>
+#include <QXmlStreamReader>
 #include <QVector>
+#include <QSet>
 
 #include <QDebug>
 
@@ -32,133 +34,182 @@ static int gcFileReaderRegistered =
 RideFile *
 GcFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
 {
-    QDomDocument doc("GoldenCheetah");
     if (!file.open(QIODevice::ReadOnly)) {
         errors << "Could not open file.";
         return NULL;
     }
 
-    bool parsed = doc.setContent(&file);
-    file.close();
-    if (!parsed) {
-        errors << "Could not parse file.";
-        return NULL;
-    }
-
+    // we stream the file rather than build a document, samples go straight
+    // into the ride so memory doesn't grow with the length of the file. As
+    // with the document only the first of each section is used.
+    QXmlStreamReader xml(&file);
     RideFile *rideFile = new RideFile();
-    QDomElement root = doc.documentElement();
-    QDomNode attributes = root.firstChildElement("attributes");
-
-    for (QDomElement attr = attributes.firstChildElement("attribute");
-         !attr.isNull(); attr = attr.nextSiblingElement("attribute")) {
-        QString key = attr.attribute("key");
-        QString value = attr.attribute("value");
-        if (key == "Device type")
-            rideFile->setDeviceType(value);
-        else if (key == "File Format")
-            rideFile->setFileFormat(value);
-        if (key == "Start time") {
-            // by default QDateTime is localtime - the source however is UTC
-            QDateTime aslocal = QDateTime::fromString(value, DATETIME_FORMAT);
-            // construct in UTC so we can honour the conversion to localtime
-            QDateTime asUTC = QDateTime(aslocal.date(), aslocal.time(), Qt::UTC);
-            // now set in localtime
-            rideFile->setStartTime(asUTC.toLocalTime());
-        }
-        if (key == "Identifier") {
-            rideFile->setId(value);
-        }
-    }
-
-    // read in metric overrides:
-    //  <override>
-    //    <metric name="skiba_bike_score" value="100"/>
-    //    <metric name="average_speed" secs="3600" km="30"/>
-    //  </override>
-
-    QDomNode overrides = root.firstChildElement("override");
-    if (!overrides.isNull()) {
 
-        for (QDomElement override = overrides.firstChildElement("metric");
-            !override.isNull();
-            override = override.nextSiblingElement("metric")) {
-
-            // setup the metric overrides QMap
-            QMap<QString, QString> bsm;
-
-            // for now only value is known to be maintained
-            bsm.insert("value", override.attribute("value"));
+    QVector<double> intervalStops; // used to set the interval number for each point
+    RideFileInterval add;          // used to add each named interval to RideFile
+    QSet<QString> sections;        // the ones we've seen
+    bool hasSamples = false, recIntSet = false, renumber = false;
+    int interval = 0;
 
-            // insert into the rideFile overrides
-            rideFile->metricOverrides.insert(override.attribute("name"), bsm);
+    if (xml.readNextStartElement()) { // <ride>
+
+        while (xml.readNextStartElement()) {
+
+            QString section = xml.name().toString();
+            if (sections.contains(section)) {
+                xml.skipCurrentElement();
+                continue;
+            }
+            sections.insert(section);
+
+            if (section == "attributes") {
+
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("attribute")) {
+                        QXmlStreamAttributes attr = xml.attributes();
+                        QString key = attr.value("key").toString();
+                        QString value = attr.value("value").toString();
+                        if (key == "Device type")
+                            rideFile->setDeviceType(value);
+                        else if (key == "File Format")
+                            rideFile->setFileFormat(value);
+                        if (key == "Start time") {
+                            // by default QDateTime is localtime - the source however is UTC
+                            QDateTime aslocal = QDateTime::fromString(value, DATETIME_FORMAT);
+                            // construct in UTC so we can honour the conversion to localtime
+                            QDateTime asUTC = QDateTime(aslocal.date(), aslocal.time(), Qt::UTC);
+                            // now set in localtime
+                            rideFile->setStartTime(asUTC.toLocalTime());
+                        }
+                        if (key == "Identifier") {
+                            rideFile->setId(value);
+                        }
+                    }
+                    xml.skipCurrentElement();
+                }
+
+            } else if (section == "override") {
+
+                // read in metric overrides:
+                //  <override>
+                //    <metric name="skiba_bike_score" value="100"/>
+                //    <metric name="average_speed" secs="3600" km="30"/>
+                //  </override>
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("metric")) {
+                        QXmlStreamAttributes attr = xml.attributes();
+
+                        // setup the metric overrides QMap
+                        QMap<QString, QString> bsm;
+
+                        // for now only value is known to be maintained
+                        bsm.insert("value", attr.value("value").toString());
+
+                        // insert into the rideFile overrides
+                        rideFile->metricOverrides.insert(attr.value("name").toString(), bsm);
+                    }
+                    xml.skipCurrentElement();
+                }
+
+            } else if (section == "tags") {
+
+                // read in the name/value metadata pairs
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("tag")) {
+                        QXmlStreamAttributes attr = xml.attributes();
+                        rideFile->setTag(attr.value("name").toString(), attr.value("value").toString());
+                    }
+                    xml.skipCurrentElement();
+                }
+
+            } else if (section == "intervals") {
+
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("interval")) {
+                        QXmlStreamAttributes attr = xml.attributes();
+
+                        // record the stops for old-style datapoint interval numbering
+                        double stop = attr.value("stop").toString().toDouble();
+                        intervalStops.append(stop);
+
+                        // add a new interval to the new-style interval ranges
+                        add.stop = stop;
+                        add.start = attr.value("start").toString().toDouble();
+                        add.name = attr.value("name").toString();
+                        rideFile->addInterval(RideFileInterval::DEVICE, add.start, add.stop, add.name);
+                    }
+                    xml.skipCurrentElement();
+                }
+                std::sort(intervalStops.begin(), intervalStops.end()); // just in case
+                renumber = hasSamples;
+
+            } else if (section == "samples") {
+
+                hasSamples = true;
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("sample")) {
+                        QXmlStreamAttributes attr = xml.attributes();
+                        double secs, cad, hr, km, kph, nm, watts, alt, lon, lat;
+                        double headwind = 0.0;
+                        secs = attr.value("secs").toString().toDouble();
+                        cad = attr.value("cad").toString().toDouble();
+                        hr = attr.value("hr").toString().toDouble();
+                        km = attr.value("km").toString().toDouble();
+                        kph = attr.value("kph").toString().toDouble();
+                        nm = attr.value("nm").toString().toDouble();
+                        watts = attr.value("watts").toString().toDouble();
+                        alt = attr.value("alt").toString().toDouble();
+                        lon = attr.value("lon").toString().toDouble();
+                        lat = attr.value("lat").toString().toDouble();
+                        while ((interval < intervalStops.size()) && (secs >= intervalStops[interval]))
+                            ++interval;
+                        rideFile->appendPoint(secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, 0.0,
+                                               RideFile::NA, RideFile::NA,
+                                              0.0, 0.0, 0.0, 0.0,
+                                              0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, interval);
+                        if (!recIntSet) {
+                            rideFile->setRecIntSecs(attr.value("len").toString().toDouble());
+                            recIntSet = true;
+                        }
+                    }
+                    xml.skipCurrentElement();
+                }
+
+            } else {
+                xml.skipCurrentElement();
+            }
         }
     }
 
-    // read in the name/value metadata pairs
-    QDomNode tags = root.firstChildElement("tags");
-    if (!tags.isNull()) {
-
-        for (QDomElement tag = tags.firstChildElement("tag");
-             !tag.isNull();
-             tag = tag.nextSiblingElement("tag")) {
+    // read to the end, so we notice if it isn't well formed
+    while (!xml.atEnd()) xml.readNext();
+    file.close();
 
-            rideFile->setTag(tag.attribute("name"), tag.attribute("value"));
-        }
+    if (xml.hasError()) {
+        errors << "Could not parse file.";
+        delete rideFile;
+        return NULL;
     }
 
-    QVector<double> intervalStops; // used to set the interval number for each point
-    RideFileInterval add;          // used to add each named interval to RideFile
-    QDomNode intervals = root.firstChildElement("intervals");
-    if (!intervals.isNull()) {
-        for (QDomElement interval = intervals.firstChildElement("interval");
-             !interval.isNull(); interval = interval.nextSiblingElement("interval")) {
-
-            // record the stops for old-style datapoint interval numbering
-            double stop = interval.attribute("stop").toDouble();
-            intervalStops.append(stop);
-
-            // add a new interval to the new-style interval ranges
-            add.stop = stop;
-            add.start = interval.attribute("start").toDouble();
-            add.name = interval.attribute("name");
-            rideFile->addInterval(RideFileInterval::DEVICE, add.start, add.stop, add.name);
+    // intervals after the samples isn't something we write, but
+    // number the points as we would have done if they came first
+    if (renumber) {
+        bool present = false;
+        interval = 0;
+        foreach(RideFilePoint *point, rideFile->dataPoints()) {
+            while ((interval < intervalStops.size()) && (point->secs >= intervalStops[interval]))
+                ++interval;
+            point->interval = interval;
+            if (interval) present = true;
         }
+        rideFile->setDataPresent(RideFile::interval, present);
     }
-    std::sort(intervalStops.begin(), intervalStops.end()); // just in case
-    int interval = 0;
 
-    QDomElement samples = root.firstChildElement("samples");
-    if (samples.isNull()) return rideFile; // manual file will have no samples
-
-    bool recIntSet = false;
-    for (QDomElement sample = samples.firstChildElement("sample");
-         !sample.isNull(); sample = sample.nextSiblingElement("sample")) {
-        double secs, cad, hr, km, kph, nm, watts, alt, lon, lat;
-        double headwind = 0.0;
-        secs = sample.attribute("secs", "0.0").toDouble();
-        cad = sample.attribute("cad", "0.0").toDouble();
-        hr = sample.attribute("hr", "0.0").toDouble();
-        km = sample.attribute("km", "0.0").toDouble();
-        kph = sample.attribute("kph", "0.0").toDouble();
-        nm = sample.attribute("nm", "0.0").toDouble();
-        watts = sample.attribute("watts", "0.0").toDouble();
-        alt = sample.attribute("alt", "0.0").toDouble();
-        lon = sample.attribute("lon", "0.0").toDouble();
-        lat = sample.attribute("lat", "0.0").toDouble();
-        while ((interval < intervalStops.size()) && (secs >= intervalStops[interval]))
-            ++interval;
-        rideFile->appendPoint(secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, 0.0,
-                               RideFile::NA, RideFile::NA,
-                              0.0, 0.0, 0.0, 0.0,
-                              0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, interval);
-        if (!recIntSet) {
-            rideFile->setRecIntSecs(sample.attribute("len").toDouble());
-            recIntSet = true;
-        }
-    }
+    if (!hasSamples) return rideFile; // manual file will have no samples
 
     if (!recIntSet) {
         errors << "no samples in ride file";
+        delete rideFile;
         return NULL;
     }
 
@@ -767,19 +767,20 @@ JsonFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &fil
     // truncate existing
     file.resize(0);
 
-    QByteArray xml = toByteArray(context, ride, true, true, true, true);
-
-    // setup streamer
-    QTextStream out(&file);
     // unified codepage and BOM for identification on all platforms
-    out.setCodec("UTF-8");
-    out.setGenerateByteOrderMark(true);
-
-    out << xml;
-    out.flush();
+    file.write("\xEF\xBB\xBF");
+    bool success = writeRideData(context, ride, file);
 
     // close
     file.close();
 
-    return true;
+    return success;
+}
+
+// toByteArray is already UTF-8 so goes straight out
+bool
+JsonFileReader::writeRideData(Context *context, const RideFile *ride, QIODevice &out) const
+{
+    QByteArray json = toByteArray(context, ride, true, true, true, true);
+    return out.write(json) == json.size();
 }
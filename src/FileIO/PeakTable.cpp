@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "PeakTable.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "RideFileCache.h"
+
+#include <limits>
+#include <cmath>
+
+static const float UNKNOWN = std::numeric_limits<float>::quiet_NaN();
+
+PeakTable::PeakTable(Context *context) : context(context)
+{
+}
+
+int
+PeakTable::rowFor(const QString &filename)
+{
+    int row = rows.value(filename, -1);
+    if (row >= 0) return row;
+
+    // new ride, it's unknown in all the columns
+    row = names.count();
+    rows.insert(filename, row);
+    names << filename;
+    for (int i=0; i<columns.count(); i++) columns[i].values.append(UNKNOWN);
+
+    return row;
+}
+
+int
+PeakTable::columnFor(RideFile::SeriesType series, int duration)
+{
+    QPair<int,int> key(static_cast<int>(series), duration);
+    int column = index.value(key, -1);
+    if (column >= 0) return column;
+
+    Column add;
+    add.series = series;
+    add.duration = duration;
+    add.values.fill(UNKNOWN, names.count());
+
+    column = columns.count();
+    columns << add;
+    index.insert(key, column);
+
+    return column;
+}
+
+void
+PeakTable::load(int row, RideFile::SeriesType series)
+{
+    // read all the columns we have for this series
+    // that are unknown for the ride in one go
+    QList<int> wanted;
+    QVector<int> durations;
+    for (int i=0; i<columns.count(); i++) {
+        if (columns[i].series == series && std::isnan(columns[i].values[row])) {
+            wanted << i;
+            durations << columns[i].duration;
+        }
+    }
+    if (wanted.isEmpty()) return;
+
+    QVector<float> values = RideFileCache::readBests(context, names[row], series, durations);
+    for (int i=0; i<wanted.count(); i++) columns[wanted[i]].values[row] = values[i];
+}
+
+double
+PeakTable::best(QString filename, RideFile::SeriesType series, int duration)
+{
+    QMutexLocker locker(&mutex);
+
+    int row = rowFor(filename);
+    int column = columnFor(series, duration);
+
+    if (std::isnan(columns[column].values[row])) load(row, series);
+    return columns[column].values[row];
+}
+
+QVector<QVector<double> >
+PeakTable::bests(const QStringList &filenames, RideFile::SeriesType series, const QList<int> &durations)
+{
+    QMutexLocker locker(&mutex);
+
+    // make sure all the columns exist before we load
+    // so each ride's .cpx file is read only once
+    QVector<int> wanted;
+    foreach(int duration, durations) wanted << columnFor(series, duration);
+
+    QVector<QVector<double> > returning(filenames.count());
+    for (int i=0; i<filenames.count(); i++) {
+
+        int row = rowFor(filenames[i]);
+
+        QVector<double> &here = returning[i];
+        here.resize(wanted.count());
+        for (int j=0; j<wanted.count(); j++) {
+            if (std::isnan(columns[wanted[j]].values[row])) load(row, series);
+            here[j] = columns[wanted[j]].values[row];
+        }
+    }
+    return returning;
+}
+
+void
+PeakTable::prefetch(RideFile::SeriesType series, const QList<int> &durations)
+{
+    if (context->athlete->rideCache == NULL) return;
+
+    QStringList filenames;
+    foreach(RideItem *item, context->athlete->rideCache->rides()) filenames << item->fileName;
+
+    bests(filenames, series, durations);
+}
+
+void
+PeakTable::invalidate(QString filename)
+{
+    QMutexLocker locker(&mutex);
+
+    int row = rows.value(filename, -1);
+    if (row < 0) return;
+
+    for (int i=0; i<columns.count(); i++) columns[i].values[row] = UNKNOWN;
+}
+
+void
+PeakTable::clear()
+{
+    QMutexLocker locker(&mutex);
+
+    rows.clear();
+    names.clear();
+    columns.clear();
+    index.clear();
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_PeakTable_h
+#define _GC_PeakTable_h 1
+#include "GoldenCheetah.h"
+#include "RideFile.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QPair>
+#include <QMutex>
+
+class Context;
+
+//
+// Resident table of the athlete's peaks (mean maximals) by ride
+//
+// RideFileCache::best() is called in loops over every ride, from the
+// best() function in a DataFilter and from the R peaks data frames, and
+// each call used to open the ride's .cpx file to read a single float.
+//
+// Here we keep a row per ride and a column per series and duration that
+// has been asked for. Cells are filled from the .cpx file on first use,
+// reading all the columns for that series in one go, and are forgotten
+// when the .cpx file is refreshed so they get read again next time.
+//
+// bests() answers for lots of rides and durations in one call and is
+// what callers that loop should use. All methods are thread safe, the
+// ride cache refresh and user metrics call in from worker threads.
+//
+class PeakTable
+{
+    public:
+
+        PeakTable(Context *context);
+
+        // peak for a single ride, same as RideFileCache::best()
+        double best(QString filename, RideFile::SeriesType series, int duration);
+
+        // peaks for lots of rides, returns a row per file in the order
+        // passed, with a value per duration in the order passed
+        QVector<QVector<double> > bests(const QStringList &filenames, RideFile::SeriesType series, const QList<int> &durations);
+
+        // fill the table for all rides ahead of evaluating a filter
+        void prefetch(RideFile::SeriesType series, const QList<int> &durations);
+
+        // the .cpx file was written, re-read when next asked for
+        void invalidate(QString filename);
+        void clear();
+
+    private:
+
+        // all called with the mutex held
+        int rowFor(const QString &filename);
+        int columnFor(RideFile::SeriesType series, int duration);
+        void load(int row, RideFile::SeriesType series);
+
+        Context *context;
+        QMutex mutex;
+
+        // rows
+        QHash<QString, int> rows;
+        QStringList names;
+
+        // columns, dense over the rows, NaN if not read yet
+        struct Column {
+            RideFile::SeriesType series;
+            int duration;
+            QVector<float> values;
+        };
+        QList<Column> columns;
+        QHash<QPair<int,int>, int> index; // series, duration -> column
+};
+
+#endif // _GC_PeakTable_h
@@ -20,6 +20,8 @@
 #include "Athlete.h"
 #include "Settings.h"
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QHash>
 #include <QVector>
 
 #include <QDebug>
@@ -28,32 +30,102 @@ static int pwxFileReaderRegistered =
     RideFileFactory::instance().registerReader(
         "pwx", "TrainingPeaks PWX", new PwxFileReader());
 
+//
+// PWX files are read with QXmlStreamReader, one child of <workout> at a
+// time, rather than building a DOM of the whole file. A long ride has tens
+// of thousands of <sample> elements and the DOM was many times the size of
+// the RideFile we build from it.
+//
+// PwxElement holds the text of the descendants of the element just read,
+// keyed by their path (e.g. "summarydata/duration"), so the code below can
+// still ask for each field by name as it did with firstChildElement().
+//
+class PwxElement
+{
+    public:
+
+        PwxElement(QXmlStreamReader &xml) : name(xml.qualifiedName().toString()) {
+            content = read(xml, "");
+        }
+
+        QString name;
+
+        // the first element at path, or the element itself if path is empty
+        bool has(QString path) const { return fields.contains(path); }
+        QString text(QString path = QString()) const { return path.isEmpty() ? content : fields.value(path); }
+
+        // name and text of each child of the element at path, in document order
+        // path must be below this element (e.g. "extension" within <device>)
+        QList<QPair<QString,QString> > children(QString path) const {
+            QList<QPair<QString,QString> > returning;
+            QString prefix = path + "/";
+            for (int i=0; i<ordered.count(); i++) {
+                const QString &p = ordered[i].first;
+                if (p.startsWith(prefix) && p.indexOf('/', prefix.length()) == -1)
+                    returning << qMakePair(p.mid(prefix.length()), ordered[i].second);
+            }
+            return returning;
+        }
+
+    private:
+
+        // reads up to and including the end of the current element, returns
+        // its text content ignoring whitespace between elements, as QDomElement::text()
+        QString read(QXmlStreamReader &xml, QString prefix) {
+            QString text;
+            while (!xml.atEnd()) {
+                xml.readNext();
+                if (xml.isStartElement()) {
+                    QString path = prefix + xml.qualifiedName().toString();
+                    QString inner = read(xml, path + "/");
+                    if (!fields.contains(path)) fields.insert(path, inner);
+                    if (!prefix.isEmpty()) ordered << qMakePair(path, inner); // only nested, see children()
+                    text += inner;
+                } else if (xml.isCharacters() && !xml.isWhitespace()) {
+                    text += xml.text();
+                } else if (xml.isEndElement()) {
+                    break;
+                }
+            }
+            return text;
+        }
+
+        QString content;
+        QHash<QString,QString> fields;
+        QList<QPair<QString,QString> > ordered;
+};
+
 RideFile *
 PwxFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
 {
-    QDomDocument doc("TrainingPeaks PWX");
     if (!file.open(QIODevice::ReadOnly)) {
         errors << "Could not open file.";
         return NULL;
     }
 
-    bool parsed = doc.setContent(&file);
+    QXmlStreamReader xml(&file);
+    RideFile *returning = PwxFromStream(xml, errors);
     file.close();
-    if (!parsed) {
-        errors << "Could not parse file.";
-        return NULL;
-    }
 
-    return PwxFromDomDoc(doc, errors);
+    return returning;
 }
 
 RideFile *
-PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
+PwxFileReader::PwxFromStream(QXmlStreamReader &xml, QStringList &errors) const
 {
+    // find the first <workout> in the document element
+    bool workout = false;
+    if (xml.readNextStartElement()) {
+        while (xml.readNextStartElement()) {
+            if (xml.qualifiedName() == "workout") {
+                workout = true;
+                break;
+            }
+            xml.skipCurrentElement();
+        }
+    }
+
     RideFile *rideFile = new RideFile();
-    QDomElement root = doc.documentElement();
-    QDomNode workout = root.firstChildElement("workout");
-    QDomNode node = workout.firstChild();
 
     // get the Smart Recording parameters
     QVariant isGarminSmartRecording = appsettings->value(NULL, GC_GARMIN_SMARTRECORD,Qt::Checked);
@@ -90,109 +162,96 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
     swimXdata->valuename << "DURATION";
     swimXdata->valuename << "STROKES";
 
-    while (!node.isNull()) {
+    while (workout && xml.readNextStartElement()) {
+
+        // one child of <workout> with its content
+        PwxElement node(xml);
 
         // athlete
-        if (node.nodeName() == "athlete") {
+        if (node.name == "athlete") {
 
-            QDomElement name = node.firstChildElement("name");
-            if (!name.isNull()) {
-                rideFile->setTag("Athlete Name", name.text());
+            if (node.has("name")) {
+                rideFile->setTag("Athlete Name", node.text("name"));
             }
 
-            QDomElement weight = node.firstChildElement("weight");
-            if (!weight.isNull()) {
-                rideFile->setTag("Weight", weight.text());
+            if (node.has("weight")) {
+                rideFile->setTag("Weight", node.text("weight"));
             }
 
         // workout code
-        } else if (node.nodeName() == "code") {
+        } else if (node.name == "code") {
 
-            QDomElement code = node.toElement();
-            rideFile->setTag("Workout Code", code.text());
+            rideFile->setTag("Workout Code", node.text());
 
         // workout title
-        } else if (node.nodeName() == "title") {
+        } else if (node.name == "title") {
 
-            QDomElement title = node.toElement();
-            rideFile->setTag("Workout Title", title.text());
+            rideFile->setTag("Workout Title", node.text());
 
         // goal / objective
-        } else if (node.nodeName() == "goal") {
+        } else if (node.name == "goal") {
 
-            QDomElement goal = node.toElement();
-            rideFile->setTag("Objective", goal.text());
+            rideFile->setTag("Objective", node.text());
 
         // sport
-        } else if (node.nodeName() == "sportType") {
+        } else if (node.name == "sportType") {
 
-            QDomElement sport = node.toElement();
-            rideFile->setTag("Sport", sport.text());
+            rideFile->setTag("Sport", node.text());
 
         // notes
-        } else if (node.nodeName() == "cmt") {
+        } else if (node.name == "cmt") {
 
             // Add the PWX cmt tag as notes
-            QDomElement notes = node.toElement();
-            rideFile->setTag("Notes", notes.text());
+            rideFile->setTag("Notes", node.text());
 
         // device type and info
-        } else if (node.nodeName() == "device") {
+        } else if (node.name == "device") {
 
             QString devicetype;
             // make and model
-            QDomElement make = node.firstChildElement("make");
-            if (!make.isNull()) devicetype = make.text();
-            QDomElement model = node.firstChildElement("model");
-            if (!model.isNull()) {
+            if (node.has("make")) devicetype = node.text("make");
+            if (node.has("model")) {
                 if (devicetype != "") devicetype += " ";
-                devicetype += model.text();
+                devicetype += node.text("model");
             }
             rideFile->setDeviceType(devicetype);
             rideFile->setFileFormat("Peaksware Data File (pwx)");
 
             // device settings data
             QString deviceinfo;
-            QDomElement extension = node.firstChildElement("extension");
-            if (!extension.isNull()) {
-                for (QDomElement info=extension.firstChildElement();
-                    !info.isNull();
-                    info = info.nextSiblingElement()) {
-                    deviceinfo += info.tagName();
+            if (node.has("extension")) {
+                QList<QPair<QString,QString> > info = node.children("extension");
+                for (int i=0; i<info.count(); i++) {
+                    deviceinfo += info[i].first;
                     deviceinfo += ": ";
-                    deviceinfo += info.text();
+                    deviceinfo += info[i].second;
                     deviceinfo += '\n';
                 }
             }
             rideFile->setTag("Device Info", deviceinfo);
 
         // start date/time
-        } else if (node.nodeName() == "time") {
-            QDomElement date = node.toElement();
-            rideDate = QDateTime::fromString(date.text(), Qt::ISODate);
+        } else if (node.name == "time") {
+            rideDate = QDateTime::fromString(node.text(), Qt::ISODate);
             rideFile->setStartTime(rideDate);
 
         // interval data
-        } else if (node.nodeName() == "segment") {
+        } else if (node.name == "segment") {
             RideFileInterval add;
 
             // name
-            QDomElement name = node.firstChildElement("name");
-            if (!name.isNull()) add.name = name.text();
+            if (node.has("name")) add.name = node.text("name");
             else add.name = QString("Interval #%1").arg(++intervals);
 
-            QDomElement summary = node.firstChildElement("summarydata");
-            if (!summary.isNull()) {
+            if (node.has("summarydata")) {
 
                 // start
-                QDomElement beginning = summary.firstChildElement("beginning");
-                if (!beginning.isNull()) add.start = beginning.text().toDouble();
+                if (node.has("summarydata/beginning")) add.start = node.text("summarydata/beginning").toDouble();
                 else add.start = -1;
 
                 // duration - convert to end
-                QDomElement duration = summary.firstChildElement("duration");
-                if (!duration.isNull() && add.start != -1)
-                    add.stop = duration.text().toDouble() + add.start;
+                if (node.has("summarydata/duration") && add.start != -1)
+                    add.stop = node.text("summarydata/duration").toDouble() + add.start;
                 else
                     add.stop = -1;
 
@@ -203,84 +262,68 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
             }
 
         // data points: offset, hr, spd, pwr, torq, cad, dist, lat, lon, alt, temp
-        } else if (node.nodeName() == "sample") {
+        } else if (node.name == "sample") {
             RideFilePoint add;
 
             // offset (secs)
-            QDomElement off = node.firstChildElement("timeoffset");
-            if (!off.isNull()) add.secs = round(off.text().toDouble());
+            if (node.has("timeoffset")) add.secs = round(node.text("timeoffset").toDouble());
             else add.secs = 0.0;
             // hr
-            QDomElement hr = node.firstChildElement("hr");
-            if (!hr.isNull()) add.hr = hr.text().toDouble();
+            if (node.has("hr")) add.hr = node.text("hr").toDouble();
             else add.hr = 0.0;
             // spd in meters per second converted to kph
-            QDomElement spd = node.firstChildElement("spd");
-            if (!spd.isNull()) add.kph = spd.text().toDouble() * 3.6;
+            if (node.has("spd")) add.kph = node.text("spd").toDouble() * 3.6;
             else add.kph = 0.0;
             // pwr
-            QDomElement pwr = node.firstChildElement("pwr");
-            if (!pwr.isNull()) {
-                add.watts = pwr.text().toDouble();
+            if (node.has("pwr")) {
+                add.watts = node.text("pwr").toDouble();
                 // NOTE! undo the fudge to set zero values to
                 //       1 in the writer (below). This is to keep
                 //       the TP upload web-service happy with zero values
                 if (add.watts == 1) add.watts = 0.0;
             } else add.watts = 0.0;
             // lrbalance (pwrright)
-            QDomElement lrbalance = node.firstChildElement("pwrright");
-            if (!lrbalance.isNull()) {
+            if (node.has("pwrright")) {
                 if (add.watts == 0) {
                    add.lrbalance = 50.0;
                 } else {
-                    add.lrbalance =(add.watts-lrbalance.text().toDouble())/add.watts*100.0;
+                    add.lrbalance =(add.watts-node.text("pwrright").toDouble())/add.watts*100.0;
                 }
             } else add.lrbalance = RideFile::NA;
             // torq
-            QDomElement torq = node.firstChildElement("torq");
-            if (!torq.isNull()) add.nm = torq.text().toDouble();
+            if (node.has("torq")) add.nm = node.text("torq").toDouble();
             else add.nm = 0.0;
             // cad
-            QDomElement cad = node.firstChildElement("cad");
-            if (!cad.isNull()) add.cad = cad.text().toDouble();
+            if (node.has("cad")) add.cad = node.text("cad").toDouble();
             else add.cad = 0.0;
             // dist
-            QDomElement dist = node.firstChildElement("dist");
-            if (!dist.isNull()) add.km = dist.text().toDouble() /1000;
+            if (node.has("dist")) add.km = node.text("dist").toDouble() /1000;
             else add.km = 0.0;
 
             // lat
-            QDomElement lat = node.firstChildElement("lat");
-            if (!lat.isNull()) add.lat = lat.text().toDouble();
+            if (node.has("lat")) add.lat = node.text("lat").toDouble();
             else add.lat = 0.0;
             // lon
-            QDomElement lon = node.firstChildElement("lon");
-            if (!lon.isNull()) add.lon = lon.text().toDouble();
+            if (node.has("lon")) add.lon = node.text("lon").toDouble();
             else add.lon = 0.0;
             // alt
-            QDomElement alt = node.firstChildElement("alt");
-            if (!alt.isNull()) add.alt = alt.text().toDouble();
+            if (node.has("alt")) add.alt = node.text("alt").toDouble();
             else add.alt = 0.0;
             // temp
-            QDomElement temp = node.firstChildElement("temp");
-            if (!temp.isNull()) add.temp = temp.text().toDouble();
+            if (node.has("temp")) add.temp = node.text("temp").toDouble();
             else add.temp = RideFile::NA;
 
             // torque_effectiveness_left
-            QDomElement lte = node.firstChildElement("torque_effectiveness_left");
-            if (!lte.isNull()) add.lte = lte.text().toDouble();
+            if (node.has("torque_effectiveness_left")) add.lte = node.text("torque_effectiveness_left").toDouble();
             else add.lte = 0.0;
             // torque_effectiveness_right
-            QDomElement rte = node.firstChildElement("torque_effectiveness_right");
-            if (!rte.isNull()) add.rte = rte.text().toDouble();
+            if (node.has("torque_effectiveness_right")) add.rte = node.text("torque_effectiveness_right").toDouble();
             else add.rte = 0.0;
             // pedal_smoothness_left
-            QDomElement lps = node.firstChildElement("pedal_smoothness_left");
-            if (!lps.isNull()) add.lps = lps.text().toDouble();
+            if (node.has("pedal_smoothness_left")) add.lps = node.text("pedal_smoothness_left").toDouble();
             else add.lps = 0.0;
             // pedal_smoothness_right
-            QDomElement rps = node.firstChildElement("pedal_smoothness_right");
-            if (!rps.isNull()) add.rps = rps.text().toDouble();
+            if (node.has("pedal_smoothness_right")) add.rps = node.text("pedal_smoothness_right").toDouble();
             else add.rps = 0.0;
 
             // if there are data points && a time difference > 1sec && smartRecording processing is requested at all
@@ -425,7 +468,7 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
                     add.interval);
             }
         
-        } else if (node.nodeName() == "summarydata") {
+        } else if (node.name == "summarydata") {
 
             // get the summary data in case there are no samples
             // this is when there is a manual entry, so we can
@@ -443,42 +486,42 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
             //</summarydata>
 
             // duration
-            QDomElement off = node.firstChildElement("duration");
-            if (!off.isNull()) manualDuration = off.text().toDouble();
+            if (node.has("duration")) manualDuration = node.text("duration").toDouble();
 
             // work
-            off = node.firstChildElement("work");
-            if (!off.isNull()) manualWork = off.text().toDouble();
+            if (node.has("work")) manualWork = node.text("work").toDouble();
 
             // tss
-            off = node.firstChildElement("tss");
-            if (!off.isNull()) manualTSS = off.text().toDouble();
+            if (node.has("tss")) manualTSS = node.text("tss").toDouble();
 
             // hr
-            off = node.firstChildElement("hr");
-            if (!off.isNull()) manualHR = off.text().toDouble();
+            if (node.has("hr")) manualHR = node.text("hr").toDouble();
 
             // speed
-            off = node.firstChildElement("spd");
-            if (!off.isNull()) manualSpeed = off.text().toDouble();
+            if (node.has("spd")) manualSpeed = node.text("spd").toDouble();
 
             // power
-            off = node.firstChildElement("pwr");
-            if (!off.isNull()) manualPower = off.text().toDouble();
+            if (node.has("pwr")) manualPower = node.text("pwr").toDouble();
 
             // distance
-            off = node.firstChildElement("dist");
-            if (!off.isNull()) manualKM = off.text().toDouble();
+            if (node.has("dist")) manualKM = node.text("dist").toDouble();
 
             // Elevation
-            off = node.firstChildElement("climbingelevation");
-            if (!off.isNull()) manualElevation = off.text().toDouble();
+            if (node.has("climbingelevation")) manualElevation = node.text("climbingelevation").toDouble();
 
 
-        } else if (node.nodeName() == "extension") {
+        } else if (node.name == "extension") {
         }
 
-        node = node.nextSibling();
+    }
+
+    // we still need to check the rest of the document is well formed
+    while (!xml.atEnd()) xml.readNext();
+    if (xml.hasError()) {
+        errors << "Could not parse file.";
+        delete swimXdata;
+        delete rideFile;
+        return NULL;
     }
 
     // post-process and check
@@ -599,6 +642,26 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
 
 bool
 PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
+{
+    if (!file.open(QIODevice::WriteOnly)) return(false);
+    file.resize(0);
+
+    // unified codepage and BOM for identification on all platforms
+    file.write("\xEF\xBB\xBF");
+    bool success = writeRideData(context, ride, file);
+    file.close();
+    return(success);
+}
+
+bool
+PwxFileReader::writeRideData(Context *context, const RideFile *ride, QIODevice &out) const
+{
+    QByteArray xml = toByteArray(context, ride);
+    return out.write(xml) == xml.size();
+}
+
+QByteArray
+PwxFileReader::toByteArray(Context *context, const RideFile *ride) const
 {
     QDomText text; // used all over
     QDomDocument doc;
@@ -981,14 +1044,5 @@ PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file
         }
     }
 
-    QByteArray xml = doc.toByteArray(4);
-    if (!file.open(QIODevice::WriteOnly)) return(false);
-    file.resize(0);
-    QTextStream out(&file);
-    out.setCodec("UTF-8");
-    out.setGenerateByteOrderMark(true);
-    out << xml;
-    out.flush();
-    file.close();
-    return(true);
+    return doc.toByteArray(4);
 }
@@ -22,12 +22,14 @@
 
 #include "RideFile.h"
 #include "Context.h"
-#include <QDomDocument>
+#include <QXmlStreamReader>
 
 struct PwxFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
     bool writeRideFile(Context *, const RideFile *ride, QFile &file) const;
-    virtual RideFile *PwxFromDomDoc(QDomDocument doc, QStringList &errors) const;
+    bool writeRideData(Context *context, const RideFile *ride, QIODevice &out) const;
+    QByteArray toByteArray(Context *context, const RideFile *ride) const;
+    virtual RideFile *PwxFromStream(QXmlStreamReader &xml, QStringList &errors) const;
     bool hasWrite() const { return true; }
 };
 
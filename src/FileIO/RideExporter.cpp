@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideExporter.h"
+
+#include "RideFile.h"
+#include "CsvRideFile.h"
+
+#include <QFile>
+#include <QBuffer>
+#include <QThread>
+#include <QRunnable>
+
+// the runnable placed on the pool just calls back into the exporter
+class RideExporterJob : public QRunnable
+{
+    public:
+        RideExporterJob(RideExporter *exporter, int index) : exporter(exporter), index(index) {}
+        void run() { exporter->run(index); }
+
+    private:
+        RideExporter *exporter;
+        int index;
+};
+
+// read and write helpers, these are reentrant
+static RideFile *
+readRide(Context *context, QString source, QStringList &errors)
+{
+    QFile in(source);
+    if (!in.exists()) {
+        errors << QString("%1 does not exist").arg(source);
+        return NULL;
+    }
+    return RideFileFactory::instance().openRideFile(context, in, errors);
+}
+
+static bool
+writeRide(Context *context, const RideFile *ride, QString target, QString format)
+{
+    QFile out(target);
+    if (format == "gccsv") {
+        CsvFileReader writer;
+        return writer.writeRideFile(context, ride, out, CsvFileReader::gc);
+    }
+    return RideFileFactory::instance().writeRideFile(context, ride, out, format);
+}
+
+// straight into memory, no byte order mark
+static bool
+writeRideData(Context *context, const RideFile *ride, QString format, QByteArray &data)
+{
+    QBuffer buffer(&data);
+    if (!buffer.open(QIODevice::WriteOnly)) return false;
+
+    if (format == "gccsv") {
+        CsvFileReader writer;
+        return writer.writeRideData(context, ride, buffer, CsvFileReader::gc);
+    }
+    return RideFileFactory::instance().writeRideData(context, ride, buffer, format);
+}
+
+RideExporter::RideExporter(Context *context, QString format, int threads, QObject *parent) :
+    QObject(parent), context(context), format(format), overwrite(false), aborted(false),
+    next(0), taken(0), done(0), exports_(0), fails_(0)
+{
+    if (threads <= 0) threads = QThread::idealThreadCount();
+    if (threads <= 0) threads = 1;
+    pool.setMaxThreadCount(threads);
+}
+
+RideExporter::~RideExporter()
+{
+    // stop queueing but don't signal, whoever was listening
+    // may well be being destroyed too (we are their child)
+    mutex.lock();
+    aborted = true;
+    while (next < jobs.count()) {
+        jobs[next].status = Aborted;
+        next++;
+        done++;
+    }
+    changed.wakeAll();
+    mutex.unlock();
+
+    pool.waitForDone();
+}
+
+int
+RideExporter::addFile(QString source, QString target)
+{
+    job add;
+    add.source = source;
+    add.target = target;
+    add.status = Pending;
+
+    QMutexLocker locker(&mutex);
+    jobs << add;
+    return jobs.count()-1;
+}
+
+void
+RideExporter::start()
+{
+    mutex.lock();
+    queueMore();
+    bool empty = (done == jobs.count());
+    mutex.unlock();
+
+    if (empty) emit finished();
+}
+
+// called with the mutex held
+void
+RideExporter::queueMore()
+{
+    // in memory exports are only queued a little ahead of the consumer
+    int window = 2 * pool.maxThreadCount();
+
+    while (!aborted && next < jobs.count() && (jobs[next].target != "" || next - taken < window)) {
+        jobs[next].status = Queued;
+        pool.start(new RideExporterJob(this, next));
+        next++;
+    }
+}
+
+void
+RideExporter::abort()
+{
+    QList<int> skipped;
+
+    mutex.lock();
+    aborted = true;
+    while (next < jobs.count()) {
+        jobs[next].status = Aborted;
+        skipped << next;
+        next++;
+        done++;
+    }
+    bool complete = skipped.count() && done == jobs.count();
+    changed.wakeAll();
+    mutex.unlock();
+
+    foreach(int index, skipped) emit progress(index, Aborted);
+    if (complete) emit finished();
+}
+
+void
+RideExporter::wait()
+{
+    QMutexLocker locker(&mutex);
+    while (done < jobs.count()) changed.wait(&mutex);
+}
+
+bool
+RideExporter::isAborted() const
+{
+    QMutexLocker locker(&mutex);
+    return aborted;
+}
+
+RideExporter::Status
+RideExporter::status(int index) const
+{
+    QMutexLocker locker(&mutex);
+    return jobs[index].status;
+}
+
+RideExporter::Status
+RideExporter::take(int index, QByteArray &data, QStringList &errors)
+{
+    QMutexLocker locker(&mutex);
+
+    while (jobs[index].status < Exported) changed.wait(&mutex);
+
+    // hand over and release
+    data = jobs[index].data;
+    errors = jobs[index].errors;
+    jobs[index].data.clear();
+
+    // let the pool move on
+    if (index >= taken) taken = index+1;
+    queueMore();
+
+    return jobs[index].status;
+}
+
+void
+RideExporter::setStatus(int index, Status status)
+{
+    bool complete = false;
+
+    mutex.lock();
+    jobs[index].status = status;
+    if (status >= Exported) {
+        if (status == Exported) exports_++;
+        else if (status != Aborted) fails_++;
+        done++;
+        complete = (done == jobs.count());
+        changed.wakeAll();
+    }
+    mutex.unlock();
+
+    emit progress(index, status);
+    if (complete) emit finished();
+}
+
+void
+RideExporter::run(int index)
+{
+    // get a copy of what we need, the jobs vector is not resized once started
+    mutex.lock();
+    QString source = jobs[index].source;
+    QString target = jobs[index].target;
+    bool stop = aborted;
+    mutex.unlock();
+
+    if (stop) {
+        setStatus(index, Aborted);
+        return;
+    }
+
+    // don't overwrite unless asked to
+    if (target != "" && QFile(target).exists()) {
+        if (overwrite == false) {
+            setStatus(index, Exists);
+            return;
+        }
+        QFile(target).remove();
+    }
+
+    setStatus(index, Reading);
+    QStringList errors;
+    RideFile *ride = readRide(context, source, errors);
+    if (!ride) {
+        mutex.lock();
+        jobs[index].errors = errors;
+        mutex.unlock();
+        setStatus(index, ReadError);
+        return;
+    }
+
+    setStatus(index, Writing);
+    QByteArray data;
+    bool success = (target != "") ? writeRide(context, ride, target, format)
+                                  : writeRideData(context, ride, format, data);
+    delete ride; // free memory!
+
+    mutex.lock();
+    jobs[index].data = data;
+    jobs[index].errors = errors;
+    mutex.unlock();
+
+    setStatus(index, success ? Exported : WriteError);
+}
+
+bool
+RideExporter::exportRide(Context *context, QString source, QString format, QByteArray &out, QStringList &errors)
+{
+    RideFile *ride = readRide(context, source, errors);
+    if (!ride) return false;
+
+    bool success = writeRideData(context, ride, format, out);
+    delete ride;
+    return success;
+}
+
+bool
+RideExporter::exportRide(Context *context, QString source, QString target, QString format, QStringList &errors)
+{
+    RideFile *ride = readRide(context, source, errors);
+    if (!ride) return false;
+
+    bool success = writeRide(context, ride, target, format);
+    delete ride;
+    return success;
+}
+
+QString
+RideExporter::statusText(Status status)
+{
+    switch (status) {
+    case Pending: return tr("Export");
+    case Queued: return tr("Queued");
+    case Reading: return tr("Reading...");
+    case Writing: return tr("Writing...");
+    case Exported: return tr("Exported");
+    case Exists: return tr("Exists - not exported");
+    case ReadError: return tr("Read error");
+    case WriteError: return tr("Write failed");
+    case Aborted: return tr("Aborted");
+    }
+    return "";
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideExporter_h
+#define _GC_RideExporter_h 1
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+
+class Context;
+
+//
+// Export a batch of activities to another file format using a pool of worker
+// threads. Each job reads the source file and writes it in the requested format
+// either to a target file or, when no target is given, into memory so callers
+// (like the API web service) can stream the results as they complete.
+//
+// The exporter does not need a GUI or an event loop; progress is reported via
+// signals for the BatchExportDialog, whilst headless callers can use take() to
+// consume results in order. Only a window of jobs ahead of the consumer are
+// queued onto the pool so memory use is bounded for in-memory exports.
+//
+class RideExporter : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        enum status { Pending=0, Queued, Reading, Writing, Exported, Exists, ReadError, WriteError, Aborted };
+        typedef enum status Status;
+
+        // format is a RideFileFactory write suffix or "gccsv" for the full GC csv,
+        // "csv" is the registered PowerTap writer
+        // threads of 0 means use the ideal thread count for this machine
+        RideExporter(Context *context, QString format, int threads=0, QObject *parent=NULL);
+        ~RideExporter();
+
+        // add work -- an empty target means export into memory
+        int addFile(QString source, QString target=QString());
+        int count() const { return jobs.count(); }
+
+        // overwrite existing targets, default is to skip them
+        void setOverwrite(bool x) { overwrite = x; }
+
+        // kick off, returns immediately, signals as we go
+        void start();
+
+        // stop queueing, jobs in progress will complete
+        void abort();
+        bool isAborted() const;
+
+        // block until all jobs are done
+        void wait();
+
+        // block until job is done and return its result (in memory exports
+        // the data is released once taken so the pool can move on)
+        Status take(int index, QByteArray &data, QStringList &errors);
+
+        // results
+        Status status(int index) const;
+        QString source(int index) const { return jobs[index].source; }
+        int exports() const { return exports_; }
+        int fails() const { return fails_; }
+        int threads() const { return pool.maxThreadCount(); }
+
+        // export a single activity, safe to call from any thread
+        static bool exportRide(Context *context, QString source, QString format, QByteArray &out, QStringList &errors);
+        static bool exportRide(Context *context, QString source, QString target, QString format, QStringList &errors);
+
+        // the status as a translated string for display
+        static QString statusText(Status);
+
+    signals:
+
+        // emitted from worker threads so connections will be queued
+        void progress(int index, int status);
+        void finished();
+
+    protected:
+
+        friend class RideExporterJob;
+
+        // a worker thread runs a job
+        void run(int index);
+
+    private:
+
+        struct job {
+            QString source, target;
+            Status status;
+            QByteArray data;
+            QStringList errors;
+        };
+
+        void setStatus(int index, Status status);
+        void queueMore(); // called with mutex held
+
+        Context *context;
+        QString format;
+        bool overwrite;
+        bool aborted;
+
+        QVector<job> jobs;
+        int next, taken, done;
+        int exports_, fails_;
+
+        QThreadPool pool;
+        mutable QMutex mutex;
+        QWaitCondition changed;
+};
+
+#endif // _GC_RideExporter_h
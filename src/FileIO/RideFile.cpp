@@ -21,6 +21,7 @@
 #include "RideFile.h"
 #include "FilterHRV.h"
 #include "WPrime.h"
+#include "PowerSums.h"
 #include "Athlete.h"
 #include "DataProcessor.h"
 #include "RideEditor.h"
@@ -30,6 +31,7 @@
 #include "Units.h"
 
 #include <QtXml/QtXml>
+#include <QTemporaryFile>
 #include <algorithm> // for std::lower_bound
 #include <assert.h>
 #ifdef Q_CC_MSVC
@@ -63,8 +65,8 @@
 const QChar deltaChar(0x0394);
 
 RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
-            wstale(true), startTime_(startTime), recIntSecs_(recIntSecs),
-            deviceType_("unknown"), data(NULL), wprime_(NULL), 
+            wstale(true), sstale(true), startTime_(startTime), recIntSecs_(recIntSecs),
+            deviceType_("unknown"), data(NULL), wprime_(NULL), sums_(NULL),
             weight_(0), totalCount(0), totalTemp(0), dstale(true)
 {
     command = new RideFileCommand(this);
@@ -79,7 +81,7 @@ RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
 // when constructing a temporary ridefile when computing intervals
 // and we want to get special fields and ESPECIALLY "CP" and "Weight"
 RideFile::RideFile(RideFile *p) :
-    wstale(true), recIntSecs_(p->recIntSecs_), deviceType_(p->deviceType_), data(NULL), wprime_(NULL), 
+    wstale(true), sstale(true), recIntSecs_(p->recIntSecs_), deviceType_(p->deviceType_), data(NULL), wprime_(NULL), sums_(NULL),
     weight_(p->weight_), totalCount(0), dstale(true)
 {
     startTime_ = p->startTime_;
@@ -100,7 +102,7 @@ RideFile::RideFile(RideFile *p) :
 }
 
 RideFile::RideFile() : 
-    wstale(true), recIntSecs_(0.0), deviceType_("unknown"), data(NULL), wprime_(NULL), 
+    wstale(true), sstale(true), recIntSecs_(0.0), deviceType_("unknown"), data(NULL), wprime_(NULL), sums_(NULL),
     weight_(0), totalCount(0), dstale(true)
 {
     command = new RideFileCommand(this);
@@ -122,6 +124,7 @@ RideFile::~RideFile()
         //delete interval;
     delete command;
     if (wprime_) delete wprime_;
+    if (sums_) delete sums_;
 
     // delete any Xdata
     QMapIterator<QString,XDataSeries*> it(xdata_);
@@ -208,6 +211,20 @@ RideFile::wprimeData()
     return wprime_;
 }
 
+PowerSums *
+RideFile::powerSums()
+{
+    // the metrics for all the intervals in a ride are computed in
+    // parallel, the first one in builds it and the others wait
+    QMutexLocker locker(&sumsLock);
+    if (sums_ == NULL || sstale || sums_->samples() != dataPoints_.count() || sums_->recIntSecs() != recIntSecs_) {
+        if (!sums_) sums_ = new PowerSums();
+        sums_->setRide(this);
+        sstale = false;
+    }
+    return sums_;
+}
+
 bool
 RideFile::isRun() const
 {
@@ -710,6 +727,37 @@ RideFileFactory::writeRideFile(Context *context, const RideFile *ride, QFile &fi
     else return reader->writeRideFile(context, ride, file);
 }
 
+bool
+RideFileFactory::writeRideData(Context *context, const RideFile *ride, QIODevice &out, QString format) const
+{
+    RideFileReader *reader = readFuncs_.value(format.toLower());
+
+    if (!reader || !reader->hasWrite()) return false;
+    else return reader->writeRideData(context, ride, out);
+}
+
+bool
+RideFileReader::writeRideData(Context *context, const RideFile *ride, QIODevice &out) const
+{
+    // write to a file and copy it across
+    QTemporaryFile tempfile; // deletes file when goes out of scope
+    if (!tempfile.open()) return false;
+    tempfile.close();
+    QFile file(tempfile.fileName());
+    if (!writeRideFile(context, ride, file)) return false;
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    // skip a utf-8 byte order mark, the caller didn't ask for one
+    QByteArray bom = file.peek(3);
+    if (bom == "\xEF\xBB\xBF") file.read(3);
+
+    while (!file.atEnd()) {
+        QByteArray chunk = file.read(64 * 1024);
+        if (chunk.isEmpty() || out.write(chunk) != chunk.size()) return false;
+    }
+    return true;
+}
+
 RideFileReader *RideFileFactory::readerForSuffix(QString suffix) const
 {
     return readFuncs_.value(suffix.toLower());
@@ -2133,7 +2181,7 @@ void
 RideFile::emitSaved()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = sstale = dstale = true;
     emit saved();
 }
 
@@ -2141,7 +2189,7 @@ void
 RideFile::emitReverted()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = sstale = dstale = true;
     emit reverted();
 }
 
@@ -2149,7 +2197,7 @@ void
 RideFile::emitModified()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = sstale = dstale = true;
     emit modified();
 }
 
@@ -26,6 +26,7 @@
 #include <QList>
 #include <QMap>
 #include <QVector>
+#include <QMutex>
 #include <QObject>
 
 class RideItem;
@@ -33,6 +34,7 @@ class RideCache;
 class Specification;
 class IntervalItem;
 class WPrime;
+class PowerSums;
 class RideFile;
 class XDataSeries;
 class XDataPoint;
@@ -349,6 +351,7 @@ class RideFile : public QObject // QObject to emit signals
         double getHeight(); // legacy - moved to Athlete::getHeight
  
         WPrime *wprimeData(); // return wprime, init/refresh if needed
+        PowerSums *powerSums(); // running totals for the power metrics, as above
 
         // XDATA
         XDataSeries *xdata(QString name) { return xdata_.value(name, NULL); }
@@ -404,6 +407,7 @@ class RideFile : public QObject // QObject to emit signals
         void emitModified();
 
         bool wstale;
+        bool sstale; // power sums need recomputing
 
     private:
 
@@ -424,6 +428,8 @@ class RideFile : public QObject // QObject to emit signals
         QMap<QString,QString> tags_;
         EditorData *data;
         WPrime *wprime_;
+        PowerSums *sums_;
+        QMutex sumsLock;
         double weight_; // cached to save calls to getWeight();
         double totalCount, totalTemp;
 
@@ -594,6 +600,11 @@ struct RideFileReader {
     // if hasWrite capability should re-implement writeRideFile and hasWrite
     virtual bool hasWrite() const { return false; }
     virtual bool writeRideFile(Context *, const RideFile *, QFile &) const { return false; }
+
+    // write to a device that is already open, e.g. a buffer or socket, without
+    // any byte order mark. The default goes via a temporary file so writers
+    // should re-implement it when they can write the device directly.
+    virtual bool writeRideData(Context *context, const RideFile *ride, QIODevice &out) const;
 };
 
 class MetricAggregator;
@@ -627,6 +638,7 @@ class RideFileFactory {
                            RideFileReader *reader);
         RideFile *openRideFile(Context *context, QFile &file, QStringList &errors, QList<RideFile*>* = 0) const;
         bool writeRideFile(Context *context, const RideFile *ride, QFile &file, QString format) const;
+        bool writeRideData(Context *context, const RideFile *ride, QIODevice &out, QString format) const;
         QStringList suffixes() const;
         QStringList writeSuffixes() const;
         bool supportedFormat(QString filename) const;
@@ -21,11 +21,13 @@
 #include "Context.h"
 #include "Athlete.h"
 #include "RideCache.h"
+#include "Trace.h"
 #include "Zones.h"
 #include "HrZones.h"
 #include "PaceZones.h"
 #include "WPrime.h" // for wbal zones
 #include "LTMSettings.h" // getAllBestsFor needs this
+#include "PeakTable.h"
 
 #include <cmath> // for pow()
 #include <QDebug>
@@ -852,6 +854,9 @@ RideFileCache::refreshCache()
         // all done now, phew
         cacheFile.close();
 
+        // the peaks we had for this ride are out of date
+        context->athlete->peaks->invalidate(QFileInfo(rideFileName).fileName());
+
         // invalidate any incore cache of aggregate
         // that contains this ride in its date range
         QDate date = ride->startTime().date();
@@ -901,6 +906,8 @@ void RideFileCache::refresh(RideFile *file)
 // with many cores would benefit enormously
 void RideFileCache::RideFileCache::compute()
 {
+    GC_TRACE_DETAIL("RideFileCache::compute", rideFileName);
+
     if (ride == NULL) {
         return;
     }
@@ -2119,15 +2126,17 @@ int RideFileCache::rank(Context *context, RideFile::SeriesType series, int durat
          double value, Specification spec, int &of)
 {
 
-    QList<double> values;
-
+    QStringList files;
     foreach(RideItem*item, context->athlete->rideCache->rides()) {
-        if (!spec.pass(item)) continue;
-
-        // get the best for this one
-        values << RideFileCache::best(context, item->fileName, series, duration);
+        if (spec.pass(item)) files << item->fileName;
     }
 
+    // get the best for all of them
+    QList<double> values;
+    QList<int> durations;
+    durations << duration;
+    foreach(QVector<double> peaks, context->athlete->peaks->bests(files, series, durations)) values << peaks[0];
+
     // sort the list
     qSort(values.begin(), values.end(), qGreater<double>());
 
@@ -2145,38 +2154,56 @@ int RideFileCache::rank(Context *context, RideFile::SeriesType series, int durat
 double 
 RideFileCache::best(Context *context, QString filename, RideFile::SeriesType series, int duration)
 {
+    // called in loops over all rides, so kept resident
+    return context->athlete->peaks->best(filename, series, duration);
+}
+
+QVector<float>
+RideFileCache::readBests(Context *context, QString filename, RideFile::SeriesType series, const QVector<int> &durations)
+{
+    QVector<float> returning(durations.count());
+    returning.fill(0);
+
     // read the header
     QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + filename);
     QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-    QFileInfo cacheFileInfo(cacheFileName);
 
     // head
     RideFileCacheHeader head;
     QFile cacheFile(cacheFileName);
 
-    if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == true) {
+    if (cacheFile.open(QIODevice::ReadOnly) == true) {
         QDataStream inFile(&cacheFile);
         inFile.readRawData((char *) &head, sizeof(head));
 
-        // out of date or not enough samples
-        if (head.version != RideFileCacheVersion || duration > countForMeanMax(head, series)) {
+        // out of date
+        if (head.version != RideFileCacheVersion) {
             cacheFile.close();
-            return 0;
+            return returning;
         }
 
-        // jump to correct offset
-        long offset = offsetForMeanMax(head, series) + (sizeof(float) * (duration));
-        inFile.skipRawData(offset);
+        // we read up to the longest duration that is in there
+        int count = countForMeanMax(head, series);
+        int longest = -1;
+        foreach(int duration, durations) if (duration >= 0 && duration < count && duration > longest) longest = duration;
 
-        float readhere = 0;
-        inFile.readRawData((char*)&readhere, sizeof(float));
-        cacheFile.close();
+        if (longest >= 0) {
 
-        double divisor = pow(10, decimalsFor(series)); // ? 10 : 1;
-        return readhere / divisor; // will convert to double
+            // jump to the array and read once
+            QVector<float> meanmax(longest+1);
+            inFile.skipRawData(offsetForMeanMax(head, series));
+            inFile.readRawData((char*)meanmax.data(), sizeof(float) * meanmax.count());
+
+            double divisor = pow(10, decimalsFor(series)); // ? 10 : 1;
+            for (int i=0; i<durations.count(); i++) {
+                int duration = durations[i];
+                if (duration >= 0 && duration <= longest) returning[i] = meanmax[duration] / divisor;
+            }
+        }
+        cacheFile.close();
     }
 
-    return 0;
+    return returning;
 }
 
 int 
@@ -191,6 +191,10 @@ class RideFileCache
         static int rank(Context *context, RideFile::SeriesType series, int duration, 
                         double value, Specification spec, int &of);
         static double best(Context *context, QString fileName, RideFile::SeriesType series, int duration);
+
+        // read bests for several durations from the cache file in one go, this
+        // always goes to disk; best() above is answered from the athlete's PeakTable
+        static QVector<float> readBests(Context *context, QString fileName, RideFile::SeriesType series, const QVector<int> &durations);
         static int tiz(Context *context, QString fileName, RideFile::SeriesType series, int zone);
 
         // get all the bests passed and return a list of summary metrics, like the DBAccess
@@ -436,15 +436,19 @@ TcxFileReader::toByteArray(Context *context, const RideFile *ride, bool withAlt,
 bool
 TcxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
 {
-    QByteArray xml = toByteArray(context, ride, true, true, true, true);
-
     if (!file.open(QIODevice::WriteOnly)) return(false);
     file.resize(0);
-    QTextStream out(&file);
-    out.setCodec("UTF-8");
-    out.setGenerateByteOrderMark(true);
-    out << xml;
-    out.flush();
+
+    // unified codepage and BOM for identification on all platforms
+    file.write("\xEF\xBB\xBF");
+    bool success = writeRideData(context, ride, file);
     file.close();
-    return(true);
+    return(success);
+}
+
+bool
+TcxFileReader::writeRideData(Context *context, const RideFile *ride, QIODevice &out) const
+{
+    QByteArray xml = toByteArray(context, ride, true, true, true, true);
+    return out.write(xml) == xml.size();
 }
@@ -19,6 +19,10 @@
 #include "AboutDialog.h"
 #include "GcUpgrade.h"
 #include "GcCrashDialog.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideFileLRU.h"
 
 AboutDialog::AboutDialog(Context *context) : context(context)
 {
@@ -107,6 +111,19 @@ VersionPage::VersionPage(Context *context) : context(context)
     mainLayout->setContentsMargins(0,0,0,0);
     mainLayout->addWidget(text);
 
+    // how much memory are open activities using
+    if (context && context->athlete && context->athlete->rideCache) {
+        RideFileLRU::Stats stats = context->athlete->rideCache->lru()->stats();
+        QLabel *memory = new QLabel(this);
+        memory->setContentsMargins(0,0,0,0);
+        memory->setText(QString("<center>%1</center>")
+                        .arg(tr("Open activities: %1 (%2 in use) using %3 MB of %4 MB, %5 loaded, %6 closed to save memory")
+                        .arg(stats.open).arg(stats.pinned)
+                        .arg(stats.bytes / (1024*1024)).arg(stats.budget / (1024*1024))
+                        .arg(stats.loads).arg(stats.evictions)));
+        mainLayout->addWidget(memory);
+    }
+
     setLayout(mainLayout);
 }
 
@@ -26,7 +26,9 @@
 #include "HelpWhatsThis.h"
 #include "CsvRideFile.h"
 
-BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWindow), context(context)
+#include <QThread>
+
+BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWindow), context(context), exporter(NULL)
 {
     setAttribute(Qt::WA_DeleteOnClose);
     //setWindowFlags(windowFlags() | Qt::WindowStaysOnTopHint); // must stop using this flag!
@@ -105,6 +107,13 @@ BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWi
     if (!QDir(dirDefault).exists()) dirDefault = QDir::home().absolutePath();
 
     dirName = new QLabel(dirDefault, this);
+
+    // how many to read/write in parallel
+    threadsLabel = new QLabel(tr("Parallel exports"), this);
+    threads = new QSpinBox(this);
+    threads->setRange(1, 64);
+    threads->setValue(appsettings->value(this, GC_BE_THREADS, QThread::idealThreadCount() > 0 ? QThread::idealThreadCount() : 1).toInt());
+
     all = new QCheckBox(tr("check/uncheck all"), this);
     all->setChecked(true);
 
@@ -113,7 +122,9 @@ BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWi
     grid->addWidget(dirLabel, 1,0, Qt::AlignLeft);
     grid->addWidget(dirName, 1,1, Qt::AlignLeft);
     grid->addWidget(selectDir, 1,2, Qt::AlignLeft);
-    grid->addWidget(all, 2,0, Qt::AlignLeft);
+    grid->addWidget(threadsLabel, 2,0, Qt::AlignLeft);
+    grid->addWidget(threads, 2,1, Qt::AlignLeft);
+    grid->addWidget(all, 3,0, Qt::AlignLeft);
     grid->setColumnStretch(0, 1);
     grid->setColumnStretch(1, 10);
 
@@ -176,23 +187,35 @@ BatchExportDialog::okClicked()
         aborted = false;
 
         overwrite->hide();
+        threads->setEnabled(false);
         status->setText(tr("Exporting..."));
         status->show();
         cancel->hide();
         ok->setText(tr("Abort"));
         appsettings->setValue(GC_BE_LASTDIR, dirName->text());
         appsettings->setValue(GC_BE_LASTFMT, format->currentIndex());
+        appsettings->setValue(GC_BE_THREADS, threads->value());
         exportFiles();
-        status->setText(QString(tr("%1 activities exported, %2 failed or skipped.")).arg(exports).arg(fails));
-        ok->setText(tr("Finish"));
 
     } else if (ok->text() == "Abort" || ok->text() == tr("Abort")) {
         aborted = true;
+        if (exporter) exporter->abort();
     } else if (ok->text() == "Finish" || ok->text() == tr("Finish")) {
         accept(); // our work is done!
     }
 }
 
+BatchExportDialog::~BatchExportDialog()
+{
+    // closed mid-export, stop listening before the exporter
+    // waits for its workers, our widgets are about to go
+    if (exporter) {
+        exporter->disconnect(this);
+        delete exporter;
+        exporter = NULL;
+    }
+}
+
 void
 BatchExportDialog::cancelClicked()
 {
@@ -202,82 +225,54 @@ BatchExportDialog::cancelClicked()
 void
 BatchExportDialog::exportFiles()
 {
-    // what format to export as?
-    QString type = format->currentIndex() > 0 ? RideFileFactory::instance().writeSuffixes().at(format->currentIndex()-1) : "csv";
-
-    // loop through the table and export all selected
+    // what format to export as? the first is the full GC csv
+    QString type = format->currentIndex() > 0 ? RideFileFactory::instance().writeSuffixes().at(format->currentIndex()-1) : "gccsv";
+    QString suffix = type == "gccsv" ? "csv" : type;
+
+    // reads and writes are done on a pool of worker threads
+    // and we get told as each one progresses
+    exporter = new RideExporter(context, type, threads->value(), this);
+    exporter->setOverwrite(overwrite->isChecked());
+    connect(exporter, SIGNAL(progress(int,int)), this, SLOT(exportProgress(int,int)));
+    connect(exporter, SIGNAL(finished()), this, SLOT(exportFinished()));
+
+    // loop through the table and queue all selected
+    exporting.clear();
     for(int i=0; i<files->invisibleRootItem()->childCount(); i++) {
 
-        // give user a chance to abort..
-        QApplication::processEvents();
-
-        // did they?
-        if (aborted == true) return; // user aborted!
-
         QTreeWidgetItem *current = files->invisibleRootItem()->child(i);
 
         // is it selected
         if (static_cast<QCheckBox*>(files->itemWidget(current,0))->isChecked()) {
 
-            files->setCurrentItem(current); QApplication::processEvents();
-
-            QString filename = dirName->text() + "/" + QFileInfo(current->text(1)).baseName() + "." + type;
-
-            if (QFile(filename).exists()) {
-                if (overwrite->isChecked() == false) {
-                    // skip existing files
-                    current->setText(4, tr("Exists - not exported")); QApplication::processEvents();
-                    fails++;
-                    continue;
-
-                } else {
-
-                    // remove existing
-                    QFile(filename).remove();
-                    current->setText(4, tr("Removing...")); QApplication::processEvents();
-                }
-
-            }
-            // this one then
-            current->setText(4, tr("Reading...")); QApplication::processEvents();
+            QString source = context->athlete->home->activities().absolutePath() + "/" + current->text(1);
+            QString target = dirName->text() + "/" + QFileInfo(current->text(1)).baseName() + "." + suffix;
 
-            // open it..
-            QStringList errors;
-            QList<RideFile*> rides;
-            QFile thisfile(QString(context->athlete->home->activities().absolutePath()+"/"+current->text(1)));
-            RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
-
-            // open success?
-            if (ride) {
-
-
-                current->setText(4, tr("Writing...")); QApplication::processEvents();
-                QFile out(filename);
-
-                bool success = false;
-                if (format->currentIndex() > 0)
-                    success = RideFileFactory::instance().writeRideFile(context, ride, out, type);
-                else {
-                    CsvFileReader writer;
-                    success = writer.writeRideFile(context, ride, out, CsvFileReader::gc);
-                }
+            exporter->addFile(source, target);
+            exporting << current;
+            current->setText(4, RideExporter::statusText(RideExporter::Queued));
+        }
+    }
 
-                if (success) {
-                    exports++;
-                    current->setText(4, tr("Exported")); QApplication::processEvents();
-                } else {
-                    fails++;
-                    current->setText(4, tr("Write failed")); QApplication::processEvents();
-                }
+    exporter->start();
+}
 
-                delete ride; // free memory!
+void
+BatchExportDialog::exportProgress(int index, int state)
+{
+    if (index < 0 || index >= exporting.count()) return;
 
-            // open failed
-            } else {
+    QTreeWidgetItem *current = exporting.at(index);
+    current->setText(4, RideExporter::statusText(static_cast<RideExporter::Status>(state)));
+    if (state == RideExporter::Reading) files->setCurrentItem(current);
+}
 
-                current->setText(4, tr("Read error")); QApplication::processEvents();
+void
+BatchExportDialog::exportFinished()
+{
+    exports = exporter->exports();
+    fails = exporter->fails();
 
-            }
-        }
-    }
+    status->setText(QString(tr("%1 activities exported, %2 failed or skipped.")).arg(exports).arg(fails));
+    ok->setText(tr("Finish"));
 }
@@ -26,6 +26,7 @@
 
 #include "RideItem.h"
 #include "RideFile.h"
+#include "RideExporter.h"
 
 #include <QtGui>
 #include <QTreeWidget>
@@ -34,6 +35,7 @@
 #include <QFileDialog>
 #include <QCheckBox>
 #include <QLabel>
+#include <QSpinBox>
 #include <QListIterator>
 #include <QDebug>
 
@@ -48,6 +50,7 @@ class BatchExportDialog : public QDialog
 
 public:
     BatchExportDialog(Context *context);
+    ~BatchExportDialog();
 
     QTreeWidget *files; // choose files to export
 
@@ -60,6 +63,10 @@ private slots:
     void exportFiles();
     void allClicked();
 
+    // background export progress
+    void exportProgress(int, int);
+    void exportFinished();
+
 private:
     Context *context;
     bool aborted;
@@ -72,11 +79,18 @@ private:
     QPushButton *selectDir;
     QLabel *dirLabel, *dirName;
 
+    QLabel *threadsLabel;
+    QSpinBox *threads;
+
     QCheckBox *overwrite;
     QPushButton *cancel, *ok;
 
     int exports, fails;
     QLabel *status;
+
+    // runs the export on a pool of worker threads
+    RideExporter *exporter;
+    QList<QTreeWidgetItem*> exporting; // job index to tree item
 };
 #endif // _BatchExportDialog_h
 
@@ -34,6 +34,11 @@
 
 #include <QCheckBox>
 #include <QFormLayout>
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentMap>
+#endif
 #include <QTextEdit>
 
 
@@ -151,11 +156,175 @@ ComparePane::ComparePane(Context *context, QWidget *parent, CompareMode mode) :
 
     connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
     connect(table->horizontalHeader(), SIGNAL(sectionClicked(int)), this, SLOT(itemsWereSorted()));
+    connect(&watcher, SIGNAL(resultReadyAt(int)), this, SLOT(metricsReady(int)));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(metricsFinished()));
+}
+
+ComparePane::~ComparePane()
+{
+    cancelMetrics();
+}
+
+//
+// Metrics for the compare intervals are computed in the background as they are
+// dropped, and cached by ride, interval and config so dropping them again (or
+// matching a route across a season again) is quick. The table rows are filled
+// in as the results arrive and the charts are told once they're all in.
+//
+QCache<QString, CompareMetrics> ComparePane::cache(250);
+
+// anything that would change the metrics changes the key
+QString
+ComparePane::metricsKey(QString how, RideItem *source, double start, double stop)
+{
+    // being edited, so the crc is out of date
+    if (source == NULL || source->isDirty()) return "";
+
+    return QString("%1|%2|%3|%4|%5|%6|%7|%8|%9")
+           .arg(how)
+           .arg(source->context->athlete->cyclist)
+           .arg(source->fileName)
+           .arg(start).arg(stop)
+           .arg(source->crc).arg(source->metacrc).arg(source->fingerprint)
+           .arg(UserMetricSchemaVersion);
+}
+
+// runs on a worker thread, item is the fake ride item
+// for the interval so not shared with anything else
+static CompareMetrics
+computeCompareMetrics(CompareMetrics work)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    QHash<QString,RideMetricPtr> computed= RideMetric::computeMetrics(work.item, Specification(), factory.allMetrics());
+    work.metrics.fill(0, factory.metricCount());
+    work.counts.fill(0, factory.metricCount());
+    QHashIterator<QString, RideMetricPtr> l(computed);
+    while (l.hasNext()) {
+        l.next();
+        work.metrics[l.value()->index()] = l.value()->value();
+        work.counts[l.value()->index()] = l.value()->count();
+    }
+    for(int j=0; j<factory.metricCount(); j++)
+        if (std::isinf(work.metrics[j]) || std::isnan(work.metrics[j]))
+            work.metrics[j] = 0.00f;
+
+    return work;
+}
+
+void
+ComparePane::computeMetrics(QList<CompareMetrics> work)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    foreach(CompareMetrics m, work) {
+
+        // seen it before
+        CompareMetrics *cached = m.key != "" ? cache.object(m.key) : NULL;
+        if (cached) {
+            m.item->metrics_ = cached->metrics;
+            m.item->count_ = cached->counts;
+            continue;
+        }
+
+        // sized here so the worker only updates values in place
+        // (user metrics read them) whilst the charts may look
+        m.item->metrics_.fill(0, factory.metricCount());
+        m.item->count_.fill(0, factory.metricCount());
+
+        pending.insert(m.item);
+        waiting << m;
+    }
+
+    if (!watcher.isRunning()) startMetrics();
+}
+
+void
+ComparePane::startMetrics()
+{
+    if (waiting.isEmpty()) return;
+
+    watcher.setFuture(QtConcurrent::mapped(waiting, computeCompareMetrics));
+    waiting.clear();
+}
+
+void
+ComparePane::cancelMetrics()
+{
+    waiting.clear();
+    pending.clear();
+    watcher.cancel();
+    watcher.waitForFinished();
+}
+
+void
+ComparePane::metricsReady(int index)
+{
+    CompareMetrics m = watcher.resultAt(index);
+
+    // cleared whilst we were working
+    if (!pending.remove(m.item)) return;
+
+    m.item->metrics_ = m.metrics;
+    m.item->count_ = m.counts;
+    if (m.key != "") {
+        CompareMetrics *keep = new CompareMetrics(m);
+        keep->pin.reset(); // only the values are reused
+        cache.insert(m.key, keep);
+    }
+
+    // fill in the row, the last column is the index into compareIntervals
+    int which = -1;
+    for (int i=0; i<context->compareIntervals.count(); i++)
+        if (context->compareIntervals[i].rideItem == m.item) which = i;
+
+    int last = table->columnCount()-1;
+    for (int row=0; which >= 0 && row<table->rowCount(); row++) {
+        if (table->item(row, last) == NULL || table->item(row, last)->text().toInt() != which) continue;
+
+        for(int i = 0; i < worklist.count(); i++)
+            table->item(row, i + 5)->setText(m.item->getStringForSymbol(worklist[i], context->athlete->useMetricUnits));
+        break;
+    }
+}
+
+void
+ComparePane::metricsFinished()
+{
+    // more dropped whilst we were busy
+    if (!waiting.isEmpty()) {
+        startMetrics();
+        return;
+    }
+
+    // all done, let the charts know
+    if (pending.isEmpty() && mode_ == interval) {
+        table->setVisible(false);
+        table->resizeColumnsToContents();
+        table->setVisible(true);
+        context->notifyCompareIntervalsChanged();
+    }
 }
 
 void
-ComparePane::configChanged(qint32)
+ComparePane::configChanged(qint32 state)
 {
+    // metrics we kept or worked out for the intervals are now wrong,
+    // the date ranges come from the ride cache which refreshes itself
+    if (state & (CONFIG_ZONES | CONFIG_USERMETRICS | CONFIG_UNITS)) {
+
+        cache.clear();
+
+        if (context->compareIntervals.count()) {
+            cancelMetrics();
+
+            QList<CompareMetrics> work;
+            foreach(CompareInterval x, context->compareIntervals)
+                work << CompareMetrics(x.rideItem, "");
+            computeMetrics(work);
+        }
+    }
+
     // via standard style sheet
     table->setStyleSheet(GCColor::stylesheet());
 
@@ -194,7 +363,7 @@ ComparePane::refreshTable()
             << tr("Date")
             << tr("Time");
 
-        QStringList worklist; // metrics to compute
+        worklist.clear(); // metrics to show
         RideMetricFactory &factory = RideMetricFactory::instance();
 
         foreach(QString metric, metricColumns) {
@@ -238,12 +407,6 @@ ComparePane::refreshTable()
         int counter = 0;
         foreach(CompareInterval x, context->compareIntervals) {
 
-            // compute the metrics for this ride
-            RideItem metrics;
-            QHash<QString, RideMetricPtr> computed = RideMetric::computeMetrics(x.rideItem, Specification(), worklist);
-
-            metrics.setFrom(computed);
-
             // First few cols always the same
             // check - color - athlete - date - time
             // now create a row on the compare pane
@@ -279,16 +442,14 @@ ComparePane::refreshTable()
             t->setFlags(t->flags() & (~Qt::ItemIsEditable));
             table->setItem(counter, 4, t);
 
-            // metrics
+            // metrics, filled in later if still being computed
             for(int i = 0; i < worklist.count(); i++) {
 
-                RideMetricPtr m = computed.value(worklist[i]);
-
                 QString strValue;
 
-                if (m) {
+                if (!pending.contains(x.rideItem)) {
                     // get the formated value
-                    strValue = metrics.getStringForSymbol(worklist[i],
+                    strValue = x.rideItem->getStringForSymbol(worklist[i],
                                           context->athlete->useMetricUnits);
                 }
 
@@ -363,7 +524,7 @@ ComparePane::refreshTable()
             << tr("From")
             << tr("To");
 
-        QStringList worklist; // metrics to compute
+        worklist.clear(); // metrics to show
         RideMetricFactory &factory = RideMetricFactory::instance();
 
         foreach(QString metric, metricColumns) {
@@ -548,6 +709,9 @@ ComparePane::clear()
 {
     if (mode_ == interval) { // INTERVALS
 
+        // the rides are about to go
+        cancelMetrics();
+
         // wipe all away
         foreach(CompareInterval ci, context->compareIntervals) {
             delete ci.data;
@@ -664,6 +828,7 @@ ComparePane::dropEvent(QDropEvent *event)
         int count;
 
         QList<CompareInterval> newOnes;
+        QList<CompareMetrics> work;
 
         // lets get the basic data
         stream >> count;
@@ -684,6 +849,7 @@ ComparePane::dropEvent(QDropEvent *event)
 
             stream >> ridep;
             RideItem *rideItem = (RideItem*)ridep;
+            RidePin pin(rideItem);
             RideFile *ride = rideItem->ride();
 
             // index into ridefile
@@ -800,24 +966,13 @@ ComparePane::dropEvent(QDropEvent *event)
             add.rideItem->present = add.data->getTag("Data", "");
             add.rideItem->samples = add.data->dataPoints().count() > 0;
 
-            const RideMetricFactory &factory = RideMetricFactory::instance();
-
-            QHash<QString,RideMetricPtr> computed= RideMetric::computeMetrics(add.rideItem, Specification(), factory.allMetrics());
-            add.rideItem->metrics_.fill(0, factory.metricCount());
-            add.rideItem->count_.fill(0, factory.metricCount());
-            QHashIterator<QString, RideMetricPtr> l(computed);
-            while (l.hasNext()) {
-                l.next();
-                add.rideItem->metrics_[l.value()->index()] = l.value()->value();
-                add.rideItem->count_[l.value()->index()] = l.value()->count();
-            }
-            for(int j=0; j<factory.metricCount(); j++)
-                if (std::isinf(add.rideItem->metrics_[j]) || std::isnan(add.rideItem->metrics_[j]))
-                    add.rideItem->metrics_[j] = 0.00f;
             // end of fake RideItem hack XXX
 
-            // now add but only if not empty
-            if (!add.data->dataPoints().empty()) newOnes << add;
+            // now add but only if not empty, metrics are computed below
+            if (!add.data->dataPoints().empty()) {
+                newOnes << add;
+                work << CompareMetrics(add.rideItem, metricsKey("drop", rideItem, start, stop));
+            }
         }
 
         // if we have nothing being compared yet and are only dropping one and it's a route
@@ -888,6 +1043,7 @@ ComparePane::dropEvent(QDropEvent *event)
                             add.context = context;                  // UPDATE COMPARE INTERVAL
                             add.sourceContext = newOnes[0].sourceContext;      // UPDATE COMPARE INTERVAL
 
+                            RidePin pin(matched->rideItem());
                             RideFile *ride = matched->rideItem()->ride();
 
                             add.name = QString("%1/%2 %3").arg(matched->rideItem()->dateTime.date().day())
@@ -947,19 +1103,6 @@ ComparePane::dropEvent(QDropEvent *event)
                             add.rideItem->present = add.data->getTag("Data", "");
                             add.rideItem->samples = add.data->dataPoints().count() > 0;
 
-                            const RideMetricFactory &factory = RideMetricFactory::instance();
-                            QHash<QString,RideMetricPtr> computed= RideMetric::computeMetrics(add.rideItem, Specification(), factory.allMetrics());
-                            add.rideItem->metrics_.fill(0, factory.metricCount());
-                            add.rideItem->count_.fill(0, factory.metricCount());
-                            QHashIterator<QString, RideMetricPtr> l(computed);
-                            while (l.hasNext()) {
-                                l.next();
-                                add.rideItem->metrics_[l.value()->index()] = l.value()->value();
-                                add.rideItem->count_[l.value()->index()] = l.value()->count();
-                            }
-                            for(int j=0; j<factory.metricCount(); j++)
-                                if (std::isinf(add.rideItem->metrics_[j]) || std::isnan(add.rideItem->metrics_[j]))
-                                    add.rideItem->metrics_[j] = 0.00f;
                             // end of fake RideItem hack XXX
 
                             // just use standard colors and cycle round
@@ -967,8 +1110,11 @@ ComparePane::dropEvent(QDropEvent *event)
                             // just edit them using the button
                             add.color = standardColors.at((newOnes.count()) % standardColors.count());
 
-                            // now add but only if not empty
-                            if (!add.data->dataPoints().empty()) newOnes << add;
+                            // now add but only if not empty, metrics are computed below
+                            if (!add.data->dataPoints().empty()) {
+                                newOnes << add;
+                                work << CompareMetrics(add.rideItem, metricsKey("route", matched->rideItem(), matched->start, matched->stop));
+                            }
                         }
                     }
                 }  
@@ -980,11 +1126,14 @@ ComparePane::dropEvent(QDropEvent *event)
 
             context->compareIntervals.append(newOnes);
 
+            // get the metrics computed, any we've seen before are used straight away
+            computeMetrics(work);
+
             // refresh the table to reflect the new list
             refreshTable();
 
-            // let all the charts know
-            context->notifyCompareIntervalsChanged();
+            // let all the charts know, once the metrics are ready
+            if (pending.isEmpty()) context->notifyCompareIntervalsChanged();
         }
 
     } else { // SEASONS
@@ -25,11 +25,28 @@
 #include <QTableWidget>
 #include <QScrollArea>
 #include <QDialog>
+#include <QCache>
+#include <QSet>
+#include <QFutureWatcher>
 
 #include "GcSideBarItem.h"
 #include "Context.h"
 #include "Athlete.h"
 #include "CompareInterval.h"
+#include "RideFileLRU.h"
+
+// metrics for a compare interval, computed in the background
+class CompareMetrics
+{
+    public:
+        CompareMetrics() : item(NULL) {}
+        CompareMetrics(RideItem *item, QString key) : item(item), pin(item), key(key) {}
+
+        RideItem *item;     // the fake ride item for the interval
+        RidePin pin;        // held whilst the work is in flight
+        QString key;        // for the cache, empty if not to be cached
+        QVector<double> metrics, counts;
+};
 
 class ComparePane : public QWidget
 {
@@ -40,6 +57,7 @@ class ComparePane : public QWidget
         typedef enum mode CompareMode;
 
         ComparePane(Context *context, QWidget *parent, CompareMode mode=interval);
+        ~ComparePane();
 
     protected:
         void dragEnterEvent(QDragEnterEvent*);
@@ -58,6 +76,10 @@ class ComparePane : public QWidget
         void intervalButtonsChanged();
         void daterangeButtonsChanged();
 
+        // background metrics
+        void metricsReady(int);
+        void metricsFinished();
+
     protected:
         void refreshTable();
 
@@ -66,6 +88,18 @@ class ComparePane : public QWidget
         CompareMode mode_; // remember the mode we were created as...
         QTableWidget *table;
         QScrollArea *scrollArea;
+        QStringList worklist; // metric columns
+
+        // background metrics
+        void computeMetrics(QList<CompareMetrics> work);
+        void startMetrics();
+        void cancelMetrics();
+        static QString metricsKey(QString how, RideItem *source, double start, double stop);
+
+        QFutureWatcher<CompareMetrics> watcher;
+        QList<CompareMetrics> waiting;  // to start when the current lot are done
+        QSet<RideItem*> pending;        // not computed yet
+        static QCache<QString, CompareMetrics> cache;
 };
 
 class RouteDropDialog : public QDialog
@@ -24,6 +24,10 @@
 #include "MainWindow.h"
 #include "HelpWhatsThis.h"
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
 // minimum R-squared fit when trying to find offsets to
 // merge ride files. Lower numbers mean happier to take
 // and answer that is less likely to be correct, but then
@@ -117,6 +121,172 @@ MergeActivityWizard::setRide(RideFile **here, RideFile *with)
     }
 }
 
+//
+// Aligning on shared series
+//
+// Both rides have been resampled to the same recording interval, so we look
+// for the offset with the best normalised cross correlation between them.
+// Each of the sums it needs, over just the samples where both rides have data
+// at that offset, is a cross correlation in its own right and they are found
+// for every offset at once with an FFT (see Padfield, "Masked FFT Registration").
+//
+typedef std::complex<double> complexd;
+
+// in place radix 2 FFT, the size must be a power of 2
+static void
+fft(QVector<complexd> &data, bool inverse)
+{
+    int n = data.size();
+    complexd *d = data.data();
+
+    // bit reversed order
+    for (int i=1, j=0; i<n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(d[i], d[j]);
+    }
+
+    // twiddle factors for the last stage, earlier stages use every k'th
+    QVector<complexd> twiddle(n/2);
+    for (int k=0; k<n/2; k++) {
+        double angle = 2.0 * M_PI * k / n;
+        twiddle[k] = complexd(cos(angle), inverse ? sin(angle) : -sin(angle));
+    }
+
+    for (int length=2; length<=n; length <<= 1) {
+        int half = length / 2, stride = n / length;
+        for (int i=0; i<n; i += length) {
+            for (int j=0; j<half; j++) {
+                complexd u = d[i+j];
+                complexd v = d[i+j+half] * twiddle[j * stride];
+                d[i+j] = u + v;
+                d[i+j+half] = u - v;
+            }
+        }
+    }
+
+    if (inverse) for (int i=0; i<n; i++) d[i] /= double(n);
+}
+
+// spectrum of a real signal zero padded to size
+static QVector<complexd>
+spectrum(const QVector<double> &signal, int size)
+{
+    QVector<complexd> returning(size, complexd(0,0));
+    for (int i=0; i<int(signal.size()); i++) returning[i] = complexd(signal[i], 0);
+    fft(returning, false);
+    return returning;
+}
+
+// sum of x[i+d] * y[i] for every offset d, negative d wrap round to the end
+static QVector<double>
+correlation(const QVector<complexd> &x, const QVector<complexd> &y)
+{
+    QVector<complexd> product(x.size());
+    for (int i=0; i<int(x.size()); i++) product[i] = x[i] * std::conj(y[i]);
+    fft(product, true);
+
+    QVector<double> returning(product.size());
+    for (int i=0; i<int(product.size()); i++) returning[i] = product[i].real();
+    return returning;
+}
+
+// the offset of fit against base, within +/- window samples, with the best
+// correlation where both were recorded (mask is 1) and the correlation there
+static double
+alignSeries(const QVector<double> &base, const QVector<double> &baseMask,
+            const QVector<double> &fit, const QVector<double> &fitMask,
+            int window, int &offset)
+{
+    offset = 0;
+
+    // large enough that the correlation doesn't wrap
+    int size = 1;
+    while (size < int(base.size() + fit.size())) size <<= 1;
+
+    QVector<double> base2(base.size()), fit2(fit.size());
+    for (int i=0; i<int(base.size()); i++) base2[i] = base[i] * base[i];
+    for (int i=0; i<int(fit.size()); i++) fit2[i] = fit[i] * fit[i];
+
+    QVector<complexd> B = spectrum(base, size), B2 = spectrum(base2, size), MB = spectrum(baseMask, size);
+    QVector<complexd> F = spectrum(fit, size), F2 = spectrum(fit2, size), MF = spectrum(fitMask, size);
+
+    // all the sums, over the overlap at each offset
+    QVector<double> sumBF = correlation(B, F);
+    QVector<double> sumB = correlation(B, MF);
+    QVector<double> sumF = correlation(MB, F);
+    QVector<double> sumB2 = correlation(B2, MF);
+    QVector<double> sumF2 = correlation(MB, F2);
+    QVector<double> overlap = correlation(MB, MF);
+
+    // at least half of what was recorded must overlap
+    double recorded = 0;
+    for (int i=0; i<int(fitMask.size()); i++) recorded += fitMask[i];
+    double minimum = std::max(10.0, recorded / 2);
+
+    double best = 0;
+    for (int d=-window; d<=window; d++) {
+        int k = d < 0 ? size + d : d;
+
+        double n = floor(overlap[k] + 0.5);
+        if (n < minimum) continue;
+
+        double covariance = sumBF[k] - sumB[k] * sumF[k] / n;
+        double varBase = sumB2[k] - sumB[k] * sumB[k] / n;
+        double varFit = sumF2[k] - sumF[k] * sumF[k] / n;
+
+        // flat, nothing to line up
+        if (varBase <= 1e-9 * sumB2[k] || varFit <= 1e-9 * sumF2[k]) continue;
+
+        double r = covariance / sqrt(varBase * varFit);
+        if (r > best) {
+            best = r;
+            offset = d;
+        }
+    }
+    return best;
+}
+
+// values of a series centred on their mean, with a mask that is 1 where the
+// ride was recorded, or 0 in the gaps that were filled with zeroes when it
+// was resampled (every series is zero)
+static void
+seriesData(RideFile *ride, RideFile::SeriesType series, QVector<double> &values, QVector<double> &mask)
+{
+    QVector<RideFile::SeriesType> present;
+    for (int i=0; i<static_cast<int>(RideFile::none); i++) {
+        RideFile::SeriesType x = static_cast<RideFile::SeriesType>(i);
+        if (x != RideFile::secs && ride->isDataPresent(x)) present << x;
+    }
+
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    values.resize(points.count());
+    mask.resize(points.count());
+
+    double sum = 0;
+    int count = 0;
+    for (int i=0; i<points.count(); i++) {
+        bool recorded = false;
+        foreach(RideFile::SeriesType x, present) {
+            if (points[i]->value(x) != 0) {
+                recorded = true;
+                break;
+            }
+        }
+        values[i] = points[i]->value(series);
+        mask[i] = recorded ? 1 : 0;
+        if (recorded) {
+            sum += values[i];
+            count++;
+        }
+    }
+
+    // centred so the sums don't lose precision
+    double mean = count ? sum / count : 0;
+    for (int i=0; i<points.count(); i++) values[i] = mask[i] ? values[i] - mean : 0;
+}
+
 void 
 MergeActivityWizard::analyse()
 {
@@ -154,10 +324,10 @@ MergeActivityWizard::analyse()
             break;
 
     case 1: // align on shared series
-            // using a shotgun algorithm
+            // using normalised cross correlation
     {
-            // calculate the R2 fit using the current offset
-            // for the first shared series
+            // calculate the fit for every offset at once
+            // for each shared series
             RideFile *base = ride1;
             RideFile *fit = ride2;
 
@@ -183,39 +353,17 @@ MergeActivityWizard::analyse()
                     // for each shared series look for best fit
                     RideFile::SeriesType shared = i.key();
 
-                    double bestR2 = 0.0f;
-                    int bestOffset = 0;
+                    QVector<double> baseValues, baseMask, fitValues, fitMask;
+                    seriesData(base, shared, baseValues, baseMask);
+                    seriesData(fit, shared, fitValues, fitMask);
 
                     // no more than shifting by a third of the ride backwards or forwards
-                    for(int offset=-1 * (base->dataPoints().count()/3); 
-                            offset<base->dataPoints().count()/3; 
-                            offset++) {
-
-                        double SStot=0.0f, SSres=0.0f;
-                        double mean =0.0f;
-                        int count=0;
-
-                        for(int i=0; (i+offset)<base->dataPoints().count(); i++) {
-                            if ((i+offset)>0) {
-                                mean += base->dataPoints()[i+offset]->value(shared);
-                            }
-                            count++;
-                        }
-                        mean /= double(count);
-                
-                        for(int i=0; (i+offset)<base->dataPoints().count() && i<fit->dataPoints().count(); i++) {
-                            if((i+offset)>0) {
-                                SSres += pow(base->dataPoints()[i+offset]->value(shared) - fit->dataPoints()[i]->value(shared), 2);
-                                SStot += pow(base->dataPoints()[i+offset]->value(shared) - mean, 2);
-                            }
-                        }
-
-                        double R2= 1.0f - (SSres/SStot);
-                        if (R2 > bestR2) {
-                            bestR2= R2;
-                            bestOffset=offset;
-                        }
-                    }
+                    int bestOffset = 0;
+                    double r = alignSeries(baseValues, baseMask, fitValues, fitMask,
+                                           base->dataPoints().count()/3, bestOffset);
+
+                    // the R-squared of the best straight line fit between them
+                    double bestR2 = r * r;
 
                     // is this a better fit ?
                     if (bestR2 > bestFit) {
@@ -144,7 +144,7 @@ RideNavigator::RideNavigator(Context *context, bool mainwindow) : GcChartWindow(
     // repaint etc when background refresh is working
     connect(context, SIGNAL(refreshStart()), this, SLOT(backgroundRefresh()));
     connect(context, SIGNAL(refreshEnd()), this, SLOT(backgroundRefresh()));
-    connect(context, SIGNAL(refreshUpdate(QDate)), this, SLOT(backgroundRefresh())); // we might miss 1st one
+    // updates in between arrive from the model as dataChanged, batched up
 
     if (!mainwindow) {
         connect(searchFilterBox, SIGNAL(searchResults(QStringList)), this, SLOT(searchStrings(QStringList)));
@@ -1391,21 +1391,23 @@ RideNavigatorSortProxyModel::RideNavigatorSortProxyModel(QObject *parent) : QSor
 bool RideNavigatorSortProxyModel::lessThan(const QModelIndex &left,
                                            const QModelIndex &right) const
 {
-    QVariant leftData = sourceModel()->data(left);
-    QVariant rightData = sourceModel()->data(right);
-
-    if (leftData.type() == QVariant::DateTime) {
-        return leftData.toDateTime() < rightData.toDateTime();
+    // the ride cache model worked out how each cell sorts
+    // when it formatted it, numbers are doubles, dates are
+    // datetimes and everything else sorts as text
+    QVariant leftKey = sourceModel()->data(left, RideCacheModel::SortRole);
+    QVariant rightKey = sourceModel()->data(right, RideCacheModel::SortRole);
+
+    if (leftKey.type() == QVariant::DateTime) {
+        return leftKey.toDateTime() < rightKey.toDateTime();
     }
-    QString leftString = leftData.toString();
-    QString rightString = rightData.toString();
-
-    if (leftString.contains(QRegExp("[^0-9.,]")) ||
-            rightString.contains(QRegExp("[^0-9.,]"))) { // alpha
-        return QString::localeAwareCompare(leftString, rightString) < 0;
+    if (leftKey.type() == QVariant::Double && rightKey.type() == QVariant::Double) {
+        return leftKey.toDouble() < rightKey.toDouble();
     }
-    // assume numeric
-    return leftString.toDouble() < rightString.toDouble();
+
+    // alpha, as displayed
+    QString leftString = leftKey.type() == QVariant::String ? leftKey.toString() : sourceModel()->data(left).toString();
+    QString rightString = rightKey.type() == QVariant::String ? rightKey.toString() : sourceModel()->data(right).toString();
+    return QString::localeAwareCompare(leftString, rightString) < 0;
 
 }
 
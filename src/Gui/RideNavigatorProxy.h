@@ -38,6 +38,7 @@
 
 #include <QtGui>
 #include "RideNavigator.h"
+#include "RideCacheModel.h"
 #include "RideItem.h"
 #include "RideFile.h"
 
@@ -81,6 +82,10 @@ private:
     QVector<int> sourceRowToGroupRow;
     QList<rankx> rankedRows;
 
+    // the same, by group number, so mapping is a lookup not a search
+    QVector<QVector<int>*> groupRows;
+    QVector<int> sourceRowToGroup;
+
     void clearGroups() {
         // Wipe current
         QMapIterator<QString, QVector<int>*> i(groupToSourceRow);
@@ -93,6 +98,8 @@ private:
         groupToSourceRow.clear();
         sourceRowToGroupRow.clear();
         rankedRows.clear();
+        groupRows.clear();
+        sourceRowToGroup.clear();
     }
 
     static bool initGroupRanges();
@@ -148,7 +155,7 @@ public:
         setIndexes();
 
         connect(model, SIGNAL(modelReset()), this, SLOT(sourceModelChanged()));
-        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SIGNAL(dataChanged(QModelIndex, QModelIndex)));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex, QModelIndex)));
         connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceModelChanged()));
         connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(sourceModelChanged()));
         connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(sourceModelChanged()));
@@ -187,7 +194,7 @@ public:
                 return QModelIndex();
             }
 
-            return sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()),
+            return sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()),
                                         proxyIndex.column()-2, // accommodate virtual columns
                                         QModelIndex());
         }
@@ -197,18 +204,12 @@ public:
     QModelIndex mapFromSource(const QModelIndex &sourceIndex) const {
 
         // which group did we put this row into?
-        QString group = whichGroup(sourceIndex.row());
-        int groupNo = groups.indexOf(group);
+        int row = sourceIndex.row();
+        if (!sourceIndex.isValid() || row >= sourceRowToGroup.size()) return QModelIndex();
 
-        if (groupNo < 0) {
-            return QModelIndex();
-        } else {
-            QModelIndex *p = new QModelIndex(createIndex(groupNo, 0, (void*)NULL));
-            if (sourceIndex.row() > 0 && sourceIndex.row() < sourceRowToGroupRow.size())
-                return createIndex(sourceRowToGroupRow[sourceIndex.row()], sourceIndex.column()+2, &p); // accommodate virtual columns
-            else
-                return QModelIndex();
-        }
+        int groupNo = sourceRowToGroup[row];
+        return createIndex(sourceRowToGroupRow[row], sourceIndex.column()+2, // accommodate virtual columns
+                           (void*)&groupIndexes[groupNo]);
     }
 
     // we override the standard version to make our virtual column zero
@@ -291,7 +292,7 @@ public:
                     // hideous code, sorry
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0) returning="";
-                    else string = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), calendarText)).toString();
+                    else string = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), calendarText)).toString();
                     // get rid of cr, lf and tab chars
                     string.replace("\n", " ");
                     string.replace("\t", " ");
@@ -316,7 +317,7 @@ public:
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         colorstring= GColor(CPLOTMARKER).name();
-                    else colorstring = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), colorColumn)).toString();
+                    else colorstring = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), colorColumn)).toString();
 
                     returning = QColor(colorstring);
                 } else {
@@ -333,7 +334,7 @@ public:
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         filename="";
-                    else filename = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), fileIndex)).toString();
+                    else filename = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), fileIndex)).toString();
 
                     returning = filename;
                 } else {
@@ -350,7 +351,7 @@ public:
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         returning = false;
-                    else isRun = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), isRunIndex)).toBool();
+                    else isRun = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), isRunIndex)).toBool();
 
                     returning = isRun;
                 } else {
@@ -367,7 +368,9 @@ public:
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         date="";
-                    else date = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), dateColumn)).toString();
+                    else if (role == RideCacheModel::SortRole) // sort by the datetime itself
+                        return sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), dateColumn), role);
+                    else date = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), dateColumn)).toString();
 
                     returning = date;//sourceModel()->data(sourceModel()->index(proxyIndex.row(),dateColumn)).toString();
 
@@ -397,11 +400,11 @@ public:
                     QString returnString = QString(tr("%1: %2 (%3 activities)"))
                                            .arg(sourceModel()->headerData(groupBy, Qt::Horizontal).toString())
                                            .arg(group)
-                                           .arg(groupToSourceRow.value(groups[proxyIndex.row()])->count());
+                                           .arg(groupRows[proxyIndex.row()]->count());
                     returning = QVariant(returnString);
                 } else {
                     QString returnString = QString(tr("%1 activities"))
-                                           .arg(groupToSourceRow.value(groups[proxyIndex.row()])->count());
+                                           .arg(groupRows[proxyIndex.row()]->count());
                     returning = QVariant(returnString);
                 }
             }
@@ -443,7 +446,7 @@ public:
         } else if (parent.column() == 0 && parent.internalPointer() == NULL) {
 
             // second level return count of rows for group
-            return groupToSourceRow.value(groups[parent.row()])->count();
+            return groupRows[parent.row()]->count();
 
         } else {
 
@@ -463,7 +466,7 @@ public:
         } else if (index.column() == 0 && index.internalPointer() == NULL) {
 
             // first column - the group bys
-            return (groupToSourceRow.value(groups[index.row()])->count() > 0);
+            return (groupRows[index.row()]->count() > 0);
 
         } else {
 
@@ -571,10 +574,13 @@ public:
 
         // Update list of groups
         int group=0;
+        sourceRowToGroup.resize(sourceRowToGroupRow.count());
         QMapIterator<QString, QVector<int>*> j(groupToSourceRow);
         while (j.hasNext()) {
             j.next();
+            foreach(int row, *j.value()) sourceRowToGroup[row] = group;
             groups << j.key();
+            groupRows << j.value();
             groupIndexes << createIndex(group++,0,(void*)NULL);
         }
 
@@ -605,6 +611,29 @@ public slots:
         // now show em
         rideNavigator->tableView->expandAll();
     }
+
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+
+        // rows that changed together in the source are spread
+        // across the groups, so signal each group's run of rows
+        int top = topLeft.row(), bottom = qMin(bottomRight.row(), sourceRowToGroup.count()-1);
+        if (top < 0 || top > bottom) return;
+
+        QVector<int> from(groups.count(), -1), to(groups.count(), -1);
+        for (int row=top; row <= bottom; row++) {
+            int groupNo = sourceRowToGroup[row];
+            int groupRow = sourceRowToGroupRow[row];
+            if (from[groupNo] < 0 || groupRow < from[groupNo]) from[groupNo] = groupRow;
+            if (groupRow > to[groupNo]) to[groupNo] = groupRow;
+        }
+
+        for (int groupNo=0; groupNo < groups.count(); groupNo++) {
+            if (from[groupNo] < 0) continue;
+            void *parent = (void*)&groupIndexes[groupNo];
+            emit dataChanged(createIndex(from[groupNo], 1, parent), // virtual ride_time column too
+                             createIndex(to[groupNo], bottomRight.column()+2, parent));
+        }
+    }
 };
 
 
@@ -632,7 +661,7 @@ class SearchFilter : public QSortFilterProxyModel
 
 	// make sure changes are propogated upstream
         connect(model, SIGNAL(modelReset()), this, SIGNAL(modelReset()));
-        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SIGNAL(dataChanged(QModelIndex, QModelIndex)));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex, QModelIndex)));
         connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SIGNAL(modelReset()));
         connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SIGNAL(modelReset()));
         connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SIGNAL(modelReset()));
@@ -652,6 +681,31 @@ class SearchFilter : public QSortFilterProxyModel
 
     public slots:
 
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+
+        // pass on as our rows, which are the same unless searching
+        if (searchActive == false) {
+            emit dataChanged(index(topLeft.row(), topLeft.column()), index(bottomRight.row(), bottomRight.column()));
+            return;
+        }
+
+        // the rows we show, in runs
+        int from = -1, last = -1;
+        for (int row=topLeft.row(); row <= bottomRight.row(); row++) {
+
+            QModelIndex here = mapFromSource(model->index(row, topLeft.column()));
+            if (!here.isValid()) continue;
+
+            if (from >= 0 && here.row() == last+1) {
+                last = here.row();
+                continue;
+            }
+            if (from >= 0) emit dataChanged(index(from, topLeft.column()), index(last, bottomRight.column()));
+            from = last = here.row();
+        }
+        if (from >= 0) emit dataChanged(index(from, topLeft.column()), index(last, bottomRight.column()));
+    }
+
     void setStrings(QStringList list) {
         beginResetModel();
         strings = list;
@@ -25,6 +25,7 @@
 #include "LTMOutliers.h"
 #include "Units.h"
 #include "Zones.h"
+#include "PowerSums.h"
 #include "cmath"
 #include <assert.h>
 #include <algorithm>
@@ -1033,17 +1034,12 @@ struct AvgPower : public RideMetric {
             return;
         }
 
-        total = count = 0;
-    
+        // from the ride's running totals
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
+        int samples;
+        item->ride()->powerSums()->average(it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
 
-            if (point->watts >= 0.0) {
-                total += point->watts;
-                ++count;
-            }
-        }
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -23,6 +23,7 @@
 #include "Context.h"
 #include "Athlete.h"
 #include "Zones.h"
+#include "PowerSums.h"
 #include <cmath>
 #include <assert.h>
 #include <QApplication>
@@ -66,37 +67,15 @@ class XPower : public RideMetric {
             return;
         }
 
-        static const double EPSILON = 0.1;
-        static const double NEGLIGIBLE = 0.1;
-
         double secsDelta = item->ride()->recIntSecs();
-        double sampsPerWindow = 25.0 / secsDelta;
-        double attenuation = sampsPerWindow / (sampsPerWindow + secsDelta);
-        double sampleWeight = secsDelta / (sampsPerWindow + secsDelta);
-
-        double lastSecs = 0.0;
-        double weighted = 0.0;
 
         double total = 0.0;
         int count = 0;
 
+        // 25s moving average raised to the 4th power, decaying through
+        // any gaps in recording, from the ride's running totals
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-
-            while ((weighted > NEGLIGIBLE)
-                   && (point->secs > lastSecs + secsDelta + EPSILON)) {
-                weighted *= attenuation;
-                lastSecs += secsDelta;
-                total += pow(weighted, 4.0);
-                count++;
-            }
-            weighted *= attenuation;
-            weighted += sampleWeight * point->watts;
-            lastSecs = point->secs;
-            total += pow(weighted, 4.0);
-            count++;
-        }
+        item->ride()->powerSums()->xpower(it.firstIndex(), it.lastIndex(), total, count);
         xpower = count ? pow(total / count, 0.25) : 0.0;
         secs = count * secsDelta;
 
@@ -24,6 +24,7 @@
 #include "Athlete.h"
 #include "Specification.h"
 #include "Units.h"
+#include "PowerSums.h"
 #include <cmath>
 #include <assert.h>
 #include <QApplication>
@@ -59,38 +60,14 @@ class NP : public RideMetric {
             return;
         }
 
-        int rollingwindowsize = 30 / item->ride()->recIntSecs();
-
         double total = 0;
         int count = 0;
 
-        // no point doing a rolling average if the
-        // sample rate is greater than the rolling average
-        // window!!
-        if (rollingwindowsize > 1) {
-
-            QVector<double> rolling(rollingwindowsize);
-            int index = 0;
-            double sum = 0;
-
-            // loop over the data and convert to a rolling
-            // average for the given windowsize
-            RideFileIterator it(item->ride(), spec);
-            while (it.hasNext()) {
-                struct RideFilePoint *point = it.next();
-
-                sum += point->watts;
-                sum -= rolling[index];
-
-                rolling[index] = point->watts;
-
-                total += pow(sum/rollingwindowsize,4); // raise rolling average to 4th power
-                count ++;
-
-                // move index on/round
-                index = (index >= rollingwindowsize-1) ? 0 : index+1;
-            }
-        }
+        // 30s rolling average raised to the 4th power, from the ride's
+        // running totals; none if the sample rate is greater than the
+        // rolling average window!!
+        RideFileIterator it(item->ride(), spec);
+        item->ride()->powerSums()->np(it.firstIndex(), it.lastIndex(), total, count);
         if (count) {
             np = pow(total / (count), 0.25);
             secs = count * item->ride()->recIntSecs();
@@ -26,6 +26,7 @@
 #include "Specification.h"
 #include "Season.h"
 #include "Context.h"
+#include "Trace.h"
 
 #include <stdio.h>
 #include <cmath>
@@ -106,6 +107,8 @@ void PMCData::refresh()
 {
     if (!isstale) return;
 
+    GC_TRACE("PMCData::refresh");
+
     // we need to reread config if refreshing (it might have changed)
     if (useDefaults) {
 
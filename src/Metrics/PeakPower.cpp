@@ -23,6 +23,7 @@
 #include "Athlete.h"
 #include "Specification.h"
 #include "Zones.h"
+#include "PowerSums.h"
 #include <cmath>
 #include <QApplication>
 
@@ -297,9 +298,10 @@ class PeakPower : public RideMetric {
             return;
         }
 
-        QList<AddIntervalDialog::AddedInterval> results;
-        AddIntervalDialog::findPeaks(item->context, true, item->ride(), spec, RideFile::watts, RideFile::original, secs, 1, results, "", "");
-        if (results.count() > 0 && results.first().avg < 3000) watts = results.first().avg;
+        // best average as AddIntervalDialog::findPeaks, from the ride's running totals
+        double best;
+        RideFileIterator it(item->ride(), spec);
+        if (item->ride()->powerSums()->peak(it.firstIndex(), it.lastIndex(), secs, best) && best < 3000) watts = best;
         else watts = 0.0;
 
         setValue(watts);
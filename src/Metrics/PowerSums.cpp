@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "PowerSums.h"
+#include "RideFile.h"
+
+#include <QMutexLocker>
+#include <cmath>
+
+// samples in each peak block
+static const int BLOCK = 64;
+static const double NONE = -HUGE_VAL;
+
+// moving averages closer than this are the same
+static const double CONVERGED = 1e-9;
+
+// one sample of the xPower moving average, as the XPower metric
+static void
+xpowerStep(const RideFilePoint *point, double secsDelta, double &weighted, double &lastSecs, double &total, int &count)
+{
+    static const double EPSILON = 0.1;
+    static const double NEGLIGIBLE = 0.1;
+
+    double sampsPerWindow = 25.0 / secsDelta;
+    double attenuation = sampsPerWindow / (sampsPerWindow + secsDelta);
+    double sampleWeight = secsDelta / (sampsPerWindow + secsDelta);
+
+    // decay through any gap in the recording
+    while ((weighted > NEGLIGIBLE) && (point->secs > lastSecs + secsDelta + EPSILON)) {
+        weighted *= attenuation;
+        lastSecs += secsDelta;
+        total += pow(weighted, 4.0);
+        count++;
+    }
+    weighted *= attenuation;
+    weighted += sampleWeight * point->watts;
+    lastSecs = point->secs;
+    total += pow(weighted, 4.0);
+    count++;
+}
+
+PowerSums::PowerSums() : ride(NULL), recInt(0), npWindow(0)
+{
+    positive.fill(0, 1);
+}
+
+void
+PowerSums::setRide(RideFile *ride)
+{
+    this->ride = ride;
+    recInt = ride->recIntSecs();
+
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    int n = points.count();
+
+    watts.fill(0, n+1);
+    positive.fill(0, n+1);
+    counted.fill(0, n+1);
+    for (int j=0; j<n; j++) {
+        double w = points[j]->watts;
+        watts[j+1] = watts[j] + w;
+        positive[j+1] = positive[j] + (w >= 0.0 ? w : 0.0);
+        counted[j+1] = counted[j] + (w >= 0.0 ? 1 : 0);
+    }
+
+    // 30s rolling average as NP computes it from the start of the ride
+    npWindow = recInt > 0 ? 30 / recInt : 0;
+    npTotal.fill(0, n+1);
+    if (npWindow > 1) {
+        QVector<double> rolling(npWindow);
+        int index = 0;
+        double sum = 0;
+        for (int j=0; j<n; j++) {
+            sum += points[j]->watts;
+            sum -= rolling[index];
+            rolling[index] = points[j]->watts;
+            npTotal[j+1] = npTotal[j] + pow(sum/npWindow, 4);
+            index = (index >= npWindow-1) ? 0 : index+1;
+        }
+    }
+
+    // and the xPower moving average
+    xpWeighted.fill(0, n);
+    xpTotal.fill(0, n+1);
+    xpCount.fill(0, n+1);
+    if (recInt > 0) {
+        double weighted = 0, lastSecs = 0;
+        for (int j=0; j<n; j++) {
+            double total = 0;
+            int count = 0;
+            xpowerStep(points[j], recInt, weighted, lastSecs, total, count);
+            xpWeighted[j] = weighted;
+            xpTotal[j+1] = xpTotal[j] + total;
+            xpCount[j+1] = xpCount[j] + count;
+        }
+    }
+
+    QMutexLocker locker(&peakLock);
+    peakBlocks.clear();
+}
+
+void
+PowerSums::average(int start, int stop, double &total, int &count) const
+{
+    total = count = 0;
+    if (start < 0 || stop < start || stop >= samples()) return;
+
+    total = positive[stop+1] - positive[start];
+    count = counted[stop+1] - counted[start];
+}
+
+void
+PowerSums::np(int start, int stop, double &total, int &count) const
+{
+    total = count = 0;
+    if (start < 0 || stop < start || stop >= samples() || npWindow <= 1) return;
+
+    // the rolling average starts again at the start of the range, it's
+    // only the same as the ride's once there's a whole window in it
+    int whole = start + npWindow - 1;
+    for (int j=start; j<=stop && j<whole; j++)
+        total += pow((watts[j+1] - watts[start]) / npWindow, 4);
+    if (stop >= whole) total += npTotal[stop+1] - npTotal[whole];
+
+    count = stop - start + 1;
+}
+
+void
+PowerSums::xpower(int start, int stop, double &total, int &count) const
+{
+    total = count = 0;
+    if (start < 0 || stop < start || stop >= samples() || recInt <= 0) return;
+
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+    double weighted = 0, lastSecs = 0;
+    for (int j=start; j<=stop; j++) {
+
+        // caught up with the ride's moving average, the rest is the same
+        if (j > start && fabs(weighted - xpWeighted[j-1]) <= CONVERGED) {
+            total += xpTotal[stop+1] - xpTotal[j];
+            count += xpCount[stop+1] - xpCount[j];
+            return;
+        }
+        xpowerStep(points[j], recInt, weighted, lastSecs, total, count);
+    }
+}
+
+// first sample in a window ending at j, no earlier than from
+int
+PowerSums::windowStart(int from, int j, double duration) const
+{
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+    // same test findPeaks uses to drop samples off the front
+    int lo = from, hi = j;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (points[j]->secs - points[mid]->secs + recInt >= duration + recInt) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool
+PowerSums::windowAverage(int i, int j, double duration, double &avg) const
+{
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+    double secs = points[j]->secs - points[i]->secs + recInt;
+    if (secs < duration) return false;
+
+    avg = (watts[j+1] - watts[i]) * recInt / secs;
+    return true;
+}
+
+bool
+PowerSums::peak(int start, int stop, double duration, double &best)
+{
+    best = 0;
+    int n = samples();
+    if (start < 0 || stop < start || stop >= n || duration <= 0) return false;
+
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+    // ride is shorter than the window size!
+    if (duration > points[n-1]->secs + recInt) return false;
+
+    // best for the windows ending in each block over the whole ride
+    QVector<double> blocks;
+    {
+        QMutexLocker locker(&peakLock);
+        if (!peakBlocks.contains(duration)) {
+            QVector<double> computed((n + BLOCK - 1) / BLOCK, NONE);
+            for (int i=0, j=0; j<n; j++) {
+                while (points[j]->secs - points[i]->secs + recInt >= duration + recInt) i++;
+                double avg;
+                if (windowAverage(i, j, duration, avg) && avg > computed[j/BLOCK]) computed[j/BLOCK] = avg;
+            }
+            peakBlocks.insert(duration, computed);
+        }
+        blocks = peakBlocks.value(duration);
+    }
+
+    bool found = false;
+
+    // windows ending before m would start before the range, so within
+    // it they all start at the start and are only long enough near m
+    int m = start;
+    if (start > 0) {
+        int lo = start, hi = stop + 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (points[mid]->secs - points[start-1]->secs + recInt >= duration + recInt) hi = mid;
+            else lo = mid + 1;
+        }
+        m = lo;
+
+        int lo2 = start, hi2 = m;
+        while (lo2 < hi2) {
+            int mid = (lo2 + hi2) / 2;
+            if (points[mid]->secs - points[start]->secs + recInt >= duration) hi2 = mid;
+            else lo2 = mid + 1;
+        }
+        for (int j=lo2; j<m; j++) {
+            double avg;
+            if (windowAverage(start, j, duration, avg) && (!found || avg > best)) {
+                best = avg;
+                found = true;
+            }
+        }
+    }
+
+    // the rest are the same windows as for the ride, whole
+    // blocks are looked up and the ends worked out
+    for (int j=m; j<=stop;) {
+        int b = j / BLOCK;
+        if (j % BLOCK == 0 && j + BLOCK - 1 <= stop) {
+            if (blocks[b] != NONE && (!found || blocks[b] > best)) {
+                best = blocks[b];
+                found = true;
+            }
+            j += BLOCK;
+        } else {
+            double avg;
+            if (windowAverage(windowStart(start, j, duration), j, duration, avg) && (!found || avg > best)) {
+                best = avg;
+                found = true;
+            }
+            j++;
+        }
+    }
+    return found;
+}
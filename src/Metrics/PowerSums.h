@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_PowerSums_h
+#define _GC_PowerSums_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QMap>
+#include <QMutex>
+
+class RideFile;
+
+//
+// Running totals of power over a ride
+//
+// The metrics are computed for the whole ride and then again for every
+// interval we find in it (peaks, efforts, climbs, W' matches ...) and the
+// power metrics each walked all the samples in the interval to do it. These
+// are worked out once for the ride so each interval can just look them up:
+//
+// Average power is the difference of two prefix sums.
+//
+// NP's 30s rolling average is the same as the ride's once a whole window
+// is inside the interval, so only the first 30s need computing.
+//
+// xPower's moving average starts from zero at the start of the interval and
+// converges on the ride's, once they agree we use the ride's totals.
+//
+// Peak power keeps the best average for each block of samples so only the
+// blocks at either end of the interval need looking at.
+//
+// The results are the same as the metrics' own loops give, bar rounding.
+// Ranges are sample indexes as RideFileIterator firstIndex() and lastIndex().
+//
+class PowerSums
+{
+    public:
+
+        PowerSums();
+
+        // recompute for the ride
+        void setRide(RideFile *ride);
+
+        int samples() const { return positive.count() - 1; }
+        double recIntSecs() const { return recInt; }
+
+        // watts >= 0, as Average Power
+        void average(int start, int stop, double &total, int &count) const;
+
+        // sum of the 4th power of the 30s rolling average, as NP
+        void np(int start, int stop, double &total, int &count) const;
+
+        // sum of the 4th power of the 25s moving average, as xPower
+        void xpower(int start, int stop, double &total, int &count) const;
+
+        // best average for duration secs as AddIntervalDialog::findPeaks,
+        // returns false if the range is too short for one
+        bool peak(int start, int stop, double duration, double &best);
+
+    private:
+
+        RideFile *ride;
+        double recInt;
+
+        QVector<double> watts;          // prefix sums of all watts
+        QVector<double> positive;       // prefix sums of watts >= 0
+        QVector<int> counted;           // and how many there were
+
+        int npWindow;                   // samples in 30s
+        QVector<double> npTotal;        // prefix sums of rolling average^4
+
+        QVector<double> xpWeighted;     // moving average after each sample
+        QVector<double> xpTotal;        // prefix sums of moving average^4
+        QVector<int> xpCount;           // including any filled in for gaps
+
+        // best average for windows ending in each block, by duration
+        // added as they are asked for, by any of the interval threads
+        QMutex peakLock;
+        QMap<double, QVector<double> > peakBlocks;
+
+        int windowStart(int from, int j, double duration) const;
+        bool windowAverage(int i, int j, double duration, double &avg) const;
+};
+
+#endif // _GC_PowerSums_h
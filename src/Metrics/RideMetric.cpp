@@ -22,9 +22,12 @@
 #include "Specification.h"
 #include "UserMetricSettings.h"
 #include "TimeUtils.h"
+#include "Trace.h"
 #include "Zones.h"
 #include "HrZones.h"
 
+#include <QSet>
+
 // DB Schema Version - YOU MUST UPDATE THIS IF THE SCHEMA VERSION CHANGES!!!
 // Schema version will change if a) the default metadata.xml is updated
 //                            or b) new metrics are added / old changed
@@ -171,8 +174,8 @@ RideMetric::userMetricFingerprint(QList<UserMetricSettings> these)
     return qChecksum(fingers.constData(), fingers.size());
 }
 
-QHash<QString,RideMetricPtr>
-RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList &metrics)
+QStringList
+RideMetric::computeOrder(const QStringList &metrics)
 {
     const RideMetricFactory &factory = RideMetricFactory::instance();
 
@@ -191,23 +194,23 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
                 builtin << metric;
         }
 
-    // this is what we've completed as we go
-    QHash<QString,RideMetric*> done;
+    // what's on the builtin list, so we don't have to search it
+    QSet<QString> queued = builtin.toSet();
 
-    // resize the metric array in the interval if needed
-    if (spec.interval() && spec.interval()->metrics().size() < factory.metricCount()) 
-        spec.interval()->metrics().resize(factory.metricCount());
-
-    // resize the metric array in the interval if needed
-    if (!spec.interval() && item->metrics().size() < factory.metricCount())
-        item->metrics().resize(factory.metricCount());
+    // this is what we've completed as we go
+    QSet<QString> done;
+    QStringList order;
 
     // working through the todo list...
     while (!builtin.isEmpty() || !user.isEmpty()) {
 
         // next one to do, builtins first then user defined
-        QString symbol = builtin.isEmpty() ? user.takeFirst() :
-                                             builtin.takeFirst();
+        QString symbol;
+        if (builtin.isEmpty()) symbol = user.takeFirst();
+        else {
+            symbol = builtin.takeFirst();
+            queued.remove(symbol);
+        }
 
         // doesn't exist !
         if (!factory.haveMetric(symbol)) continue;
@@ -221,44 +224,90 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
         foreach (QString dep, deps) {
             if (!done.contains(dep)) {
                 ready = false;
-                if (!builtin.contains(dep))
+                if (!queued.contains(dep)) {
                     builtin.append(dep);
+                    queued.insert(dep);
+                }
             }
         }
 
         // if all our depencies are computed we can do this one
         if (ready) {
 
-            // we clone so we can remain thread safe
-            // do not be tempted to change this (!)
-            RideMetric *m = factory.newMetric(symbol);
-            m->setValue(0.0);
-            m->setCount(0);
-            m->compute(item, spec, done);
-
-            // override the computed value if set by user, but not for intervals
-            if (!spec.interval() && item->ride() && item->ride()->metricOverrides.contains(symbol))
-                m->override(item->ride()->metricOverrides.value(symbol));
-
-            // all computed add to the return list
-            done.insert(symbol, m);
-
-            // put into value array too. user metrics will interrogate
-            // this for symbol values, rather than the metric pointer
-            // this is crucial, even though RideItem and IntervalItem both
-            // update their values directly. But only need to bother if the
-            // user has defined any local metrics.
-            if (user.count()) {
-                if (spec.interval()) spec.interval()->metrics()[m->index()] = m->value();
-                else item->metrics()[m->index()] = m->value();
-            }
+            done.insert(symbol);
+            order << symbol;
 
         } else {
 
             // we need to wait for our dependencies so add
             // to the back of the list 
-            if (!builtin.contains(symbol))
+            if (!queued.contains(symbol)) {
                 builtin.append(symbol);
+                queued.insert(symbol);
+            }
+        }
+    }
+    return order;
+}
+
+QHash<QString,RideMetricPtr>
+RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList &metrics)
+{
+    return computeMetrics(item, spec, metrics, computeOrder(metrics));
+}
+
+QHash<QString,RideMetricPtr>
+RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList &metrics, const QStringList &order)
+{
+    GC_TRACE("RideMetric::computeMetrics");
+
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    // user metrics will interrogate the value array for
+    // symbol values, rather than the metric pointer
+    bool user = false;
+    foreach(QString symbol, order)
+        if (factory.rideMetric(symbol)->isUser()) {
+            user = true;
+            break;
+        }
+
+    // this is what we've completed as we go
+    QHash<QString,RideMetric*> done;
+
+    // resize the metric array in the interval if needed
+    if (spec.interval() && spec.interval()->metrics().size() < factory.metricCount()) 
+        spec.interval()->metrics().resize(factory.metricCount());
+
+    // resize the metric array in the interval if needed
+    if (!spec.interval() && item->metrics().size() < factory.metricCount())
+        item->metrics().resize(factory.metricCount());
+
+    // dependencies always come before the metrics that need them
+    foreach(QString symbol, order) {
+
+        // we clone so we can remain thread safe
+        // do not be tempted to change this (!)
+        RideMetric *m = factory.newMetric(symbol);
+        m->setValue(0.0);
+        m->setCount(0);
+        m->compute(item, spec, done);
+
+        // override the computed value if set by user, but not for intervals
+        if (!spec.interval() && item->ride() && item->ride()->metricOverrides.contains(symbol))
+            m->override(item->ride()->metricOverrides.value(symbol));
+
+        // all computed add to the return list
+        done.insert(symbol, m);
+
+        // put into value array too. user metrics will interrogate
+        // this for symbol values, rather than the metric pointer
+        // this is crucial, even though RideItem and IntervalItem both
+        // update their values directly. But only need to bother if the
+        // user has defined any local metrics.
+        if (user) {
+            if (spec.interval()) spec.interval()->metrics()[m->index()] = m->value();
+            else item->metrics()[m->index()] = m->value();
         }
     }
 
@@ -266,7 +315,7 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
     // which is deleted when reference count 0 and goes out of scope
     QHash<QString,RideMetricPtr> result;
     foreach (QString symbol, metrics) {
-        if (factory.haveMetric(symbol)) {
+        if (factory.haveMetric(symbol) && done.contains(symbol)) {
             result.insert(symbol, QSharedPointer<RideMetric>(done.value(symbol)));
             done.remove(symbol);
         }
@@ -220,6 +220,12 @@ public:
     static QHash<QString,RideMetricPtr>
     computeMetrics(RideItem *item, Specification spec, const QStringList &metrics);
 
+    // the order metrics are computed in, dependencies first. When computing the
+    // same metrics for lots of intervals work it out once and pass it in
+    static QStringList computeOrder(const QStringList &metrics);
+    static QHash<QString,RideMetricPtr>
+    computeMetrics(RideItem *item, Specification spec, const QStringList &metrics, const QStringList &order);
+
     // get the value for metric m from precomputed values stored at p
     static double getForSymbol(QString m, const QHash<QString,RideMetric*> *p);
 
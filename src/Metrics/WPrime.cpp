@@ -466,6 +466,79 @@ WPrime::setWatts(Context *context, QVector<int>&wattsArray, int CP, int WPRIME)
 
     if (minY < -30000) minY = 0; // the data is definitely out of bounds!
                                  // so lets not exacerbate the problem - truncate
+
+    // remember what we computed with for updateWatts
+    this->CP = CP;
+    this->WPRIME = WPRIME;
+    wasIntegral = integral;
+}
+
+void
+WPrime::updateWatts(Context *context, QVector<int>&wattsArray, int CP, int WPRIME, int from)
+{
+    bool integral = (appsettings->value(NULL, GC_WBALFORM, "int").toString() == "int");
+    double tau = appsettings->cvalue(context->athlete->cyclist, GC_WBALTAU, 300).toInt();
+
+    // anything other than samples changing from a point onwards
+    // means starting from scratch
+    if (from <= 0 || from > last || from > wattsArray.count() || integral != wasIntegral ||
+        CP != this->CP || WPRIME != this->WPRIME || (integral && tau != TAU)) {
+        setWatts(context, wattsArray, CP, WPRIME);
+        return;
+    }
+
+    // W' bal at any point only depends upon what went before it
+    // so we just run forward from the first sample that changed
+    last = wattsArray.count();
+
+    if (integral) {
+
+        // output[t] = output[t-1] * e^(-1/tau) + power[t], which is the
+        // same sum WPrimeIntegrator computes, carried on from where the
+        // unchanged samples leave off
+        values.resize(last+1);
+        xvalues.resize(last+1);
+
+        double decay = exp(-1.0f / TAU);
+        double I = WPRIME - values[from-1];
+        for (int t=from; t<=last; t++) {
+            int value = t < last ? wattsArray[t] : 0;
+            I = (I * decay) + (value > CP ? value-CP : 0);
+            values[t] = WPRIME - I;
+            xvalues[t] = t * 1000.00f;
+        }
+
+        // total expenditure above CP
+        EXP = 0;
+        for (int i=0; i<last; i++) if (wattsArray[i] >= CP) EXP += wattsArray[i];
+
+    } else {
+
+        values.resize(last);
+        xvalues.resize(last);
+
+        double W = values[from-1];
+        for (int i=from; i<last; i++) {
+
+            int value = wattsArray[i];
+
+            if(value < CP) {
+                W  = W + (CP-value)*(WPRIME-W)/WPRIME;
+            } else {
+                W  = W + (CP-value);
+            }
+
+            values[i] = W;
+            xvalues[i] = i*1000;
+        }
+    }
+
+    minY = maxY = WPRIME;
+    foreach(double value, values) {
+        if (value > maxY) maxY = value;
+        if (value < minY) minY = value;
+    }
+    if (minY < -30000) minY = 0; // as above
 }
 
 void
@@ -49,6 +49,7 @@ class WPrime {
         void setRide(RideFile *ride);
         void setErg(ErgFile *erg);
         void setWatts(Context *context, QVector<int>&watts, int CP, int WPRIME);
+        void updateWatts(Context *context, QVector<int>&watts, int CP, int WPRIME, int from); // from changed onwards
 
         RideFile *ride() { return rideFile; }
 
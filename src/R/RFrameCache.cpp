@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RFrameCache.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+
+// frames we keep, they can be big so not many
+static const int MAX_FRAMES = 32;
+
+RFrameCache::RFrameCache()
+{
+}
+
+RFrameCache::~RFrameCache()
+{
+    clear();
+}
+
+static QString
+contextKey(Context *context, QString key)
+{
+    return QString("%1|%2").arg(quintptr(context)).arg(key);
+}
+
+bool
+RFrameCache::lookup(Context *context, QString key, QList<SEXP> &returning)
+{
+    watch(context);
+
+    QString k = contextKey(context, key);
+    QHash<QString, QList<SEXP> >::const_iterator it = frames.constFind(k);
+    if (it == frames.constEnd()) return false;
+
+    // most recently used goes to the back
+    order.removeOne(k);
+    order << k;
+
+    returning = it.value();
+    return true;
+}
+
+void
+RFrameCache::insert(Context *context, QString key, QList<SEXP> list)
+{
+    watch(context);
+
+    QString k = contextKey(context, key);
+    if (frames.contains(k)) release(k);
+
+    foreach(SEXP frame, list) {
+        R_PreserveObject(frame);
+
+        // R must copy before a script modifies it
+#ifdef MARK_NOT_MUTABLE
+        MARK_NOT_MUTABLE(frame);
+#else
+        SET_NAMED(frame, 2);
+#endif
+    }
+    frames.insert(k, list);
+    order << k;
+
+    while (order.count() > MAX_FRAMES) release(order.first());
+}
+
+void
+RFrameCache::release(QString key)
+{
+    foreach(SEXP frame, frames.value(key)) R_ReleaseObject(frame);
+    frames.remove(key);
+    order.removeOne(key);
+}
+
+void
+RFrameCache::clear()
+{
+    foreach(QString key, order) foreach(SEXP frame, frames.value(key)) R_ReleaseObject(frame);
+    frames.clear();
+    order.clear();
+}
+
+void
+RFrameCache::watch(Context *context)
+{
+    if (context == NULL || watching.contains(context)) return;
+    watching.insert(context);
+
+    // anything that might change the rides or how we present them
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(clear()));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(clear()));
+    connect(context, SIGNAL(rideChanged(RideItem*)), this, SLOT(clear()));
+    connect(context, SIGNAL(rideSaved(RideItem*)), this, SLOT(clear()));
+    connect(context, SIGNAL(rideDirty(RideItem*)), this, SLOT(clear()));
+    connect(context, SIGNAL(intervalsChanged()), this, SLOT(clear()));
+    connect(context, SIGNAL(refreshEnd()), this, SLOT(clear()));
+    connect(context, SIGNAL(configChanged(qint32)), this, SLOT(clear()));
+    connect(context, SIGNAL(destroyed(QObject*)), this, SLOT(contextDestroyed(QObject*)));
+    if (context->athlete && context->athlete->rideCache)
+        connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(clear()));
+}
+
+void
+RFrameCache::contextDestroyed(QObject *object)
+{
+    watching.remove(static_cast<Context*>(object));
+    clear();
+}
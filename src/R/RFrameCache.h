@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RFrameCache_h
+#define _GC_RFrameCache_h 1
+#include "GoldenCheetah.h"
+
+#include "REmbed.h"
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class Context;
+
+//
+// Data frames we already handed to R scripts
+//
+// Charts re-run their script whenever they are shown, resized or a ride is
+// selected, and most scripts start by asking for the same GC.activity() or
+// GC.season.metrics() frame they asked for last time. Building those means
+// walking every sample of a ride or every ride in the cache, so we keep the
+// frames we built keyed on what was asked for and return them again.
+//
+// Cached frames are kept alive with R_PreserveObject and marked as shared so
+// R copies them before a script modifies one. Everything is thrown away when
+// a watched athlete adds, removes, changes or refreshes rides, or when the
+// config changes, since any of those can change the contents.
+//
+class RFrameCache : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RFrameCache();
+        ~RFrameCache();
+
+        // look for / remember the frames for a key, context is the
+        // athlete they were built for and we start watching it
+        bool lookup(Context *context, QString key, QList<SEXP> &frames);
+        void insert(Context *context, QString key, QList<SEXP> frames);
+
+    public slots:
+
+        // release them all
+        void clear();
+
+        // an athlete we watch closed
+        void contextDestroyed(QObject *);
+
+    private:
+
+        void watch(Context *context);
+        void release(QString key);
+
+        QSet<Context*> watching;
+        QHash<QString, QList<SEXP> > frames;
+        QStringList order; // oldest first
+};
+
+#endif // _GC_RFrameCache_h
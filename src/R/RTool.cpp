@@ -23,8 +23,10 @@
 #include "RideCache.h"
 #include "RideItem.h"
 #include "IntervalItem.h"
+#include "RideFileLRU.h"
 #include "RideFile.h"
 #include "RideFileCache.h"
+#include "PeakTable.h"
 #include "Colors.h"
 #include "RideMetric.h"
 #include "RideMetadata.h"
@@ -103,6 +105,7 @@ RTool::RTool()
 #endif
 
         dev = new RGraphicsDevice();
+        frames = new RFrameCache();
 
         // IMPORTANT: **** REMEMBER TO CHANGE BOTH WHEN ADDING NEW ROUTINES ****
         //
@@ -905,6 +908,75 @@ RTool::activities(SEXP filter)
     return dates;
 }
 
+// data.frame row names 1..n in R's compact form c(NA, -n), rather
+// than making a string for every row
+static SEXP
+rowNames(int n)
+{
+    SEXP rownames = Rf_allocVector(INTSXP, 2);
+    INTEGER(rownames)[0] = NA_INTEGER;
+    INTEGER(rownames)[1] = -n;
+    return rownames;
+}
+
+// the RideFilePoint member holding a series, so we can copy a whole
+// series without going through RideFilePoint::value() for every sample
+// NULL if it isn't a double member or isn't stored in the point
+static double RideFilePoint::*
+pointMember(RideFile::SeriesType series)
+{
+    switch (series) {
+        case RideFile::secs : return &RideFilePoint::secs;
+        case RideFile::cad : return &RideFilePoint::cad;
+        case RideFile::hr : return &RideFilePoint::hr;
+        case RideFile::km : return &RideFilePoint::km;
+        case RideFile::kph : return &RideFilePoint::kph;
+        case RideFile::kphd : return &RideFilePoint::kphd;
+        case RideFile::cadd : return &RideFilePoint::cadd;
+        case RideFile::nmd : return &RideFilePoint::nmd;
+        case RideFile::hrd : return &RideFilePoint::hrd;
+        case RideFile::nm : return &RideFilePoint::nm;
+        case RideFile::watts : return &RideFilePoint::watts;
+        case RideFile::wattsd : return &RideFilePoint::wattsd;
+        case RideFile::alt : return &RideFilePoint::alt;
+        case RideFile::lon : return &RideFilePoint::lon;
+        case RideFile::lat : return &RideFilePoint::lat;
+        case RideFile::headwind : return &RideFilePoint::headwind;
+        case RideFile::slope : return &RideFilePoint::slope;
+        case RideFile::temp : return &RideFilePoint::temp;
+        case RideFile::lrbalance : return &RideFilePoint::lrbalance;
+        case RideFile::lte : return &RideFilePoint::lte;
+        case RideFile::rte : return &RideFilePoint::rte;
+        case RideFile::lps : return &RideFilePoint::lps;
+        case RideFile::rps : return &RideFilePoint::rps;
+        case RideFile::thb : return &RideFilePoint::thb;
+        case RideFile::lpco : return &RideFilePoint::lpco;
+        case RideFile::rpco : return &RideFilePoint::rpco;
+        case RideFile::lppb : return &RideFilePoint::lppb;
+        case RideFile::rppb : return &RideFilePoint::rppb;
+        case RideFile::lppe : return &RideFilePoint::lppe;
+        case RideFile::rppe : return &RideFilePoint::rppe;
+        case RideFile::lpppb : return &RideFilePoint::lpppb;
+        case RideFile::rpppb : return &RideFilePoint::rpppb;
+        case RideFile::lpppe : return &RideFilePoint::lpppe;
+        case RideFile::rpppe : return &RideFilePoint::rpppe;
+        case RideFile::smo2 : return &RideFilePoint::smo2;
+        case RideFile::o2hb : return &RideFilePoint::o2hb;
+        case RideFile::hhb : return &RideFilePoint::hhb;
+        case RideFile::rcad : return &RideFilePoint::rcad;
+        case RideFile::rvert : return &RideFilePoint::rvert;
+        case RideFile::rcontact : return &RideFilePoint::rcontact;
+        case RideFile::gear : return &RideFilePoint::gear;
+        case RideFile::NP : return &RideFilePoint::np;
+        case RideFile::xPower : return &RideFilePoint::xp;
+        case RideFile::aPower : return &RideFilePoint::apower;
+        case RideFile::aTISS : return &RideFilePoint::atiss;
+        case RideFile::anTISS : return &RideFilePoint::antiss;
+        case RideFile::tcore : return &RideFilePoint::tcore;
+        default: return NULL;
+    }
+}
+
 SEXP
 RTool::dfForRideItem(const RideItem *ri)
 {
@@ -1080,6 +1152,11 @@ RTool::dfForRideItem(const RideItem *ri)
 SEXP
 RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
 {
+    // already built it?
+    QList<SEXP> cached;
+    QString key = QString("metrics|%1").arg(rtool->rangeKey(all, range, filter));
+    if (rtool->frames->lookup(rtool->context, key, cached)) return cached[0];
+
     const RideMetricFactory &factory = RideMetricFactory::instance();
     int rides = rtool->context->athlete->rideCache->count();
     int metrics = factory.metricCount();
@@ -1123,12 +1200,14 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     specification.setFilterSet(fs);
     UNPROTECT(1);
 
-    // we need to count rides that are in range...
-    rides = 0;
+    // select the rides that are in range once, rather than
+    // filtering them again for every column we add
+    QList<RideItem*> selected;
     foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
         if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) rides++;
+        if (all || range.pass(ride->dateTime.date())) selected << ride;
     }
+    rides = selected.count();
 
     // get a listAllocated
     SEXP ans;
@@ -1140,11 +1219,7 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     PROTECT(names = Rf_allocVector(STRSXP, metrics+meta+3));
 
     // we have to give a name to each row
-    PROTECT(rownames = Rf_allocVector(STRSXP, rides));
-    for(int i=0; i<rides; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-    }
+    PROTECT(rownames = rowNames(rides));
 
     // next name
     int next=0;
@@ -1155,11 +1230,8 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
 
     int k=0;
     QDate d1970(1970,01,01);
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date()))
-            INTEGER(date)[k++] = d1970.daysTo(ride->dateTime.date());
-    }
+    foreach(RideItem *ride, selected)
+        INTEGER(date)[k++] = d1970.daysTo(ride->dateTime.date());
 
     SEXP dclas;
     PROTECT(dclas=Rf_allocVector(STRSXP, 1));
@@ -1176,11 +1248,8 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
 
     // fill with values for date and class if its one we need to return
     k=0;
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date()))
-            REAL(time)[k++] = ride->dateTime.toUTC().toTime_t();
-    }
+    foreach(RideItem *ride, selected)
+        REAL(time)[k++] = ride->dateTime.toUTC().toTime_t();
 
     // POSIXct class
     SEXP clas;
@@ -1217,12 +1286,9 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
         bool useMetricUnits = rtool->context->athlete->useMetricUnits;
 
         int index=0;
-        foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                REAL(m)[index++] = item->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion())
-                                                      + (useMetricUnits ? 0.0f : metric->conversionSum());
-            }
+        foreach(RideItem *item, selected) {
+            REAL(m)[index++] = item->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion())
+                                                  + (useMetricUnits ? 0.0f : metric->conversionSum());
         }
 
         // add to the list
@@ -1251,12 +1317,8 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
         PROTECT(m=Rf_allocVector(STRSXP, rides));
 
         int index=0;
-        foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                SET_STRING_ELT(m, index++, Rf_mkChar(item->getText(field.name, "").toLatin1().constData()));
-            }
-        }
+        foreach(RideItem *item, selected)
+            SET_STRING_ELT(m, index++, Rf_mkChar(item->getText(field.name, "").toLatin1().constData()));
 
         // add to the list
         SET_VECTOR_ELT(ans, next, m);
@@ -1275,23 +1337,20 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     PROTECT(color=Rf_allocVector(STRSXP, rides));
 
     int index=0;
-    foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(item)) continue;
-        if (all || range.pass(item->dateTime.date())) {
+    foreach(RideItem *item, selected) {
 
-            // apply item color, remembering that 1,1,1 means use default (reverse in this case)
-            if (item->color == QColor(1,1,1,1)) {
+        // apply item color, remembering that 1,1,1 means use default (reverse in this case)
+        if (item->color == QColor(1,1,1,1)) {
 
-                // use the inverted color, not plot marker as that hideous
-                QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
+            // use the inverted color, not plot marker as that hideous
+            QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
 
-                // white is jarring on a dark background!
-                if (col==QColor(Qt::white)) col=QColor(127,127,127);
+            // white is jarring on a dark background!
+            if (col==QColor(Qt::white)) col=QColor(127,127,127);
 
-                SET_STRING_ELT(color, index++, Rf_mkChar(col.name().toLatin1().constData()));
-            } else
-                SET_STRING_ELT(color, index++, Rf_mkChar(item->color.name().toLatin1().constData()));
-        }
+            SET_STRING_ELT(color, index++, Rf_mkChar(col.name().toLatin1().constData()));
+        } else
+            SET_STRING_ELT(color, index++, Rf_mkChar(item->color.name().toLatin1().constData()));
     }
 
     // add to the list and name it
@@ -1306,6 +1365,9 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
     Rf_namesgets(ans, names);
 
+    // keep it for next time
+    rtool->frames->insert(rtool->context, key, QList<SEXP>() << ans);
+
     // ans + names
     UNPROTECT(3);
 
@@ -1316,6 +1378,15 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
 SEXP
 RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
 {
+    // already built it?
+    QList<SEXP> cached;
+    QString key = QString("intervals|%1|%2|%3|%4|%5").arg(range.from.toString(Qt::ISODate))
+                                                      .arg(range.to.toString(Qt::ISODate))
+                                                      .arg(types.join(","))
+                                                      .arg(rtool->context->isfiltered ? rtool->context->filters.join(",") : "")
+                                                      .arg(rtool->context->ishomefiltered ? rtool->context->homeFilters.join(",") : "");
+    if (rtool->frames->lookup(rtool->context, key, cached)) return cached[0];
+
     const RideMetricFactory &factory = RideMetricFactory::instance();
     int intervals = 0;
     int metrics = factory.metricCount();
@@ -1330,19 +1401,18 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
     fs.addFilter(rtool->context->ishomefiltered, rtool->context->homeFilters);
     specification.setFilterSet(fs);
 
-    // we need to count intervals that are in range...
-    intervals = 0;
+    // select the intervals that are in range once, rather than
+    // filtering them again for every column we add
+    QList<IntervalItem*> selected;
     foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
         if (!specification.pass(ride)) continue;
         if (!range.pass(ride->dateTime.date())) continue;
 
-        if (types.isEmpty()) intervals += ride->intervals().count();
-        else {
-            foreach(IntervalItem *item, ride->intervals())
-                if (types.contains(RideFileInterval::typeDescription(item->type)))
-                    intervals++;
-        }
+        foreach(IntervalItem *item, ride->intervals())
+            if (types.isEmpty() || types.contains(RideFileInterval::typeDescription(item->type)))
+                selected << item;
     }
+    intervals = selected.count();
 
     // get a listAllocated
     SEXP ans;
@@ -1354,11 +1424,7 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
     PROTECT(names = Rf_allocVector(STRSXP, metrics+5));
 
     // we have to give a name to each row
-    PROTECT(rownames = Rf_allocVector(STRSXP, intervals));
-    for(int i=0; i<intervals; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-    }
+    PROTECT(rownames = rowNames(intervals));
 
     // next name
     int next=0;
@@ -1369,14 +1435,8 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
 
     int k=0;
     QDate d1970(1970,01,01);
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (range.pass(ride->dateTime.date())) {
-            foreach(IntervalItem *item, ride->intervals())
-                if (types.isEmpty() || types.contains(RideFileInterval::typeDescription(item->type)))
-                    INTEGER(date)[k++] = d1970.daysTo(ride->dateTime.date());
-        }
-    }
+    foreach(IntervalItem *item, selected)
+        INTEGER(date)[k++] = d1970.daysTo(item->rideItem()->dateTime.date());
 
     SEXP dclas;
     PROTECT(dclas=Rf_allocVector(STRSXP, 1));
@@ -1393,14 +1453,8 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
 
     // fill with values for date and class if its one we need to return
     k=0;
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (range.pass(ride->dateTime.date())) {
-            foreach(IntervalItem *item, ride->intervals())
-                if (types.isEmpty() || types.contains(RideFileInterval::typeDescription(item->type)))
-                    REAL(time)[k++] = ride->dateTime.toUTC().toTime_t() + item->start;  // time offsets by time of interval
-        }
-    }
+    foreach(IntervalItem *item, selected)
+        REAL(time)[k++] = item->rideItem()->dateTime.toUTC().toTime_t() + item->start;  // time offsets by time of interval
 
     // POSIXct class
     SEXP clas;
@@ -1421,14 +1475,8 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
     SEXP intervalnames;
     PROTECT(intervalnames = Rf_allocVector(STRSXP, intervals));
     k=0;
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (range.pass(ride->dateTime.date())) {
-            foreach(IntervalItem *item, ride->intervals())
-                if (types.isEmpty() || types.contains(RideFileInterval::typeDescription(item->type)))
-                    SET_STRING_ELT(intervalnames, k++, Rf_mkChar(item->name.toLatin1().constData()));
-        }
-    }
+    foreach(IntervalItem *item, selected)
+        SET_STRING_ELT(intervalnames, k++, Rf_mkChar(item->name.toLatin1().constData()));
 
     // add to the list and give a columnname
     SET_VECTOR_ELT(ans, next, intervalnames);
@@ -1439,14 +1487,8 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
     SEXP intervaltypes;
     PROTECT(intervaltypes = Rf_allocVector(STRSXP, intervals));
     k=0;
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (range.pass(ride->dateTime.date())) {
-            foreach(IntervalItem *item, ride->intervals())
-                if (types.isEmpty() || types.contains(RideFileInterval::typeDescription(item->type)))
-                    SET_STRING_ELT(intervaltypes, k++, Rf_mkChar(RideFileInterval::typeDescription(item->type).toLatin1().constData()));
-        }
-    }
+    foreach(IntervalItem *item, selected)
+        SET_STRING_ELT(intervaltypes, k++, Rf_mkChar(RideFileInterval::typeDescription(item->type).toLatin1().constData()));
     SET_VECTOR_ELT(ans, next, intervaltypes);
     SET_STRING_ELT(names, next, Rf_mkChar("type"));
     next++;
@@ -1472,16 +1514,9 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
         bool useMetricUnits = rtool->context->athlete->useMetricUnits;
 
         int index=0;
-        foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (range.pass(item->dateTime.date())) {
-
-                foreach(IntervalItem *interval, item->intervals()) {
-                    if (types.isEmpty() || types.contains(RideFileInterval::typeDescription(interval->type)))
-                        REAL(m)[index++] = interval->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion())
-                                                          + (useMetricUnits ? 0.0f : metric->conversionSum());
-                }
-            }
+        foreach(IntervalItem *interval, selected) {
+            REAL(m)[index++] = interval->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion())
+                                                      + (useMetricUnits ? 0.0f : metric->conversionSum());
         }
 
         // add to the list
@@ -1501,27 +1536,20 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
     PROTECT(color=Rf_allocVector(STRSXP, intervals));
 
     int index=0;
-    foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(item)) continue;
-        if (!range.pass(item->dateTime.date())) continue;
+    foreach(IntervalItem *interval, selected) {
 
-        foreach(IntervalItem *interval, item->intervals()) {
+        // apply item color, remembering that 1,1,1 means use default (reverse in this case)
+        if (interval->color == QColor(1,1,1,1)) {
 
-            if (!types.isEmpty() && !types.contains(RideFileInterval::typeDescription(interval->type))) continue;
+            // use the inverted color, not plot marker as that hideous
+            QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
 
-            // apply item color, remembering that 1,1,1 means use default (reverse in this case)
-            if (interval->color == QColor(1,1,1,1)) {
+            // white is jarring on a dark background!
+            if (col==QColor(Qt::white)) col=QColor(127,127,127);
 
-                // use the inverted color, not plot marker as that hideous
-                QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
-
-                // white is jarring on a dark background!
-                if (col==QColor(Qt::white)) col=QColor(127,127,127);
-
-                SET_STRING_ELT(color, index++, Rf_mkChar(col.name().toLatin1().constData()));
-            } else
-                SET_STRING_ELT(color, index++, Rf_mkChar(item->color.name().toLatin1().constData()));
-        }
+            SET_STRING_ELT(color, index++, Rf_mkChar(col.name().toLatin1().constData()));
+        } else
+            SET_STRING_ELT(color, index++, Rf_mkChar(interval->rideItem()->color.name().toLatin1().constData()));
     }
 
     // add to the list and name it
@@ -1536,6 +1564,9 @@ RTool::dfForDateRangeIntervals(DateRange range, QStringList types)
     Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
     Rf_namesgets(ans, names);
 
+    // keep it for next time
+    rtool->frames->insert(rtool->context, key, QList<SEXP>() << ans);
+
     // ans + names
     UNPROTECT(3);
 
@@ -1902,11 +1933,35 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
     if (seriescount) seriescount++;
     else return returning;
 
+    // the samples and which series are present, looked up once
+    // rather than for every sample of every series
+    const QVector<RideFilePoint*> &samples = f->dataPoints();
+    QVector<bool> present(static_cast<int>(RideFile::none));
+    for(int s=0; s < static_cast<int>(RideFile::none); s++)
+        present[s] = f->isDataPresent(static_cast<RideFile::SeriesType>(s));
+
+    // sample times are offsets from the start
+    double start = f->startTime().toUTC().toTime_t();
+
+    // how to join xdata
+    RideFile::XDataJoin xjoin;
+    xjoin = RideFile::REPEAT;
+    QStringList xdataValidSymbols;
+    xdataValidSymbols << "sparse" << "repeat" << "interpolate" << "resample";
+    int xx = xdataValidSymbols.indexOf(join, Qt::CaseInsensitive);
+    switch(xx) {
+        case 0: xjoin = RideFile::SPARSE; break;
+        default:
+        case 1: xjoin = RideFile::REPEAT; break;
+        case 2: xjoin = RideFile::INTERPOLATE; break;
+        case 3: xjoin = RideFile::RESAMPLE; break;
+    }
+
     // start at first sample in ride
     int index=0;
     int pcount=0;
 
-    while(index < f->dataPoints().count()) {
+    while(index < samples.count()) {
 
         // we return a list of series vectors
         SEXP ans = PROTECT(Rf_allocVector(VECSXP, seriescount));
@@ -1922,10 +1977,10 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
         //
 
         // do we stop at the end, or mid-ride ?
-        int stop = f->dataPoints().count();
+        int stop = samples.count();
         if (split) {
-            for(int i=index+1; i<f->dataPoints().count(); i++) {
-                if (i && (f->dataPoints()[i]->secs - f->dataPoints()[i-1]->secs) > double(split)) {
+            for(int i=index+1; i<samples.count(); i++) {
+                if (i && (samples[i]->secs - samples[i-1]->secs) > double(split)) {
                     stop = i;
                     goto outer;
                 }
@@ -1940,8 +1995,8 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
         SEXP time = PROTECT(Rf_allocVector(REALSXP, points));
         pcount++;
 
-        // fill with values for date and class
-        for(int k=0; k<points; k++) REAL(time)[k] = f->startTime().addSecs(f->dataPoints()[index+k]->secs).toUTC().toTime_t();
+        // fill with values for date and class, addSecs truncates to whole seconds
+        for(int k=0; k<points; k++) REAL(time)[k] = start + qint64(samples[index+k]->secs);
 
         // POSIXct class
         SEXP clas = PROTECT(Rf_allocVector(STRSXP, 2));
@@ -1964,21 +2019,25 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
             RideFile::SeriesType series = static_cast<RideFile::SeriesType>(s);
 
             // lets not add lots of NA for the more obscure data series
-            if (s > 15 && !f->isDataPresent(series)) continue;
+            if (s > 15 && !present[s]) continue;
 
             // set a vector
             SEXP vector = PROTECT(Rf_allocVector(REALSXP, points));
             pcount++;
+            double *into = REAL(vector);
+
+            double RideFilePoint::*member = pointMember(series);
+            bool nozero = (series == RideFile::lat || series == RideFile::lon);
 
-            for(int j=index; j<stop; j++) {
-                if (f->isDataPresent(series)) {
-                    if (f->dataPoints()[j]->value(series) == 0 && (series == RideFile::lat || series == RideFile::lon))
-                        REAL(vector)[j-index] = NA_REAL;
-                    else
-                        REAL(vector)[j-index] = f->dataPoints()[j]->value(series);
-                } else {
-                    REAL(vector)[j-index] = NA_REAL;
+            if (!present[s]) {
+                for(int j=0; j<points; j++) into[j] = NA_REAL;
+            } else if (member) {
+                for(int j=0; j<points; j++) {
+                    double value = samples[index+j]->*member;
+                    into[j] = (nozero && value == 0) ? NA_REAL : value;
                 }
+            } else {
+                for(int j=0; j<points; j++) into[j] = samples[index+j]->value(series);
             }
 
             // add to the list
@@ -1992,19 +2051,6 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
         }
 
         // XDATA SERIES
-        RideFile::XDataJoin xjoin;
-        xjoin = RideFile::REPEAT;
-        QStringList xdataValidSymbols;
-        xdataValidSymbols << "sparse" << "repeat" << "interpolate" << "resample";
-        int xx = xdataValidSymbols.indexOf(join, Qt::CaseInsensitive);
-        switch(xx) {
-            case 0: xjoin = RideFile::SPARSE; break;
-            default:
-            case 1: xjoin = RideFile::REPEAT; break;
-            case 2: xjoin = RideFile::INTERPOLATE; break;
-            case 3: xjoin = RideFile::RESAMPLE; break;
-        }
-
         it.toFront(); // reused from above
         while(it.hasNext()) {
 
@@ -2021,7 +2067,7 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
 
                 int idx=0;
                 for(int j=index; j<stop; j++) {
-                    RideFilePoint *p = f->dataPoints()[j];
+                    RideFilePoint *p = samples[j];
                     double val = f->xdataValue(p, idx, it.value()->name, series, xjoin);
                     REAL(vector)[j-index] = (val == RideFile::NA) ? NA_REAL : val;
                 }
@@ -2037,12 +2083,8 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
         }
 
         // add rownames
-        SEXP rownames = PROTECT(Rf_allocVector(STRSXP, points));
+        SEXP rownames = PROTECT(rowNames(points));
         pcount++;
-        for(int i=0; i<points; i++) {
-            QString rownumber=QString("%1").arg(i+1);
-            SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-        }
 
         // turn the list into a data frame + set column names
         Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
@@ -2060,6 +2102,54 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
     return returning;
 }
 
+QList<SEXP>
+RTool::framesForActivity(RideItem *item, int split, QString join)
+{
+    QList<SEXP> returning;
+
+    // held whilst we build, R may process events
+    RidePin pin(item);
+    RideFile *f = item->ride();
+    if (f == NULL) return returning;
+
+    // compare items have no file, and a ride being edited
+    // can change without telling anyone, so always build
+    if (item->fileName == "" || item->isDirty() || item->isedit) return dfForActivity(f, split, join);
+
+    // already built it?
+    QString key = QString("activity|%1|%2|%3|%4").arg(item->fileName)
+                                                 .arg(quintptr(f))
+                                                 .arg(split)
+                                                 .arg(join.toLower());
+    if (frames->lookup(context, key, returning)) return returning;
+
+    returning = dfForActivity(f, split, join);
+
+    foreach(SEXP df, returning) PROTECT(df);
+    frames->insert(context, key, returning);
+    UNPROTECT(returning.count());
+
+    return returning;
+}
+
+QString
+RTool::rangeKey(bool all, DateRange range, SEXP filter)
+{
+    // what the user asked for
+    QStringList filters;
+    PROTECT(filter=Rf_coerceVector(filter, STRSXP));
+    for(int i=0; i<Rf_length(filter); i++) filters << QString(CHAR(STRING_ELT(filter,i)));
+    UNPROTECT(1);
+
+    // and the global filters that apply
+    return QString("%1|%2|%3|%4|%5|%6").arg(all ? "all" : "range")
+                                      .arg(all ? "" : range.from.toString(Qt::ISODate) + "|" + range.to.toString(Qt::ISODate))
+                                      .arg(filters.join("\n"))
+                                      .arg(context->isfiltered ? context->filters.join(",") : "")
+                                      .arg(context->ishomefiltered ? context->homeFilters.join(",") : "")
+                                      .arg(context->athlete->useMetricUnits);
+}
+
 QList<RideItem *>
 RTool::activitiesFor(SEXP datetime)
 {
@@ -2136,7 +2226,11 @@ RTool::activity(SEXP datetime, SEXP pCompare, SEXP pSplit, SEXP pJoin)
                 // we open, if it wasn't open we also close
                 // to make sure we don't exhause memory
                 bool close = (item->isOpen() == false);
-                foreach(SEXP df, rtool->dfForActivity(item->ride(), split, join)) f<<df;
+                // protected since the cache may drop them whilst we process events
+                foreach(SEXP df, rtool->framesForActivity(item, split, join)) {
+                    PROTECT(df);
+                    f<<df;
+                }
                 if (close) item->close();
 
             }
@@ -2160,7 +2254,7 @@ RTool::activity(SEXP datetime, SEXP pCompare, SEXP pSplit, SEXP pJoin)
             Rf_setAttrib(list, R_RowNamesSymbol, rownames);
             Rf_namesgets(list, names);
 
-            UNPROTECT(3); // list and names and rownames
+            UNPROTECT(3 + f.count()); // list and names and rownames and frames
 
             return list;
 
@@ -2188,7 +2282,7 @@ RTool::activity(SEXP datetime, SEXP pCompare, SEXP pSplit, SEXP pJoin)
             foreach(CompareInterval p, rtool->context->compareIntervals) {
                 if (p.isChecked()) {
 
-                    foreach(SEXP df,  rtool->dfForActivity(p.rideItem->ride(), split, join)) {
+                    foreach(SEXP df,  rtool->framesForActivity(p.rideItem, split, join)) {
 
                         // create a named list
                         PROTECT(namedlist=Rf_allocVector(VECSXP, 2));
@@ -2234,9 +2328,9 @@ RTool::activity(SEXP datetime, SEXP pCompare, SEXP pSplit, SEXP pJoin)
             SET_STRING_ELT(names, 1, Rf_mkChar("color"));
 
             // add the ride
-            RideFile *f = const_cast<RideItem*>(rtool->context->currentRideItem())->ride();
-            f->recalculateDerivedSeries();
-            foreach(SEXP df, rtool->dfForActivity(f, split, join)) {
+            RideItem *item = const_cast<RideItem*>(rtool->context->currentRideItem());
+            item->ride()->recalculateDerivedSeries();
+            foreach(SEXP df, rtool->framesForActivity(item, split, join)) {
 
                 // named list of activity and color
                 SEXP namedlist;
@@ -2274,11 +2368,11 @@ RTool::activity(SEXP datetime, SEXP pCompare, SEXP pSplit, SEXP pJoin)
         if(rtool->context->currentRideItem() && const_cast<RideItem*>(rtool->context->currentRideItem())->ride()) {
 
             // get the ride
-            RideFile *f = const_cast<RideItem*>(rtool->context->currentRideItem())->ride();
-            f->recalculateDerivedSeries();
+            RideItem *item = const_cast<RideItem*>(rtool->context->currentRideItem());
+            item->ride()->recalculateDerivedSeries();
 
             // get as a data frame
-            QList<SEXP> returning = rtool->dfForActivity(f, 0, join);
+            QList<SEXP> returning = rtool->framesForActivity(item, 0, join);
             if (returning.count()) return returning[0];
         }
     }
@@ -2297,6 +2391,11 @@ RTool::dfForActivityMeanmax(const RideItem *i)
 SEXP
 RTool::dfForDateRangeMeanmax(bool all, DateRange range, SEXP filter)
 {
+    // already built it? aggregating the caches is expensive
+    QList<SEXP> cached;
+    QString key = QString("meanmax|%1").arg(rtool->rangeKey(all, range, filter));
+    if (rtool->frames->lookup(rtool->context, key, cached)) return cached[0];
+
     // construct the date range and then get a ridefilecache
     if (all) range = DateRange(QDate(1900,01,01), QDate(2100,01,01));
 
@@ -2322,10 +2421,12 @@ RTool::dfForDateRangeMeanmax(bool all, DateRange range, SEXP filter)
     // RideFileCache for a date range with our filters (if any)
     RideFileCache cache(rtool->context, range.from, range.to, filt, filelist, false, NULL);
 
-    return dfForRideFileCache(&cache);
+    SEXP ans;
+    PROTECT(ans = dfForRideFileCache(&cache));
+    rtool->frames->insert(rtool->context, key, QList<SEXP>() << ans);
+    UNPROTECT(1);
 
-    // nothing to return
-    return Rf_allocVector(INTSXP, 0);
+    return ans;
 }
 
 
@@ -2431,11 +2532,7 @@ RTool::dfForRideFileCache(RideFileCache *cache)
 
     // add rownames
     SEXP rownames;
-    PROTECT(rownames = Rf_allocVector(STRSXP, size));
-    for(unsigned int i=0; i<size; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-    }
+    PROTECT(rownames = rowNames(size));
 
     // turn the list into a data frame + set column names
     Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
@@ -2667,34 +2764,34 @@ RTool::dfForDateRangePeaks(bool all, DateRange range, SEXP filter, QList<RideFil
 
     SET_VECTOR_ELT(df, dfindex++, dates);
 
+    // the rides we want
+    QStringList files;
+    foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
+
+        // apply filters
+        if (!specification.pass(item)) continue;
+
+        // do we want this one ?
+        if (all || range.pass(item->dateTime.date())) files << item->fileName;
+    }
+
     foreach(RideFile::SeriesType pseries, series) {
 
-        foreach(int pduration, durations) {
+        // get all the durations for all the rides in one go
+        QVector<QVector<double> > peaks = rtool->context->athlete->peaks->bests(files, pseries, durations);
+
+        for (int d=0; d<durations.count(); d++) {
 
             // create a vector
             SEXP vector;
             PROTECT(vector=Rf_allocVector(REALSXP, size));
 
             // give it a name
-            QString name = QString("peak_%1_%2").arg(RideFile::seriesName(pseries, true)).arg(pduration);
+            QString name = QString("peak_%1_%2").arg(RideFile::seriesName(pseries, true)).arg(durations[d]);
             SET_STRING_ELT(names, next++, Rf_mkChar(name.toLatin1().constData()));
 
             // fill with values
-            // get the value for the series and duration requested, although this is called
-            int index=0;
-            foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-
-                // apply filters
-                if (!specification.pass(item)) continue;
-
-                // do we want this one ?
-                if (all || range.pass(item->dateTime.date())) {
-
-                    // for each series/duration independently its pretty quick since it lseeks to
-                    // the actual value, so /should't/ be too expensive.........
-                    REAL(vector)[index++] = RideFileCache::best(item->context, item->fileName, pseries, pduration);
-                }
-            }
+            for (int index=0; index<size; index++) REAL(vector)[index] = peaks[index][d];
 
             // add named vector to the list
             SET_VECTOR_ELT(df, dfindex++, vector);
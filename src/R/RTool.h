@@ -18,6 +18,7 @@
 
 #include "RChart.h"
 #include "Context.h"
+#include "RFrameCache.h"
 
 #ifndef _GC_RTool_h
 
@@ -35,6 +36,9 @@ class RTool {
         REmbed *R;
         RGraphicsDevice *dev;
 
+        // data frames we already built
+        RFrameCache *frames;
+
         // the canvas to plot on, it may be null
         // if no canvas is active
         RCanvas *canvas;
@@ -97,6 +101,7 @@ class RTool {
         // return a dataframe for the ride passed
         QList<RideItem *> activitiesFor(SEXP datetime);   // find the rideitem requested by the user
         QList<SEXP> dfForActivity(RideFile *f, int split, QString join); // returns date series for an activity
+        QList<SEXP> framesForActivity(RideItem *item, int split, QString join); // as above, but cached
         SEXP dfForActivityWBal(RideFile *f);            // returns w' bal series for an activity
         SEXP dfForActivityMeanmax(const RideItem *i);   // returns mean maximals for an activity
         SEXP dfForRideItem(const RideItem *i);          // returns metrics and meradata for an activity
@@ -106,6 +111,9 @@ class RTool {
         SEXP dfForDateRangePeaks(bool all, DateRange range, SEXP filter, QList<RideFile::SeriesType> series, QList<int> durations);
         SEXP dfForRideFileCache(RideFileCache *p);      // returns meanmax for a cache
 
+        // key for frames cached for a season and filter
+        QString rangeKey(bool all, DateRange range, SEXP filter);
+
 };
 
 // there is a global instance created in main
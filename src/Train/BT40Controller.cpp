@@ -142,4 +142,5 @@ BT40Controller::setWheelRpm(double wrpm) {
     if (localDc) wheel = localDc->wheelSize;
     else wheel = 2100;
     telemetry.setSpeed(wrpm * wheel / 1000 * 60 / 1000);
+    samples.push(telemetry);
 }
@@ -48,17 +48,21 @@ public:
 
     // telemetry push pull
     bool doesPush(), doesPull(), doesLoad();
+    int sampleInterval() { return 1000; } // notifications once a second
     void getRealtimeData(RealtimeData &rtData);
     void pushRealtimeData(RealtimeData &rtData);
     void setBPM(float x) {
 	telemetry.setHr(x);
+	samples.push(telemetry);
     }
     void setWatts(double watts) {
 	telemetry.setWatts(watts);
+	samples.push(telemetry);
     }
     void setWheelRpm(double wrpm);
     void setCadence(double cadence) {
 	telemetry.setCadence(cadence);
+	samples.push(telemetry);
     }
 
 private slots:
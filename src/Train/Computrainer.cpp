@@ -24,6 +24,8 @@
 
 #include "Computrainer.h"
 
+#include <QElapsedTimer>
+
 const static uint8_t ergo_command[56] = {
 //                        Ergo            various
 //      crc     -     -   mode  cmd   val   bits
@@ -71,6 +73,7 @@ const static uint8_t rrc_command[56] = {
 Computrainer::Computrainer(QObject *parent,  QString devname) : QThread(parent)
 {
 
+    ring = NULL;
     devicePower = deviceHeartRate = deviceCadence = deviceSpeed = deviceRRC = 0.00;
     for (int i=0; i<24; spinScan[i++] = 0) ;
     mode = DEFAULT_MODE;
@@ -485,6 +488,7 @@ void Computrainer::run()
     //                           when they change
 
     int cmds=0;            // count loops with no command sent
+    int rc;                // result of reading a message
 
     // holders for unpacked telemetry
     int ss1,ss2,ss3, buttons, type, value8, value12;
@@ -554,7 +558,7 @@ void Computrainer::run()
 
         if (isDeviceOpen == true) {
 
-            if (readMessage() > 0) {
+            if ((rc = readMessage()) > 0) {
 
                 //----------------------------------------------------------------
                 // UPDATE BASIC TELEMETRY (HR, CAD, SPD et al)
@@ -631,6 +635,17 @@ void Computrainer::run()
                         break;
                 }
 
+                // hand on as it arrives, each message only updates one
+                // value so we send all of them
+                if (ring) {
+                    RealtimeData sample;
+                    sample.setWatts(curPower);
+                    sample.setHr(curHeartRate);
+                    sample.setCadence(curCadence);
+                    sample.setSpeed(curSpeed);
+                    ring->push(sample);
+                }
+
             //----------------------------------------------------------------
             // UPDATE BUTTONS
             //----------------------------------------------------------------
@@ -647,10 +662,16 @@ void Computrainer::run()
             /* not yet implemented */
 
             } else {
+#ifdef WIN32
                 // no data
                 // how long to sleep for ... mmm save CPU cycles vs
                 //                           data overflow ?
                 CTsleeper::msleep (100); // lets try a tenth of a second
+#else
+                // readMessage() already waited for data to arrive
+                // so we only back off if the device is in error
+                if (rc < 0) CTsleeper::msleep (100);
+#endif
             }
 
         }
@@ -766,6 +787,7 @@ int Computrainer::readMessage()
 {
     int rc;
 
+#ifdef WIN32
     if ((rc = rawRead(buf, 7)) > 0 && (buf[6]&128) == 0) {
 
         // we got something but need to sync
@@ -785,14 +807,44 @@ int Computrainer::readMessage()
 
     }
     return rc;
+#else
+    // already got one buffered ?
+    if (nextMessage()) return 7;
+
+    // wait up to a tenth of a second for more to arrive
+    // and take everything the device has for us
+    if ((rc = inbound.fill(devicePort, 100)) < 0) return -1;
+
+    return nextMessage() ? 7 : 0;
+#endif
 }
 
+#ifndef WIN32
+// messages are 7 bytes and only the last has the top bit set, so
+// we sync on that and skip anything before it that doesn't fit
+bool Computrainer::nextMessage()
+{
+    for (int i=6; i<inbound.count(); i++) {
+        if (inbound.at(i)&128) {
+            inbound.discard(i-6);
+            inbound.take(buf, 7);
+            return true;
+        }
+    }
+
+    // no sync byte yet, only the last 6 could be part of a message
+    if (inbound.count() > 6) inbound.discard(inbound.count() - 6);
+    return false;
+}
+#endif
+
 int Computrainer::closePort()
 {
 #ifdef WIN32
     return (int)!CloseHandle(devicePort);
 #else
     tcflush(devicePort, TCIOFLUSH); // clear out the garbage
+    inbound.clear();
     return close(devicePort);
 #endif
 }
@@ -952,27 +1004,21 @@ Q_UNUSED(size);
 
 #else
 
-    int timeout=0, i=0;
-    uint8_t byte;
-
-    // read one byte at a time sleeping when no data ready
+    // take from the buffer and wait on the device for the rest
     // until we timeout waiting then return error
-    for (i=0; i<size; i++) {
-        timeout =0;
-        rc=0;
-        while (rc==0 && timeout < CT_READTIMEOUT) {
-            rc = read(devicePort, &byte, 1);
-            if (rc == -1) return -1; // error!
-            else if (rc == 0) {
-                msleep(50); // sleep for 1/20th of a second
-                timeout += 50;
-            } else {
-                bytes[i] = byte;
-            }
-        }
-        if (timeout >= CT_READTIMEOUT) return -1; // we timed out!
-    }
+    QElapsedTimer elapsed;
+    elapsed.start();
 
+    int i = inbound.take(bytes, size);
+    while (i < size) {
+        int timeout = CT_READTIMEOUT - elapsed.elapsed();
+        if (timeout <= 0) return -1; // we timed out!
+
+        rc = inbound.fill(devicePort, timeout);
+        if (rc < 0) return -1; // error!
+
+        i += inbound.take(bytes+i, size-i);
+    }
     return i;
 
 #endif
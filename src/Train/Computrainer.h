@@ -39,6 +39,7 @@
 #include <QMutex>
 #include <QFile>
 #include "RealtimeController.h"
+#include "SerialBuffer.h"
 
 #ifdef WIN32
 #include <windows.h>
@@ -123,6 +124,7 @@ public:
 
     // SET
     void setDevice(QString deviceFilename);       // setup the device filename
+    void setTelemetryRing(TelemetryRing *ring) { this->ring = ring; } // push telemetry as it arrives
     void setLoad(double load);                  // set the load to generate in ERGOMODE
     void setGradient(double gradient);          // set the load to generate in SSMODE
     void setMode(int mode,
@@ -188,6 +190,9 @@ private:
     // i/o message holder
     uint8_t buf[7];
 
+    // where we push telemetry as it arrives
+    TelemetryRing *ring;
+
     // device port
     QString deviceFilename;
 #ifdef WIN32
@@ -196,6 +201,8 @@ private:
 #else
     int devicePort;                 // unix!!
     struct termios deviceSettings;  // unix!!
+    SerialBuffer inbound;           // bytes read but not yet parsed
+    bool nextMessage();             // take a message from inbound into buf
 #endif
     // raw device utils
     int rawWrite(uint8_t *bytes, int size); // unix!!
@@ -25,6 +25,7 @@
 ComputrainerController::ComputrainerController(TrainSidebar *parent,  DeviceConfiguration *dc) : RealtimeController(parent, dc)
 {
     myComputrainer = new Computrainer (parent, dc ? dc->portSpec : ""); // we may get NULL passed when configuring
+    myComputrainer->setTelemetryRing(&samples);
     f3Depressed = false;
 }
 
@@ -43,6 +43,7 @@ public:
 
     // telemetry push pull
     bool doesPush(), doesPull(), doesLoad();
+    int sampleInterval() { return 100; } // a tenth of a second between reads
     void getRealtimeData(RealtimeData &rtData);
     void pushRealtimeData(RealtimeData &rtData);
     void setLoad(double);
@@ -26,6 +26,7 @@
 #include <QXmlSimpleReader>
 
 #include <stdint.h>
+#include <algorithm>
 #include "Units.h"
 #include "Utils.h"
 
@@ -156,6 +157,7 @@ void ErgFile::parseZwift()
 
         // calculate climbing etc
         calculateMetrics();
+        index();
     }
 }
 
@@ -336,6 +338,7 @@ void ErgFile::parseTacx()
 
         // calculate climbing etc
         calculateMetrics();
+        index();
     }
 }
 
@@ -579,6 +582,7 @@ void ErgFile::parseComputrainer(QString p)
         rightPoint = 1;
 
         calculateMetrics();
+        index();
 
     } else {
         valid = false;
@@ -923,37 +927,48 @@ ErgFile::isValid()
     return valid;
 }
 
-int
-ErgFile::wattsAt(long x, int &lapnum)
+void
+ErgFile::index()
 {
-    // workout what wattage load should be set for any given
-    // point in time in msecs.
-    if (!isValid()) return -100; // not a valuid ergfile
-
-    // is it in bounds?
-    if (x < 0 || x > Duration) return -100;   // out of bounds!!!
-
-    // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
-
-    } else lapnum = 0;
-
-    // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
+    indexedPoints = Points;
+    indexedLaps = Laps;
+
+    pointx.resize(Points.count());
+    for (int i=0; i<Points.count(); i++) pointx[i] = Points.at(i).x;
+
+    lapx.resize(Laps.count());
+    for (int i=0; i<Laps.count(); i++) lapx[i] = Laps.at(i).x;
+    qSort(lapx);
+
+    // watts at each second, unless silly long (>24hrs)
+    tape.clear();
+    if (format != CRS && Points.count() > 1 && Duration >= 0 && Duration <= 86400000L) {
+        tape.resize(Duration/1000 + 1);
+        for (int i=0; i<tape.count(); i++) {
+            segment(i * 1000L);
+            tape[i] = interpolate(i * 1000L);
         }
     }
+    leftPoint = 0;
+    rightPoint = Points.count() > 1 ? 1 : 0;
+}
 
+void
+ErgFile::segment(long x)
+{
+    // first point at or beyond x is the right point, which is the same
+    // place the old walk forward through the points would stop at
+    int right = std::lower_bound(pointx.constBegin(), pointx.constEnd(), double(x)) - pointx.constBegin();
+    if (right < 1) right = 1;
+    if (right > pointx.count()-1) right = pointx.count()-1;
+
+    rightPoint = right;
+    leftPoint = right > 0 ? right-1 : 0;
+}
+
+int
+ErgFile::interpolate(long x) const
+{
     // two different points in time but the same watts
     // at both, it doesn't really matter which value
     // we use
@@ -981,6 +996,40 @@ ErgFile::wattsAt(long x, int &lapnum)
     return nowW;
 }
 
+int
+ErgFile::lapAt(long x)
+{
+    if (!Points.isSharedWith(indexedPoints) || !Laps.isSharedWith(indexedLaps)) index();
+
+    // laps at or before x
+    return std::upper_bound(lapx.constBegin(), lapx.constEnd(), x) - lapx.constBegin();
+}
+
+int
+ErgFile::wattsAt(long x, int &lapnum)
+{
+    // workout what wattage load should be set for any given
+    // point in time in msecs.
+    if (!isValid()) return -100; // not a valuid ergfile
+
+    // is it in bounds?
+    if (x < 0 || x > Duration) return -100;   // out of bounds!!!
+
+    // points or laps changed since we indexed?
+    if (!Points.isSharedWith(indexedPoints) || !Laps.isSharedWith(indexedLaps)) index();
+    if (Points.isEmpty()) return -100;
+
+    // do we need to return the Lap marker?
+    lapnum = lapAt(x);
+
+    // whole seconds are precomputed
+    if (x % 1000 == 0 && x/1000 < tape.count()) return tape.at(x/1000);
+
+    // find right section of the file
+    segment(x);
+    return interpolate(x);
+}
+
 double
 ErgFile::gradientAt(long x, int &lapnum)
 {
@@ -991,26 +1040,15 @@ ErgFile::gradientAt(long x, int &lapnum)
     // is it in bounds?
     if (x < 0 || x > Duration) return -100;   // out of bounds!!! (-10 through +15 are valid return vals)
 
-    // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
+    // points or laps changed since we indexed?
+    if (!Points.isSharedWith(indexedPoints) || !Laps.isSharedWith(indexedLaps)) index();
+    if (Points.isEmpty()) return -100;
 
-    } else lapnum = 0;
+    // do we need to return the Lap marker?
+    lapnum = lapAt(x);
 
     // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
-        }
-    }
+    segment(x);
     return Points.at(leftPoint).val;
 }
 
@@ -1018,12 +1056,11 @@ int ErgFile::nextLap(long x)
 {
     if (!isValid()) return -1; // not a valid ergfile
 
-    // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        for (int i=0; i<Laps.count(); i++) {
-            if (x<Laps.at(i).x) return Laps.at(i).x;
-        }
-    }
+    // first marker after x
+    if (!Points.isSharedWith(indexedPoints) || !Laps.isSharedWith(indexedLaps)) index();
+    QVector<long>::const_iterator next = std::upper_bound(lapx.constBegin(), lapx.constEnd(), x);
+    if (next != lapx.constEnd()) return *next;
+
     return -1; // nope, no marker ahead of there
 }
 
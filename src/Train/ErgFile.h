@@ -31,6 +31,7 @@
 #include <QTextStream>
 #include <QTextEdit>
 #include <QRegExp>
+#include <QVector>
 #include "Zones.h"      // For zones ... see below vvvv
 
 // which section of the file are we in?
@@ -113,6 +114,7 @@ class ErgFile
         int wattsAt(long, int&);      // return the watts value for the passed msec
         double gradientAt(long, int&);      // return the gradient value for the passed meter
         int nextLap(long);      // return the msecs value for the next Lap marker
+        int lapAt(long);        // return the lap number at the passed msec/meter
 
         // turn the ergfile into a series of sections rather
         // than a list of points
@@ -152,6 +154,23 @@ class ErgFile
 
         Context *context;
 
+    private:
+
+        // Lookups are indexed so seeking in a long course is not a walk along
+        // all the points. The index is rebuilt whenever it is used after Points
+        // or Laps have been changed, we hold a shallow copy of each so any
+        // change (which detaches them) is spotted without callers having to
+        // tell us. For erg/mrc we also keep the load at every second, since
+        // WPrime and the train view ask for whole seconds most of the time.
+        void index();
+        void segment(long x);           // set leftPoint/rightPoint for x
+        int interpolate(long x) const;  // watts between left and right point
+
+        QList<ErgFilePoint> indexedPoints;
+        QList<ErgFileLap> indexedLaps;
+        QVector<double> pointx;         // Points x, in order
+        QVector<long> lapx;             // Laps x, sorted
+        QVector<int> tape;              // erg/mrc watts each second
 };
 
 #endif
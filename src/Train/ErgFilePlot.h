@@ -140,7 +140,7 @@ class ErgFilePlot : public QwtPlot
 
     public slots:
 
-    void performancePlot(RealtimeData);
+    void performancePlot(const RealtimeData &);
     void configChanged(qint32);
     void start();
 
@@ -54,6 +54,7 @@ const static uint8_t slope_command[12] = {
 Fortius::Fortius(QObject *parent) : QThread(parent)
 {
     
+    ring = NULL;
     devicePower = deviceHeartRate = deviceCadence = deviceSpeed = 0.00;
     mode = FT_IDLE;
     load = DEFAULT_LOAD;
@@ -450,6 +451,15 @@ void Fortius::run()
                 deviceHeartRate = curHeartRate;
                 devicePower = curPower;
                 pvars.unlock();
+
+                if (ring) {
+                    RealtimeData sample;
+                    sample.setWatts(curPower);
+                    sample.setHr(curHeartRate);
+                    sample.setCadence(curCadence);
+                    sample.setSpeed(curSpeed);
+                    ring->push(sample);
+                }
             }
         }
 
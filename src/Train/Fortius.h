@@ -102,6 +102,7 @@ public:
     void setPowerScaleFactor(double calibrationFactor);         // Scales output power, so user can adjust to match hub or crank power meter
     void setMode(int mode);
     void setWeight(double weight);                 // set the total weight of rider + bike in kg's
+    void setTelemetryRing(TelemetryRing *ring) { this->ring = ring; } // push telemetry as it arrives
     
     int getMode();
     double getGradient();
@@ -158,6 +159,9 @@ private:
     // i/o message holder
     uint8_t buf[64];
 
+    // where we push telemetry as it arrives
+    TelemetryRing *ring;
+
     // device port
     LibUsb *usb2;                   // used for USB2 support
 
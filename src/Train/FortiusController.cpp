@@ -23,6 +23,7 @@
 FortiusController::FortiusController(TrainSidebar *parent,  DeviceConfiguration *dc) : RealtimeController(parent, dc)
 {
     myFortius = new Fortius (parent);
+    myFortius->setTelemetryRing(&samples);
 }
 
 
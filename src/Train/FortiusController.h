@@ -47,6 +47,7 @@ public:
 
     // telemetry push pull
     bool doesPush(), doesPull(), doesLoad();
+    int sampleInterval() { return 10; } // read as fast as the brake answers
     void getRealtimeData(RealtimeData &rtData);
     void pushRealtimeData(RealtimeData &rtData);
     void setLoad(double);
@@ -25,7 +25,8 @@ Kettler::Kettler(QObject *parent,  QString devname) : QObject(parent),
     m_heartRate(0),
     m_power(0),
     m_cadence(0),
-    m_isKettlerConnectionAlive(true)
+    m_isKettlerConnectionAlive(true),
+    ring(NULL)
 {
     m_kettlerConnection.setSerialPort(devname);
     connect(&m_kettlerConnection, SIGNAL(power(quint32)), this, SLOT(newPower(quint32)), Qt::QueuedConnection);
@@ -68,6 +69,16 @@ void Kettler::newHeartRate(quint32 heartRate)
 void Kettler::newPower(quint32 power)
 {
     m_power = power;
+
+    // power comes last in each reply, so the rest are up to date
+    if (ring) {
+        RealtimeData sample;
+        sample.setWatts(m_power);
+        sample.setHr(m_heartRate);
+        sample.setCadence(m_cadence);
+        sample.setSpeed(m_speed);
+        ring->push(sample);
+    }
 }
 
 void Kettler::newSpeed(double speed)
@@ -48,6 +48,7 @@ public:
 
     void setLoad(double load);
     bool isConnected();
+    void setTelemetryRing(TelemetryRing *ring) { this->ring = ring; } // push telemetry as it arrives
 
 private:
     KettlerConnection m_kettlerConnection;
@@ -56,6 +57,7 @@ private:
     quint32 m_cadence;
     double m_speed; // in km/h
     bool m_isKettlerConnectionAlive;
+    TelemetryRing *ring;
 
 private slots:
     void newHeartRate(quint32);
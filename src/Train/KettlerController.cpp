@@ -27,6 +27,7 @@
 KettlerController::KettlerController(TrainSidebar *parent,  DeviceConfiguration *dc) : RealtimeController(parent, dc)
 {
     m_kettler = new Kettler(this, dc ? dc->portSpec : "");
+    m_kettler->setTelemetryRing(&samples);
 }
 
 bool KettlerController::find()
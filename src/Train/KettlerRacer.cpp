@@ -25,7 +25,8 @@ KettlerRacer::KettlerRacer(QObject *parent,  QString devname) : QObject(parent),
     m_heartRate(0),
     m_power(0),
     m_cadence(0),
-    m_isKettlerRacerConnectionAlive(true)
+    m_isKettlerRacerConnectionAlive(true),
+    ring(NULL)
 {
     m_kettlerRacerConnection = new KettlerRacerConnection;
     m_kettlerRacerConnection->setSerialPort(devname);
@@ -72,6 +73,16 @@ void KettlerRacer::newHeartRate(quint32 heartRate)
 void KettlerRacer::newPower(quint32 power)
 {
     m_power = power;
+
+    // power comes last in each reply, so the rest are up to date
+    if (ring) {
+        RealtimeData sample;
+        sample.setWatts(m_power);
+        sample.setHr(m_heartRate);
+        sample.setCadence(m_cadence);
+        sample.setSpeed(m_speed);
+        ring->push(sample);
+    }
 }
 
 void KettlerRacer::newSpeed(double speed)
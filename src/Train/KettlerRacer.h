@@ -48,6 +48,7 @@ public:
 
     void setLoad(double load);
     bool isConnected();
+    void setTelemetryRing(TelemetryRing *ring) { this->ring = ring; } // push telemetry as it arrives
 
 private:
     KettlerRacerConnection *m_kettlerRacerConnection;
@@ -56,6 +57,7 @@ private:
     quint32 m_cadence;
     double m_speed; // in km/h
     bool m_isKettlerRacerConnectionAlive;
+    TelemetryRing *ring;
 
 private slots:
     void newHeartRate(quint32);
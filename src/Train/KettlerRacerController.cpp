@@ -27,6 +27,7 @@
 KettlerRacerController::KettlerRacerController(TrainSidebar *parent,  DeviceConfiguration *dc) : RealtimeController(parent, dc)
 {
     m_kettlerRacer = new KettlerRacer(this, dc ? dc->portSpec : "");
+    m_kettlerRacer->setTelemetryRing(&samples);
 }
 
 bool KettlerRacerController::find()
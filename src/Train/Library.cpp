@@ -29,6 +29,13 @@
 #include <QApplication>
 #include <QDirIterator>
 #include <QFileInfo>
+#include <QSharedPointer>
+
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentMap>
+#endif
 
 // helpers
 #ifdef Q_OS_MAC
@@ -601,35 +608,95 @@ LibrarySearchDialog::removeReference()
     }
 }
 
-void
-LibrarySearchDialog::updateDB()
-{
-    // wipe away all user data before updating
-    trainDB->rebuildDB();
+//
+// Updating the library
+//
+// A library on a network drive can hold tens of thousands of workouts so rather
+// than wiping the db and parsing every file again on each search, we remember the
+// size and modification time of the files we imported and only look at the ones
+// that are new or have changed. They are parsed in batches on the thread pool and
+// each batch is written to the db in a single transaction. A workout's TSS and IF
+// depend on the athlete's CP too, so they are parsed again when that changes.
+//
+struct LibraryFile {
 
-    trainDB->startLUW();
+    enum { Video, VideoSync, Workout };
 
-    // workouts
-    foreach(QString ergFile, workoutsFound) {
-        int mode=0;
-        ErgFile file(ergFile, mode, context);
-        if (file.isValid()) {
-            trainDB->importWorkout(ergFile, &file);
+    LibraryFile() : type(Video), reference(false), known(false), changed(true), cp(0), context(NULL) {}
+    LibraryFile(QString path, int type, bool reference, double cp, Context *context) :
+        path(path), type(type), reference(reference), known(false), changed(true), cp(cp), context(context) {}
+
+    QString path;
+    int type;
+    bool reference;             // drag-n-dropped, must be valid to import
+    bool known, changed;        // seen before, and changed since
+    TrainDB::FileState was, is; // last time and now
+    double cp;                  // in effect now, for workouts
+
+    Context *context;
+    QSharedPointer<ErgFile> workout;
+    QSharedPointer<VideoSyncFile> videosync;
+};
+
+// files to parse in each batch
+static const int LIBRARY_BATCH = 256;
+
+// runs on the thread pool
+static LibraryFile
+scanLibraryFile(const LibraryFile &file)
+{
+    LibraryFile returning = file;
+
+    QFileInfo info(file.path);
+    returning.is.size = info.size();
+    returning.is.modified = info.lastModified().toTime_t();
+    returning.is.valid = true;
+    returning.is.cp = file.type == LibraryFile::Workout ? file.cp : 0;
+
+    // nothing to do if its the same as last time
+    returning.changed = !file.known || file.was.size != returning.is.size ||
+                        file.was.modified != returning.is.modified ||
+                        file.was.cp != returning.is.cp;
+    if (!returning.changed) return returning;
+
+    int mode=0;
+    switch (file.type) {
+
+    case LibraryFile::Workout:
+        returning.workout = QSharedPointer<ErgFile>(new ErgFile(file.path, mode, file.context));
+        returning.is.valid = returning.workout->isValid();
+        break;
+
+    case LibraryFile::VideoSync:
+        // only references are checked, the db doesn't hold anything from the file
+        if (file.reference) {
+            returning.videosync = QSharedPointer<VideoSyncFile>(new VideoSyncFile(file.path, mode, file.context));
+            returning.is.valid = returning.videosync->isValid();
         }
-    }
+        break;
 
-    // videos
-    foreach(QString video, videosFound) {
-        trainDB->importVideo(video);
+    default:
+        break;
     }
+    return returning;
+}
 
-    // videosyncs
-    foreach(QString videosync, videosyncsFound) {
-        int mode=0;
-        VideoSyncFile file(videosync, mode, context);
-        trainDB->importVideoSync(videosync, &file);
+void
+LibrarySearchDialog::updateDB()
+{
+    // workouts' TSS and IF are worked out with the CP now, as ErgFile does
+    double cp = 0;
+    if (context->athlete->zones(false)) {
+        int range = context->athlete->zones(false)->whichRange(QDate::currentDate());
+        if (range >= 0) cp = context->athlete->zones(false)->getCP(range);
     }
 
+    // everything we found
+    QList<LibraryFile> files;
+    foreach(QString ergFile, workoutsFound) files << LibraryFile(ergFile, LibraryFile::Workout, false, cp, context);
+    foreach(QString video, videosFound) files << LibraryFile(video, LibraryFile::Video, false, cp, context);
+    foreach(QString videosync, videosyncsFound) files << LibraryFile(videosync, LibraryFile::VideoSync, false, cp, context);
+
     // Now check and re-add references, if there are any
     // these are files which were drag-n-dropped into the
     // GC train window, but which were referenced not
@@ -641,28 +708,68 @@ LibrarySearchDialog::updateDB()
 
             if (!QFile(r).exists()) continue;
 
-            // is a video?
-            if (helper.isMedia(r)) trainDB->importVideo(r);
+            if (helper.isMedia(r)) files << LibraryFile(r, LibraryFile::Video, true, cp, context);
+            if (VideoSyncFile::isVideoSync(r)) files << LibraryFile(r, LibraryFile::VideoSync, true, cp, context);
+            if (ErgFile::isWorkout(r)) files << LibraryFile(r, LibraryFile::Workout, true, cp, context);
+        }
+    }
+
+    // what did we see last time?
+    QHash<QString, TrainDB::FileState> scanned = trainDB->scannedFiles();
+    QSet<QString> keep;
+    for (int i=0; i<files.count(); i++) {
+        QHash<QString, TrainDB::FileState>::const_iterator it = scanned.constFind(files[i].path);
+        if (it != scanned.constEnd()) {
+            files[i].known = true;
+            files[i].was = it.value();
+        }
+    }
 
-            // is a videosync?
-            if (VideoSyncFile::isVideoSync(r)) {
-                int mode=0;
-                VideoSyncFile file(r, mode, context);
-                if (file.isValid()) {
-                    trainDB->importVideoSync(r, &file);
-                }
+    pathLabelTitle->setText(tr("Updating"));
+    searchButton->hide();
+    cancelButton->hide();
+
+    for (int from=0; from < files.count(); from += LIBRARY_BATCH) {
+
+        pathLabel->setText(QString(tr("%1 of %2 files")).arg(from).arg(files.count()));
+        QApplication::processEvents();
+
+        QList<LibraryFile> batch = QtConcurrent::blockingMapped(files.mid(from, LIBRARY_BATCH), scanLibraryFile);
+
+        trainDB->startLUW();
+        foreach(const LibraryFile &file, batch) {
+
+            // the db already has it, or knows it is bad
+            if (!file.changed) {
+                keep << file.path;
+                continue;
             }
 
-            // is a workout?
-            if (ErgFile::isWorkout(r)) {
-                int mode=0;
-                ErgFile file(r, mode, context);
-                if (file.isValid()) {
-                    trainDB->importWorkout(r, &file);
+            // bad files are remembered so we don't parse them again, but
+            // not drag-n-dropped references, which must be valid to keep
+            if (!file.is.valid) {
+                if (file.known) trainDB->deleteWorkout(file.path); // was a good workout last time
+                if (!file.reference) {
+                    trainDB->importFile(file.path, file.is);
+                    keep << file.path;
                 }
+                continue;
+            }
+
+            keep << file.path;
+            switch (file.type) {
+            case LibraryFile::Workout: trainDB->importWorkout(file.path, file.workout.data()); break;
+            case LibraryFile::VideoSync: trainDB->importVideoSync(file.path, file.videosync.data()); break;
+            default: trainDB->importVideo(file.path); break;
             }
+            trainDB->importFile(file.path, file.is);
         }
+        trainDB->endLUW(false);
     }
+
+    // anything we didn't find this time is removed
+    trainDB->startLUW();
+    trainDB->removeAllExcept(keep);
     trainDB->endLUW();
 }
 
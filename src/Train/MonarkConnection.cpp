@@ -35,7 +35,8 @@ MonarkConnection::MonarkConnection() :
     m_mode(MONARK_MODE_WATT),
     m_power(0),
     m_cadence(0),
-    m_pulse(0)
+    m_pulse(0),
+    ring(NULL)
 {
 }
 
@@ -142,6 +143,15 @@ void MonarkConnection::requestAll()
     requestPulse();
     requestCadence();
 
+    if (ring) {
+        RealtimeData sample;
+        sample.setWatts(m_power);
+        sample.setHr(m_pulse);
+        sample.setCadence(m_cadence);
+        sample.setSlope(m_kp);
+        ring->push(sample);
+    }
+
     if ((m_loadToWrite != m_load) && m_mode == MONARK_MODE_WATT && canDoLoad())
     {
         QString cmd = QString("power %1\r").arg(m_loadToWrite);
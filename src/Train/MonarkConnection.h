@@ -23,6 +23,7 @@
 #include <QThread>
 #include <QTimer>
 #include <QMutex>
+#include "TelemetryRing.h"
 
 class MonarkConnection : public QThread
 {
@@ -39,6 +40,7 @@ public:
     quint32 cadence();
     quint32 pulse();
     double kp();
+    void setTelemetryRing(TelemetryRing *ring) { this->ring = ring; } // push telemetry as it arrives
 
 public slots:
     void requestAll();
@@ -73,6 +75,7 @@ private:
     quint32 m_power;
     quint32 m_cadence;
     quint32 m_pulse;
+    TelemetryRing *ring;
 
 signals:
     void pulse(quint32);
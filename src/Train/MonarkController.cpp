@@ -28,6 +28,7 @@ MonarkController::MonarkController(TrainSidebar *parent,  DeviceConfiguration *d
 {
     m_monark = new MonarkConnection();
     m_monark->setSerialPort(dc ? dc->portSpec : "");
+    m_monark->setTelemetryRing(&samples);
 }
 
 bool MonarkController::find()
@@ -20,6 +20,7 @@
 // Abstract base class for Realtime device controllers
 #include "RealtimeData.h"
 #include "CalibrationData.h"
+#include "TelemetryRing.h"
 #include "TrainSidebar.h"
 
 #ifndef _GC_RealtimeController_h
@@ -53,10 +54,18 @@ public:
     virtual bool doesPull();                    // this device is a pull device (e.g. CT)
     virtual bool doesLoad();                    // this device can generate Load
 
+    // nominal msecs between updates, devices that don't push
+    // samples are only read on each screen refresh
+    virtual int sampleInterval() { return REFRESHRATE; }
+
     // will update the realtime data with current data (only called for doesPull devices)
     virtual void getRealtimeData(RealtimeData &rtData); // update realtime data with current values
     virtual void pushRealtimeData(RealtimeData &rtData); // update realtime data with current values
 
+    // every update as it arrives from the device thread, drained by TrainSidebar
+    // on each refresh. devices that don't push to it are only polled as above
+    TelemetryRing samples;
+
     // only relevant for Computrainer like devices
     virtual void setLoad(double) { return; }
     virtual void setGradient(double) { return; }
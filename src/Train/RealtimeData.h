@@ -24,6 +24,7 @@
 #include <stdint.h> // uint8_t
 #include <QString>
 #include <QApplication>
+#include <QSharedPointer>
 
 class RealtimeData
 {
@@ -157,4 +158,7 @@ private:
     bool trainerBrakeFault;
 };
 
+// published by TrainSidebar on each refresh and shared by the charts
+typedef QSharedPointer<const RealtimeData> RealtimeSnapshot;
+
 #endif
@@ -163,7 +163,7 @@ RealtimePlotWindow::pause()
 }
 
 void
-RealtimePlotWindow::telemetryUpdate(RealtimeData rtData)
+RealtimePlotWindow::telemetryUpdate(const RealtimeData &rtData)
 {
 
     // lets apply smoothing if we have to
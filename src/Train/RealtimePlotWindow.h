@@ -73,7 +73,7 @@ class RealtimePlotWindow : public GcChartWindow
    public slots:
 
         // trap signals
-        void telemetryUpdate(RealtimeData rtData); // got new data
+        void telemetryUpdate(const RealtimeData &rtData); // got new data
         void configChanged(qint32);
         void start();
         void stop();
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "SerialBuffer.h"
+
+#include <string.h>
+#include <errno.h>
+
+#ifndef WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+SerialBuffer::SerialBuffer(int capacity) : head_(0), count_(0)
+{
+    // round up to a power of two so we can mask the indexes
+    capacity_ = 64;
+    while (capacity_ < capacity) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    data_ = new uint8_t[capacity_];
+}
+
+SerialBuffer::~SerialBuffer()
+{
+    delete[] data_;
+}
+
+int
+SerialBuffer::append(const uint8_t *bytes, int size)
+{
+    if (size <= 0) return 0;
+
+    // only the most recent capacity bytes can be kept
+    if (size > capacity_) {
+        bytes += size - capacity_;
+        size = capacity_;
+    }
+
+    // make room by dropping the oldest, the parser will resync
+    if (size > space()) discard(size - space());
+
+    int tail = (head_ + count_) & mask_;
+    int first = capacity_ - tail;
+    if (first > size) first = size;
+
+    memcpy(data_ + tail, bytes, first);
+    if (size > first) memcpy(data_, bytes + first, size - first);
+    count_ += size;
+
+    return size;
+}
+
+int
+SerialBuffer::take(uint8_t *bytes, int size)
+{
+    if (size > count_) size = count_;
+    if (size <= 0) return 0;
+
+    int first = capacity_ - head_;
+    if (first > size) first = size;
+
+    memcpy(bytes, data_ + head_, first);
+    if (size > first) memcpy(bytes + first, data_, size - first);
+    discard(size);
+
+    return size;
+}
+
+void
+SerialBuffer::discard(int size)
+{
+    if (size >= count_) {
+        clear();
+        return;
+    }
+    if (size <= 0) return;
+
+    head_ = (head_ + size) & mask_;
+    count_ -= size;
+}
+
+#ifndef WIN32
+int
+SerialBuffer::wait(int fd, int msecs)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int rc;
+    do {
+        rc = poll(&pfd, 1, msecs);
+    } while (rc == -1 && errno == EINTR);
+
+    if (rc == -1) return -errno;
+    if (rc == 0) return 0;
+
+    // device went away (e.g. usb serial unplugged)
+    if (pfd.revents & (POLLERR | POLLNVAL)) return -EIO;
+    if ((pfd.revents & POLLHUP) && !(pfd.revents & POLLIN)) return -ENXIO;
+
+    return 1;
+}
+
+int
+SerialBuffer::fill(int fd, int msecs)
+{
+    int rc = wait(fd, msecs);
+    if (rc <= 0) return rc;
+
+    // read everything there, the fd is non-blocking
+    uint8_t chunk[512];
+    int total = 0;
+    while (1) {
+        int n = read(fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            append(chunk, n);
+            total += n;
+            if (n < int(sizeof(chunk))) break;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            // readable but eof, or an error
+            if (total == 0) return n == 0 ? -ENXIO : -errno;
+            break;
+        }
+    }
+    return total;
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_SerialBuffer_h
+#define _GC_SerialBuffer_h 1
+
+#include <stdint.h>
+
+//
+// Receive buffer for the serial device drivers (ANT, Computrainer)
+//
+// The drivers used to read the device a byte at a time and sleep for a
+// while whenever nothing was there. Instead we read whatever is available
+// in one go into this ring buffer and the driver parses whole messages out
+// of it. On unix fill() waits in poll() for the device to become readable so
+// we wake as soon as data arrives rather than when a sleep expires.
+//
+// It is only ever used by the device thread that owns it, so no locking.
+//
+class SerialBuffer
+{
+    public:
+
+        SerialBuffer(int capacity = 4096);
+        ~SerialBuffer();
+
+        int count() const { return count_; }
+        int space() const { return capacity_ - count_; }
+        void clear() { head_ = count_ = 0; }
+
+        // byte at offset from the front, offset must be < count()
+        uint8_t at(int offset) const { return data_[(head_ + offset) & mask_]; }
+
+        // append bytes we have read from somewhere else, returns
+        // how many were stored; if we overflow the oldest are dropped
+        int append(const uint8_t *bytes, int size);
+
+        // copy out and remove from the front
+        int take(uint8_t *bytes, int size);
+        void discard(int size);
+
+#ifndef WIN32
+        // wait up to msecs for fd to be readable, returns 1 when ready, 0 on
+        // timeout and -errno on error
+        static int wait(int fd, int msecs);
+
+        // wait for data then read everything available on fd, returns the
+        // number of bytes added, 0 on timeout and -errno on error
+        int fill(int fd, int msecs);
+#endif
+
+    private:
+
+        uint8_t *data_;
+        int capacity_, mask_;
+        int head_, count_;
+};
+
+#endif // _GC_SerialBuffer_h
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "SessionJournal.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideFile.h"
+#include "JsonRideFile.h"
+#include "DataProcessor.h"
+#include "RideMetadata.h" // for linked defaults processing
+
+#include <QFileInfo>
+
+#include <math.h>
+
+#include <stddef.h> // offsetof
+#include <string.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// at the front of the file
+struct SessionHeader
+{
+    char magic[4];              // GCSJ
+    quint32 version;
+    qint64 start;               // msecs since the epoch
+    quint32 recordSize;         // sizeof(SessionRecord) when written
+    quint32 interval;           // nominal msecs between samples, 0 if not known
+};
+
+static const char MAGIC[4] = { 'G', 'C', 'S', 'J' };
+static const quint32 VERSION = 1;
+
+// records are written and read in native byte order, a journal is only
+// ever read back on the machine that wrote it
+static quint16
+recordChecksum(const SessionRecord &record)
+{
+    return qChecksum((const char *)&record, offsetof(SessionRecord, checksum));
+}
+
+SessionJournal::SessionJournal()
+{
+}
+
+SessionJournal::~SessionJournal()
+{
+    close();
+}
+
+bool
+SessionJournal::open(QString filename, QDateTime start, int interval)
+{
+    close();
+
+    file.setFileName(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) return false;
+
+    SessionHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.start = start.toMSecsSinceEpoch();
+    header.recordSize = sizeof(SessionRecord);
+    header.interval = qMax(0, interval);
+
+    if (file.write((const char *)&header, sizeof(header)) != sizeof(header)) {
+        file.close();
+        return false;
+    }
+
+    // make sure the header is there before we start
+    return checkpoint();
+}
+
+bool
+SessionJournal::append(SessionRecord &record)
+{
+    if (!file.isOpen()) return false;
+
+    record.spare = 0;
+    record.checksum = recordChecksum(record);
+    return file.write((const char *)&record, sizeof(record)) == sizeof(record);
+}
+
+bool
+SessionJournal::checkpoint()
+{
+    if (!file.isOpen()) return false;
+
+    // out of our buffers and then out of the OS buffers
+    if (!file.flush()) return false;
+#ifdef WIN32
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+void
+SessionJournal::close()
+{
+    if (!file.isOpen()) return;
+
+    checkpoint();
+    file.close();
+}
+
+bool
+SessionJournal::remove()
+{
+    close();
+    return file.remove();
+}
+
+RideFile *
+SessionJournal::read(QString filename, QStringList &errors)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) {
+        errors << QObject::tr("Could not open session journal %1").arg(filename);
+        return NULL;
+    }
+
+    SessionHeader header;
+    if (file.read((char *)&header, sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, MAGIC, sizeof(MAGIC)) || header.version != VERSION ||
+        header.recordSize != sizeof(SessionRecord)) {
+        errors << QObject::tr("%1 is not a session journal").arg(filename);
+        return NULL;
+    }
+
+    RideFile *ride = new RideFile(QDateTime::fromMSecsSinceEpoch(header.start), 1);
+    ride->setDeviceType("GoldenCheetah");
+    ride->setFileFormat("GoldenCheetah Session Journal (gcj)");
+
+    // the samples aren't evenly spaced, but the devices' nominal
+    // rate is what the recording interval means for an activity
+    if (header.interval > 0) ride->setRecIntSecs(header.interval / 1000.0);
+
+    XDataSeries *trainSeries = NULL;
+    quint32 last = 0;
+
+    SessionRecord record;
+    while (file.read((char *)&record, sizeof(record)) == sizeof(record)) {
+
+        // anything after a bad record was being written when we crashed
+        if (record.checksum != recordChecksum(record)) break;
+
+        // samples arriving together are merged into one record when they
+        // are written, so a repeated time can only be a duplicate
+        if (!ride->dataPoints().isEmpty() && record.msecs <= last) continue;
+        last = record.msecs;
+
+        // records are written as samples arrive, not on a fixed tick
+        double secs = record.msecs / 1000.0;
+
+        ride->appendPoint(secs, record.cad, record.hr, record.km,
+                          record.kph, record.nm, record.watts, record.alt,
+                          0.0, 0.0, 0.0, record.slope, RideFile::NA, record.lrbalance,
+                          record.lte, record.rte, record.lps, record.rps,
+                          0.0, 0.0,
+                          0.0, 0.0, 0.0, 0.0,
+                          0.0, 0.0, 0.0, 0.0,
+                          record.smo2, record.thb,
+                          0.0, 0.0, 0.0, 0.0, record.lap);
+
+        if (record.target > 0.0) {
+            if (trainSeries == NULL)  {
+                trainSeries = new XDataSeries();
+                trainSeries->name = "TRAIN";
+                trainSeries->valuename << "TARGET";
+                trainSeries->unitname << "Watts";
+            }
+
+            XDataPoint *p = new XDataPoint();
+            p->secs = secs;
+            p->km = record.km;
+            p->number[0] = record.target;
+            trainSeries->datapoints.append(p);
+        }
+    }
+    if (trainSeries) ride->addXData("TRAIN", trainSeries);
+
+    return ride;
+}
+
+// an activity already saved from the same journal, we compare what was
+// recorded rather than trust the tags, it may predate them
+static bool
+sameActivity(Context *context, QString filename, const RideFile *ride)
+{
+    QFile file(filename);
+    QStringList errors;
+    RideFile *saved = RideFileFactory::instance().openRideFile(context, file, errors);
+    if (saved == NULL) return false;
+
+    // the json writer keeps whole seconds for the start and
+    // about 6 significant digits for the samples
+    bool same = qAbs(saved->startTime().msecsTo(ride->startTime())) < 1000 &&
+                saved->dataPoints().count() == ride->dataPoints().count();
+    for (int i=0; same && i<ride->dataPoints().count(); i++) {
+        const RideFilePoint *a = saved->dataPoints()[i];
+        const RideFilePoint *b = ride->dataPoints()[i];
+        same = fabs(a->secs - b->secs) <= 0.01 + fabs(b->secs) * 1e-5 &&
+               fabs(a->watts - b->watts) <= 0.5 && fabs(a->hr - b->hr) <= 0.5 &&
+               fabs(a->cad - b->cad) <= 0.5;
+    }
+    delete saved;
+    return same;
+}
+
+bool
+SessionJournal::import(Context *context, QString filename, QStringList &errors, bool select)
+{
+    RideFile *ride = read(filename, errors);
+    if (ride == NULL) return false;
+
+    // stopped before anything was recorded
+    if (ride->dataPoints().isEmpty()) {
+        delete ride;
+        QFile::remove(filename);
+        return true;
+    }
+
+    // as the import wizard does for any other file
+    QString journalname = QFileInfo(filename).fileName();
+    ride->setTag("Source Filename", journalname);
+    context->athlete->rideMetadata()->setLinkedDefaults(ride);
+    DataProcessorFactory::instance().autoProcess(ride, "Auto", "Import");
+    ride->recalculateDerivedSeries();
+
+    // the filename is the start time, if there is already an activity
+    // from this journal (we crashed after saving but before removing it)
+    // we are done, otherwise start a second later rather than overwrite
+    // someone else's or give up
+    QDateTime ridedatetime = ride->startTime();
+    QString targetnosuffix, target;
+    for (int tries = 0; ; tries++) {
+
+        QChar zero = QLatin1Char ( '0' );
+        targetnosuffix = QString ( "%1_%2_%3_%4_%5_%6" )
+                           .arg ( ridedatetime.date().year(), 4, 10, zero )
+                           .arg ( ridedatetime.date().month(), 2, 10, zero )
+                           .arg ( ridedatetime.date().day(), 2, 10, zero )
+                           .arg ( ridedatetime.time().hour(), 2, 10, zero )
+                           .arg ( ridedatetime.time().minute(), 2, 10, zero )
+                           .arg ( ridedatetime.time().second(), 2, 10, zero );
+
+        target = context->athlete->home->activities().canonicalPath() + "/" + targetnosuffix + ".json";
+        if (!QFileInfo(target).exists()) break;
+
+        if (sameActivity(context, target, ride)) {
+            delete ride;
+            QFile::remove(filename);
+            return true;
+        }
+
+        // leave the journal so nothing is lost
+        if (tries == 60) {
+            errors << QObject::tr("Activity %1 already exists").arg(targetnosuffix + ".json");
+            delete ride;
+            return false;
+        }
+        ridedatetime = ridedatetime.addSecs(1);
+    }
+    ride->setStartTime(ridedatetime);
+    ride->setTag("Filename", targetnosuffix + ".json");
+
+    JsonFileReader reader;
+    QFile out(target);
+    if (!reader.writeRideFile(context, ride, out)) {
+        errors << QObject::tr("Could not save activity %1").arg(target);
+        delete ride;
+        return false;
+    }
+
+    context->athlete->addRide(targetnosuffix + ".json", true, select);
+
+    // now metrics have been calculated
+    DataProcessorFactory::instance().autoProcess(ride, "Save", "ADD");
+    delete ride;
+
+    // its safely in the activities now
+    QFile::remove(filename);
+    return true;
+}
+
+QStringList
+SessionJournal::orphans(QDir dir)
+{
+    QStringList returning;
+    foreach(QString name, dir.entryList(QStringList() << QString("*.%1").arg(suffix()), QDir::Files, QDir::Name))
+        returning << dir.absoluteFilePath(name);
+    return returning;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_SessionJournal_h
+#define _GC_SessionJournal_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+
+class Context;
+class RideFile;
+
+// a sample recorded during the session as it arrived from the devices,
+// every record is the same size so a torn write at the end of the file
+// is simply dropped
+struct SessionRecord
+{
+    quint32 msecs;              // since the session started
+    qint32 lap;
+    float cad, hr, km, kph, nm, watts, alt, slope;
+    float lrbalance, lte, rte, lps, rps;
+    float smo2, thb, o2hb, hhb;
+    float target;               // load when in erg mode
+    quint16 checksum;           // of everything above
+    quint16 spare;
+};
+
+//
+// Train mode recording
+//
+// Samples are appended to a small binary journal in the athlete's records
+// folder as they are recorded, and every so often we checkpoint it to disk
+// so a crash or power cut loses at most the last few seconds. When the
+// session stops the journal is converted straight into a RideFile and saved
+// as an activity, and the journal deleted.
+//
+// Any journals found when train view starts are from sessions that didn't
+// finish, they get recovered and imported the same way.
+//
+class SessionJournal
+{
+    public:
+
+        SessionJournal();
+        ~SessionJournal();
+
+        // create a new journal for a session starting now, interval is
+        // the devices' nominal msecs between samples
+        bool open(QString filename, QDateTime start, int interval);
+        bool isOpen() const { return file.isOpen(); }
+        QString fileName() const { return file.fileName(); }
+
+        // add a record, it is buffered until the next checkpoint
+        bool append(SessionRecord &record);
+
+        // flush and sync to disk
+        bool checkpoint();
+
+        void close();
+        bool remove();
+
+        // read a journal, even one that was never closed
+        static RideFile *read(QString filename, QStringList &errors);
+
+        // convert to an activity and add to the ride cache, the journal
+        // is removed once the activity has been saved
+        static bool import(Context *context, QString filename, QStringList &errors, bool select=true);
+
+        // journals left behind by sessions that didn't stop cleanly
+        static QStringList orphans(QDir dir);
+
+        static const char *suffix() { return "gcj"; }
+
+    private:
+
+        QFile file;
+};
+
+#endif // _GC_SessionJournal_h
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TelemetryRing.h"
+
+#include <QElapsedTimer>
+
+// started before main() runs, so before any device threads
+static struct TelemetryClock {
+    TelemetryClock() { timer.start(); }
+    QElapsedTimer timer;
+} telemetryClock;
+
+qint64
+TelemetryRing::now()
+{
+    return telemetryClock.timer.elapsed();
+}
+
+// QAtomicInt is used for its ordering guarantees, fetchAndAddOrdered(0)
+// is a read with a full barrier and fetchAndStoreOrdered a barriered
+// write, they are the same on Qt4 and Qt5
+TelemetryRing::TelemetryRing() : head(0), tail(0), dropped(0)
+{
+}
+
+bool
+TelemetryRing::push(const RealtimeData &data)
+{
+    int h = head.fetchAndAddOrdered(0);
+    int t = tail.fetchAndAddOrdered(0);
+
+    // full, the consumer is behind
+    if (h - t >= Capacity) {
+        dropped.fetchAndAddOrdered(1);
+        return false;
+    }
+
+    TelemetrySample &slot = samples[h & (Capacity-1)];
+    slot.msecs = now();
+    slot.data = data;
+
+    // publish it
+    head.fetchAndStoreOrdered(h + 1);
+    return true;
+}
+
+bool
+TelemetryRing::pop(TelemetrySample &sample)
+{
+    int t = tail.fetchAndAddOrdered(0);
+    int h = head.fetchAndAddOrdered(0);
+
+    if (h == t) return false; // empty
+
+    sample = samples[t & (Capacity-1)];
+
+    // give the slot back
+    tail.fetchAndStoreOrdered(t + 1);
+    return true;
+}
+
+void
+TelemetryRing::clear()
+{
+    tail.fetchAndStoreOrdered(head.fetchAndAddOrdered(0));
+}
+
+int
+TelemetryRing::count() const
+{
+    return head.fetchAndAddOrdered(0) - tail.fetchAndAddOrdered(0);
+}
+
+int
+TelemetryRing::overruns() const
+{
+    return dropped.fetchAndAddOrdered(0);
+}
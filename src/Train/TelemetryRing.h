@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TelemetryRing_h
+#define _GC_TelemetryRing_h 1
+#include "GoldenCheetah.h"
+
+#include "RealtimeData.h"
+#include <QAtomicInt>
+
+// a telemetry update and when it arrived from the device
+struct TelemetrySample
+{
+    qint64 msecs;           // TelemetryRing::now() when it was pushed
+    RealtimeData data;
+};
+
+//
+// Hands telemetry from a device thread to TrainSidebar without locking
+//
+// The device thread pushes a sample each time it decodes an update and the
+// sidebar drains them on each screen refresh, so nothing is lost when the
+// device updates faster than we refresh (Fortius is 100Hz, ANT power 4Hz).
+// There must only ever be one thread pushing and one thread popping.
+//
+// If the consumer falls behind the newest samples are dropped and counted
+// rather than overwriting ones it may be reading.
+//
+class TelemetryRing
+{
+    public:
+
+        enum { Capacity = 256 }; // must be a power of two
+
+        TelemetryRing();
+
+        // producer side
+        bool push(const RealtimeData &data);
+
+        // consumer side
+        bool pop(TelemetrySample &sample);
+        void clear();
+        int count() const;
+
+        // samples dropped because the ring was full
+        int overruns() const;
+
+        // monotonic clock shared by all rings, in msecs
+        static qint64 now();
+
+    private:
+
+        TelemetrySample samples[Capacity];
+
+        // head is only written by the producer and tail by the consumer
+        // both just count up, the index is masked on access
+        mutable QAtomicInt head, tail;
+        mutable QAtomicInt dropped;
+};
+
+#endif // _GC_TelemetryRing_h
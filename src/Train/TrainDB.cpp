@@ -27,6 +27,7 @@
 // 01  21 Dec 2012  Mark Liversedge    Initial Build
 
 static int TrainDBSchemaVersion = 1;
+static int TrainDBFileSchemaVersion = 2; // added cp
 TrainDB *trainDB;
 
 TrainDB::TrainDB(QDir home) : home(home)
@@ -42,6 +43,8 @@ void TrainDB::closeConnection()
 
 TrainDB::~TrainDB()
 {
+    clearPrepared();
+
     if (db) {
         db->close();
         delete db;
@@ -87,6 +90,8 @@ TrainDB::rebuildDB()
     createVideoTable();
     dropVideoSyncTable();
     createVideoSyncTable();
+    dropFileTable();
+    createFileTable();
 }
 
 
@@ -225,8 +230,59 @@ bool TrainDB::createWorkoutTable()
     return rc;
 }
 
+bool TrainDB::createFileTable()
+{
+    QSqlQuery query(db->database(sessionid));
+    bool rc;
+    bool createTables = true;
+
+    // does the table exist?
+    rc = query.exec("SELECT name FROM sqlite_master WHERE type='table' ORDER BY name;");
+    if (rc) {
+        while (query.next()) {
+
+            QString table = query.value(0).toString();
+            if (table == "files") {
+                createTables = false;
+                break;
+            }
+        }
+    }
+    // we need to create it!
+    if (rc && createTables) {
+
+        QString createFileTable = "create table files (filepath varchar primary key,"
+                                    "size integer,"
+                                    "modified integer,"
+                                    "valid integer,"
+                                    "cp real);";
+
+        rc = query.exec(createFileTable);
+
+        // add row to version database
+        query.exec("DELETE FROM version where table_name = \"files\"");
+
+        // insert into table
+        query.prepare("INSERT INTO version (table_name, schema_version, creation_date) values (?,?,?);");
+        query.addBindValue("files");
+	    query.addBindValue(TrainDBFileSchemaVersion);
+	    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+        rc = query.exec();
+    }
+    return rc;
+}
+
+bool TrainDB::dropFileTable()
+{
+    clearPrepared();
+    QSqlQuery query("DROP TABLE files", db->database(sessionid));
+    bool rc = query.exec();
+    return rc;
+}
+
 bool TrainDB::dropVideoTable()
 {
+    clearPrepared();
     QSqlQuery query("DROP TABLE videos", db->database(sessionid));
     bool rc = query.exec();
     return rc;
@@ -234,6 +290,7 @@ bool TrainDB::dropVideoTable()
 
 bool TrainDB::dropVideoSyncTable()
 {
+    clearPrepared();
     QSqlQuery query("DROP TABLE videosyncs", db->database(sessionid));
     bool rc = query.exec();
     return rc;
@@ -241,6 +298,7 @@ bool TrainDB::dropVideoSyncTable()
 
 bool TrainDB::dropWorkoutTable()
 {
+    clearPrepared();
     QSqlQuery query("DROP TABLE workouts", db->database(sessionid));
     bool rc = query.exec();
     return rc;
@@ -255,6 +313,7 @@ bool TrainDB::createDatabase()
 	createWorkoutTable();
 	createVideoTable();
 	createVideoSyncTable();
+	createFileTable();
 
     return true;
 }
@@ -286,6 +345,9 @@ void TrainDB::checkDBVersion()
 
         dropVideoSyncTable();
         createVideoSyncTable();
+
+        dropFileTable();
+        createFileTable();
         return;
     }
 
@@ -294,6 +356,7 @@ void TrainDB::checkDBVersion()
     bool dropWorkout = false;
     bool dropVideo = false;
     bool dropVideoSync = false;
+    bool dropFile = false;
     while (query.next()) {
 
         QString table_name = query.value(0).toString();
@@ -302,13 +365,18 @@ void TrainDB::checkDBVersion()
         if (table_name == "workouts" && currentversion != TrainDBSchemaVersion) dropWorkout = true;
         if (table_name == "videos" && currentversion != TrainDBSchemaVersion) dropVideo = true;
         if (table_name == "videosyncs" && currentversion != TrainDBSchemaVersion) dropVideoSync = true;
+        if (table_name == "files" && currentversion != TrainDBFileSchemaVersion) dropFile = true;
     }
     query.finish();
 
+    // we scanned files into the tables being dropped
+    if (dropWorkout || dropVideo || dropVideoSync) dropFile = true;
+
     // "workouts" table, is it up-to-date?
     if (dropWorkout) dropWorkoutTable();
     if (dropVideo) dropVideoTable();
     if (dropVideoSync) dropVideoSyncTable();
+    if (dropFile) dropFileTable();
 }
 
 int TrainDB::getCount()
@@ -349,30 +417,51 @@ int TrainDB::getDBVersion()
  * CRUD routines
  *----------------------------------------------------------------------*/
 
-bool TrainDB::deleteWorkout(QString pathname)
+// when importing thousands of files preparing the same
+// statement each time adds up, so we keep them
+QSqlQuery &
+TrainDB::prepared(QString statement)
 {
-	QSqlQuery query(db->database(sessionid));
-    QDateTime timestamp = QDateTime::currentDateTime();
+    QSqlQuery *query = statements.value(statement, NULL);
+    if (query == NULL) {
+        query = new QSqlQuery(db->database(sessionid));
+        query->prepare(statement);
+        statements.insert(statement, query);
+    }
+    return *query;
+}
+
+// tables are being dropped or we're closing
+void
+TrainDB::clearPrepared()
+{
+    qDeleteAll(statements);
+    statements.clear();
+}
 
+bool TrainDB::deleteWorkout(QString pathname)
+{
     // zap the current row - if there is one
-    query.prepare("DELETE FROM workouts WHERE filepath = ?;");
-    query.addBindValue(pathname);
+    QSqlQuery &query = prepared("DELETE FROM workouts WHERE filepath = ?;");
+    query.bindValue(0, pathname);
 
-    return query.exec();
+    bool rc = query.exec();
+
+    // forget we scanned it too
+    QSqlQuery &file = prepared("DELETE FROM files WHERE filepath = ?;");
+    file.bindValue(0, pathname);
+    file.exec();
+
+    return rc;
 }
 
 bool TrainDB::importWorkout(QString pathname, ErgFile *ergFile)
 {
-	QSqlQuery query(db->database(sessionid));
     QDateTime timestamp = QDateTime::currentDateTime();
 
-    // zap the current row - if there is one
-    query.prepare("DELETE FROM workouts WHERE filepath = ?;");
-    query.addBindValue(pathname);
-    query.exec();
-
-    // construct an insert statement
-    QString insertStatement = "insert into workouts ( filepath, "
+    // construct an insert statement, replaces
+    // the current row - if there is one
+    QSqlQuery &query = prepared("insert or replace into workouts ( filepath, "
                                     "filename,"
                                     "timestamp,"
                                     "description,"
@@ -382,98 +471,150 @@ bool TrainDB::importWorkout(QString pathname, ErgFile *ergFile)
                                     "coggan_tss,"
                                     "coggan_if,"
                                     "elevation,"
-                                    "grade ) values ( ?,?,?,?,?,?,?,?,?,?,? );";
-	query.prepare(insertStatement);
+                                    "grade ) values ( ?,?,?,?,?,?,?,?,?,?,? );");
 
     // filename, timestamp, ride date
-	query.addBindValue(pathname);
-	query.addBindValue(QFileInfo(pathname).fileName());
-	query.addBindValue(timestamp);
-    query.addBindValue(ergFile->Name);
-	query.addBindValue(ergFile->Source);
-	query.addBindValue(ergFile->Ftp);
-	query.addBindValue((int)ergFile->Duration);
-	query.addBindValue(ergFile->TSS);
-	query.addBindValue(ergFile->IF);
-	query.addBindValue(ergFile->ELE);
-	query.addBindValue(ergFile->GRADE);
+    query.bindValue(0, pathname);
+    query.bindValue(1, QFileInfo(pathname).fileName());
+    query.bindValue(2, timestamp);
+    query.bindValue(3, ergFile->Name);
+    query.bindValue(4, ergFile->Source);
+    query.bindValue(5, ergFile->Ftp);
+    query.bindValue(6, (int)ergFile->Duration);
+    query.bindValue(7, ergFile->TSS);
+    query.bindValue(8, ergFile->IF);
+    query.bindValue(9, ergFile->ELE);
+    query.bindValue(10, ergFile->GRADE);
 
     // go do it!
-	bool rc = query.exec();
+    bool rc = query.exec();
 
-	return rc;
+    return rc;
 }
 
 bool TrainDB::deleteVideoSync(QString pathname)
 {
-	QSqlQuery query(db->database(sessionid));
-    QDateTime timestamp = QDateTime::currentDateTime();
-
     // zap the current row - if there is one
-    query.prepare("DELETE FROM videosyncs WHERE filepath = ?;");
-    query.addBindValue(pathname);
+    QSqlQuery &query = prepared("DELETE FROM videosyncs WHERE filepath = ?;");
+    query.bindValue(0, pathname);
 
-    return query.exec();
+    bool rc = query.exec();
+
+    // forget we scanned it too
+    QSqlQuery &file = prepared("DELETE FROM files WHERE filepath = ?;");
+    file.bindValue(0, pathname);
+    file.exec();
+
+    return rc;
 }
 
 bool TrainDB::importVideoSync(QString pathname, VideoSyncFile *videosyncFile)
 {
     Q_UNUSED(videosyncFile) // not used at present
-	QSqlQuery query(db->database(sessionid));
-    QDateTime timestamp = QDateTime::currentDateTime();
 
-    // zap the current row - if there is one
-    query.prepare("DELETE FROM videosyncs WHERE filepath = ?;");
-    query.addBindValue(pathname);
-    query.exec();
-
-    // construct an insert statement
-    QString insertStatement = "insert into videosyncs ( filepath, filename ) values ( ?,? );";
-	query.prepare(insertStatement);
+    // construct an insert statement, replaces
+    // the current row - if there is one
+    QSqlQuery &query = prepared("insert or replace into videosyncs ( filepath, filename ) values ( ?,? );");
 
     // filename, path
-	query.addBindValue(pathname);
-	query.addBindValue(QFileInfo(pathname).fileName());
+    query.bindValue(0, pathname);
+    query.bindValue(1, QFileInfo(pathname).fileName());
 
     // go do it!
-	bool rc = query.exec();
+    bool rc = query.exec();
 
-	return rc;
+    return rc;
 }
 
 bool TrainDB::deleteVideo(QString pathname)
 {
-	QSqlQuery query(db->database(sessionid));
-    QDateTime timestamp = QDateTime::currentDateTime();
-
     // zap the current row - if there is one
-    query.prepare("DELETE FROM videos WHERE filepath = ?;");
-    query.addBindValue(pathname);
-    return query.exec();
+    QSqlQuery &query = prepared("DELETE FROM videos WHERE filepath = ?;");
+    query.bindValue(0, pathname);
+
+    bool rc = query.exec();
+
+    // forget we scanned it too
+    QSqlQuery &file = prepared("DELETE FROM files WHERE filepath = ?;");
+    file.bindValue(0, pathname);
+    file.exec();
+
+    return rc;
 }
 
 bool TrainDB::importVideo(QString pathname)
 {
-	QSqlQuery query(db->database(sessionid));
-    QDateTime timestamp = QDateTime::currentDateTime();
-
-    // zap the current row - if there is one
-    query.prepare("DELETE FROM videos WHERE filepath = ?;");
-    query.addBindValue(pathname);
-    query.exec();
-
-    // construct an insert statement
-    QString insertStatement = "insert into videos ( filepath,filename ) values ( ?,? );";
-	query.prepare(insertStatement);
+    // construct an insert statement, replaces
+    // the current row - if there is one
+    QSqlQuery &query = prepared("insert or replace into videos ( filepath,filename ) values ( ?,? );");
 
     // filename, path
-	query.addBindValue(pathname);
-	query.addBindValue(QFileInfo(pathname).fileName());
+    query.bindValue(0, pathname);
+    query.bindValue(1, QFileInfo(pathname).fileName());
 
     // go do it!
-	bool rc = query.exec();
+    bool rc = query.exec();
+
+    return rc;
+}
+
+QHash<QString, TrainDB::FileState>
+TrainDB::scannedFiles()
+{
+    QHash<QString, FileState> returning;
+
+    QSqlQuery query("SELECT filepath, size, modified, valid, cp FROM files;", db->database(sessionid));
+    if (query.exec()) {
+        while (query.next()) {
+            FileState state;
+            state.size = query.value(1).toLongLong();
+            state.modified = query.value(2).toUInt();
+            state.valid = query.value(3).toInt() != 0;
+            state.cp = query.value(4).toDouble();
+            returning.insert(query.value(0).toString(), state);
+        }
+    }
+    return returning;
+}
+
+bool TrainDB::importFile(QString pathname, FileState state)
+{
+    QSqlQuery &query = prepared("insert or replace into files ( filepath, size, modified, valid, cp ) values ( ?,?,?,?,? );");
+
+    query.bindValue(0, pathname);
+    query.bindValue(1, state.size);
+    query.bindValue(2, state.modified);
+    query.bindValue(3, state.valid ? 1 : 0);
+    query.bindValue(4, state.cp);
+
+    return query.exec();
+}
 
-	return rc;
+void TrainDB::removeAllExcept(const QSet<QString> &keep)
+{
+    QStringList tables;
+    tables << "workouts" << "videos" << "videosyncs" << "files";
+
+    foreach(QString table, tables) {
+
+        // what's there that we don't want, the default
+        // entries (e.g. manual erg mode) start with //
+        QStringList zap;
+        QSqlQuery query(QString("SELECT filepath FROM %1;").arg(table), db->database(sessionid));
+        if (query.exec()) {
+            while (query.next()) {
+                QString filepath = query.value(0).toString();
+                if (!filepath.startsWith("//") && !keep.contains(filepath)) zap << filepath;
+            }
+        }
+        query.finish();
+
+        QSqlQuery &remove = prepared(QString("DELETE FROM %1 WHERE filepath = ?;").arg(table));
+        foreach(QString filepath, zap) {
+            remove.bindValue(0, filepath);
+            remove.exec();
+        }
+    }
 }
 
 bool TrainDB::createDefaultEntriesWorkout()
@@ -23,6 +23,7 @@
 #include <QMessageBox>
 #include <QDir>
 #include <QHash>
+#include <QSet>
 #include <QtSql>
 
 class ErgFile;
@@ -50,7 +51,7 @@ class TrainDB : public QObject
     ~TrainDB();
 
     void startLUW() { db->database(sessionid).transaction(); }
-    void endLUW() { db->database(sessionid).commit(); emit dataChanged(); }
+    void endLUW(bool notify=true) { db->database(sessionid).commit(); if (notify) emit dataChanged(); }
 
     bool importWorkout(QString pathname, ErgFile *ergFile);
     bool deleteWorkout(QString pathname);
@@ -61,6 +62,20 @@ class TrainDB : public QObject
     bool importVideoSync(QString pathname, VideoSyncFile *videosyncFile);
     bool deleteVideoSync(QString pathname);
 
+    // files seen when scanning the library, so a rescan can skip
+    // the ones that haven't changed since
+    struct FileState {
+        qint64 size;
+        uint modified;
+        bool valid;
+        double cp;      // workouts' TSS and IF were worked out with
+    };
+    QHash<QString, FileState> scannedFiles();
+    bool importFile(QString pathname, FileState state);
+
+    // remove anything not in keep, except the default entries
+    void removeAllExcept(const QSet<QString> &keep);
+
     // for 3.3
     bool upgradeDefaultEntriesWorkout();
 
@@ -84,6 +99,13 @@ class TrainDB : public QObject
         bool dropVideoTable();
         bool createVideoSyncTable();
         bool dropVideoSyncTable();
+        bool createFileTable();
+        bool dropFileTable();
+
+        // statements are prepared once and reused
+        QSqlQuery &prepared(QString statement);
+        void clearPrepared();
+        QHash<QString, QSqlQuery*> statements;
 
         bool createDefaultEntriesWorkout();
         bool createDefaultEntriesVideosync();
@@ -25,7 +25,6 @@
 #include "Units.h"
 #include "DeviceTypes.h"
 #include "DeviceConfiguration.h"
-#include "RideImportWizard.h"
 #include <QApplication>
 #include <QtGui>
 #include <QRegExp>
@@ -75,6 +74,7 @@
 #endif
 
 #include <cmath> // isnan and isinf
+#include <algorithm> // stable_sort
 #include "TrainDB.h"
 #include "Library.h"
 
@@ -333,7 +333,7 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     lap_time = QTime();
     lap_elapsed_msec = 0;
 
-    recordFile = NULL;
+    journalRecords = 0;
     status = 0;
     setStatusFlags(RT_MODE_ERGO);         // ergo mode by default
     mode = ERG;
@@ -346,6 +346,8 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     spdcount = 0;
     lodcount = 0;
     wbalr = wbal = 0;
+    journalMsecs = 0;
+    journalPending = false;
     load_msecs = total_msecs = lap_msecs = 0;
     displayWorkoutDistance = displayDistance = displayPower = displayHeartRate =
     displaySpeed = displayCadence = slope = load = 0;
@@ -367,6 +369,26 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     //toolbarButtons->hide();
 #endif
 
+    // anything left from last time?
+    QTimer::singleShot(0, this, SLOT(recoverSessions()));
+}
+
+void
+TrainSidebar::recoverSessions()
+{
+    int recovered = 0;
+    QStringList errors;
+
+    foreach(QString filename, SessionJournal::orphans(context->athlete->home->records()))
+        if (SessionJournal::import(context, filename, errors, false)) recovered++;
+
+    if (recovered) emit setNotification(tr("Recovered %1 unfinished session(s)..").arg(recovered), 5);
+
+    // they're left in the records folder, we'll try again next time
+    if (errors.count())
+        QMessageBox::warning(this, tr("Session Recovery"),
+                             tr("Some unfinished sessions could not be recovered, "
+                                "they will be tried again next time.\n\n%1").arg(errors.join("\n")));
 }
 
 void
@@ -1173,24 +1195,29 @@ void TrainSidebar::Start()       // when start button is pressed
             QDateTime now = QDateTime::currentDateTime();
 
             // setup file
-            QString filename = now.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString(".csv");
+            QString filename = now.toString(QString("yyyy_MM_dd_hh_mm_ss")) + "." + SessionJournal::suffix();
 
             if (!context->athlete->home->records().exists())
                 context->athlete->home->createAllSubdirs();
 
             QString fulltarget = context->athlete->home->records().canonicalPath() + "/" + filename;
 
-            if (recordFile) delete recordFile;
-            recordFile = new QFile(fulltarget);
-            if (!recordFile->open(QFile::WriteOnly | QFile::Truncate)) {
-                clearStatusFlags(RT_RECORDING);
-            } else {
-
-                // CSV File header
+            // recorded at the rate of the fastest device we use
+            int interval = 0;
+            foreach(int dev, activeDevices) {
+                if (dev != wattsTelemetry && dev != bpmTelemetry &&
+                    dev != rpmTelemetry && dev != kphTelemetry) continue;
 
-                QTextStream recordFileStream(recordFile);
-                recordFileStream << "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb, target\n";
+                int x = Devices[dev].controller->sampleInterval();
+                if (interval == 0 || x < interval) interval = x;
+            }
 
+            if (!journal.open(fulltarget, now, interval)) {
+                clearStatusFlags(RT_RECORDING);
+            } else {
+                journalRecords = 0;
+                journalMsecs = 0;
+                journalPending = false;
                 disk_timer->start(SAMPLERATE);  // start screen
             }
         }
@@ -1294,22 +1321,22 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
         disk_timer->stop();
 
         // close and reset File
-        recordFile->close();
+        journalFlush();
+        journal.close();
 
         if(deviceStatus == DEVICE_ERROR)
         {
-            recordFile->remove();
+            journal.remove();
         }
         else {
-            // add to the view - using basename ONLY
-            QString name;
-            name = recordFile->fileName();
-
-            QList<QString> list;
-            list.append(name);
-
-            RideImportWizard *dialog = new RideImportWizard (list, context);
-            dialog->process(); // do it!
+            // straight into an activity, if it fails the journal is
+            // left behind and we try again next time
+            QStringList errors;
+            if (!SessionJournal::import(context, journal.fileName(), errors)) {
+                QMessageBox::warning(this, tr("Save Activity"),
+                                     tr("The session could not be saved as an activity, "
+                                        "it will be tried again next time.\n\n%1").arg(errors.join("\n")));
+            }
         }
     }
 
@@ -1473,6 +1500,9 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
             foreach(int dev, activeDevices) { // Do for selected device only
                 RealtimeData local = rtData;
 
+                // not recording, just keep them from filling up
+                Devices[dev].controller->samples.clear();
+
                 if (calibrationDeviceIndex == dev) {
                     // need telemetry for calibration dialog updates
                     // (and F3 button press for Computrainer)
@@ -1524,11 +1554,15 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
             rtData.setSlope(slope); // always set load..
 
             // fetch the right data from each device...
+            QList<JournalSample> arrived;
             foreach(int dev, activeDevices) {
 
                 RealtimeData local = rtData;
                 Devices[dev].controller->getRealtimeData(local);
 
+                // and everything it sent since the last refresh
+                drainSamples(dev, arrived);
+
                 // get spinscan data from a computrainer?
                 if (Devices[dev].type == DEV_CT) {
                     memcpy((uint8_t*)rtData.spinScan, (uint8_t*)local.spinScan, 24);
@@ -1650,6 +1684,14 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
             displayO2HB = rtData.getO2Hb();
             displayHHB = rtData.getHHb();
 
+            // what the devices sent in the order it arrived, or
+            // what we have now if nothing pushed samples
+            if ((status&RT_RECORDING) && (status&RT_RUNNING) && ((status&RT_PAUSED) == 0)) {
+                if (arrived.isEmpty()) journalSample(total_msecs, -1, NULL);
+                std::stable_sort(arrived.begin(), arrived.end(), arrivedBefore);
+                foreach(const JournalSample &sample, arrived) journalSample(sample.msecs, sample.dev, &sample.data);
+            }
+
             // virtual speed
             double crr = 0.004f; // typical for asphalt surfaces
             double g = 9.81;     // g constant 9.81 m/s
@@ -1721,6 +1763,33 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
     }
 }
 
+// what the device pushed since the last refresh, placed in session time
+void TrainSidebar::drainSamples(int dev, QList<JournalSample> &arrived)
+{
+    RealtimeController *controller = Devices[dev].controller;
+    bool recording = (status&RT_RECORDING) && (status&RT_RUNNING) && ((status&RT_PAUSED) == 0);
+
+    // session time now, samples are placed by how long ago they arrived
+    qint64 now = TelemetryRing::now();
+    qint64 elapsed = session_elapsed_msec + session_time.elapsed();
+
+    TelemetrySample sample;
+    while (controller->samples.pop(sample)) {
+
+        if (dev == wattsTelemetry) controller->processRealtimeData(sample.data); // e.g. virtual power
+
+        // only what we use from this device
+        if (!recording || (dev != wattsTelemetry && dev != bpmTelemetry &&
+                           dev != rpmTelemetry && dev != kphTelemetry)) continue;
+
+        JournalSample add;
+        add.msecs = qMax(qint64(0), elapsed - (now - sample.msecs));
+        add.dev = dev;
+        add.data = sample.data;
+        arrived << add;
+    }
+}
+
 // can be called from the controller - when user presses "Lap" button
 void TrainSidebar::newLap()
 {
@@ -1762,45 +1831,70 @@ void TrainSidebar::warnnoConfig()
 //----------------------------------------------------------------------
 void TrainSidebar::diskUpdate()
 {
-    int  secs;
+    if (calibrating) return;
 
-    long torq = 0, altitude = 0;
-    QTextStream recordFileStream(recordFile);
+    // get it onto the disk every so often, so a crash
+    // only loses the last few seconds
+    if (++journalRecords % CHECKPOINTRATE == 0) journal.checkpoint();
+}
 
-    if (calibrating) return;
+// samples at the same time, or that arrived late from before the
+// last record, are merged into one record rather than repeat a time
+void TrainSidebar::journalSample(quint32 msecs, int dev, const RealtimeData *data)
+{
+    if (!journalPending || msecs > journalMsecs) {
+        journalFlush();
+        journalRecord(journalNext, msecs);
+        journalPending = true;
+    }
+    if (data == NULL) return;
+
+    // everything else as at this refresh
+    if (dev == bpmTelemetry) journalNext.hr = data->getHr();
+    if (dev == rpmTelemetry) journalNext.cad = data->getCadence();
+    if (dev == kphTelemetry) journalNext.kph = data->getSpeed();
+    if (dev == wattsTelemetry) {
+        journalNext.watts = data->getWatts();
+        journalNext.lrbalance = data->getLRBalance();
+        journalNext.lte = data->getLTE();
+        journalNext.rte = data->getRTE();
+        journalNext.lps = data->getLPS();
+        journalNext.rps = data->getRPS();
+    }
+}
 
-    // convert from milliseconds to secondes
-    total_msecs = session_elapsed_msec + session_time.elapsed();
-    secs = total_msecs;
-    secs /= 1000.0;
-
-    // GoldenCheetah CVS Format "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb\n";
-
-    recordFileStream    << secs
-                        << "," << displayCadence
-                        << "," << displayHeartRate
-                        << "," << displayDistance
-                        << "," << displaySpeed
-                        << "," << torq
-                        << "," << displayPower
-                        << "," << altitude
-                        << "," // lon
-                        << "," // lat
-                        << "," // headwind
-                        << "," // slope
-                        << "," // temp
-                        << "," << (displayLap + displayWorkoutLap)
-                        << "," << displayLRBalance
-                        << "," << displayLTE
-                        << "," << displayRTE
-                        << "," << displayLPS
-                        << "," << displayRPS
-                        << "," << displaySMO2
-                        << "," << displayTHB
-                        << "," << displayO2HB
-                        << "," << displayHHB
-                        << "," << load
-                        << "," << "\n";
+void TrainSidebar::journalFlush()
+{
+    if (journalPending) journal.append(journalNext);
+    journalPending = false;
+}
+
+// same values the csv recording used to have; no torque,
+// altitude, slope or temperature
+void TrainSidebar::journalRecord(SessionRecord &record, quint32 msecs)
+{
+    journalMsecs = qMax(journalMsecs, msecs);
+
+    record.msecs = journalMsecs;
+    record.lap = displayLap + displayWorkoutLap;
+    record.cad = displayCadence;
+    record.hr = displayHeartRate;
+    record.km = displayDistance;
+    record.kph = displaySpeed;
+    record.nm = 0;
+    record.watts = displayPower;
+    record.alt = 0;
+    record.slope = 0;
+    record.lrbalance = displayLRBalance;
+    record.lte = displayLTE;
+    record.rte = displayRTE;
+    record.lps = displayLPS;
+    record.rps = displayRPS;
+    record.smo2 = displaySMO2;
+    record.thb = displayTHB;
+    record.o2hb = displayO2HB;
+    record.hhb = displayHHB;
+    record.target = load;
 }
 
 //----------------------------------------------------------------------
@@ -30,6 +30,7 @@
 #include "ErgFilePlot.h"
 #include "GcSideBarItem.h"
 #include "RemoteControl.h"
+#include "SessionJournal.h"
 #include "Tab.h"
 
 // standard stuff
@@ -65,6 +66,7 @@
 #define REFRESHRATE    200 // screen refresh in milliseconds
 #define STREAMRATE     200 // rate at which we stream updates to remote peer
 #define SAMPLERATE     1000 // disk update in milliseconds
+#define CHECKPOINTRATE 10   // disk updates between syncing the journal to disk
 #define LOADRATE       1000 // rate at which load is adjusted
 
 // device treeview node types
@@ -192,6 +194,9 @@ class TrainSidebar : public GcWindow
         void diskUpdate();          // writes to CSV file
         void loadUpdate();          // sets Load on CT like devices
 
+        // import sessions that didn't stop cleanly
+        void recoverSessions();
+
         // When no config has been setup
         void warnnoConfig();
 
@@ -253,12 +258,25 @@ class TrainSidebar : public GcWindow
         bool lapAudioEnabled;
         bool lapAudioThisLap;
 
+        // every sample as it arrived from the devices goes in the journal,
+        // devices that don't push samples are recorded on each refresh
+        struct JournalSample { quint32 msecs; int dev; RealtimeData data; };
+        static bool arrivedBefore(const JournalSample &a, const JournalSample &b) { return a.msecs < b.msecs; }
+        void drainSamples(int dev, QList<JournalSample> &arrived);
+        void journalSample(quint32 msecs, int dev, const RealtimeData *data);
+        void journalRecord(SessionRecord &record, quint32 msecs);
+        void journalFlush();
+        quint32 journalMsecs;      // of the last record, so time never goes backwards
+        SessionRecord journalNext; // samples at the same time are merged into it
+        bool journalPending;
+
         // for non-zero average calcs
         int pwrcount, cadcount, hrcount, spdcount, lodcount, grdcount; // for NZ average calc
         int status;
         int displaymode;
 
-        QFile *recordFile;      // where we record!
+        SessionJournal journal; // where we record!
+        int journalRecords;     // disk updates since it was opened
         ErgFile *ergFile;       // workout file
         VideoSyncFile *videosyncFile;       // videosync file
 
@@ -287,7 +287,7 @@ void VideoWindow::resumePlayback()
 #endif
 }
 
-void VideoWindow::telemetryUpdate(RealtimeData rtd)
+void VideoWindow::telemetryUpdate(const RealtimeData &rtd)
 {
     foreach(MeterWidget* p_meterWidget , m_metersWidget)
     {
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "WorkoutAnalytics.h"
+
+#include <cmath>
+
+// how many durations to search before checking if we've been cancelled
+static const int CHECK_EVERY = 16;
+
+WorkoutAnalytics::WorkoutAnalytics() : NP(0), IF(0), TSS(0), valid(false), generation(NULL), expected(0),
+    CP(0), FTP(0), WPRIME(0), from(0), to(0), oldTo(0), npTotal(0)
+{
+}
+
+void
+WorkoutAnalytics::setParameters(int CP, int FTP, int WPRIME)
+{
+    if (CP != this->CP || FTP != this->FTP || WPRIME != this->WPRIME) valid = false;
+
+    this->CP = CP;
+    this->FTP = FTP;
+    this->WPRIME = WPRIME;
+}
+
+int
+WorkoutAnalytics::firstChange(const QVector<int> &a, const QVector<int> &b)
+{
+    int n = qMin(a.count(), b.count());
+    int i = 0;
+    while (i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+int
+WorkoutAnalytics::nextDuration(int d)
+{
+    // increments to limit search scope
+    if (d<120) return d+1;
+    else if (d<600) return d+2;
+    else if (d<1200) return d+5;
+    else if (d<3600) return d+20;
+    else if (d<7200) return d+120;
+    else return d+300;
+}
+
+int
+WorkoutAnalytics::diff(const QVector<int> &samples)
+{
+    next = samples;
+
+    int n = next.count();
+    int m = watts.count();
+
+    // same at the start
+    from = firstChange(watts, next);
+    if (from == n && n == m) {
+        to = oldTo = from;
+        return 0;
+    }
+
+    // same at the end
+    int k = 0;
+    while (k < n-from && k < m-from && next[n-1-k] == watts[m-1-k]) k++;
+    to = n - k;
+    oldTo = m - k;
+
+    return qMax(to, oldTo) - from;
+}
+
+double
+WorkoutAnalytics::npContribution(int i) const
+{
+    // 30s rolling average raised to the 4th power
+    double sum = integrated[i+1] - integrated[qMax(0, i-29)];
+    return pow(sum/30, 4);
+}
+
+void
+WorkoutAnalytics::bestFor(int k, int d, int lo, int hi)
+{
+    // windows of d seconds starting in [lo,hi)
+    for (int s=lo; s<hi; s++) {
+        qint64 joules = integrated[s+d] - integrated[s];
+        if (joules > bests[k]) {
+            bests[k] = joules;
+            offsets[k] = s;
+        }
+    }
+}
+
+void
+WorkoutAnalytics::update()
+{
+    int n = next.count();
+    int m = watts.count();
+    int shift = n - m;
+
+    // joules before each second, from the first change
+    integrated.resize(n+1);
+    for (int i=from; i<n; i++) integrated[i+1] = integrated[i] + next[i];
+
+    // rolling averages overlapping the span are recomputed and
+    // the ones after it moved along with the samples
+    QVector<double> previous = np4;
+    np4.resize(n);
+
+    int end = qMin(n, to+29);
+    for (int i=from; i<qMin(m, oldTo+29); i++) npTotal -= previous[i];
+    for (int i=from; i<end; i++) npTotal += (np4[i] = npContribution(i));
+    for (int i=end; i<n; i++) np4[i] = previous[i-shift];
+
+    // a best effort still stands if it didn't overlap the span
+    // we just need to see if a window over the span beats it
+    int searched = durations.count();
+    QVector<qint64> oldBests = bests;
+    QVector<int> oldOffsets = offsets;
+
+    durations.resize(0);
+    for (int d=1; d<n; d=nextDuration(d)) durations << d;
+    bests.resize(durations.count());
+    offsets.resize(durations.count());
+
+    for (int k=0; k<durations.count(); k++) {
+
+        int d = durations[k];
+
+        if (k < searched && (oldOffsets[k] + d <= from || oldOffsets[k] >= oldTo)) {
+
+            bests[k] = oldBests[k];
+            offsets[k] = oldOffsets[k] >= oldTo ? oldOffsets[k] + shift : oldOffsets[k];
+            bestFor(k, d, qMax(0, from-d+1), qMin(to, n-d+1));
+
+        } else {
+
+            // search again
+            bests[k] = 0;
+            offsets[k] = 0;
+            bestFor(k, d, 0, n-d+1);
+        }
+    }
+
+    watts = next;
+    from = to = oldTo = n;
+
+    metrics();
+    fillMMP();
+    tte();
+}
+
+bool
+WorkoutAnalytics::compute()
+{
+    int n = next.count();
+
+    integrated.resize(n+1);
+    integrated[0] = 0;
+    for (int i=0; i<n; i++) integrated[i+1] = integrated[i] + next[i];
+
+    np4.resize(n);
+    npTotal = 0;
+    for (int i=0; i<n; i++) npTotal += (np4[i] = npContribution(i));
+
+    durations.resize(0);
+    for (int d=1; d<n; d=nextDuration(d)) durations << d;
+    bests.resize(durations.count());
+    offsets.resize(durations.count());
+
+    for (int k=0; k<durations.count(); k++) {
+
+        if (k % CHECK_EVERY == 0 && cancelled()) return false;
+
+        bests[k] = 0;
+        offsets[k] = 0;
+        bestFor(k, durations[k], 0, n-durations[k]+1);
+    }
+
+    watts = next;
+    from = to = oldTo = n;
+
+    metrics();
+    fillMMP();
+    tte();
+
+    valid = true;
+    return !cancelled();
+}
+
+void
+WorkoutAnalytics::metrics()
+{
+    // NP moves up and down during the ride, once we have 30s
+    NP = 0;
+    int count = watts.count();
+    if (count > 30) NP = pow(npTotal / double(count), 0.25f);
+
+    // IF.....
+    IF = double(NP) / double(FTP);
+
+    // TSS.....
+    double normWork = NP * count;
+    double rawTSS = normWork * IF;
+    double workInAnHourAtCP = FTP * 3600;
+    TSS = rawTSS / workInAnHourAtCP * 100.0;
+}
+
+void
+WorkoutAnalytics::fillMMP()
+{
+    mmp.resize(0);
+    mmp.resize(watts.count()+1);
+
+    for (int k=0; k<durations.count(); k++)
+        mmp[durations[k]] = double(bests[k]) / double(durations[k]);
+
+    // since we minimise the search space over
+    // longer durations we need to fill in the gaps
+    int last=0;
+    for (int i=mmp.size()-1; i; i--) {
+        if (mmp[i] == 0) mmp[i]=last;
+        else last = mmp[i];
+    }
+}
+
+void
+WorkoutAnalytics::tte()
+{
+    // clear what we found last time
+    efforts.clear();
+    if (CP <= 0) return;
+
+    int secs=watts.count();
+
+    for (int j=0; j<2; j++) {
+
+        // 2 iterations:- 85% sustained, then 100% or higher
+        WWEffort tte; tte.start = tte.duration = 0;
+
+        for (int i=0; i<secs; i++) {
+
+            // start out at 30 minutes and drop back to
+            // 2 minutes, anything shorter and we are done
+            int t = (secs-i-1) > 3600 ? 3600 : secs-i-1;
+
+            while (t > 120) {
+
+                // calculate the TTE for the joules in the interval
+                // starting at i seconds with duration t
+                // This takes the monod equation p(t) = W'/t + CP and
+                // solves for t, but the added complication of also
+                // accounting for the fact it is expressed in joules
+                // So take Joules = (W'/t + CP) * t and solving that
+                // for t gives t = (Joules - W') / CP
+                double tc = ((integrated[i+t+1]-integrated[i+1]) - WPRIME) / CP;
+                // NOTE FOR ABOVE: it is looking at accumulation AFTER this point
+                //                 not FROM this point, so we are looking 1s ahead of i
+                //                 which is why the interval is registered as starting
+                //                 at i+1 in the code below
+
+                // this is either a TTE or getting very close
+                if (tc >= (j ? t : (t*0.85))) {
+
+                    if (tte.start > (i+1) || (tte.duration+tte.start) < (i+t)) {
+
+                        tte.start = i + 1; // see NOTE above
+                        tte.duration = t;
+                        tte.joules = integrated[i+t+1]-integrated[i+1];
+                        tte.quality = tc / double(t);
+
+                        // add 100 or more on second round
+                        // quick way of doing overlapping
+                        if ((j && tc >= t) || (!j && tc < t)) efforts << tte;
+                    }
+
+
+                    // move on shorter/harder are just as bad
+                    t=0;
+
+                } else {
+
+                    t = tc;
+                    if (t<120)
+                        t=120;
+                }
+            }
+        }
+    }
+}
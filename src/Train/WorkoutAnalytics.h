@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_WorkoutAnalytics_h
+#define _GC_WorkoutAnalytics_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QList>
+#include <QAtomicInt>
+
+// TTE efforts
+struct WWEffort {
+    int start, duration, joules;
+    int zone;
+    double quality;
+};
+
+//
+// Metrics for the workout being edited in the WorkoutWidget
+//
+// Every edit and every mouse move whilst dragging used to resample the whole
+// workout and recompute NP, mean max and TTE from scratch. We keep the 1s
+// samples from last time and when they change work out the span that is
+// different; everything before it is unchanged and everything after it is
+// unchanged apart from being shifted if the workout got longer or shorter.
+//
+// So we only recompute the 30s rolling averages that overlap the span, and
+// for mean max, the best effort for each duration still stands unless it
+// overlapped the span, in which case that duration is searched again, so we
+// only look at the windows that overlap the span.
+//
+// When the change is large (or the CP etc changes) it is quicker to do it all
+// again and the widget does that in a background thread, this is a value class
+// so a copy can be handed over and the generation checked to cancel it.
+//
+class WorkoutAnalytics
+{
+    public:
+
+        WorkoutAnalytics();
+
+        // settings the metrics depend upon, a change means computing it all
+        void setParameters(int CP, int FTP, int WPRIME);
+
+        // the samples to compute for, returns how many samples are in the span
+        // that changed since last time, 0 if nothing changed
+        int diff(const QVector<int> &samples);
+
+        // recompute the span that changed, must be valid
+        void update();
+
+        // compute it all, checking *generation still matches expected
+        // as we go so a background run can be abandoned
+        void setCancel(const QAtomicInt *generation, int expected) { this->generation = generation; this->expected = expected; }
+        bool compute();
+        bool isValid() const { return valid; }
+        bool isCurrent() const { return !cancelled(); }
+
+        // first sample that differs
+        static int firstChange(const QVector<int> &a, const QVector<int> &b);
+
+        // results
+        QVector<int> watts;
+        double NP, IF, TSS;
+        QVector<int> mmp;
+        QList<WWEffort> efforts;
+
+    private:
+
+        bool cancelled() const { return generation && generation->loadAcquire() != expected; }
+
+        // durations searched for mean max, as RideFileCache::fastSearch
+        static int nextDuration(int d);
+
+        double npContribution(int i) const;
+        void metrics();
+        void bestFor(int k, int d, int lo, int hi);
+        void fillMMP();
+        void tte();
+
+        bool valid;
+        const QAtomicInt *generation;
+        int expected;
+
+        int CP, FTP, WPRIME;
+
+        // samples pending and what changed, [from,to) in the new
+        // samples replaces [from,oldTo) in the old ones
+        QVector<int> next;
+        int from, to, oldTo;
+
+        QVector<qint64> integrated;     // count+1, joules before each second
+        QVector<double> np4;            // 30s rolling average ^4 at each second
+        double npTotal;
+
+        QVector<int> durations;         // durations searched
+        QVector<qint64> bests;          // best joules for each duration
+        QVector<int> offsets;           // where the best starts
+};
+
+#endif // _GC_WorkoutAnalytics_h
@@ -24,7 +24,6 @@
 #include "WPrime.h"
 #include "ErgFile.h"
 #include "RideFile.h"
-#include "RideFileCache.h"
 #include "RealtimeData.h"
 
 #include "TimeUtils.h" // time_to_string()
@@ -36,6 +35,12 @@
 #include <cmath>
 #include <float.h> // DBL_EPSILON
 
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentRun>
+#endif
+
 #include "Colors.h"
 
 static int MINTOOLHEIGHT = 350; // minimum size for a full editor
@@ -86,7 +91,7 @@ void WorkoutWidget::adjustLayout()
 }
 
 WorkoutWidget::WorkoutWidget(WorkoutWindow *parent, Context *context) :
-    QWidget(parent),  state(none), ergFile(NULL), dragging(NULL), parent(parent), context(context), stackptr(0), recording_(false)
+    QWidget(parent),  state(none), ergFile(NULL), dragging(NULL), parent(parent), context(context), stackptr(0), generation(0), analyticsPending(false), recording_(false)
 {
     minVX_=0;
     maxVX_=maxWX_=3600;
@@ -108,9 +113,17 @@ WorkoutWidget::WorkoutWidget(WorkoutWindow *parent, Context *context) :
     connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
     connect(context, SIGNAL(telemetryUpdate(RealtimeData)), this, SLOT(telemetryUpdate(RealtimeData)));
     connect(context, SIGNAL(setNow(long)), this, SLOT(setNow(long)));
+    connect(&analyticsWatcher, SIGNAL(finished()), this, SLOT(analyticsFinished()));
     configChanged(CONFIG_APPEARANCE);
 }
 
+WorkoutWidget::~WorkoutWidget()
+{
+    // abandon any background recompute
+    generation.fetchAndAddOrdered(1);
+    analyticsWatcher.waitForFinished();
+}
+
 void
 WorkoutWidget::updateErgFile(ErgFile *f)
 {
@@ -177,7 +190,7 @@ WorkoutWidget::setNow(long x)
 }
 
 void
-WorkoutWidget::telemetryUpdate(RealtimeData rt)
+WorkoutWidget::telemetryUpdate(const RealtimeData &rt)
 {
     // only plot when recording
     if (!recording_) return;
@@ -1519,6 +1532,13 @@ WorkoutWidget::save()
     return;
 }
 
+static WorkoutAnalytics
+computeInBackground(WorkoutAnalytics analytics)
+{
+    analytics.compute();
+    return analytics;
+}
+
 void
 WorkoutWidget::recompute(bool editing)
 {
@@ -1552,10 +1572,6 @@ WorkoutWidget::recompute(bool editing)
                         context->athlete->zones(false)->useCPforFTPSetting(), 0).toInt() == 0);
     if (useCPForFTP) FTP=CP;
 
-    // truncate
-    wattsArray.resize(0);
-    mmpArray.resize(0);
-
     // running time and watts for interpolating
     int ctime = 0;
     double cwatts = 0;
@@ -1563,6 +1579,7 @@ WorkoutWidget::recompute(bool editing)
     double maxy=0;
 
     // resample the erg file into 1s samples
+    QVector<int> samples;
     foreach(WWPoint *p, points_) {
 
         // ramprate per second
@@ -1571,7 +1588,7 @@ WorkoutWidget::recompute(bool editing)
         while (ctime < p->x) {
             cwatts += ramp;
             ctime++;
-            wattsArray << int(cwatts);
+            samples << int(cwatts);
         }
 
         cwatts = p->y;
@@ -1583,136 +1600,38 @@ WorkoutWidget::recompute(bool editing)
     if (maxY_ < maxy) maxY_ = maxy *1.5; // too small
     if (maxy == 0) maxY_ = 400;
 
-    //
-    // COMPUTE KEY METRICS TSS/IF
-    //
-
-    // The Workout Window has labels for TSS and IF.
-    double NP=0, TSS=0, IF=0;
-
-    // calculating NP
-    QVector<int> NProlling(30);
-    NProlling.fill(0,30);
-    double NPtotal=0;
-    double NPsum=0;
-    int NPindex=0;
-    int NPcount=0;
-
-    foreach(int watts, wattsArray) {
-
-        //
-        // Normalised Power
-        //
-
-        // sum last 30secs
-        NPsum += watts;
-        NPsum -= NProlling[NPindex];
-        NProlling[NPindex] = watts;
-
-        // running total and count
-        NPtotal += pow(NPsum/30,4); // raise rolling average to 4th power
-        NPcount ++;
-
-        // it moves up and down during the ride
-        if (NPcount > 30) {
-            NP = pow(double(NPtotal) / double(NPcount), 0.25f);
-        }
-
-        // move index on/round
-        NPindex = (NPindex >= 29) ? 0 : NPindex+1;
-    }
-
-    // IF.....
-    IF = double(NP) / double(FTP);
-
-    // TSS.....
-    double normWork = NP * NPcount;
-    double rawTSS = normWork * IF;
-    double workInAnHourAtCP = FTP * 3600;
-    TSS = rawTSS / workInAnHourAtCP * 100.0;
-
-    parent->IFlabel->setText(QString("%1 IF").arg(IF, 0, 'f', 2));
-    parent->TSSlabel->setText(QString("%1 TSS").arg(TSS, 0, 'f', 0));
-
     //
     // COMPUTE W'BAL
     //
-    wpBal.setWatts(context, wattsArray, CP, WPRIME);
-
-    //
-    // MEAN MAX [works but need to think about UI]
-    //
-    RideFileCache::fastSearch(wattsArray, mmpArray, mmpOffsets);
-    //qDebug()<<"RECOMPUTE:"<<timer.elapsed()<<"ms"<<wattsArray.count()<<"samples";
+    // only from the first second that changed
+    int from = WorkoutAnalytics::firstChange(wattsArray, samples);
+    wattsArray = samples;
+    wpBal.updateWatts(context, wattsArray, CP, WPRIME, from);
 
     //
-    // SEARCH FOR IMPOSSIBLE TTE SECTIONS
+    // COMPUTE KEY METRICS TSS/IF, MEAN MAX AND TTE
     //
-    QVector<long> integrated;
-    integrated.resize(wattsArray.size());
-    long rt=0;
-    int secs=wattsArray.size();
-    for(int i=0; i<wattsArray.size(); i++) {
-        rt += wattsArray[i];
-        integrated[i] = rt;
-    }
-
-    // clear what we found last time
-    efforts.clear();
-
-    for (int j=0; j<2; j++) {
-
-        // 2 iterations:- 85% sustained, then 100% or higher
-        WWEffort tte; tte.start = tte.duration = 0;
-
-        for (int i=0; i<secs; i++) {
-
-            // start out at 30 minutes and drop back to
-            // 2 minutes, anything shorter and we are done
-            int t = (secs-i-1) > 3600 ? 3600 : secs-i-1;
-
-            while (t > 120) {
+    // When dragging a block only the span that moved needs
+    // recomputing, but if most of the workout changed its just
+    // as quick to recompute it all, which we do in the background
+    // so long workouts don't make editing sluggish
+    analytics.setParameters(CP, FTP, WPRIME);
+    int changed = analytics.diff(wattsArray);
 
-                // calculate the TTE for the joules in the interval
-                // starting at i seconds with duration t
-                // This takes the monod equation p(t) = W'/t + CP and
-                // solves for t, but the added complication of also
-                // accounting for the fact it is expressed in joules
-                // So take Joules = (W'/t + CP) * t and solving that
-                // for t gives t = (Joules - W') / CP
-                double tc = ((integrated[i+t]-integrated[i]) - WPRIME) / CP;
-                // NOTE FOR ABOVE: it is looking at accumulation AFTER this point
-                //                 not FROM this point, so we are looking 1s ahead of i
-                //                 which is why the interval is registered as starting
-                //                 at i+1 in the code below
+    if (analyticsPending || !analytics.isValid() || (changed > 600 && changed*4 > wattsArray.count())) {
 
-                // this is either a TTE or getting very close
-                if (tc >= (j ? t : (t*0.85))) {
+        // anything in progress is now out of date
+        int expected = generation.fetchAndAddOrdered(1) + 1;
+        analyticsPending = true;
 
-                    if (tte.start > (i+1) || (tte.duration+tte.start) < (i+t)) {
+        WorkoutAnalytics job = analytics;
+        job.setCancel(&generation, expected);
+        analyticsWatcher.setFuture(QtConcurrent::run(computeInBackground, job));
 
-                        tte.start = i + 1; // see NOTE above
-                        tte.duration = t;
-                        tte.joules = integrated[i+t]-integrated[i];
-                        tte.quality = tc / double(t);
+    } else if (changed) {
 
-                        // add 100 or more on second round
-                        // quick way of doing overlapping
-                        if ((j && tc >= t) || (!j && tc < t)) efforts << tte;
-                    }
-
-
-                    // move on shorter/harder are just as bad
-                    t=0;
-
-                } else {
-
-                    t = tc;
-                    if (t<120)
-                        t=120;
-                }
-            }
-        }
+        analytics.update();
+        showAnalytics();
     }
 
     // set the properties if not editing
@@ -1726,6 +1645,32 @@ WorkoutWidget::recompute(bool editing)
     parent->setScroller(QPointF(minVX_,maxVX_));
 }
 
+void
+WorkoutWidget::analyticsFinished()
+{
+    WorkoutAnalytics result = analyticsWatcher.result();
+
+    // cancelled, or something else has happened since
+    if (!result.isValid() || !result.isCurrent()) return;
+
+    analytics = result;
+    analytics.setCancel(NULL, 0);
+    analyticsPending = false;
+
+    showAnalytics();
+    repaint();
+}
+
+void
+WorkoutWidget::showAnalytics()
+{
+    mmpArray = analytics.mmp;
+    efforts = analytics.efforts;
+
+    parent->IFlabel->setText(QString("%1 IF").arg(analytics.IF, 0, 'f', 2));
+    parent->TSSlabel->setText(QString("%1 TSS").arg(analytics.TSS, 0, 'f', 0));
+}
+
 // as 1m or 60s etc
 static QString qduration(int t)
 {
@@ -24,6 +24,7 @@
 #include "Athlete.h"
 
 #include "WPrime.h"
+#include "WorkoutAnalytics.h"
 
 #include "RideFile.h"
 #include "Settings.h"
@@ -37,6 +38,8 @@
 #include <QPainterPath>
 #include <QPropertyAnimation>
 #include <QTimer>
+#include <QFutureWatcher>
+#include <QAtomicInt>
 
 #include "../qtsolutions/codeeditor/codeeditor.h"
 
@@ -100,13 +103,6 @@ class WorkoutWidgetCommand
         WorkoutWidget *workoutWidget_;
 };
 
-// TTE efforts
-struct WWEffort {
-    int start, duration, joules;
-    int zone;
-    double quality;
-};
-
 class WorkoutWidget : public QWidget
 {
     Q_OBJECT
@@ -117,6 +113,7 @@ class WorkoutWidget : public QWidget
     public:
 
         WorkoutWidget(WorkoutWindow *parent, Context *context);
+        ~WorkoutWidget();
 
         // qwkode string
         QString qwkcode();
@@ -254,7 +251,7 @@ class WorkoutWidget : public QWidget
         void start();
         void stop();
         void setNow(long);
-        void telemetryUpdate(RealtimeData rtData);
+        void telemetryUpdate(const RealtimeData &rtData);
 
         // and erg file was selected
         void ergFileSelected(ErgFile *);
@@ -271,6 +268,7 @@ class WorkoutWidget : public QWidget
 
         // recompute metrics etc
         void recompute(bool editing=false);
+        void analyticsFinished();
 
         // trap signals
         void configChanged(qint32);
@@ -362,6 +360,13 @@ class WorkoutWidget : public QWidget
         // for computing W'bal
         WPrime wpBal;
 
+        // NP, mean max etc incrementally or in the background
+        void showAnalytics();
+        WorkoutAnalytics analytics;
+        QAtomicInt generation;
+        bool analyticsPending;
+        QFutureWatcher<WorkoutAnalytics> analyticsWatcher;
+
         // sizing
         double IHEIGHT;         // interval gap at bottom (used for TTE warning)
         double THEIGHT;         // top section height (lap markers)
@@ -0,0 +1,215 @@
+#!/usr/bin/python3
+
+#
+# Replay an ANT+ capture (antlog.raw written by the ANTLogger) through a
+# pseudo terminal, so the ANT driver can be run against it without a stick.
+#
+# Creates a pty and prints the name of the device to use in GoldenCheetah
+# (or links it to --link), then writes the received ('R') messages from the
+# capture to it with their original timing, scaled by --speed. Whatever the
+# driver sends to the "stick" is read and thrown away.
+#
+# To exercise the receive buffer and frame resync, messages can be written
+# in random pieces (--split) and a percentage of them damaged (--corrupt) by
+# flipping a byte, dropping a byte or adding junk that includes a false sync
+# byte. With --compare the driver's own antlog.raw from the session is checked
+# against what was sent: every message that wasn't flipped or cut short should
+# have arrived, in order, and nothing else should have.
+#
+#   antreplay.py [--speed=1] [--split] [--corrupt=0] [--seed=1]
+#                [--link=/tmp/ttyANT] [--compare=received.raw] antlog.raw
+#
+# e.g. antreplay.py --speed=4 --split --corrupt=5 --link=/tmp/ttyANT antlog.raw
+#
+# or, after the session, just compare (same --corrupt and --seed as replayed)
+#
+#   antreplay.py --corrupt=5 --compare=~/athlete/logs/antlog.raw antlog.raw
+#
+
+import os
+import pty
+import random
+import select
+import struct
+import sys
+import time
+import tty
+
+SYNC = 0xA4
+RECORD = 21     # RS, 8 byte timestamp, 12 bytes of message
+
+def usage():
+    sys.stderr.write("usage: antreplay.py [--speed=1] [--split] [--corrupt=0] [--seed=1]\n")
+    sys.stderr.write("                    [--link=path] [--compare=received.raw] antlog.raw\n")
+    sys.exit(1)
+
+# the received messages in a capture as (millis, frame), with the checksum
+# put back since the logger doesn't keep it
+def messages(filename, direction=b"R"):
+    returning = []
+    with open(filename, "rb") as f:
+        data = f.read()
+    for offset in range(0, len(data) - RECORD + 1, RECORD):
+        rs = data[offset:offset+1]
+        millis = struct.unpack("<Q", data[offset+1:offset+9])[0]
+        message = data[offset+9:offset+RECORD]
+        if rs != direction or message[0] != SYNC: continue
+        length = message[1]
+        if length == 0 or length + 3 > len(message): continue
+        frame = bytearray(message[:length+3])
+        checksum = 0
+        for b in frame: checksum ^= b
+        frame.append(checksum)
+        returning.append((millis, bytes(frame)))
+    return returning
+
+# damage a frame, returns the bytes to send instead and if the frame itself
+# should still get through (junk in front of it should just be skipped)
+def damage(frame, rng):
+    frame = bytearray(frame)
+    how = rng.randrange(3)
+    if how == 0:
+        # flip a bit somewhere, checksum will fail
+        i = rng.randrange(len(frame))
+        frame[i] ^= 1 << rng.randrange(8)
+    elif how == 1:
+        # lose a byte, the next frame starts early
+        del frame[rng.randrange(len(frame))]
+    else:
+        # junk in front, with a false sync and length
+        junk = bytearray(rng.randrange(256) for i in range(rng.randrange(1, 6)))
+        junk[0] = SYNC
+        return bytes(junk + frame), True
+    return bytes(frame), False
+
+# decide what to send for each message, repeatable for a given seed
+def plan(frames, options):
+    rng = random.Random(options["seed"])
+    returning = []
+    for millis, frame in frames:
+        if rng.random() * 100.0 < options["corrupt"]:
+            data, intact = damage(frame, rng)
+        else:
+            data, intact = frame, True
+        returning.append((millis, frame, data, intact))
+    return returning
+
+def replay(planned, options):
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    name = os.ttyname(slave)
+
+    if options["link"]:
+        if os.path.islink(options["link"]): os.unlink(options["link"])
+        os.symlink(name, options["link"])
+        name = options["link"]
+
+    print("replaying %d messages on %s" % (len(planned), name))
+    print("waiting for the driver to open it and send something ...")
+
+    # the driver resets the stick first, wait for that
+    select.select([master], [], [])
+    os.read(master, 4096)
+
+    rng = random.Random(options["seed"] + 1)
+    start = time.time()
+    first = planned[0][0] if planned else 0
+    sent = 0
+
+    for millis, frame, data, intact in planned:
+
+        # original timing
+        if options["speed"] > 0:
+            due = start + (millis - first) / 1000.0 / options["speed"]
+            while True:
+                wait = due - time.time()
+                if wait <= 0: break
+                ready, _, _ = select.select([master], [], [], wait)
+                if ready: os.read(master, 4096)
+
+        # in pieces, so the driver sees partial frames
+        if options["split"]:
+            i = 0
+            while i < len(data):
+                n = rng.randrange(1, len(data) - i + 1)
+                os.write(master, data[i:i+n])
+                i += n
+                time.sleep(rng.random() * 0.002)
+        else:
+            os.write(master, data)
+
+        sent += len(data)
+
+        # keep draining what the driver sends
+        ready, _, _ = select.select([master], [], [], 0)
+        if ready: os.read(master, 4096)
+
+    damaged = sum(1 for p in planned if p[2] != p[1])
+    print("sent %d messages, %d damaged, %d bytes in %.1fs" % (len(planned), damaged, sent, time.time() - start))
+
+    # leave it open so the driver doesn't see a hangup mid-message
+    sys.stdout.write("done, press return to close the pty\n")
+    sys.stdin.readline()
+
+    if options["link"]: os.unlink(options["link"])
+    os.close(slave)
+    os.close(master)
+
+# check the driver got every intact message in order, and nothing else
+def compare(planned, received):
+    expected = [frame for millis, frame, data, intact in planned if intact]
+    got = [frame for millis, frame in received]
+
+    # the driver's log also has whatever the stick said before and after
+    # the replay, so line up on the first message we expect
+    i = 0
+    while i < len(got) and expected and got[i] != expected[0]: i += 1
+
+    matched, missing, unexpected = 0, 0, 0
+    e = 0
+    while e < len(expected) and i < len(got):
+        if got[i] == expected[e]:
+            matched += 1
+            e += 1
+            i += 1
+        elif expected[e] in got[i:i+16]:
+            unexpected += 1         # a frame the damage made up
+            i += 1
+        else:
+            missing += 1            # lost one we shouldn't have
+            e += 1
+    missing += len(expected) - e
+
+    print("expected %d, received %d, missing %d, unexpected %d" % (len(expected), matched, missing, unexpected))
+    return missing == 0 and unexpected == 0
+
+def main():
+    options = { "speed": 1.0, "split": False, "corrupt": 0.0, "seed": 1, "link": "", "compare": "" }
+    files = []
+
+    for arg in sys.argv[1:]:
+        if arg == "--split":
+            options["split"] = True
+        elif arg.startswith("--"):
+            name, _, value = arg[2:].partition("=")
+            if name not in options or value == "": usage()
+            if name in ("link", "compare"): options[name] = os.path.expanduser(value)
+            elif name == "seed": options[name] = int(value)
+            else: options[name] = float(value)
+        else:
+            files.append(arg)
+
+    if len(files) != 1: usage()
+
+    planned = plan(messages(files[0]), options)
+    if not planned:
+        sys.stderr.write("no received messages in %s\n" % files[0])
+        sys.exit(1)
+
+    if options["compare"]:
+        if not compare(planned, messages(options["compare"])): sys.exit(2)
+    else:
+        replay(planned, options)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,192 @@
+#!/usr/bin/python3
+
+#
+# Load test the GoldenCheetah API web-services (GoldenCheetah --server)
+#
+# Opens a number of keep-alive connections to a server on this machine and
+# has each of them fetch the paths given, over and over, optionally sending
+# several requests before reading the responses (pipelining). Reports the
+# throughput, latency and any errors.
+#
+# Only local servers can be tested, this is not for hitting other people's.
+#
+#   httpload.py [--port=12021] [--connections=50] [--requests=100]
+#               [--pipeline=1] [--close] path [path ...]
+#
+# e.g. httpload.py --connections=200 /Mark /Mark/meanmax/bests /Fred/zones
+#
+
+import socket
+import sys
+import threading
+import time
+
+LOCAL = ("127.0.0.1", "::1", "localhost")
+
+def usage():
+    sys.stderr.write("usage: httpload.py [--host=127.0.0.1] [--port=12021] [--connections=50]\n")
+    sys.stderr.write("                   [--requests=100] [--pipeline=1] [--close] path [path ...]\n")
+    sys.exit(1)
+
+# read one response from the socket, returns (status, body length, closing)
+def response(sock, buffer):
+
+    def fill():
+        data = sock.recv(65536)
+        if not data: raise IOError("connection closed by server")
+        buffer.extend(data)
+
+    def line():
+        while b"\r\n" not in buffer: fill()
+        i = buffer.index(b"\r\n")
+        text = bytes(buffer[:i])
+        del buffer[:i+2]
+        return text
+
+    def take(n):
+        while len(buffer) < n: fill()
+        data = bytes(buffer[:n])
+        del buffer[:n]
+        return data
+
+    status = int(line().split()[1])
+    headers = {}
+    while True:
+        text = line()
+        if not text: break
+        name, _, value = text.partition(b":")
+        headers[name.strip().lower()] = value.strip()
+
+    length = 0
+    if headers.get(b"transfer-encoding", b"").lower() == b"chunked":
+        while True:
+            size = int(line().split(b";")[0], 16)
+            if size == 0:
+                line()
+                break
+            length += len(take(size))
+            line()
+    elif b"content-length" in headers:
+        length = len(take(int(headers[b"content-length"])))
+    else:
+        # body ends when the server closes
+        while True:
+            data = sock.recv(65536)
+            if not data: break
+            length += len(data)
+        headers[b"connection"] = b"close"
+
+    return status, length, headers.get(b"connection", b"").lower() == b"close"
+
+class Client(threading.Thread):
+
+    def __init__(self, options, paths, offset):
+        threading.Thread.__init__(self)
+        self.options = options
+        self.paths = paths
+        self.offset = offset
+        self.latencies = []
+        self.statuses = {}
+        self.errors = []
+        self.bytes = 0
+        self.connects = 0
+
+    def connect(self):
+        self.connects += 1
+        sock = socket.create_connection((self.options["host"], self.options["port"]), timeout=120)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return sock
+
+    def run(self):
+        sock, buffer = None, bytearray()
+        remaining = self.options["requests"]
+        n = self.offset
+        while remaining > 0:
+            try:
+                if sock is None:
+                    sock, buffer = self.connect(), bytearray()
+
+                # send a batch, then read the responses in order
+                batch = min(self.options["pipeline"], remaining)
+                request = b""
+                for i in range(batch):
+                    path = self.paths[(n + i) % len(self.paths)]
+                    request += ("GET %s HTTP/1.1\r\nHost: %s\r\n" % (path, self.options["host"])).encode()
+                    if self.options["close"]: request += b"Connection: close\r\n"
+                    request += b"\r\n"
+                start = time.time()
+                sock.sendall(request)
+
+                for i in range(batch):
+                    status, length, closed = response(sock, buffer)
+                    self.latencies.append(time.time() - start)
+                    self.statuses[status] = self.statuses.get(status, 0) + 1
+                    self.bytes += length
+                    if closed or self.options["close"]:
+                        sock.close()
+                        sock = None
+                        batch = i + 1
+                        break
+
+                n += batch
+                remaining -= batch
+
+            except (IOError, OSError, ValueError) as error:
+                self.errors.append(str(error))
+                remaining -= 1
+                if sock is not None: sock.close()
+                sock = None
+
+        if sock is not None: sock.close()
+
+def main():
+    options = { "host": "127.0.0.1", "port": 12021, "connections": 50,
+                "requests": 100, "pipeline": 1, "close": False }
+    paths = []
+
+    for arg in sys.argv[1:]:
+        if arg == "--close":
+            options["close"] = True
+        elif arg.startswith("--"):
+            name, _, value = arg[2:].partition("=")
+            if name not in options or value == "": usage()
+            options[name] = value if name == "host" else int(value)
+        else:
+            paths.append(arg if arg.startswith("/") else "/" + arg)
+
+    if not paths: usage()
+
+    # local clients only
+    if options["host"] not in LOCAL:
+        address = socket.gethostbyname(options["host"])
+        if not address.startswith("127."):
+            sys.stderr.write("refusing to load test %s, local servers only\n" % options["host"])
+            sys.exit(1)
+
+    clients = [Client(options, paths, i) for i in range(options["connections"])]
+    start = time.time()
+    for client in clients: client.start()
+    for client in clients: client.join()
+    elapsed = time.time() - start
+
+    latencies = sorted(l for c in clients for l in c.latencies)
+    statuses = {}
+    for c in clients:
+        for status, count in c.statuses.items(): statuses[status] = statuses.get(status, 0) + count
+    errors = [e for c in clients for e in c.errors]
+
+    def percentile(p):
+        if not latencies: return 0
+        return latencies[min(len(latencies) - 1, int(len(latencies) * p / 100.0))] * 1000.0
+
+    print("connections  %d (%d opened), pipeline %d" % (options["connections"], sum(c.connects for c in clients), options["pipeline"]))
+    print("requests     %d in %.2fs, %.1f/s" % (len(latencies), elapsed, len(latencies) / elapsed if elapsed else 0))
+    print("received     %.1f MB" % (sum(c.bytes for c in clients) / 1048576.0))
+    print("latency ms   p50 %.1f  p95 %.1f  p99 %.1f  max %.1f" % (percentile(50), percentile(95), percentile(99), percentile(100)))
+    print("status       %s" % ", ".join("%d: %d" % (s, statuses[s]) for s in sorted(statuses)))
+    if errors:
+        print("errors       %d, e.g. %s" % (len(errors), errors[0]))
+        sys.exit(2)
+
+if __name__ == "__main__":
+    main()
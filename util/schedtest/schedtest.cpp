@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+//
+// Exercises CloudServiceScheduler against a folder, the way LocalFileStore
+// works, checking it keeps the right number of transfers in flight, sticks
+// to the rate limit, backs off and retries downloads, and doesn't send an
+// upload again after it timed out.
+//
+//   cd util/schedtest && qmake && make && ./schedtest
+//
+// The rate limit check has to wait for a minute to go by, --quick skips it.
+//
+
+#include "stubs.h"
+
+#include "../../src/Cloud/CloudServiceScheduler.cpp"
+#include "moc_CloudServiceScheduler.cpp"
+
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QSet>
+
+#include <stdio.h>
+
+Settings *appsettings = new Settings;
+
+//
+// A local folder, as LocalFileStore, that can also be made to take a while,
+// never answer, or come back empty
+//
+class TestStore : public CloudService
+{
+    public:
+
+        TestStore(QString path) : path(path), delay(0), max(4), perMinute(0), inflight(0), peak(0) { clock.start(); }
+
+        bool writeFile(QByteArray &data, QString remotename, RideFile *) {
+            called(remotename);
+            if (silent.contains(remotename)) return true;
+
+            // LocalFileStore completes inside the call and doesn't name it
+            if (delay == 0) {
+                bool ok = save(data, remotename);
+                inflight--;
+                emit writeComplete("", ok ? "Completed." : "Write failed");
+                return ok;
+            }
+
+            QByteArray copy = data;
+            QTimer::singleShot(delay, this, [this, copy, remotename]() {
+                bool ok = save(copy, remotename);
+                inflight--;
+                emit writeComplete(remotename, ok ? "Completed." : "Write failed");
+            });
+            return true;
+        }
+
+        bool readFile(QByteArray *data, QString remotename, QString) {
+            called(remotename);
+            if (silent.contains(remotename)) return true;
+
+            if (delay == 0) {
+                load(data, remotename);
+                inflight--;
+                emit readComplete(data, remotename, "Completed.");
+                return true;
+            }
+
+            QTimer::singleShot(delay, this, [this, data, remotename]() {
+                load(data, remotename);
+                inflight--;
+                emit readComplete(data, remotename, "Completed.");
+            });
+            return true;
+        }
+
+        int maxTransfers() const { return max; }
+        int transfersPerMinute() const { return perMinute; }
+
+        QString path;
+        int delay, max, perMinute;
+
+        QSet<QString> silent;           // never answer
+        QHash<QString, int> empty;      // come back empty this many times
+
+        // what we saw
+        int inflight, peak;
+        QElapsedTimer clock;
+        QList<qint64> starts;
+        QHash<QString, QList<qint64> > calls;
+
+    private:
+
+        void called(QString name) {
+            qint64 now = clock.elapsed();
+            starts << now;
+            calls[name] << now;
+            if (++inflight > peak) peak = inflight;
+        }
+
+        bool save(const QByteArray &data, QString name) {
+            QFile file(path + "/" + name);
+            if (!file.open(QFile::WriteOnly)) return false;
+            return file.write(data) == data.size();
+        }
+
+        void load(QByteArray *data, QString name) {
+            if (empty.value(name) > 0) {
+                empty[name]--;
+                return;
+            }
+            QFile file(path + "/" + name);
+            if (file.open(QFile::ReadOnly)) *data = file.readAll();
+        }
+};
+
+static int failures = 0;
+
+static void
+check(bool ok, QString what)
+{
+    fprintf(stderr, "  %s %s\n", ok ? "ok  " : "FAIL", what.toLocal8Bit().constData());
+    if (!ok) failures++;
+}
+
+// what came back from the scheduler
+struct Results
+{
+    QHash<int, bool> uploaded, downloaded;
+    QHash<int, QString> messages;
+    QHash<int, QList<int> > retries;
+};
+
+static void
+run(CloudServiceScheduler &scheduler, Results &results)
+{
+    QObject::connect(&scheduler, &CloudServiceScheduler::uploaded, [&results](int id, bool success, QString message) {
+        results.uploaded.insert(id, success);
+        results.messages.insert(id, message);
+    });
+    QObject::connect(&scheduler, &CloudServiceScheduler::downloaded, [&results](int id, RideFile *ride, QStringList errors) {
+        results.downloaded.insert(id, ride != NULL && !ride->content.isEmpty());
+        results.messages.insert(id, errors.join(" "));
+    });
+    QObject::connect(&scheduler, &CloudServiceScheduler::retrying, [&results](int id, int attempt) {
+        results.retries[id] << attempt;
+    });
+
+    // don't hang if it never finishes
+    QEventLoop loop;
+    QTimer guard;
+    guard.setSingleShot(true);
+    QObject::connect(&scheduler, SIGNAL(finished()), &loop, SLOT(quit()));
+    QObject::connect(&guard, SIGNAL(timeout()), &loop, SLOT(quit()));
+    guard.start(3 * 60 * 1000);
+
+    scheduler.start();
+    if (scheduler.isRunning()) loop.exec();
+
+    check(!scheduler.isRunning(), "finished");
+}
+
+static QString
+activity(int i)
+{
+    return QString("2018_01_01_00_%1_00").arg(i, 2, 10, QLatin1Char('0'));
+}
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    bool quick = app.arguments().contains("--quick");
+
+    QTemporaryDir local, remote;
+    AthleteDirectoryStructure home(local.path());
+    Athlete athlete;
+    athlete.home = &home;
+    Context context;
+    context.athlete = &athlete;
+
+    for (int i=0; i<20; i++) {
+        QFile file(local.path() + "/" + activity(i) + ".json");
+        file.open(QFile::WriteOnly);
+        file.write(QString("{ \"activity\" : %1 }").arg(i).toUtf8());
+    }
+
+    fprintf(stderr, "local store, completes inside the call\n");
+    {
+        TestStore store(remote.path());
+        CloudServiceScheduler scheduler(&context, &store);
+        for (int i=0; i<20; i++) scheduler.upload(i, activity(i) + ".json");
+        for (int i=0; i<20; i++) scheduler.download(100+i, activity(i) + ".json", "");
+
+        Results results;
+        run(scheduler, results);
+
+        check(results.uploaded.count() == 20 && !results.uploaded.values().contains(false), "all uploaded");
+        check(results.downloaded.count() == 20 && !results.downloaded.values().contains(false), "all downloaded");
+        check(store.peak == 1, "one at a time");
+        check(QFile::exists(remote.path() + "/" + activity(19) + ".json"), "in the folder");
+    }
+
+    fprintf(stderr, "parallel transfers\n");
+    {
+        appsettings->setValue(GC_CLOUD_TRANSFERS, 3);
+
+        TestStore store(remote.path());
+        store.delay = 300;
+        store.max = 8;
+        CloudServiceScheduler scheduler(&context, &store);
+        for (int i=0; i<20; i++) scheduler.download(i, activity(i) + ".json", "");
+
+        Results results;
+        run(scheduler, results);
+
+        check(scheduler.parallel() == 3, "uses the setting");
+        check(store.peak == 3, QString("3 in flight (saw %1)").arg(store.peak));
+        check(results.downloaded.count() == 20 && !results.downloaded.values().contains(false), "all downloaded");
+
+        // and never more than the service allows
+        appsettings->setValue(GC_CLOUD_TRANSFERS, 16);
+        CloudServiceScheduler limited(&context, &store);
+        check(limited.parallel() == 8, "limited by the service");
+    }
+
+    fprintf(stderr, "retry and back off\n");
+    {
+        appsettings->setValue(GC_CLOUD_TRANSFERS, 4);
+
+        TestStore store(remote.path());
+        store.delay = 50;
+        store.empty.insert(activity(1) + ".json", 2);     // works on the third go
+        store.empty.insert(activity(2) + ".json", 10);    // never does
+        CloudServiceScheduler scheduler(&context, &store);
+        for (int i=0; i<4; i++) scheduler.download(i, activity(i) + ".json", "");
+
+        Results results;
+        run(scheduler, results);
+
+        QList<qint64> calls = store.calls.value(activity(1) + ".json");
+        check(results.downloaded.value(1) && results.retries.value(1) == (QList<int>() << 1 << 2), "retried twice then worked");
+        check(calls.count() == 3 && calls[1] - calls[0] >= 2000 && calls[2] - calls[1] >= 4000, "waited 2s then 4s");
+        check(!results.downloaded.value(2) && store.calls.value(activity(2) + ".json").count() == 3, "gave up after 3 attempts");
+        check(results.downloaded.value(0) && results.downloaded.value(3), "others unaffected");
+    }
+
+    fprintf(stderr, "upload times out\n");
+    {
+        TestStore store(remote.path());
+        store.delay = 50;
+        store.silent.insert(activity(5) + ".json");
+        CloudServiceScheduler scheduler(&context, &store);
+        scheduler.setTimeout(2000);
+        for (int i=0; i<8; i++) scheduler.upload(i, activity(i) + ".json");
+
+        Results results;
+        run(scheduler, results);
+
+        check(!results.uploaded.value(5) && results.retries.value(5).isEmpty(), "reported, not retried");
+        check(store.calls.value(activity(5) + ".json").count() == 1, "only sent once");
+        check(results.uploaded.count() == 8 && results.uploaded.values().count(true) == 7, "others uploaded");
+    }
+
+    if (!quick) {
+        fprintf(stderr, "rate limit, this takes a minute\n");
+
+        TestStore store(remote.path());
+        store.delay = 50;
+        store.perMinute = 5;
+        CloudServiceScheduler scheduler(&context, &store);
+        for (int i=0; i<7; i++) scheduler.download(i, activity(i) + ".json", "");
+
+        Results results;
+        run(scheduler, results);
+
+        check(store.starts.count() == 7 && store.starts[4] - store.starts[0] < 2000, "first 5 straight away");
+        check(store.starts.count() == 7 && store.starts[5] - store.starts[0] >= 59000, "6th a minute after the 1st");
+        check(results.downloaded.count() == 7 && !results.downloaded.values().contains(false), "all downloaded");
+    }
+
+    fprintf(stderr, failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
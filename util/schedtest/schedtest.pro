@@ -0,0 +1,16 @@
+#
+# Harness for the cloud sync scheduler, see schedtest.cpp
+#
+# The real headers are only found so their include guards can skip them,
+# stubs.h provides what the scheduler actually uses.
+#
+TEMPLATE = app
+TARGET = schedtest
+CONFIG += console c++11
+CONFIG -= app_bundle
+QT = core concurrent
+
+INCLUDEPATH += ../../src/Cloud ../../src/Core ../../src/FileIO ../../src/Charts
+
+HEADERS += stubs.h ../../src/Cloud/CloudServiceScheduler.h
+SOURCES += schedtest.cpp
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2018 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_schedtest_stubs_h
+#define _GC_schedtest_stubs_h 1
+
+//
+// Just enough of GoldenCheetah for CloudServiceScheduler.cpp to compile
+//
+// The include guards of the real headers are defined here so when the
+// scheduler is compiled in after this they are skipped and it gets these
+// instead. Activities are just the bytes of the file.
+//
+#define _GC_GoldenCheetah_h
+#define GC_CloudService_h
+#define _GC_Context_h
+#define _GC_Athlete_h
+#define _RideFile_h
+#define _GC_Settings_h
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVariant>
+#include <QHash>
+#include <QFile>
+#include <QDir>
+
+#define GC_CLOUD_TRANSFERS "<system>cloud/transfers"
+
+class Settings
+{
+    public:
+        QVariant value(const QObject *, QString key, QVariant def = QVariant()) const { return values.value(key, def); }
+        void setValue(QString key, QVariant value) { values.insert(key, value); }
+
+    private:
+        QHash<QString, QVariant> values;
+};
+extern Settings *appsettings;
+
+class AthleteDirectoryStructure
+{
+    public:
+        AthleteDirectoryStructure(QString path) : path(path) {}
+        QDir activities() { return QDir(path); }
+
+    private:
+        QString path;
+};
+
+class Athlete
+{
+    public:
+        AthleteDirectoryStructure *home;
+};
+
+class Context
+{
+    public:
+        Athlete *athlete;
+};
+
+class RideFile
+{
+    public:
+        QByteArray content;
+};
+
+// called from the worker threads, only reads the file
+class RideFileFactory
+{
+    public:
+        static RideFileFactory &instance() { static RideFileFactory factory; return factory; }
+
+        RideFile *openRideFile(Context *, QFile &file, QStringList &errors) {
+            if (!file.open(QFile::ReadOnly)) {
+                errors << QString("Could not open %1").arg(file.fileName());
+                return NULL;
+            }
+            RideFile *ride = new RideFile;
+            ride->content = file.readAll();
+            return ride;
+        }
+};
+
+class CloudService : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        virtual ~CloudService() {}
+
+        virtual bool writeFile(QByteArray &data, QString remotename, RideFile *ride) = 0;
+        virtual bool readFile(QByteArray *data, QString remotename, QString remoteid) = 0;
+
+        virtual int maxTransfers() const { return 4; }
+        virtual int transfersPerMinute() const { return 0; }
+
+        // no compression, called from the worker threads
+        void compressRide(RideFile *ride, QByteArray &data, QString) { data = ride->content; }
+        RideFile *uncompressRide(QByteArray *data, QString, QStringList &) {
+            RideFile *ride = new RideFile;
+            ride->content = *data;
+            return ride;
+        }
+        QString uploadExtension() { return ".json"; }
+
+    signals:
+        void writeComplete(QString id, QString message);
+        void readComplete(QByteArray *data, QString id, QString message);
+};
+
+#endif // _GC_schedtest_stubs_h